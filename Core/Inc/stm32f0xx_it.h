@@ -54,7 +54,9 @@ void PendSV_Handler(void);
 void SysTick_Handler(void);
 void EXTI0_1_IRQHandler(void);
 void DMA1_Channel2_3_IRQHandler(void);
+void DMA1_Channel4_5_IRQHandler(void);
 void TIM6_DAC_IRQHandler(void);
+void I2C1_IRQHandler(void);
 /* USER CODE BEGIN EFP */
 
 /* USER CODE END EFP */
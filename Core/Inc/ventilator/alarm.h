@@ -11,14 +11,76 @@
 
 #ifndef INC_VENTILATOR_ALARM_H_
 #define INC_VENTILATOR_ALARM_H_
+#include <stddef.h>
 #include <ventilator/types.h>
 #include <ventilator/sound.h>
 
+/**
+ * Index of a NumericalValue within NumericalValues, used to refer to values from the alarm table.
+ */
+#define ALARM_VALUE(FIELD) (offsetof(NumericalValues, FIELD) / sizeof(NumericalValue))
+
+/**
+ * Index of an Alarm within Alarms, and of its entry in the alarm table.
+ */
+#define ALARM_INDEX(FIELD) (offsetof(Alarms, FIELD) / sizeof(Alarm))
+
+/**
+ * Alarm constants.
+ */
+enum AlarmConstants {
+    ALARM_COUNT = sizeof(Alarms) / sizeof(Alarm) // Alarms, in Alarms order in the alarm table
+};
+
+/**
+ * AlarmCheck:
+ *
+ * Condition tripping an alarm, comparing the measured value of its descriptor with the setpoint and thresholds of the
+ * reference value.
+ */
+typedef enum {
+    ALARM_CHECK_NONE = 0,             // Not detected, set by other modules
+    ALARM_CHECK_BELOW_DISCONNECT,     // Measured below DISCONNECT_CMH20_CAP
+    ALARM_CHECK_OUTSIDE_THRESHOLDS,   // Measured outside the reference setpoint plus its lower or upper threshold
+    ALARM_CHECK_ABOVE_THRESHOLD,      // Measured above the reference setpoint plus its upper threshold
+    ALARM_CHECK_OUTSIDE_TEN_PERCENT,  // Measured more than ten percent away from the reference setpoint
+    ALARM_CHECK_OUTSIDE_RATES,        // Measured above its own setpoint, or below the reference setpoint
+    ALARM_CHECK_LOW_BATTERY,          // Low battery input asserted
+    ALARM_CHECK_SOFTWARE_FAULT        // A software assert has occurred
+} AlarmCheck;
+
+/**
+ * AlarmDescriptor:
+ *
+ * Entry of the constant alarm table, describing when an alarm trips and how long it takes to set and latch.
+ */
+typedef struct {
+    uint8_t check;       // AlarmCheck
+    uint8_t measured;    // ALARM_VALUE of the measured value
+    uint8_t reference;   // ALARM_VALUE of the value holding the setpoint and thresholds
+    uint8_t shift;       // DisplayAlarmShifts of the alarm LED, and of its bit in the AlarmMasks
+    uint16_t trip_time;  // Trip time (set time) in counts
+    uint16_t latch_time; // Latch time in counts
+} AlarmDescriptor;
+
+/**
+ * AlarmMasks:
+ *
+ * Aggregate state of the alarms, one bit per alarm at its DisplayAlarmShifts position. Kept up to date by the alarm module
+ * as the alarm statuses change, so the display and sound read the state of all alarms at once.
+ */
+typedef struct {
+    uint16_t visible;  // LED lit, neither off nor in the off phase of a blink
+    uint16_t sounding; // State machine asked for a tone on its last run
+    uint16_t latched;  // ALARM_LATCH
+    uint16_t blinking; // ALARM_BLINK_ON or ALARM_BLINK_OFF
+} AlarmMasks;
+
 /**
  * alarm_clear:
  *
- * Clears the alarm status. This will call "alarm_silence" and then will clear any latched alarms. Sound will remain off per "alarm_silence"
- * but set and latch counts of the alarms will continue to count, and possibly re-latch.
+ * Clears the alarm status. This will call "alarm_silence" and then will clear all alarms and their counts at once. Sound will remain off
+ * per "alarm_silence" but set and latch counts of the alarms will continue to count, and possibly re-latch.
  *
  * Alarms* alarms: alarms object to read and update.
  */
@@ -38,7 +100,8 @@ void alarm_silence();
  *
  * Detect any new alarms. An alarm condition that has been detected will increment the count of the alarm.  When the count goes above
  * the set count of the alarm, the alarm will be "set".  When the alarm goes above the "latch" count of the alarm, the alarm will "latch".
- * Latching takes precedence over setting. Calls "alarm_run" to determine counts, and timing of an alarm.
+ * Latching takes precedence over setting. Each alarm of the alarm table is checked in turn, calling "alarm_run_state" to determine
+ * counts, and timing of an alarm.
  *
  * NumericalValues* values: numerical values used to detect the alarms states for off-nominal conditions
  *
@@ -50,9 +113,29 @@ uint8_t alarm_detect(NumericalValues* values);
  * set and latched states.
  *
  * Alarm* alarm: alarm to walk through the the states
+ * const AlarmDescriptor* descriptor: table entry of the alarm, giving its trip and latch times
  * bool tripped: is the above alarm currently in violation
  */
-uint32_t alarm_run_state(Alarm* alarm, bool tripped);
+uint32_t alarm_run_state(Alarm* alarm, const AlarmDescriptor* descriptor, bool tripped);
+/**
+ * alarm_set_status:
+ *
+ * Set the status of an alarm from outside the alarm state machines, keeping the alarm masks in step. Statuses written
+ * directly are only reflected in the masks after the next "alarm_detect".
+ *
+ * Alarms* alarms: alarms object to update
+ * uint32_t index: ALARM_INDEX of the alarm
+ * AlarmStatus status: new status of the alarm
+ */
+void alarm_set_status(Alarms* alarms, uint32_t index, AlarmStatus status);
+/**
+ * alarm_masks:
+ *
+ * Snapshot of the alarm masks, as of the last change made through the alarm module.
+ *
+ * \return: alarm masks
+ */
+const AlarmMasks* alarm_masks(void);
 /**
  * Runs the alarm module by detecting alarms for new trip states.
  * NumericalValues* values: values to check and alarms object to update:
@@ -0,0 +1,57 @@
+/*
+ * alive_journal.h:
+ *
+ * Wear-leveled journal of the alive-minutes counter. The counter is written once a minute, which would wear out a
+ * single EEPROM page within a few years. Instead each write goes to the next page of a ring of EEPROM_JOURNAL_PAGES
+ * pages as a sequence-numbered entry. Entry N is always stored in page N % EEPROM_JOURNAL_PAGES, so the sequences of
+ * the ring increase by one from the first page up to the newest entry, and the newest entry is found at boot with a
+ * binary search rather than reading every page.
+ */
+
+#ifndef INC_VENTILATOR_ALIVE_JOURNAL_H_
+#define INC_VENTILATOR_ALIVE_JOURNAL_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <ventilator/eeprom.h>
+
+/**
+ * AliveJournalEntry:
+ *
+ * An entry as stored at the start of its page.
+ */
+typedef struct {
+    uint32_t sequence; // Increments with each entry written
+    uint32_t minutes;  // Alive-minutes count
+    uint32_t check;    // ALIVE_JOURNAL_CHECK ^ sequence ^ minutes, detects erased pages and torn writes
+} AliveJournalEntry;
+
+#define ALIVE_JOURNAL_CHECK 0xA11BE5EDu
+#define ALIVE_JOURNAL_ERASED 0xFFFFFFFFu // Legacy record of an EEPROM that was never written
+
+/**
+ * alive_journal_load:
+ *
+ * Find the newest entry of the journal, and return its count. An empty journal is seeded from the legacy
+ * EEPROM_ALIVE_MINUTES record. Reads wait on the I2C queue, so this is only used at initialization.
+ * return: alive-minutes count, 0 if neither the journal nor the legacy record could be read, or both are erased
+ */
+uint32_t alive_journal_load(void);
+
+/**
+ * alive_journal_record:
+ *
+ * Queue a write of the count as the next entry of the journal. Does not wait for the write, which completes over the
+ * following cycles.
+ * uint32_t minutes: alive-minutes count to record
+ * return: EEPROM_OK when queued, EEPROM_BUSY when the previous entry is still being written or the queue is full
+ */
+EepromStatus alive_journal_record(uint32_t minutes);
+
+/**
+ * alive_journal_sequence:
+ *
+ * return: sequence of the next entry to be written
+ */
+uint32_t alive_journal_sequence(void);
+
+#endif /* INC_VENTILATOR_ALIVE_JOURNAL_H_ */
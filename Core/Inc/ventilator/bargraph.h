@@ -22,6 +22,9 @@
 #define BARGRAPH_PRESSURE_HEIGHT 100
 // Height in units of bargraph display
 #define BARGRAPH_DISPLAY_HEIGHT 40
+// Reciprocal of a bargraph height, ceil(2^24 / height). Exact for every scaled value of heights up to 800, see bargraph_test.c
+#define BARGRAPH_RECIPROCAL_SHIFT 24
+#define BARGRAPH_RECIPROCAL(height) ((((uint32_t)1 << BARGRAPH_RECIPROCAL_SHIFT) + (height) - 1) / (height))
 
 /**
  * GreenBarGraph:
@@ -70,6 +73,26 @@ void bargraph_assign_value(GreenBarGraph* bargraph, uint32_t value);
  */
 uint32_t bargraph_scaled_value(int32_t value, int32_t shift, int32_t height);
 
+/**
+ * bargraph_scaled_tidal:
+ *
+ * Scale a tidal volume for the tidal bargraph. Same result as bargraph_scaled_value with BARGRAPH_TIDAL_SHIFT and
+ * BARGRAPH_TIDAL_HEIGHT, but multiplies by the reciprocal of the height rather than dividing.
+ * int32_t value: value to scale to bargraph level
+ * return: value 0-40 in post-scaled units
+ */
+uint32_t bargraph_scaled_tidal(int32_t value);
+
+/**
+ * bargraph_scaled_pressure:
+ *
+ * Scale a pressure for the pressure bargraphs. Same result as bargraph_scaled_value with BARGRAPH_PRESSURE_SHIFT and
+ * BARGRAPH_PRESSURE_HEIGHT, but multiplies by the reciprocal of the height rather than dividing.
+ * int32_t value: value to scale to bargraph level
+ * return: value 0-40 in post-scaled units
+ */
+uint32_t bargraph_scaled_pressure(int32_t value);
+
 /**
  * bargraph_assign_red_green_value:
  *
@@ -86,6 +109,25 @@ void bargraph_assign_red_green_value(GreenBarGraph* green, GreenBarGraph* red, u
 
 // **** Internal Representation ****
 
+/**
+ * bargraph_scaled_reciprocal:
+ *
+ * bargraph_scaled_value with the division replaced by a multiply with the reciprocal of the height.
+ * uint32_t reciprocal: BARGRAPH_RECIPROCAL(height)
+ */
+uint32_t bargraph_scaled_reciprocal(int32_t value, int32_t shift, int32_t height, uint32_t reciprocal);
+
+/**
+ * Bargraph words of each level [0, 40], generated into bargraph_table.c by Test/bargraph_generator.c.
+ *
+ * BARGRAPH_LEVEL_TABLE: level fill of a green bargraph, in wire order
+ * BARGRAPH_POINT_TABLE: single point of the red/green green bargraph, in bit order. Level 0 is no point.
+ * BARGRAPH_RED_POINT_TABLE: single point of the red/green red bargraph, in wire order
+ */
+extern const GreenBarGraph BARGRAPH_LEVEL_TABLE[BARGRAPH_DISPLAY_HEIGHT + 1];
+extern const GreenBarGraph BARGRAPH_POINT_TABLE[BARGRAPH_DISPLAY_HEIGHT + 1];
+extern const GreenBarGraph BARGRAPH_RED_POINT_TABLE[BARGRAPH_DISPLAY_HEIGHT + 1];
+
 /**
  * bargraph_get_u16_helper:
  *
@@ -19,34 +19,55 @@
 #include <ventilator/types.h>
 
 /**
- * ButtonPosState:
+ * ButtonMask:
  *
- * Button position state (on or off).
+ * Bits of the buttons in the expander reading, port B in the high byte. A hardware revision moving the buttons only
+ * changes these.
  */
 typedef enum {
-    BUTTON_POS_OFF, // Button is off
-    BUTTON_POS_ON   // Button is on
-} ButtonPosState;
+    BUTTON_MASK_SET_FIO_ALARM = 0x0080,
+    BUTTON_MASK_SET_PEEP      = 0x0040,
+    BUTTON_MASK_SET_TV        = 0x0020,
+    BUTTON_MASK_SET_BUR       = 0x0010,
+    BUTTON_MASK_SET_PEAK      = 0x0008,
+    BUTTON_MASK_SET_ITIME     = 0x0004,
+    BUTTON_MASK_POWER_DOWN    = 0x2000,
+    BUTTON_MASK_ALRM_SILENCE  = 0x1000,
+    BUTTON_MASK_GET_PLAT      = 0x0800,
+    BUTTON_MASK_ADJ_DWN       = 0x0200,
+    BUTTON_MASK_ADJ_UP        = 0x0100,
+    BUTTON_MASK_ALL = BUTTON_MASK_SET_FIO_ALARM | BUTTON_MASK_SET_PEEP | BUTTON_MASK_SET_TV | BUTTON_MASK_SET_BUR |
+                      BUTTON_MASK_SET_PEAK | BUTTON_MASK_SET_ITIME | BUTTON_MASK_POWER_DOWN | BUTTON_MASK_ALRM_SILENCE |
+                      BUTTON_MASK_GET_PLAT | BUTTON_MASK_ADJ_DWN | BUTTON_MASK_ADJ_UP
+} ButtonMask;
 
 /**
- * ButtonPosState:
+ * PanelButtons:
  *
- * Set of all button positions to track which buttons are pressed, and what are not.
+ * Set of all button positions to track which buttons are pressed, and what are not. A bit is set per button held, in
+ * the expander's bit order (see ButtonMask).
  */
-typedef struct {
-    ButtonPosState SET_FIO_ALRM_B;
-    ButtonPosState SET_PEEP_B;
-    ButtonPosState SET_TV_B;
-    ButtonPosState SET_BUR_B;
-    ButtonPosState SET_PEAK_B;
-    ButtonPosState SET_ITIME_B;
-    ButtonPosState POWER_DOWN_B;
-    ButtonPosState ALRM_SILENCE_B;
-    ButtonPosState GET_PLAT_B;
-    ButtonPosState ADJ_DWN_B;
-    ButtonPosState ADJ_UP_B;
-    ButtonPosState ALL_BUTTONS; //!< borrow for quick overall check
-} PanelButtons;
+typedef uint16_t PanelButtons;
+
+/**
+ * Is any of the masked buttons held.
+ * PanelButtons buttons: button positions
+ * uint16_t mask: ButtonMask bits of the buttons to check
+ * return: true when one of the buttons is held
+ */
+static inline bool panel_button_down(PanelButtons buttons, uint16_t mask) {
+    return (buttons & mask) != 0;
+}
+
+/**
+ * Buttons that were pressed or released between two sets of button positions.
+ * PanelButtons buttons: button positions
+ * PanelButtons last: previous button positions
+ * return: bits of the buttons that changed
+ */
+static inline PanelButtons panel_buttons_changed(PanelButtons buttons, PanelButtons last) {
+    return buttons ^ last;
+}
 
 /**
  * ButtonId:
@@ -68,6 +89,26 @@ typedef enum {
     BUTTON_ID_NUM_BUTTONS,
     BUTTON_NONE
 } ButtonId;
+/**
+ * ButtonEventType:
+ *
+ * Changes of a button position, queued by the detection for the state machines.
+ */
+typedef enum {
+    BUTTON_EVENT_PRESS,  // Button went down
+    BUTTON_EVENT_RELEASE // Button came up
+} ButtonEventType;
+
+/**
+ * ButtonEvent:
+ *
+ * Entry of the button event queue.
+ */
+typedef struct {
+    uint8_t id;   // ButtonId
+    uint8_t type; // ButtonEventType
+} ButtonEvent;
+
 /**
  * ButtonType:
  *
@@ -97,16 +138,27 @@ typedef enum {
     BUTTON_STATE_TIMEOUT,        // Button has timed-out and is returning to IDLE
     BUTTON_STATE_NUM_STATES      // Assertiion check
 } ButtonPressState ;
+/**
+ * ButtonConfig:
+ *
+ * Entry of the constant button table, giving the type of a button, its hold time, and where it is read from the
+ * expander.
+ */
+typedef struct {
+    uint8_t type;     // ButtonType
+    uint8_t reserved;
+    uint16_t mask;    // ButtonMask of the button
+    uint16_t wait;    // wait time for press to hold to complete, in cycles
+} ButtonConfig;
 /**
  * ButtonState:
  *
- * Button state data including type, machine state, counts (for hold and timeout) and wait information.
+ * Button state data including machine state and counts (for hold and timeout). The type and wait information are in
+ * the button table.
  */
 typedef struct {
-    ButtonType type;
     ButtonPressState state;
     uint32_t count; // countdown for press to hold, in cycles
-    uint32_t wait; // wait time for press to hold to complete, in cycles
 } ButtonState;
 /**
  * Initializes button module's state variables.
@@ -114,18 +166,59 @@ typedef struct {
 void init_button_state(void);
 
 /**
- * Detect if a button (any button) has been pressed and fill-out the state for which one was pressed.
+ * Called from the EXTI handler of the button expander INT line. Records the time of the edge, the capture is read
+ * by detect_button_state.
+ */
+void button_interrupt(void);
+
+/**
+ * Detect if a button (any button) has been pressed and fill-out the state for which one was pressed. The expander is
+ * only read after an edge is signaled by its INT line, and a reading is accepted once no edge has been seen for
+ * BUTTON_DEBOUNCE_MS. Otherwise the last debounced reading is used. Reads are queued on the I2C queue, and collected
+ * once complete, normally by the next call.
  * PanelButtons* val: value to record button presses in
- * return: true if *any* button is pressed
+ * return: false on an I2C error, true otherwise
  */
 bool detect_button_state(PanelButtons* val);
 
 /**
- * Using the pressed button states detected in "detect_button_state", run all state machines. Typically
- * only one state machine is active, but this will run all of them anyway.
- * PanelButtons* val: detected button states. Use detect_button_state to fill first.
+ * Decode a debounced expander reading into the button positions, and count how long buttons are held down. Trips a
+ * machine fault once buttons are held for BUTTON_STUCK_CYCLES. Queues a press or release event for each button that
+ * changed since the last reading. Called by detect_button_state, and by the trace replay with a recorded reading, so
+ * the replay regenerates the same event stream.
+ * uint16_t reading: debounced expander reading, port B in the high byte
+ * PanelButtons* val: value to record button presses in
+ */
+void decode_button_state(uint16_t reading, PanelButtons* val);
+
+/**
+ * Take the next button event queued by decode_button_state. The queue has a single producer and a single consumer,
+ * so needs no locking.
+ * ButtonEvent* event: (output) event taken
+ * return: true when an event was taken, false when the queue is empty
+ */
+bool button_event_take(ButtonEvent* event);
+
+/**
+ * Run the state machines and the numerical edits on the queued button events. This is run_buttons past the
+ * detection, so that a recorded reading can be replayed. Returns at once when no events are queued, no button is
+ * held, and no button state machine is out of IDLE.
+ */
+void process_buttons(void);
+
+/**
+ * Debounced reading used by the last run_buttons.
+ * uint16_t* reading: (output) debounced expander reading
+ * return: true when the last run_buttons detected the buttons and processed the reading, false when the read failed
+ */
+bool button_reading(uint16_t* reading);
+
+/**
+ * Using the pressed button states detected in "detect_button_state", run the state machine of the first button held
+ * in ButtonId order, or the release of the active one when none is held.
+ * PanelButtons val: detected button states. Use detect_button_state to fill first.
  */
-void run_button_state_machines(PanelButtons* val);
+void run_button_state_machines(PanelButtons val);
 
 /**
  * Update the button numerical states. This handles MODIFY + adjust up or down MOMENTARTY states to edit
@@ -159,7 +252,7 @@ void run_buttons();
 
 /**
  * Runs special state processing for special case buttons (non-editing). Called from
- * "run_button_state_machines".
+ * "run_button_state_machines", and returns at once while those buttons are IDLE.
  */
 void run_special_button_states();
 
@@ -0,0 +1,112 @@
+/*
+ * command.h:
+ *
+ * Command channel on the debug UART (USART1). The RX DMA runs in circular mode into a ring buffer, and the DMA
+ * counter gives the write index, so receiving takes no interrupts. Commands are frames (see frame.h) from the host,
+ * parsed in place in the ring: the CRC is checked over the ring, and a command's fields are copied out only as it runs.
+ * Each command is answered by a reply frame queued on the telemetry ring. Commands read and set the EEPROM_INIT_*
+ * parameters, so controller tuning no longer needs a reflash, and dump the statistics and the trend log.
+ *
+ * The channel never delays the cycle: at most COMMAND_RX_SIZE bytes are scanned, one frame's CRC is checked, and one
+ * command is run each cycle, replies are dropped rather than waited on, and EEPROM reads are queued and answered on a
+ * later cycle. The host waits for each reply before sending the next command, so the ring never overflows and a frame
+ * stays in place until it has run.
+ */
+
+#ifndef INC_VENTILATOR_COMMAND_H_
+#define INC_VENTILATOR_COMMAND_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <stm32f0xx_hal.h>
+#include <ventilator/eeprom.h>
+#include <ventilator/frame.h>
+
+/**
+ * Command constants.
+ */
+enum CommandConstants {
+    COMMAND_RX_SIZE = 128 // Bytes of the RX ring, longer than any command
+};
+
+/**
+ * CommandStatus:
+ *
+ * Result of a command, sent in its reply.
+ */
+typedef enum {
+    COMMAND_OK = 0,
+    COMMAND_INVALID, // Record or page out of range, or the record is not settable
+    COMMAND_BUSY,    // EEPROM busy, retry the command
+    COMMAND_FAILED   // EEPROM read failed
+} CommandStatus;
+
+/**
+ * CommandParameter:
+ *
+ * Payload of FRAME_TYPE_GET_PARAMETER and FRAME_TYPE_SET_PARAMETER, and of their replies. A set parameter is used by
+ * the controller from the next cycle, and written to the parameter block.
+ */
+typedef struct {
+    uint8_t record;    // EepromRecordId
+    uint8_t status;    // CommandStatus, in replies
+    uint8_t reserved[2];
+    int32_t value;     // Value to set, or the value in replies
+} CommandParameter;
+
+/**
+ * CommandTrendPage:
+ *
+ * Payload of the FRAME_TYPE_GET_TREND_PAGE reply. The command carries only the age.
+ */
+typedef struct {
+    uint16_t age;      // Page to read, 0 being the oldest
+    uint16_t count;    // trend_page_count(), in replies
+    uint8_t status;    // CommandStatus, in replies
+    uint8_t reserved[3];
+    uint8_t data[EEPROM_PAGE_SIZE]; // The page, as decoded by trend_decode
+} CommandTrendPage;
+
+static_assert(sizeof(CommandTrendPage) <= FRAME_PAYLOAD_MAX, "Trend page reply must fit a frame");
+static_assert((COMMAND_RX_SIZE & (COMMAND_RX_SIZE - 1)) == 0, "Command ring size must be a power of two");
+
+/**
+ * command_init:
+ *
+ * Start the RX DMA, and reset the parser.
+ */
+void command_init(void);
+
+/**
+ * command_cycle:
+ *
+ * Called once a cycle to parse received bytes and run a command, or to answer a command waiting on the EEPROM.
+ */
+void command_cycle(void);
+
+/**
+ * command_rejected:
+ *
+ * return: count of frames failing their CRC, and of unknown or malformed commands
+ */
+uint32_t command_rejected(void);
+
+/**
+ * command_dma_start:
+ *
+ * Start the circular RX DMA. Implemented in command_dri.c.
+ * uint8_t* data: ring to receive into
+ * uint16_t size: bytes of the ring
+ * return: HAL_OK when started
+ */
+HAL_StatusTypeDef command_dma_start(uint8_t* data, uint16_t size);
+
+/**
+ * command_dma_remaining:
+ *
+ * Read the DMA counter, and clear any receive errors that would stop reception. Implemented in command_dri.c.
+ * return: bytes left before the DMA wraps to the start of the ring
+ */
+uint16_t command_dma_remaining(void);
+
+#endif /* INC_VENTILATOR_COMMAND_H_ */
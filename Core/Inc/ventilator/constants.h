@@ -27,10 +27,12 @@ typedef enum {
     EDIT_TIMEOUT =          CYCLES_PER_SECOND*60, // One-minute in-action timeout on modify (cycles)
     DISPLAY_BLINK_CYCLES =  CYCLES_PER_SECOND/2,      // Total cycles for the blink period. ~2Hz
     DISPLAY_BLINK_OFF_CYCLES = CYCLES_PER_SECOND/4,   // Number of cycles the display is off. ~250ms
+    DISPLAY_REFRESH_CYCLES = CYCLES_PER_SECOND,       // Cycles between forced rewrites of unchanged display hardware. ~1s
     SOUND_BEEP_DURATION_CYCLES = CYCLES_PER_SECOND/10, // Duration a beep is played for. ~100ms
     SETPOINT_MODIFY_TIMEOUT = CYCLES_PER_SECOND*10, // Ten second timeout while in modify state. Resets each time up/down button is pushed
     FIO2_MODIFY_TIMEOUT = CYCLES_PER_SECOND*60, // Ten second timeout while in modify state. Resets each time up/down button is pushed
-    EEPROM_WRITE_TIMEOUT_CYCLES = 10, // Total number of cycles before an EEPROM write times out
+    EEPROM_WRITE_TIMEOUT_CYCLES = 10, // Total number of cycles (one acknowledge poll each) before an EEPROM write times out
+    PARAMETER_WRITE_BACK_CYCLES = CYCLES_PER_SECOND * 10, // Cycles a changed parameter block is held in RAM before it is written back
     DISCONNECT_CMH20_CAP = 1, // 1cmH20
     BREATH_PERIOD_ADJUSTMENT =  10, // Breath period can be 0-20ms over-measured.  Subtract 10ms to get an average.
     // Thresholding initial constants
@@ -38,7 +40,12 @@ typedef enum {
     PEEP_THRESHOLD_OFFSET = 50, // +/- cmH20
     TIDAL_THRESHOLD_OFFSET = 50, // +/- 3ML
     PEAK_THRESHOLD_OFFSET = 50, // +/- cmH20
-    BUTTON_STUCK_CYCLES = CYCLES_PER_SECOND * 60 // 60 seconds of held down buttons trips a machine fault
+    BUTTON_STUCK_CYCLES = CYCLES_PER_SECOND * 60, // 60 seconds of held down buttons trips a machine fault
+    BUTTON_DEBOUNCE_MS = 10, // Time without button edges before a reading is accepted (ms)
+    BUTTON_READ_FAULT_CYCLES = CYCLES_PER_SECOND, // Consecutive cycles of failed or outstanding expander reads that trip a machine fault
+    BUTTON_EVENT_QUEUE_SIZE = 16, // Button events queued between detection and the state machines, a power of two
+    CONTROLLER_SPI_TIMEOUT_MS = 5, // Time to wait on an exchange with the controller, well within a cycle (ms)
+    MS_PER_MINUTE = 60000 // Converts breaths per minute to breath period (ms)
 
 } PanelConstants;
 
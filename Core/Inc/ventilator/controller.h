@@ -9,11 +9,23 @@
 #include <ventilator/panel_public.h>
 
 /**
- * Performs an update to/from the controller. Runs the actual communication over the SPI interface.
+ * Performs an update to/from the controller. Runs the actual communication over the SPI interface, waiting at most
+ * CONTROLLER_SPI_TIMEOUT_MS. Failures are counted as controlSpiErrors or controlSpiTimeouts, and the longest exchange
+ * is recorded as controlMaxLatency.
+ *
+ * The exchange stays synchronous through if_txrx_packet, which owns the framing and CRC. SPI1 DMA is not used: its
+ * requests are only on DMA1 channels 2 and 3, taken by USART1, which cannot be remapped as channel 5 carries SPI2 TX.
  * return\: HAL_OK on success otherwise error.
  */
 HAL_StatusTypeDef do_controller_cycle(void);
 
+/**
+ * Packet received by the last exchange with the controller. Only processed when the exchange succeeded, as a failed
+ * exchange may leave it partially written.
+ * return\: last received packet, zeroed before the first exchange
+ */
+const controller_packet_t* controller_last_packet(void);
+
 // Internal functions
 
 /**
@@ -25,7 +37,8 @@ int32_t pascal_to_cmh2O(int32_t pascal);
  */
 int32_t cmh2O_to_pascal(int32_t pascal);
 /**
- * Convert breaths-per-minute to ms period. Works in reverse too.
+ * Convert breaths-per-minute to ms period, rounded to nearest. Works in reverse too. Integer only, giving the same
+ * result as the float "(int32_t)(60000.0f/bpm + 0.5f)", with INT32_MAX for 0.
  */
 int32_t bpm_to_ms_period(int32_t bpm);
 /**
@@ -0,0 +1,37 @@
+/*
+ * crc.h:
+ *
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, no reflection) used to protect data stored in the
+ * EEPROM and sent over the debug UART. The CRC of "123456789" is 0x29B1.
+ */
+
+#ifndef INC_VENTILATOR_CRC_H_
+#define INC_VENTILATOR_CRC_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <ventilator/types.h>
+
+#define CRC16_INITIAL 0xFFFF
+
+/**
+ * crc16_update:
+ *
+ * Continue a CRC over more data, allowing a CRC to be built from several buffers.
+ * uint16_t crc: CRC so far, CRC16_INITIAL to start
+ * const uint8_t* data: data to add
+ * uint32_t size: bytes of data
+ * return: updated CRC
+ */
+uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint32_t size);
+
+/**
+ * crc16:
+ *
+ * CRC of a single buffer.
+ * const uint8_t* data: data to check
+ * uint32_t size: bytes of data
+ * return: CRC of the data
+ */
+uint16_t crc16(const uint8_t* data, uint32_t size);
+
+#endif /* INC_VENTILATOR_CRC_H_ */
@@ -73,6 +73,18 @@ typedef enum {
     DISPLAY_ALARM_POWER_OFF_SHIFT  = 3,
 } DisplayAlarmShifts;
 
+/**
+ * Dirty flags for each device that holds part of the display image. A device is only written when its flag is set.
+ */
+typedef enum {
+    DISPLAY_DIRTY_NONE       = 0x0,
+    DISPLAY_DIRTY_SPI        = 0x1, // Shift-register chain
+    DISPLAY_DIRTY_MCP_LOWER  = 0x2, // Red bargraph lower I2C expander
+    DISPLAY_DIRTY_MCP_MIDDLE = 0x4, // Red bargraph middle I2C expander
+    DISPLAY_DIRTY_MCP_UPPER  = 0x8, // Red bargraph upper I2C expander
+    DISPLAY_DIRTY_ALL        = 0xF
+} DisplayDirtyFlags;
+
 /**
  * run_display:
  *
@@ -90,6 +102,14 @@ void run_display(bool force_blank, uint32_t alive_hours);
  */
 void display_init(void);
 
+/**
+ * display_image:
+ *
+ * Image of the display as last filled, the words shifted out and the red bargraph sent by I2C. Used to check a replay.
+ * return: the display
+ */
+const Display* display_image(void);
+
 /**
  * display_machine_fault:
  *
@@ -126,9 +146,27 @@ void display_send_update(NumericalValues *values);
 /**
  * display_raw_send:
  *
- * Send the raw SPI and I2C packets to the display.
+ * Send the raw SPI and I2C packets to the display. Only devices whose part of the image differs from the last
+ * committed image are written, with a forced rewrite of every device each DISPLAY_REFRESH_CYCLES calls. The SPI words
+ * are sent by DMA, and the display is latched by display_transmit_complete when the transfer finishes. The I2C words
+ * are queued on the I2C queue, and a failed write is reported by the next call.
  */
 HAL_StatusTypeDef display_raw_send(void);
 
+/**
+ * display_raw_send_blocking:
+ *
+ * Send the raw SPI and I2C packets to the display, waiting on the SPI and latching immediately. Used as a fallback
+ * when interrupts cannot be trusted (i.e. machine fault).
+ */
+HAL_StatusTypeDef display_raw_send_blocking(void);
+
+/**
+ * display_transmit_complete:
+ *
+ * Called from the SPI transmit-complete interrupt to latch the image sent by display_raw_send.
+ */
+void display_transmit_complete(void);
+
 
 #endif /* INC_VENTILATOR_DISPLAY_H_ */
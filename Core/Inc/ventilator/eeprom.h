@@ -14,7 +14,9 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <ventilator/bargraph.h>
+#include <ventilator/i2c_queue.h>
 
 //!< Define EEPROM records. Each enumeration entry
 //!< corresponds to a 64 byte page on the device.
@@ -22,7 +24,7 @@
 //!< The device will store a 32-bit int on each page.
 
 typedef enum {
-    EEPROM_ALIVE_MINUTES,
+    EEPROM_ALIVE_MINUTES, // Legacy alive-minutes record, now only read to seed an empty alive journal
     EEPROM_INIT_INHALE_SENSITIVITY,
     EEPROM_INIT_BREATH_DETECT_HOLD_OFF,
     EEPROM_INIT_PLATEAU_SAMPLE_OFFSET_TIME,
@@ -52,23 +54,124 @@ typedef enum {
 typedef enum {
     EEPROM_PAGE_SIZE = 64,       // Page size in bytes
     EEPROM_I2C_ADDR = 0x50 << 1, // EEPROM address on I2C bus
+    EEPROM_PAGE_COUNT = 512,     // Pages on the device
+    // Layout of the pages past the records
+    EEPROM_PARAMETER_PAGE = 14,      // CRC protected block of all EEPROM_INIT_* values
+    EEPROM_JOURNAL_FIRST_PAGE = 16,  // First page of the alive-minutes journal
+    EEPROM_JOURNAL_PAGES = 128,      // Pages the alive-minutes journal is spread across
+    EEPROM_TREND_FIRST_PAGE = 144,   // First page of the trend log
+    EEPROM_TREND_PAGES = 368,        // Pages of the trend log ring, the rest of the device
+    EEPROM_WRITE_QUEUE_DEPTH = 4,    // Writes waiting to be programmed
+    EEPROM_WRITE_INLINE_SIZE = 4,    // Writes up to this size are copied into the queue
+    EEPROM_FLUSH_TIMEOUT_MS = 100,   // Time eeprom_flush waits on queued writes (ms)
 } EepromConst;
 
 
 // Protects from over-using EEPROM
 static_assert(EEPROM_NUM_RECORDS < 512, "Too many EEPROM records defined");
+static_assert((int)EEPROM_NUM_RECORDS <= (int)EEPROM_PARAMETER_PAGE, "EEPROM records overlap the parameter block");
+static_assert((EEPROM_JOURNAL_FIRST_PAGE + EEPROM_JOURNAL_PAGES) <= EEPROM_TREND_FIRST_PAGE, "EEPROM journal overlaps the trend log");
+static_assert((EEPROM_TREND_FIRST_PAGE + EEPROM_TREND_PAGES) <= EEPROM_PAGE_COUNT, "EEPROM trend log too large");
 
 /**
- * Read from the eeprom.  Reads a record (of given ID) into the supplied val pointer.
+ * Completion callback of a queued EEPROM write, called once the device has finished programming. May be called from
+ * interrupt context.
+ * EepromStatus status: EEPROM_OK when written, EEPROM_ERROR when the write failed or the device never acknowledged
+ * void* context: context supplied with the write
+ */
+typedef void (*EepromCallback)(EepromStatus status, void* context);
+
+/**
+ * Read from the eeprom.  Reads a record (of given ID) into the supplied val pointer. Waits for queued writes and on the
+ * I2C queue, so it is only used at initialization.
  * const EepromRecordId id: ID to read
  * uint32_t *val: location to read to
  */
 EepromStatus readEeprom(const EepromRecordId id, uint32_t *val);
 /**
- * Write to the eeprom.  Writes a record (of given ID) from the supplied val.
+ * Write to the eeprom.  Writes a record (of given ID) from the supplied val. The write is queued, see eeprom_write_bytes,
+ * so EEPROM_OK means the write was queued. Returns EEPROM_BUSY when the queue is full.
  * const EepromRecordId id: ID to write
  * uint32_t val: value to write out
  */
 EepromStatus writeEeprom(const EepromRecordId id, const uint32_t val);
 
+/**
+ * eeprom_read_bytes:
+ *
+ * Read bytes from an EEPROM address. Waits for queued writes and on the I2C queue, so it is only used at initialization.
+ * uint16_t address: byte address to read from
+ * uint8_t* data: location to read to
+ * uint16_t size: bytes to read
+ * return: EEPROM_OK on success
+ */
+EepromStatus eeprom_read_bytes(uint16_t address, uint8_t* data, uint16_t size);
+
+/**
+ * eeprom_queue_read:
+ *
+ * Queue a read of bytes from an EEPROM address, without waiting. Used during the cycle, when eeprom_read_bytes would
+ * wait on the bus. One read is queued at a time, and only while no write is queued or programming.
+ * uint16_t address: byte address to read from
+ * uint8_t* data: location to read to, must remain valid until the callback
+ * uint16_t size: bytes to read
+ * EepromCallback callback: completion callback, may be NULL
+ * void* context: passed to the callback
+ * return: EEPROM_OK when queued, EEPROM_BUSY when a read or write is pending or the I2C queue is full
+ */
+EepromStatus eeprom_queue_read(uint16_t address, uint8_t* data, uint16_t size, EepromCallback callback, void* context);
+
+/**
+ * eeprom_write_bytes:
+ *
+ * Queue a write of bytes to an EEPROM address. Writes run one at a time: the data is sent at low priority on the I2C
+ * queue, then the device is polled once a cycle until it acknowledges the end of its write cycle. The write must not
+ * cross a page. Writes longer than EEPROM_WRITE_INLINE_SIZE are not copied, so the data must remain valid until the
+ * callback.
+ * uint16_t address: byte address to write to
+ * uint8_t* data: data to write
+ * uint16_t size: bytes to write
+ * EepromCallback callback: completion callback, may be NULL
+ * void* context: passed to the callback
+ * return: EEPROM_OK when queued, EEPROM_BUSY when the queue is full
+ */
+EepromStatus eeprom_write_bytes(uint16_t address, uint8_t* data, uint16_t size, EepromCallback callback, void* context);
+
+/**
+ * eeprom_cycle:
+ *
+ * Called once a cycle to advance queued writes: starts the next write, and polls the device for the end of a write
+ * cycle. Fails a write after EEPROM_WRITE_TIMEOUT_CYCLES polls without an acknowledge.
+ */
+void eeprom_cycle(void);
+
+/**
+ * eeprom_flush:
+ *
+ * Wait for all queued writes to complete, polling every millisecond. Only used at initialization.
+ * return: status of the last write, or EEPROM_BUSY when the writes did not complete within EEPROM_FLUSH_TIMEOUT_MS
+ */
+EepromStatus eeprom_flush(void);
+
+/**
+ * eeprom_idle:
+ *
+ * return: true when no write is queued or programming
+ */
+bool eeprom_idle(void);
+
+/**
+ * eeprom_last_status:
+ *
+ * return: status of the last completed write
+ */
+EepromStatus eeprom_last_status(void);
+
+/**
+ * eeprom_failures:
+ *
+ * return: count of failed writes
+ */
+uint32_t eeprom_failures(void);
+
 #endif /* INC_VENTILATOR_EEPROM_H_ */
@@ -0,0 +1,108 @@
+/*
+ * frame.h:
+ *
+ * Framing of binary messages on the debug UART. A frame is two sync bytes, the frame type, the payload length, the
+ * payload, and the crc16 of the type, length, and payload sent low byte first:
+ *
+ *   0xA5 0x5A type length payload[length] crc_low crc_high
+ *
+ * The receiver scans for the sync bytes and drops any frame failing its CRC, so it resynchronizes after lost or
+ * corrupted bytes without an escaping scheme. Shared with the host decoder.
+ */
+
+#ifndef INC_VENTILATOR_FRAME_H_
+#define INC_VENTILATOR_FRAME_H_
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Frame constants.
+ */
+enum FrameConstants {
+    FRAME_SYNC_FIRST = 0xA5,
+    FRAME_SYNC_SECOND = 0x5A,
+    FRAME_HEADER_SIZE = 4,  // Sync bytes, type, length
+    FRAME_CRC_SIZE = 2,
+    FRAME_OVERHEAD = FRAME_HEADER_SIZE + FRAME_CRC_SIZE,
+    FRAME_PAYLOAD_MAX = 192 // Longest payload, sizes the parser buffer
+};
+
+/**
+ * FrameType:
+ *
+ * Type of the payload carried by a frame. Commands from the host are answered by a frame of the command's type with
+ * FRAME_TYPE_REPLY set, see command.h.
+ */
+typedef enum {
+    FRAME_TYPE_STATUS = 1,            // TelemetryStatus, sent every cycle
+    FRAME_TYPE_TRACE = 2,             // TraceRecord, sent every cycle while capturing, see trace.h
+    FRAME_TYPE_GET_PARAMETER = 0x10,  // CommandParameter, value ignored
+    FRAME_TYPE_SET_PARAMETER = 0x11,  // CommandParameter
+    FRAME_TYPE_GET_STATS = 0x12,      // No payload, or a byte set to also reset the worst stage times
+    FRAME_TYPE_GET_TREND_PAGE = 0x13, // CommandTrendPage, only age used
+    FRAME_TYPE_SET_TRACE = 0x14,      // A byte set to start capturing, clear to stop
+    FRAME_TYPE_REPLY = 0x80,          // Set in the type of a reply
+    FRAME_TYPE_REJECTED = 0xFF        // Reply to an unknown or malformed command, payload is the command type
+} FrameType;
+
+/**
+ * FrameParserState:
+ *
+ * Field of the frame the parser expects next.
+ */
+typedef enum {
+    FRAME_PARSE_SYNC_FIRST,
+    FRAME_PARSE_SYNC_SECOND,
+    FRAME_PARSE_TYPE,
+    FRAME_PARSE_LENGTH,
+    FRAME_PARSE_PAYLOAD,
+    FRAME_PARSE_CRC_LOW,
+    FRAME_PARSE_CRC_HIGH
+} FrameParserState;
+
+/**
+ * FrameParser:
+ *
+ * Byte at a time parser of incoming frames.
+ */
+typedef struct {
+    FrameParserState state;
+    uint8_t type;     // Type of the parsed frame
+    uint8_t length;   // Payload length of the parsed frame
+    uint8_t count;    // Payload bytes received
+    uint16_t crc;     // Received CRC
+    uint32_t errors;  // Frames dropped on a CRC mismatch or an oversized length
+    uint8_t payload[FRAME_PAYLOAD_MAX];
+} FrameParser;
+
+/**
+ * frame_encode:
+ *
+ * Encode a frame.
+ * uint8_t* data: (output) size + FRAME_OVERHEAD bytes
+ * uint8_t type: FrameType of the payload
+ * const void* payload: payload to send
+ * uint8_t size: bytes of payload, up to FRAME_PAYLOAD_MAX
+ * return: bytes of the frame
+ */
+uint32_t frame_encode(uint8_t* data, uint8_t type, const void* payload, uint8_t size);
+
+/**
+ * frame_parser_reset:
+ *
+ * Start a parser looking for the sync bytes, clearing its error count.
+ * FrameParser* parser: parser to reset
+ */
+void frame_parser_reset(FrameParser* parser);
+
+/**
+ * frame_parse:
+ *
+ * Add a received byte to the parser.
+ * FrameParser* parser: parser to add to
+ * uint8_t byte: received byte
+ * return: true when the byte completed a valid frame, held in type, length, and payload until the next byte
+ */
+bool frame_parse(FrameParser* parser, uint8_t byte);
+
+#endif /* INC_VENTILATOR_FRAME_H_ */
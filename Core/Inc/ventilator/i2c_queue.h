@@ -0,0 +1,156 @@
+/*
+ * i2c_queue.h:
+ *
+ * Interrupt driven transaction queue for the shared I2C bus. The display expanders, the button expander, and the
+ * EEPROM all share hi2c1. Rather than each blocking the cycle on its own transfer, transactions are submitted to
+ * this queue and run back-to-back from the I2C interrupt, overlapping with the rest of the cycle. High priority
+ * transactions always run before low priority ones, and each transaction may supply a completion callback. Note:
+ * callbacks run in interrupt context and must be short.
+ *
+ * Errors are counted per device, and expander errors are also counted in p_uartDebug.fswStats.switchI2CErrors.
+ */
+
+#ifndef INC_VENTILATOR_I2C_QUEUE_H_
+#define INC_VENTILATOR_I2C_QUEUE_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <stm32f0xx_hal.h>
+
+/**
+ * I2C queue constants.
+ */
+enum I2cQueueConstants {
+    I2C_QUEUE_DEPTH = 6,          // Pending transactions per priority
+    I2C_QUEUE_INLINE_SIZE = 4,    // Writes up to this size are copied into the queue at submit
+    I2C_QUEUE_TIMEOUT_CYCLES = 2, // Cycles a transaction may run before the bus is reset
+    I2C_QUEUE_BLOCKING_TIMEOUT_MS = 100 // Time to wait in i2c_queue_transfer (ms)
+};
+
+/**
+ * I2cPriority:
+ *
+ * Priority of a transaction. Display and button traffic is high priority, EEPROM traffic is low.
+ */
+typedef enum {
+    I2C_PRIORITY_HIGH = 0,
+    I2C_PRIORITY_LOW,
+    I2C_PRIORITY_COUNT
+} I2cPriority;
+
+/**
+ * I2cOperation:
+ *
+ * Operations supported by the queue. Memory operations send the register or memory address before the data.
+ */
+typedef enum {
+    I2C_OP_MEM_WRITE,
+    I2C_OP_MEM_READ,
+    I2C_OP_POLL      // A memory read used to poll a device for an acknowledge. Failures are expected and not counted.
+} I2cOperation;
+
+/**
+ * I2cDevice:
+ *
+ * Devices on the bus, for error accounting.
+ */
+typedef enum {
+    I2C_DEVICE_DISPLAY_LOWER = 0, // Expander 0x20
+    I2C_DEVICE_DISPLAY_MIDDLE,    // Expander 0x21
+    I2C_DEVICE_DISPLAY_UPPER,     // Expander 0x22
+    I2C_DEVICE_BUTTONS,           // Expander 0x24
+    I2C_DEVICE_EEPROM,            // EEPROM 0x50
+    I2C_DEVICE_OTHER,
+    I2C_DEVICE_COUNT
+} I2cDevice;
+
+/**
+ * Completion callback of a transaction, called from interrupt context.
+ * HAL_StatusTypeDef status: HAL_OK on success, error status otherwise
+ * void* context: context supplied with the transaction
+ */
+typedef void (*I2cCallback)(HAL_StatusTypeDef status, void* context);
+
+/**
+ * I2cTransaction:
+ *
+ * A single transaction on the bus.
+ */
+typedef struct {
+    uint16_t addr;          // Device address, already shifted as used by the HAL
+    uint16_t mem_addr;      // Register or memory address
+    uint8_t mem_addr_size;  // Bytes of memory address, 1 or 2. Sent big-endian
+    uint8_t op;             // I2cOperation
+    uint16_t size;          // Bytes to read or write
+    uint8_t* data;          // Destination of a read, or source of a write longer than I2C_QUEUE_INLINE_SIZE. Must remain
+                            // valid until completion
+    uint8_t inline_data[I2C_QUEUE_INLINE_SIZE]; // Short writes are copied here, so callers may reuse their buffer
+    I2cCallback callback;   // Completion callback, may be NULL
+    void* context;          // Passed to the callback
+} I2cTransaction;
+
+/**
+ * i2c_queue_init:
+ *
+ * Initialize the queue, dropping anything pending.
+ */
+void i2c_queue_init(void);
+
+/**
+ * i2c_queue_submit:
+ *
+ * Queue a transaction. It is started immediately if the bus is idle. Safe to call from a completion callback.
+ * I2cPriority priority: priority of the transaction
+ * const I2cTransaction* transaction: transaction to copy into the queue
+ * return: HAL_OK when queued, HAL_BUSY when the queue of that priority is full
+ */
+HAL_StatusTypeDef i2c_queue_submit(I2cPriority priority, const I2cTransaction* transaction);
+
+/**
+ * i2c_queue_transfer:
+ *
+ * Queue a transaction and wait for it to complete. Only used outside of the cycle (i.e. initialization).
+ * I2cPriority priority: priority of the transaction
+ * I2cTransaction* transaction: transaction to run. The callback is replaced.
+ * return: completion status, HAL_BUSY if it could not be queued, or HAL_TIMEOUT
+ */
+HAL_StatusTypeDef i2c_queue_transfer(I2cPriority priority, I2cTransaction* transaction);
+
+/**
+ * i2c_queue_complete:
+ *
+ * Called from the HAL I2C completion and error callbacks to finish the current phase of the running transaction.
+ * HAL_StatusTypeDef status: HAL_OK from completion callbacks, HAL_ERROR from the error callback
+ */
+void i2c_queue_complete(HAL_StatusTypeDef status);
+
+/**
+ * i2c_queue_cycle:
+ *
+ * Called once a cycle. Resets the bus if a transaction has not completed within I2C_QUEUE_TIMEOUT_CYCLES.
+ */
+void i2c_queue_cycle(void);
+
+/**
+ * i2c_queue_reset:
+ *
+ * Reset the bus and drop all transactions, calling back each with HAL_TIMEOUT. Callbacks must not resubmit without
+ * bound, as their submissions are dropped as well. Used before falling back to blocking transfers on a machine fault.
+ */
+void i2c_queue_reset(void);
+
+/**
+ * i2c_queue_idle:
+ *
+ * return: true when no transaction is running or pending
+ */
+bool i2c_queue_idle(void);
+
+/**
+ * i2c_queue_errors:
+ *
+ * I2cDevice device: device to read
+ * return: count of failed transactions of the device
+ */
+uint32_t i2c_queue_errors(I2cDevice device);
+
+#endif /* INC_VENTILATOR_I2C_QUEUE_H_ */
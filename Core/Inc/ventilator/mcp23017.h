@@ -13,6 +13,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "stm32f0xx_hal.h"
+#include <ventilator/i2c_queue.h>
 
 // register addresses - use bank = 0 for sequential reads
 
@@ -39,6 +40,10 @@
 #define REG_OLATA 0x14
 #define REG_OLATB 0x15
 
+// IOCON bits
+#define MCP_IOCON_MIRROR 0x40 // INTA and INTB are internally connected
+#define MCP_IOCON_INTPOL 0x02 // INT output is active-high
+
 typedef struct {
     uint16_t addr;
     I2C_HandleTypeDef* i2c;
@@ -58,7 +63,8 @@ HAL_StatusTypeDef mcp23017_init(McpHandle* handle, uint8_t addr, bool is_input);
 /**
  * mcp23017_read_reg:
  *
- * Reads register memory from the device, starting at device_reg_addr and moving forward num_addrs.
+ * Reads register memory from the device, starting at device_reg_addr and moving forward num_addrs. Blocks until done, so only
+ * used at initialization and on machine fault. See mcp23017_read_reg_async.
  * McpHandle* handle: handle for device to read from
  * const uint8_t device_reg_addr: address of register on device to read from
  * uint8_t* val: data pointer to read into
@@ -70,7 +76,8 @@ HAL_StatusTypeDef mcp23017_read_reg(McpHandle* handle, const uint8_t device_reg_
 /**
  * mcp23017_write_reg:
  *
- * Writes register memory to the device, starting at device_reg_addr and moving forward num_addrs.
+ * Writes register memory to the device, starting at device_reg_addr and moving forward num_addrs. Blocks until done, so only
+ * used at initialization and on machine fault. See mcp23017_write_reg_async.
  * McpHandle* handle: handle for device to write to
  * const uint8_t device_reg_addr: address of register on device to write to
  * const uint8_t* val: data pointer to write out of
@@ -79,4 +86,34 @@ HAL_StatusTypeDef mcp23017_read_reg(McpHandle* handle, const uint8_t device_reg_
  */
 HAL_StatusTypeDef mcp23017_write_reg(McpHandle* handle, const uint8_t device_reg_addr, uint8_t* val, const uint8_t num_addrs);
 
+/**
+ * mcp23017_read_reg_async:
+ *
+ * Queues a read of register memory on the shared I2C queue. val is filled in once the callback reports success.
+ * McpHandle* handle: handle for device to read from
+ * const uint8_t device_reg_addr: address of register on device to read from
+ * uint8_t* val: data pointer to read into, must remain valid until the callback
+ * const uint8_t num_addrs: numer of address to read in
+ * I2cCallback callback: called from interrupt context on completion, may be NULL
+ * void* context: passed to the callback
+ * return: HAL_OK (0) when queued, HAL_BUSY when the queue is full
+ */
+HAL_StatusTypeDef mcp23017_read_reg_async(McpHandle* handle, const uint8_t device_reg_addr, uint8_t* val, const uint8_t num_addrs,
+                                          I2cCallback callback, void* context);
+
+/**
+ * mcp23017_write_reg_async:
+ *
+ * Queues a write of register memory on the shared I2C queue. The value is copied, so val may be reused immediately.
+ * McpHandle* handle: handle for device to write to
+ * const uint8_t device_reg_addr: address of register on device to write to
+ * uint8_t* val: data pointer to write out of
+ * const uint8_t num_addrs: numer of address to write out, at most I2C_QUEUE_INLINE_SIZE
+ * I2cCallback callback: called from interrupt context on completion, may be NULL
+ * void* context: passed to the callback
+ * return: HAL_OK (0) when queued, HAL_BUSY when the queue is full
+ */
+HAL_StatusTypeDef mcp23017_write_reg_async(McpHandle* handle, const uint8_t device_reg_addr, uint8_t* val, const uint8_t num_addrs,
+                                           I2cCallback callback, void* context);
+
 #endif /* INC_VENTILATOR_MCP23017_H_ */
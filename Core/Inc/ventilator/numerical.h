@@ -53,6 +53,27 @@ void numerical_set_two_digit(TwoDigit* digit, int32_t value);
  */
 void numerical_set_three_digit(ThreeDigit* digit, int32_t value);
 
+/**
+ * numerical_divide_by_10:
+ *
+ * Divide by 10 with a multiply and shift. The Cortex-M0 has no hardware divide, so this avoids a call into the
+ * software divide when splitting values into digits.
+ *
+ * uint32_t value: (input) value to divide. Must be in the range [0, 1028]
+ * return: value / 10
+ */
+uint32_t numerical_divide_by_10(uint32_t value);
+
+/**
+ * numerical_divide_by_100:
+ *
+ * Divide by 100 with a multiply and shift. See numerical_divide_by_10.
+ *
+ * uint32_t value: (input) value to divide. Must be in the range [0, 1098]
+ * return: value / 100
+ */
+uint32_t numerical_divide_by_100(uint32_t value);
+
 /**
  * numerical_digit_to_segment_helper:
  *
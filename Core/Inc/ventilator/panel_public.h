@@ -24,6 +24,7 @@
 #define SD_LATCH_Pin GPIO_PIN_12
 #define DISP_BLNK_Pin GPIO_PIN_14
 #define LOW_BATTERY_Pin GPIO_PIN_10
+#define BTN_INTA_Pin GPIO_PIN_1
 
 // When defined run the hardware test code to check hardware status.  This is special hardware test firmware
 //#define TEST_MODE
@@ -0,0 +1,111 @@
+/*
+ * parameters.h:
+ *
+ * Controller configuration parameters stored in the EEPROM as a single CRC protected block on page
+ * EEPROM_PARAMETER_PAGE, so that boot loads them all with one sequential read and one integrity check. The block
+ * holds a value for each EEPROM_INIT_* record, in record order. The per-record pages remain as the legacy location,
+ * only read to migrate the values into the block.
+ *
+ * Writes go to a staging copy in RAM and mark it dirty. The copy is written back as one block once it has been held
+ * for PARAMETER_WRITE_BACK_CYCLES, so a burst of changes while tuning costs a single page write, and unchanged writes
+ * cost nothing. parameters_flush writes it back without waiting, as on entering POWER_OFF_STATE.
+ */
+
+#ifndef INC_VENTILATOR_PARAMETERS_H_
+#define INC_VENTILATOR_PARAMETERS_H_
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <if_controller.h>
+#include <ventilator/eeprom.h>
+
+/**
+ * Parameter constants.
+ */
+enum ParameterConstants {
+    PARAMETER_FIRST_RECORD = EEPROM_INIT_INHALE_SENSITIVITY,                // Record of the first value in the block
+    PARAMETER_COUNT = EEPROM_NUM_RECORDS - EEPROM_INIT_INHALE_SENSITIVITY, // Values in the block
+    PARAMETER_BLOCK_VERSION = 1                                            // Layout of the block, stored with it
+};
+
+// Index of a record's value in the block
+#define PARAMETER_INDEX(record) ((record) - PARAMETER_FIRST_RECORD)
+
+/**
+ * ParameterBlock:
+ *
+ * The block as stored in the EEPROM.
+ */
+typedef struct {
+    uint32_t version;                 // PARAMETER_BLOCK_VERSION
+    int32_t values[PARAMETER_COUNT];  // Value of each record
+    uint32_t crc;                     // crc16 of the preceding bytes. Erased EEPROM never matches.
+} ParameterBlock;
+
+static_assert(sizeof(ParameterBlock) <= EEPROM_PAGE_SIZE, "Parameter block must fit a page");
+
+/**
+ * parameters_read:
+ *
+ * Read the block with a single sequential read, and check it. Only used at initialization.
+ * int32_t* values: (output) PARAMETER_COUNT values, only written when the block is valid
+ * return: EEPROM_OK when valid, EEPROM_ERROR on a CRC or version mismatch, or the status of a failed read
+ */
+EepromStatus parameters_read(int32_t* values);
+
+/**
+ * parameters_write:
+ *
+ * Copy the values into the staging copy, marking it dirty when they changed. Never waits on the EEPROM, and values
+ * written while a block write is in flight coalesce into the next block. A write that fails, or finds the EEPROM queue
+ * full, is retried by parameters_cycle, and failures are counted in p_uartDebug.fswStats.parameterWriteFailures.
+ * const int32_t* values: PARAMETER_COUNT values to write
+ */
+void parameters_write(const int32_t* values);
+
+/**
+ * parameters_cycle:
+ *
+ * Called once a cycle to queue the write back of a staging copy held dirty for PARAMETER_WRITE_BACK_CYCLES, or left
+ * dirty by a failed or refused write.
+ */
+void parameters_cycle(void);
+
+/**
+ * parameters_flush:
+ *
+ * Queue the write back of a dirty staging copy without waiting for PARAMETER_WRITE_BACK_CYCLES. Does not wait on the
+ * EEPROM. Called each cycle in POWER_OFF_STATE so nothing is held back while the panel is off.
+ */
+void parameters_flush(void);
+
+/**
+ * parameters_dirty:
+ *
+ * return: true while the last written values have not reached the EEPROM
+ */
+bool parameters_dirty(void);
+
+/**
+ * parameters_load:
+ *
+ * Load all parameters. When the block is not valid, each value falls back to its legacy record, or the compiled
+ * default when that record is unreadable or erased, and the block is rewritten so the next boot reads it directly.
+ * int32_t* values: (output) PARAMETER_COUNT loaded values
+ * const int32_t* defaults: PARAMETER_COUNT compiled defaults
+ * bool load: false to ignore the EEPROM and rewrite it with the defaults
+ * return: true when the values came from a valid block
+ */
+bool parameters_load(int32_t* values, const int32_t* defaults, bool load);
+
+/**
+ * parameters_field:
+ *
+ * Field of the controller parameters holding a value of the block.
+ * parameters_t* parameters: parameters holding the field
+ * uint32_t index: PARAMETER_INDEX of the record, below PARAMETER_COUNT
+ * return: the field
+ */
+int32_t* parameters_field(parameters_t* parameters, uint32_t index);
+
+#endif /* INC_VENTILATOR_PARAMETERS_H_ */
@@ -0,0 +1,128 @@
+/*
+ * profiler.h:
+ *
+ * Cycle-time profiler. Each stage of the 50Hz cycle is bracketed with a start/stop pair, and the elapsed time is
+ * recorded as min/max/mean and a log2 histogram per stage. Time is taken from a free-running timestamp built on
+ * SysTick (see profiler_dri.c) counting CPU clock ticks, so a 20ms cycle is 960000 ticks on the 48MHz part. The
+ * worst busy time of a cycle is published as p_uartDebug.fswStats.maxCycle.
+ */
+
+#ifndef INC_VENTILATOR_PROFILER_H_
+#define INC_VENTILATOR_PROFILER_H_
+#include <stdint.h>
+#include <ventilator/types.h>
+
+/**
+ * ProfileStage:
+ *
+ * Stages of the cycle that are profiled. PROFILE_STAGE_WAIT is time spent waiting on the incoming watchdog, which
+ * is the headroom left in the cycle. PROFILE_STAGE_IDLE is the time the core slept within that wait, so excludes the
+ * interrupts serviced while waiting. PROFILE_STAGE_CYCLE is the busy time of the whole cycle after the wait.
+ */
+typedef enum {
+    PROFILE_STAGE_WAIT = 0,
+    PROFILE_STAGE_IDLE,
+    PROFILE_STAGE_CONTROLLER,
+    PROFILE_STAGE_SOUND,
+    PROFILE_STAGE_BUTTONS,
+    PROFILE_STAGE_ALARM,
+    PROFILE_STAGE_DISPLAY,
+    PROFILE_STAGE_CYCLE,
+    PROFILE_STAGE_COUNT
+} ProfileStage;
+
+/**
+ * Profiler constants. Histogram bin 0 holds samples below 2^(PROFILE_HISTOGRAM_BASE_SHIFT + 1) ticks, bin n holds
+ * samples in [2^(BASE + n), 2^(BASE + n + 1)) and the last bin holds everything above, so with 48 ticks per
+ * microsecond the bins run from ~10us up to ~11ms and beyond.
+ */
+enum ProfileConstants {
+    PROFILE_TICKS_PER_US = 48,
+    PROFILE_HISTOGRAM_BINS = 12,
+    PROFILE_HISTOGRAM_BASE_SHIFT = 8
+};
+
+/**
+ * ProfileStats:
+ *
+ * Accumulated timing of a single stage, in timestamp ticks.
+ */
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint32_t last;
+    uint32_t count;
+    uint64_t total;
+    uint32_t histogram[PROFILE_HISTOGRAM_BINS];
+} ProfileStats;
+
+/**
+ * profiler_timestamp:
+ *
+ * Free-running timestamp in CPU clock ticks. Wraps every ~89 seconds, so only differences are meaningful.
+ * return: current timestamp
+ */
+uint32_t profiler_timestamp(void);
+
+/**
+ * profiler_reset:
+ *
+ * Clears all collected statistics.
+ */
+void profiler_reset(void);
+
+/**
+ * profiler_start:
+ *
+ * Mark the start of a stage.
+ * ProfileStage stage: stage being started
+ */
+void profiler_start(ProfileStage stage);
+
+/**
+ * profiler_stop:
+ *
+ * Mark the end of a stage, recording the time since the matching profiler_start call. Stopping the
+ * PROFILE_STAGE_CYCLE stage also updates the maxCycle statistic.
+ * ProfileStage stage: stage being stopped
+ * return: elapsed ticks of the stage
+ */
+uint32_t profiler_stop(ProfileStage stage);
+
+/**
+ * profiler_record:
+ *
+ * Record a single sample for the given stage.
+ * ProfileStage stage: stage to record against
+ * uint32_t ticks: elapsed time of the stage
+ */
+void profiler_record(ProfileStage stage, uint32_t ticks);
+
+/**
+ * profiler_get_stats:
+ *
+ * Get the collected statistics for a stage.
+ * ProfileStage stage: stage to read
+ * return: pointer to the read-only stats
+ */
+const ProfileStats* profiler_get_stats(ProfileStage stage);
+
+/**
+ * profiler_mean:
+ *
+ * Mean time of a stage. Performs a 64bit division, so call it when reporting rather than every cycle.
+ * ProfileStage stage: stage to read
+ * return: mean ticks of the stage, 0 when no samples were recorded
+ */
+uint32_t profiler_mean(ProfileStage stage);
+
+/**
+ * profiler_histogram_bin:
+ *
+ * Histogram bin for a given sample.
+ * uint32_t ticks: sample to bin
+ * return: bin index 0 to PROFILE_HISTOGRAM_BINS - 1
+ */
+uint32_t profiler_histogram_bin(uint32_t ticks);
+
+#endif /* INC_VENTILATOR_PROFILER_H_ */
@@ -0,0 +1,119 @@
+/*
+ * telemetry.h:
+ *
+ * Binary telemetry on the debug UART (USART1). Every cycle a status frame (see frame.h) is added to a ring buffer,
+ * and the ring is drained by TX DMA in the background. At 500 kbaud a status frame takes ~3.6ms of the 20ms cycle.
+ * When the host does not keep up, or the DMA stalls, frames that do not fit the ring are dropped, so sending never
+ * waits on the UART.
+ */
+
+#ifndef INC_VENTILATOR_TELEMETRY_H_
+#define INC_VENTILATOR_TELEMETRY_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+#include <stm32f0xx_hal.h>
+#include <ventilator/types.h>
+#include <ventilator/frame.h>
+#include <ventilator/profiler.h>
+
+/**
+ * Telemetry constants.
+ */
+enum TelemetryConstants {
+    TELEMETRY_RING_SIZE = 512,    // Bytes of the TX ring, a power of two
+    TELEMETRY_STALL_CYCLES = 10,  // Cycles a DMA transfer may take before it is aborted
+    TELEMETRY_READING_COUNT = offsetof(NumericalValues, alarms) / sizeof(NumericalValue), // Readings sent
+    TELEMETRY_ALARM_COUNT = sizeof(Alarms) / sizeof(Alarm) // Alarm statuses sent
+};
+
+/**
+ * TelemetryStatus:
+ *
+ * Payload of a FRAME_TYPE_STATUS frame. Little-endian, as on the host.
+ */
+typedef struct {
+    uint32_t sequence;                            // Frames queued, a gap shows dropped frames
+    uint32_t dropped;                             // Frames dropped as the ring was full, and stalled transfers
+    uint32_t alive_minutes;                       // p_aliveMinutes
+    FswStats fsw_stats;                           // p_uartDebug.fswStats
+    int32_t readings[TELEMETRY_READING_COUNT];    // val of each NumericalValue, in NumericalValues order
+    uint32_t stage_last[PROFILE_STAGE_COUNT];     // Last time of each ProfileStage, in profiler ticks
+    uint32_t stage_max[PROFILE_STAGE_COUNT];      // Worst time of each ProfileStage, in profiler ticks
+    uint8_t alarms[TELEMETRY_ALARM_COUNT];        // AlarmStatus of each alarm, in Alarms order
+    uint8_t power_state;                          // PowerState
+    uint16_t load;                                // Busy share of the last cycle, per mille of the wait and cycle times
+} TelemetryStatus;
+
+static_assert(sizeof(TelemetryStatus) <= FRAME_PAYLOAD_MAX, "Telemetry status must fit a frame");
+static_assert((TELEMETRY_RING_SIZE & (TELEMETRY_RING_SIZE - 1)) == 0, "Telemetry ring size must be a power of two");
+
+/**
+ * telemetry_init:
+ *
+ * Empty the ring, and reset the frame counts.
+ */
+void telemetry_init(void);
+
+/**
+ * telemetry_send:
+ *
+ * Add a frame to the ring and start the DMA when idle. Must not be called from interrupts, as the frame is encoded in
+ * a shared buffer.
+ * uint8_t type: FrameType of the payload
+ * const void* payload: payload of the frame
+ * uint8_t size: bytes of payload, up to FRAME_PAYLOAD_MAX
+ * return: HAL_OK when queued, HAL_BUSY when dropped as the ring is full
+ */
+HAL_StatusTypeDef telemetry_send(uint8_t type, const void* payload, uint8_t size);
+
+/**
+ * telemetry_cycle:
+ *
+ * Called once a cycle to send the status frame, and to abort a DMA transfer that has stalled.
+ */
+void telemetry_cycle(void);
+
+/**
+ * telemetry_status:
+ *
+ * Fill the status payload from the global state. The payload is a single static buffer, kept off the stack, so this
+ * must only be called from the main loop.
+ * return: the payload, valid until the next call
+ */
+const TelemetryStatus* telemetry_status(void);
+
+/**
+ * telemetry_sent:
+ *
+ * Called by the driver from the DMA interrupt when a transfer started by telemetry_dma_start has completed or failed.
+ * Frees the sent bytes and starts the next transfer.
+ */
+void telemetry_sent(void);
+
+/**
+ * telemetry_dropped:
+ *
+ * return: count of frames dropped as the ring was full, and of stalled transfers aborted
+ */
+uint32_t telemetry_dropped(void);
+
+/**
+ * telemetry_dma_start:
+ *
+ * Start a TX DMA transfer. Implemented in telemetry_dri.c.
+ * const uint8_t* data: bytes to send, held until telemetry_sent
+ * uint16_t size: bytes to send
+ * return: HAL_OK when started
+ */
+HAL_StatusTypeDef telemetry_dma_start(const uint8_t* data, uint16_t size);
+
+/**
+ * telemetry_dma_abort:
+ *
+ * Abort the TX DMA transfer, without calling telemetry_sent. Implemented in telemetry_dri.c.
+ */
+void telemetry_dma_abort(void);
+
+#endif /* INC_VENTILATOR_TELEMETRY_H_ */
@@ -0,0 +1,108 @@
+/*
+ * trace.h:
+ *
+ * Capture of the inputs of each cycle for a deterministic replay of field issues. While capturing, a trace record
+ * (see TraceRecord) is sent as a FRAME_TYPE_TRACE frame every cycle on the debug UART, ahead of the status frame. It holds
+ * the controller packet and the debounced button reading used by the cycle, along with the display image checksum and
+ * the alarm statuses it produced. The host replay feeds the records through process_control_packet, process_buttons,
+ * and alarm_run, and reports any cycle where the display or the alarms differ.
+ *
+ * Records are kept compact: the packet is only sent when it differs from the last one sent, and in full every
+ * TRACE_KEYFRAME_CYCLES so a replay resynchronizes after frames dropped by the telemetry ring. Capture starts at boot
+ * when TRACE_FROM_BOOT is set in panel.c, otherwise with the FRAME_TYPE_SET_TRACE command. Only a capture from boot
+ * replays exactly, as the replay starts from the initial state.
+ */
+
+#ifndef INC_VENTILATOR_TRACE_H_
+#define INC_VENTILATOR_TRACE_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+#include <stm32f0xx_hal.h>
+#include <if_controller.h>
+#include <ventilator/types.h>
+#include <ventilator/frame.h>
+
+/**
+ * Trace constants.
+ */
+enum TraceConstants {
+    TRACE_KEYFRAME_CYCLES = 50,  // Cycles between records always carrying the packet, a second at 50Hz
+    TRACE_ALARM_COUNT = sizeof(Alarms) / sizeof(Alarm)
+};
+
+/**
+ * TraceFlags:
+ *
+ * Flags of a trace record.
+ */
+typedef enum {
+    TRACE_FLAG_CONTROLLER_OK = 0x01, // Controller exchange succeeded, and its packet was processed
+    TRACE_FLAG_PACKET = 0x02,        // Packet follows the record, otherwise it is the packet last sent
+    TRACE_FLAG_ATTACHED = 0x04,      // Controller attached, so buttons and alarms ran
+    TRACE_FLAG_BUTTONS = 0x08,       // Buttons were detected and the reading processed
+    TRACE_FLAG_LOW_BATTERY = 0x10,   // Low battery input asserted
+    TRACE_FLAG_START = 0x20          // First record of the capture
+} TraceFlags;
+
+/**
+ * TraceRecord:
+ *
+ * Payload of a FRAME_TYPE_TRACE frame. Without TRACE_FLAG_PACKET the payload ends before the packet.
+ */
+typedef struct {
+    uint32_t cycle;                     // Cycles since boot, a gap shows dropped frames
+    uint16_t buttons;                   // Debounced expander reading, with TRACE_FLAG_BUTTONS
+    uint16_t display_crc;               // trace_display_crc after the cycle
+    uint16_t alive_hours;               // Shown while powering on
+    uint8_t flags;                      // TraceFlags
+    uint8_t power_state;                // PowerState after the cycle, the state the next cycle starts in
+    uint8_t alarms[TRACE_ALARM_COUNT];  // AlarmStatus of each alarm after the cycle, in Alarms order
+    uint8_t reserved[3];
+    controller_packet_t packet;         // Controller packet, with TRACE_FLAG_PACKET
+} TraceRecord;
+
+/**
+ * Trace record sizes.
+ */
+enum TraceSizes {
+    TRACE_RECORD_SHORT_SIZE = offsetof(TraceRecord, packet) // Payload of a record without the packet
+};
+
+static_assert(sizeof(TraceRecord) <= FRAME_PAYLOAD_MAX, "Trace record must fit a frame");
+static_assert((TRACE_RECORD_SHORT_SIZE % 4) == 0, "Trace packet must stay aligned");
+
+/**
+ * trace_init:
+ *
+ * Reset the cycle count, and start or stop capturing.
+ * bool capture: capture from the first cycle
+ */
+void trace_init(bool capture);
+
+/**
+ * trace_capture:
+ *
+ * Start or stop capturing. A started capture begins with a TRACE_FLAG_START record carrying the packet.
+ * bool capture: true to capture
+ */
+void trace_capture(bool capture);
+
+/**
+ * trace_cycle:
+ *
+ * Called once a cycle after the display is updated, to count the cycle and send its record while capturing.
+ * HAL_StatusTypeDef controller_status: status of the controller exchange of the cycle
+ * bool attached: controller attached, so the buttons and alarms ran
+ */
+void trace_cycle(HAL_StatusTypeDef controller_status, bool attached);
+
+/**
+ * trace_display_crc:
+ *
+ * return: crc16 of the display image, the words shifted out followed by the red bargraph
+ */
+uint16_t trace_display_crc(void);
+
+#endif /* INC_VENTILATOR_TRACE_H_ */
@@ -0,0 +1,150 @@
+/*
+ * trend.h:
+ *
+ * Trend log of per-minute sensor aggregates, kept in the EEPROM pages past the alive journal for post-incident
+ * review. Each cycle is sampled into min/max/mean aggregates of the pressure, last tidal volume, respiratory rate, and
+ * FIO2, along with the alarm transitions of the minute. Once a minute the aggregates are encoded as a record of
+ * zig-zag varint deltas from the previous record, so a typical minute takes around 16 bytes.
+ *
+ * Pages form a ring of EEPROM_TREND_PAGES pages. Each page starts with a sequence number, and page N of the log is
+ * stored in ring page N % EEPROM_TREND_PAGES, so the newest page is found with a binary search as in the alive
+ * journal. The first record of a page is encoded from zero, so every page decodes on its own once older pages have
+ * been overwritten. Records are sized by their first byte, and erased bytes (0xFF) end a page.
+ */
+
+#ifndef INC_VENTILATOR_TREND_H_
+#define INC_VENTILATOR_TREND_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <ventilator/types.h>
+#include <ventilator/eeprom.h>
+
+/**
+ * TrendQuantity:
+ *
+ * Quantities aggregated by the trend log, in record order.
+ */
+typedef enum {
+    TREND_PRESSURE,     // pressure.val
+    TREND_TIDAL_VOLUME, // tidal_volume_last.val
+    TREND_RESP_RATE,    // resp_rate.val
+    TREND_FIO2,         // FIO2.val
+    TREND_QUANTITY_COUNT
+} TrendQuantity;
+
+/**
+ * Trend constants.
+ */
+enum TrendConstants {
+    TREND_EVENTS_MAX = 6,           // Alarm transitions kept per minute, later ones are dropped
+    TREND_ALARM_COUNT = sizeof(Alarms) / sizeof(Alarm), // Alarms watched for transitions
+    TREND_PAGE_HEADER_SIZE = sizeof(uint32_t),          // Sequence number starting each page
+    TREND_PAGE_PAYLOAD = EEPROM_PAGE_SIZE - TREND_PAGE_HEADER_SIZE, // Bytes of records per page
+    TREND_RECORD_MAX_SIZE = 1 + 5 + (TREND_QUANTITY_COUNT * 3 * 5) + 1 + TREND_EVENTS_MAX // Longest encoding
+};
+
+/**
+ * TrendAggregate:
+ *
+ * Aggregate of a quantity over a minute.
+ */
+typedef struct {
+    int32_t min;
+    int32_t max;
+    int32_t mean;
+} TrendAggregate;
+
+/**
+ * TrendEvent:
+ *
+ * An alarm transition. Encoded as one byte: the alarm in the upper bits, and the status in the lower three.
+ */
+typedef struct {
+    uint8_t alarm;  // Index of the alarm within Alarms
+    uint8_t status; // AlarmStatus entered, both blink phases are ALARM_BLINK_ON
+} TrendEvent;
+
+/**
+ * TrendRecord:
+ *
+ * A decoded minute of the trend log.
+ */
+typedef struct {
+    uint32_t minute; // Alive minute the record was taken at
+    TrendAggregate aggregates[TREND_QUANTITY_COUNT];
+    uint8_t event_count;
+    TrendEvent events[TREND_EVENTS_MAX];
+} TrendRecord;
+
+/**
+ * trend_init:
+ *
+ * Find the newest page of the log, so new records continue the sequence in a fresh page. Reads wait on the I2C queue,
+ * so this is only used at initialization.
+ */
+void trend_init(void);
+
+/**
+ * trend_sample:
+ *
+ * Add a cycle's values to the aggregates of the current minute, and record alarm transitions.
+ * const NumericalValues* values: values of the cycle
+ */
+void trend_sample(const NumericalValues* values);
+
+/**
+ * trend_minute:
+ *
+ * Close the aggregates of the current minute into a record. The record is encoded and written by trend_cycle over the
+ * following cycles. A minute without samples, such as in standby, records nothing.
+ * uint32_t minute: alive minute to stamp the record with
+ */
+void trend_minute(uint32_t minute);
+
+/**
+ * trend_cycle:
+ *
+ * Called once a cycle to place the closed record into the current page, and queue the unwritten bytes of the page to
+ * the EEPROM. Never waits on the EEPROM, a failed write is retried on a later cycle.
+ */
+void trend_cycle(void);
+
+/**
+ * trend_page_count:
+ *
+ * return: pages of the log holding history, up to EEPROM_TREND_PAGES
+ */
+uint32_t trend_page_count(void);
+
+/**
+ * trend_queue_read_page:
+ *
+ * Read a page of the log without waiting, see eeprom_queue_read. The current page is copied from RAM, as it may hold
+ * records not yet written, and the callback is called before returning.
+ * uint32_t age: page to read, 0 being the oldest up to trend_page_count() - 1 being the current page
+ * uint8_t* data: (output) EEPROM_PAGE_SIZE bytes of the page, valid once the callback is called with EEPROM_OK
+ * EepromCallback callback: completion callback
+ * void* context: passed to the callback
+ * return: EEPROM_OK when queued, EEPROM_ERROR when the page is out of range, EEPROM_BUSY when the EEPROM is busy
+ */
+EepromStatus trend_queue_read_page(uint32_t age, uint8_t* data, EepromCallback callback, void* context);
+
+/**
+ * trend_decode:
+ *
+ * Decode the records of a page, as read by trend_queue_read_page. Shared with the host decoder.
+ * const uint8_t* data: EEPROM_PAGE_SIZE bytes of the page
+ * TrendRecord* records: (output) decoded records
+ * uint32_t max_records: size of records
+ * return: records decoded, stopping at the end of the page or the first malformed record
+ */
+uint32_t trend_decode(const uint8_t* data, TrendRecord* records, uint32_t max_records);
+
+/**
+ * trend_dropped:
+ *
+ * return: count of records dropped, as the previous record was still waiting to be written or did not fit a page
+ */
+uint32_t trend_dropped(void);
+
+#endif /* INC_VENTILATOR_TREND_H_ */
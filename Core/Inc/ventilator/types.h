@@ -37,13 +37,13 @@ typedef enum {
 /**
  * Alarm:
  *
- * Alarm type containing the status, configuration settings, and active timing count of the alarm.
+ * Alarm type containing the status and active timing count of the alarm. The condition and timings of each alarm are
+ * in the constant alarm table, see alarm.c, so a zeroed alarm is off.
  */
 typedef struct {
-    AlarmStatus status; // Alarm is off, set, or latched
-    uint32_t count; // Count used to time transitions between alarms
-    uint32_t latch_time; // Latch time in counts
-    uint32_t trip_time; // Trip time (set time) in counts
+    uint8_t status; // AlarmStatus, alarm is off, set, or latched
+    uint8_t reserved;
+    uint16_t count; // Count used to time transitions between alarms, saturating
 } Alarm;
 
 /**
@@ -129,15 +129,18 @@ typedef enum {
 } FailSafeClockState;
 
 /**
- * Statistics to communicate as telemetry.  **UNUSED** at this time.
+ * Statistics to communicate as telemetry.
  */
 typedef struct {
-    uint32_t maxCycle; //!< max cycle time
+    uint32_t maxCycle; //!< max cycle busy time in microseconds
     uint32_t controlSpiErrors; //!< SPI CRC errors
     uint32_t switchI2CErrors; //!< switch I2C IOExpander errors
+    uint32_t controlSpiTimeouts; //!< SPI exchanges that timed out
+    uint32_t controlMaxLatency; //!< max SPI exchange time in microseconds
+    uint32_t parameterWriteFailures; //!< failed writes of the EEPROM parameter block, each retried
 } FswStats;
 /**
- * Statistics to communicate as telemetry.  **UNUSED** at this time.
+ * Statistics to communicate as telemetry. Sent in each status frame on the debug UART, see telemetry.h.
  */
 typedef struct {
     FswStats fswStats;
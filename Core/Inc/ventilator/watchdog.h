@@ -7,7 +7,7 @@
  * 1. outgoing watchdog, toggle every cycle, or be determined as dead.
  * 2. fail-safe timer: a timer that will detect a failure to get communication and fault the system. Reset count
  * each cycle.
- * 3. incoming watchdog: control signal. Spin until toggled to time "cycle start"
+ * 3. incoming watchdog: control signal. Sleep until toggled to time "cycle start"
  *
  *  Created on: Apr 14, 2020
  *      Author: tcanham
@@ -28,8 +28,8 @@ void init_fail_safe_timer(TIM_HandleTypeDef* timer);
 void stroke_outgoing_watchdog(void);
 
 /**
- * Spins on incoming watch dog. Will assert on a timeout of fail-safe timer. When incoming watchdog toggles, stop
- * spinning and release cycle.
+ * Waits on incoming watch dog, sleeping the core between interrupts. Will assert on a timeout of fail-safe timer. When
+ * incoming watchdog toggles, stop waiting and release cycle. The time slept is recorded as PROFILE_STAGE_IDLE.
  */
 void spin_on_incoming_watchdog(void);
 /**
@@ -26,6 +26,8 @@
 #include <ventilator/cycle.h>
 #include <ventilator/panel.h>
 #include <ventilator/types.h>
+#include <ventilator/display.h>
+#include <ventilator/i2c_queue.h>
 #define EXTERN // Forces variables to be instantiated
 #include <ventilator/panel_public.h>
 
@@ -61,6 +63,7 @@ UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
 DMA_HandleTypeDef hdma_usart1_rx;
 DMA_HandleTypeDef hdma_usart1_tx;
+DMA_HandleTypeDef hdma_spi2_tx;
 
 /* USER CODE BEGIN PV */
 
@@ -638,6 +641,9 @@ static void MX_DMA_Init(void)
   /* DMA1_Channel2_3_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 0, 0);
   HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+  /* DMA1_Channel4_5_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel4_5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_5_IRQn);
 
 }
 
@@ -708,6 +714,39 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
     if (GPIO_PIN_0 == GPIO_Pin) {
         p_doCycle = 1; // set flag for waiting loop
+    } else if (BTN_INTA_Pin == GPIO_Pin) {
+        button_interrupt(); // button expander saw a change, capture it next cycle
+    }
+}
+
+// Display shift-register DMA transfer has finished, latch the new image
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if (hspi == &hspi2) {
+        display_transmit_complete();
+    }
+}
+
+// I2C queue frame has finished, start the next frame or transaction
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == &hi2c1) {
+        i2c_queue_complete(HAL_OK);
+    }
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == &hi2c1) {
+        i2c_queue_complete(HAL_OK);
+    }
+}
+
+// I2C queue frame failed (i.e. no acknowledge), fail the transaction
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == &hi2c1) {
+        i2c_queue_complete(HAL_ERROR);
     }
 }
 
@@ -12,17 +12,35 @@
  *  Created on: Apr 17, 2020
  *      Author: mstarch
  */
+#include <string.h>
 #include <ventilator/alarm.h>
 #include <ventilator/sound.h>
 #include <ventilator/types.h>
+#include <ventilator/display.h>
+#include <ventilator/initialize.h>
 #include <ventilator/panel_public.h>
 #include <swassert.h>
 
 STATIC uint32_t ALARM_SOUND_COUNTDOWN = 0; //!< Countdown before alarm will redetect
 STATIC uint32_t ALARM_BLINK_COUNTER = 0;
+STATIC AlarmMasks m_alarm_masks = {0, 0, 0, 0};
 
-uint32_t alarm_run_state(Alarm* alarm, bool tripped) {
+// Alarm table, in Alarms order. Adding an alarm is adding its field to Alarms and its entry here.
+STATIC const AlarmDescriptor ALARM_TABLE[ALARM_COUNT] = {
+    [ALARM_INDEX(disconnect)]    = {ALARM_CHECK_BELOW_DISCONNECT,    ALARM_VALUE(pressure),              ALARM_VALUE(pressure),      DISPLAY_ALARM_DISCONNECT_SHIFT, INITIAL_DISCONNECT_TRIP,   INITIAL_DISCONNECT_LATCH},
+    [ALARM_INDEX(tidal_vol)]     = {ALARM_CHECK_OUTSIDE_TEN_PERCENT, ALARM_VALUE(tidal_volume_last),     ALARM_VALUE(tidal_volume),  DISPLAY_ALARM_TIDAL_VOL_SHIFT,  INITIAL_TIDALVOL_TRIP,     INITIAL_TIDALVOL_LATCH},
+    [ALARM_INDEX(peak_press)]    = {ALARM_CHECK_ABOVE_THRESHOLD,     ALARM_VALUE(peak_pressure_average), ALARM_VALUE(peak_pressure), DISPLAY_ALARM_PEAK_PRES_SHIFT,  INITIAL_PEAK_TRIP,         INITIAL_PEAK_LATCH},
+    [ALARM_INDEX(resp_rate)]     = {ALARM_CHECK_OUTSIDE_RATES,       ALARM_VALUE(resp_rate),             ALARM_VALUE(backup_rate),   DISPLAY_ALARM_RESP_RATE_SHIFT,  INITIAL_RESPRATE_TRIP,     INITIAL_RESPRATE_LATCH},
+    [ALARM_INDEX(peep)]          = {ALARM_CHECK_OUTSIDE_THRESHOLDS,  ALARM_VALUE(peep_pressure_average), ALARM_VALUE(PEEP),          DISPLAY_ALARM_PEEP_PRES_SHIFT,  INITIAL_PEEP_TRIP,         INITIAL_PEEP_LATCH},
+    [ALARM_INDEX(fio2)]          = {ALARM_CHECK_OUTSIDE_THRESHOLDS,  ALARM_VALUE(FIO2),                  ALARM_VALUE(FIO2),          DISPLAY_ALARM_FIO2_PERC_SHIFT,  INITIAL_FIO2_TRIP,         INITIAL_FIO2_LATCH},
+    [ALARM_INDEX(machine_fault)] = {ALARM_CHECK_SOFTWARE_FAULT,      0,                                  0,                          DISPLAY_ALARM_MACH_FALT_SHIFT,  INITIAL_MACHINEFAULT_TRIP, INITIAL_MACHINEFAULT_LATCH},
+    [ALARM_INDEX(low_power)]     = {ALARM_CHECK_LOW_BATTERY,         0,                                  0,                          DISPLAY_ALARM_LOW_POWER_SHIFT,  INITIAL_LOWPOW_TRIP,       INITIAL_LOWPOW_LATCH},
+    [ALARM_INDEX(power_off)]     = {ALARM_CHECK_NONE,                0,                                  0,                          DISPLAY_ALARM_POWER_OFF_SHIFT,  INITIAL_POWEROFF_TRIP,     INITIAL_POWEROFF_LATCH}
+};
+
+uint32_t alarm_run_state(Alarm* alarm, const AlarmDescriptor* descriptor, bool tripped) {
     SW_ASSERT(alarm);
+    SW_ASSERT(descriptor);
     // Blinking state is highest priority, and is transitioned based on set conditions
     if (alarm->status == ALARM_BLINK_OFF || alarm->status == ALARM_BLINK_ON) {
         alarm->status = (ALARM_BLINK_COUNTER > DISPLAY_BLINK_OFF_CYCLES)? ALARM_BLINK_ON : ALARM_BLINK_OFF;
@@ -38,12 +56,12 @@ uint32_t alarm_run_state(Alarm* alarm, bool tripped) {
         alarm->status = ALARM_OFF;
         return 0;
     }
-    // Tripped alarm, run the alarm state machine
-    alarm->count += 1;
-    if (alarm->count >= alarm->latch_time || alarm->status == ALARM_LATCH) {
+    // Tripped alarm, run the alarm state machine. The count saturates, past the latch time it no longer matters.
+    alarm->count += (alarm->count < UINT16_MAX) ? 1 : 0;
+    if (alarm->count >= descriptor->latch_time || alarm->status == ALARM_LATCH) {
         alarm->status = ALARM_LATCH;
         return 1;
-    } else if (alarm->count >= alarm->trip_time) {
+    } else if (alarm->count >= descriptor->trip_time) {
         alarm->status = ALARM_SET;
         return 1;
     } else {
@@ -52,83 +70,93 @@ uint32_t alarm_run_state(Alarm* alarm, bool tripped) {
     }
 }
 
-uint8_t alarm_detect(NumericalValues* values) {
-    SW_ASSERT(values);
-    // set up boolean for alarm tone
-    uint8_t alarm_tone = 0;
-
-    // Disconnect alarm
-    bool tripped = (values->pressure.val < DISCONNECT_CMH20_CAP);
-    alarm_tone = alarm_tone | alarm_run_state(&values->alarms.disconnect, tripped);
-
-    // PEEP (lower) pressure alarm
-    tripped = ((values->peep_pressure_average.val > (values->PEEP.setpoint + values->PEEP.thresh_upper)) ||
-               (values->peep_pressure_average.val < (values->PEEP.setpoint + values->PEEP.thresh_lower)));
-    alarm_tone = alarm_tone | alarm_run_state(&values->alarms.peep, tripped);
+/**
+ * Check the condition of an alarm table entry.
+ */
+STATIC bool alarm_tripped(const AlarmDescriptor* descriptor, const NumericalValues* values) {
+    const NumericalValue* measured = &((const NumericalValue*)values)[descriptor->measured];
+    const NumericalValue* reference = &((const NumericalValue*)values)[descriptor->reference];
+    uint32_t ten_percent = 0;
+    switch (descriptor->check) {
+        case ALARM_CHECK_BELOW_DISCONNECT:
+            return (measured->val < DISCONNECT_CMH20_CAP);
+        case ALARM_CHECK_OUTSIDE_THRESHOLDS:
+            return ((measured->val > (reference->setpoint + reference->thresh_upper)) ||
+                    (measured->val < (reference->setpoint + reference->thresh_lower)));
+        case ALARM_CHECK_ABOVE_THRESHOLD:
+            return (measured->val > (reference->setpoint + reference->thresh_upper));
+        case ALARM_CHECK_OUTSIDE_TEN_PERCENT:
+            ten_percent = (10*reference->setpoint)/100;
+            return (measured->val > (reference->setpoint + ten_percent) ||
+                    measured->val < (reference->setpoint - ten_percent));
+        case ALARM_CHECK_OUTSIDE_RATES:
+            return ((measured->val > measured->setpoint) || (measured->val < reference->setpoint));
+        case ALARM_CHECK_LOW_BATTERY:
+            // No need for a measured value, this is driven directly from the GPIO
+            return (HAL_GPIO_ReadPin(GPIOB, LOW_BATTERY_Pin) == GPIO_PIN_RESET);
+        case ALARM_CHECK_SOFTWARE_FAULT:
+            return SW_ASSERT_FLAG; // Best attempt at machine fault
+        default:
+            break;
+    }
+    return false;
+}
 
-    // Tidal volume exceeds alarm value
-    uint32_t ten_percent = (10*values->tidal_volume.setpoint)/100;
-    tripped = (values->tidal_volume_last.val > (values->tidal_volume.setpoint + ten_percent) ||
-               values->tidal_volume_last.val < (values->tidal_volume.setpoint - ten_percent));
-    alarm_tone = alarm_tone | alarm_run_state(&values->alarms.tidal_vol, tripped);
+/**
+ * Update the bits of an alarm in the alarm masks from its status.
+ */
+STATIC void alarm_mask_update(uint32_t index, uint8_t status, bool sounding) {
+    uint16_t bit = (uint16_t)(1 << ALARM_TABLE[index].shift);
+    uint16_t keep = (uint16_t)~bit;
+    m_alarm_masks.visible = (m_alarm_masks.visible & keep) | (((status != ALARM_OFF) && (status != ALARM_BLINK_OFF)) ? bit : 0);
+    m_alarm_masks.sounding = (m_alarm_masks.sounding & keep) | (sounding ? bit : 0);
+    m_alarm_masks.latched = (m_alarm_masks.latched & keep) | ((status == ALARM_LATCH) ? bit : 0);
+    m_alarm_masks.blinking = (m_alarm_masks.blinking & keep) | (((status == ALARM_BLINK_ON) || (status == ALARM_BLINK_OFF)) ? bit : 0);
+}
 
-    // Peak pressure exceeds alarm value
-    tripped = ((values->peak_pressure_average.val > (values->peak_pressure.setpoint + values->peak_pressure.thresh_upper)));
-    alarm_tone = alarm_tone | alarm_run_state(&values->alarms.peak_press, tripped);
-    // Check for halt ventilation
+uint8_t alarm_detect(NumericalValues* values) {
+    SW_ASSERT(values);
+    uint32_t i = 0;
+    Alarm* alarms = (Alarm*)&values->alarms;
+    for (i = 0; i < ALARM_COUNT; i++) {
+        const AlarmDescriptor* descriptor = &ALARM_TABLE[i];
+        bool sounding = false;
+        if (descriptor->check != ALARM_CHECK_NONE) {
+            sounding = alarm_run_state(&alarms[i], descriptor, alarm_tripped(descriptor, values)) != 0;
+        }
+        alarm_mask_update(i, alarms[i].status, sounding);
+    }
+    // Check for halt ventilation, overriding the PEEP alarm
     if (values->pressure.val > (values->peak_pressure.setpoint + values->peak_pressure.thresh_upper)) {
         p_haltVentilation = true;
-        values->alarms.peep.status = ALARM_BLINK_ON;
+        alarm_set_status(&values->alarms, ALARM_INDEX(peep), ALARM_BLINK_ON);
     } else if (p_haltVentilation && (values->pressure.val >= (values->PEEP.setpoint + 5))) {
         p_haltVentilation = true;
     } else if (p_haltVentilation && (values->pressure.val < (values->PEEP.setpoint + 5))) {
-        values->alarms.peep.status = ALARM_OFF;
+        alarm_set_status(&values->alarms, ALARM_INDEX(peep), ALARM_OFF);
         p_haltVentilation = false;
     }
+    // Tone when any state machine asked for one
+    return (m_alarm_masks.sounding != 0) ? 1 : 0;
+}
 
-    // Respiratory rate exceeds alarm value
-    tripped = ((values->resp_rate.val > values->resp_rate.setpoint) ||
-               (values->resp_rate.val < values->backup_rate.setpoint));
-    alarm_tone = alarm_tone | alarm_run_state(&values->alarms.resp_rate, tripped);
-
-
-    // FI02 exceeds alarm value
-    tripped = (values->FIO2.val > (values->FIO2.setpoint + values->FIO2.thresh_upper) ||
-               values->FIO2.val < (values->FIO2.setpoint + values->FIO2.thresh_lower));
-    alarm_tone = alarm_tone | alarm_run_state(&values->alarms.fio2, tripped);
-
-    // Check low battery, no need for state machine, this is driven directly from the GPIO
-    tripped = (HAL_GPIO_ReadPin(GPIOB, LOW_BATTERY_Pin) == GPIO_PIN_RESET);
-    alarm_tone = alarm_tone | alarm_run_state(&values->alarms.low_power, tripped);
+void alarm_set_status(Alarms* alarms, uint32_t index, AlarmStatus status) {
+    SW_ASSERT(alarms);
+    SW_ASSERT(index < ALARM_COUNT);
+    Alarm* alarm = &((Alarm*)alarms)[index];
+    alarm->status = status;
+    alarm_mask_update(index, status, (m_alarm_masks.sounding & (1 << ALARM_TABLE[index].shift)) != 0);
+}
 
-    // Best attempt at machine fault
-    tripped = SW_ASSERT_FLAG; // For parallelism with other alarms
-    alarm_tone = alarm_tone | alarm_run_state(&values->alarms.machine_fault, tripped);
-    return alarm_tone;
+const AlarmMasks* alarm_masks(void) {
+    return &m_alarm_masks;
 }
 
 void alarm_clear(Alarms* alarms) {
     SW_ASSERT(alarms);
     alarm_silence(alarms); // Silence alarms first
-    alarms->machine_fault.status = ALARM_OFF;
-    alarms->power_off.status = ALARM_OFF;
-    alarms->fio2.status = ALARM_OFF;
-    alarms->resp_rate.status = ALARM_OFF;
-    alarms->peak_press.status = ALARM_OFF;
-    alarms->tidal_vol.status = ALARM_OFF;
-    alarms->peep.status = ALARM_OFF;
-    alarms->disconnect.status = ALARM_OFF;
-    alarms->low_power.status = ALARM_OFF;
-    // Clear counts too
-    alarms->machine_fault.count = 0;
-    alarms->power_off.count = 0;
-    alarms->fio2.count = 0;
-    alarms->resp_rate.count = 0;
-    alarms->peak_press.count = 0;
-    alarms->tidal_vol.count = 0;
-    alarms->peep.count = 0;
-    alarms->disconnect.count = 0;
-    alarms->low_power.count = 0;
+    (void) memset(alarms, 0, sizeof(Alarms)); // ALARM_OFF, and clear counts too
+    (void) memset(&m_alarm_masks, 0, sizeof(AlarmMasks));
 }
 
 void alarm_silence(Alarms* alarms) {
@@ -143,7 +171,7 @@ void alarm_silence(Alarms* alarms) {
 
 void alarm_run(NumericalValues* values, PowerState state) {
     SW_ASSERT(values);
-    // set up boolean for alarm tone
+    // Detection leaves the tone in the sounding mask
     uint8_t alarm_tone = alarm_detect(values);
     // Countdown on the alarm, and sound if the countdown is zero, and a tone should be generated
     ALARM_SOUND_COUNTDOWN = (ALARM_SOUND_COUNTDOWN == 0) ? 0 :   ALARM_SOUND_COUNTDOWN - 1;
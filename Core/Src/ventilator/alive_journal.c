@@ -0,0 +1,99 @@
+/*
+ * alive_journal.c:
+ *
+ * Implementation of the wear-leveled alive-minutes journal. See alive_journal.h for the layout.
+ */
+#include <swassert.h>
+#include <ventilator/alive_journal.h>
+#include <ventilator/types.h>
+
+STATIC AliveJournalEntry m_journal_entry;        // Entry being written, held until the write completes
+STATIC volatile bool m_journal_writing = false;  // A write of m_journal_entry is queued or on the bus
+STATIC volatile uint32_t m_journal_sequence = 0; // Sequence of the next entry
+
+/**
+ * Read the entry of a journal page.
+ * uint32_t index: page within the journal
+ * AliveJournalEntry* entry: (output) entry read
+ * return: true when read and valid for the page
+ */
+bool alive_journal_read(uint32_t index, AliveJournalEntry* entry) {
+    SW_ASSERT1(index < EEPROM_JOURNAL_PAGES, index);
+    uint16_t address = (EEPROM_JOURNAL_FIRST_PAGE + index) * EEPROM_PAGE_SIZE;
+    if (eeprom_read_bytes(address, (uint8_t*)entry, sizeof(AliveJournalEntry)) != EEPROM_OK) {
+        return false;
+    }
+    return (entry->check == (ALIVE_JOURNAL_CHECK ^ entry->sequence ^ entry->minutes)) &&
+           ((entry->sequence % EEPROM_JOURNAL_PAGES) == index);
+}
+
+uint32_t alive_journal_load(void) {
+    AliveJournalEntry first;
+    AliveJournalEntry entry;
+    m_journal_writing = false;
+    if (!alive_journal_read(0, &first)) {
+        // The newest entry ends a pass when the write starting the next pass was torn
+        if (alive_journal_read(EEPROM_JOURNAL_PAGES - 1, &entry)) {
+            m_journal_sequence = entry.sequence + 1;
+            return entry.minutes;
+        }
+        // Empty journal, continue from the count of the legacy record unless the EEPROM is blank
+        uint32_t minutes = 0;
+        m_journal_sequence = 0;
+        if ((readEeprom(EEPROM_ALIVE_MINUTES, &minutes) != EEPROM_OK) || (minutes == ALIVE_JOURNAL_ERASED)) {
+            return 0;
+        }
+        return minutes;
+    }
+    // Pages holding the pass started at the first page continue its sequence, the rest hold the previous pass or were
+    // never written. Binary search for the last page continuing the sequence.
+    AliveJournalEntry newest = first;
+    uint32_t low = 0;
+    uint32_t high = EEPROM_JOURNAL_PAGES - 1;
+    while (low < high) {
+        uint32_t middle = (low + high + 1) >> 1;
+        if (alive_journal_read(middle, &entry) && (entry.sequence == (first.sequence + middle))) {
+            low = middle;
+            newest = entry;
+        } else {
+            high = middle - 1;
+        }
+    }
+    m_journal_sequence = newest.sequence + 1;
+    return newest.minutes;
+}
+
+/**
+ * Completion of an entry write. The sequence only advances once the entry is written, so a failed write is retried in
+ * the same page and the sequence of the pages never skips.
+ */
+void alive_journal_write_complete(EepromStatus status, void* context) {
+    (void) context;
+    if (status == EEPROM_OK) {
+        m_journal_sequence = m_journal_entry.sequence + 1;
+    }
+    m_journal_writing = false;
+}
+
+EepromStatus alive_journal_record(uint32_t minutes) {
+    // The EEPROM queue always completes a write, so the previous entry is still being written
+    if (m_journal_writing) {
+        return EEPROM_BUSY;
+    }
+    uint32_t sequence = m_journal_sequence;
+    m_journal_entry.sequence = sequence;
+    m_journal_entry.minutes = minutes;
+    m_journal_entry.check = ALIVE_JOURNAL_CHECK ^ sequence ^ minutes;
+    m_journal_writing = true;
+    uint16_t address = (EEPROM_JOURNAL_FIRST_PAGE + (sequence % EEPROM_JOURNAL_PAGES)) * EEPROM_PAGE_SIZE;
+    EepromStatus status = eeprom_write_bytes(address, (uint8_t*)&m_journal_entry, sizeof(AliveJournalEntry),
+                                             alive_journal_write_complete, NULL);
+    if (status != EEPROM_OK) {
+        m_journal_writing = false;
+    }
+    return status;
+}
+
+uint32_t alive_journal_sequence(void) {
+    return m_journal_sequence;
+}
@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <ventilator/display.h>
 #include <ventilator/types.h>
+#include <ventilator/alarm.h>
 #include <ventilator/panel_public.h>
 #include <ventilator/controller.h>
 #include <main.h>
@@ -23,7 +24,7 @@ void generic_assert_helper(void) {
         // Hail Mary machine fault to LED
         display_machine_fault();
         // Hail Mary send values to controller, don't react to returned values, just continue to inform controller
-        p_numericalValues.alarms.machine_fault.status = ALARM_LATCH;
+        alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(machine_fault), ALARM_LATCH);
         (void) do_controller_cycle();
     }
     assert(0);
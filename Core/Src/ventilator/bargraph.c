@@ -45,20 +45,36 @@ uint32_t bargraph_scaled_value(int32_t value, int32_t shift, int32_t height) {
     return result;
 }
 
+uint32_t bargraph_scaled_reciprocal(int32_t value, int32_t shift, int32_t height, uint32_t reciprocal) {
+    if (value <= shift) {
+        return 0;
+    }
+    // Shift value to bottom of chart
+    value = value - shift;
+    if (value >= height) {
+        return BARGRAPH_DISPLAY_HEIGHT;
+    }
+    // Scale the value to the chart, multiplying by the reciprocal of the height as the M0 has no divide
+    uint32_t scaled = (value * BARGRAPH_DISPLAY_HEIGHT) + (BARGRAPH_DISPLAY_HEIGHT/2);
+    return (scaled * reciprocal) >> BARGRAPH_RECIPROCAL_SHIFT;
+}
+
+uint32_t bargraph_scaled_tidal(int32_t value) {
+    return bargraph_scaled_reciprocal(value, BARGRAPH_TIDAL_SHIFT, BARGRAPH_TIDAL_HEIGHT, BARGRAPH_RECIPROCAL(BARGRAPH_TIDAL_HEIGHT));
+}
+
+uint32_t bargraph_scaled_pressure(int32_t value) {
+    return bargraph_scaled_reciprocal(value, BARGRAPH_PRESSURE_SHIFT, BARGRAPH_PRESSURE_HEIGHT,
+                                      BARGRAPH_RECIPROCAL(BARGRAPH_PRESSURE_HEIGHT));
+}
+
 void bargraph_assign_single_point(GreenBarGraph* bargraph, uint32_t value) {
     SW_ASSERT(bargraph != 0);
     SW_ASSERT1(value <= 40, value);
-    if (value == 0) {
-        return;
-    }
     // Assign a single point. **Assume the value already cleared**
-    if (value > 32) {
-        bargraph->upper |= 1 << (value - 33);
-    } else if (value > 16) {
-        bargraph->middle |= 1 << (value - 17);
-    } else {
-        bargraph->lower |= 1 << (value - 1);
-    }
+    bargraph->upper |= BARGRAPH_POINT_TABLE[value].upper;
+    bargraph->middle |= BARGRAPH_POINT_TABLE[value].middle;
+    bargraph->lower |= BARGRAPH_POINT_TABLE[value].lower;
 }
 
 void bargraph_assign_triple_point(GreenBarGraph* bargraph, uint32_t value1, uint32_t value2, uint32_t value3, uint32_t value4) {
@@ -88,41 +104,17 @@ void bargraph_assign_red_green_value(GreenBarGraph* green, GreenBarGraph* red, u
     SW_ASSERT1(yellow <= 40, yellow);
     //Green has all three points
     bargraph_assign_triple_point(green, green_upper, green_mid, green_lower, yellow);
-    // Red assigns only a single point, that matches for a "yellow"ish, and a single red-only point
-    red->lower = 0;
-    red->middle = 0;
-    red->upper = 0;
-    bargraph_assign_single_point(red, yellow);  // Set the single point of 0-40 for the bargraph
-    // (A LSB) represents the high order bits for the lower 2 words, but the lower bits for the upper word
-    // (B MSB) represents the lower order bits for the lower 2 words, and is disconnected on the upper word
-    // All individual bytes have reversed-ordered bits (LSB becomes MSB etc)
-    // Since memory is little endian, and the registers are little endian then only the top byt need to be swapped
-    red->lower = little_to_big16(reverse_bit_order(red->lower));
-    red->middle = little_to_big16(reverse_bit_order(red->middle));
-    red->upper = reverse_bit_order(red->upper);
+    // Red assigns only a single point, that matches for a "yellow"ish, and a single red-only point. The table holds the
+    // point already converted to the order the expanders are wired in.
+    *red = BARGRAPH_RED_POINT_TABLE[yellow];
 }
 
 void bargraph_assign_value(GreenBarGraph* bargraph, uint32_t value) {
     // Contractual checks
     SW_ASSERT(bargraph != 0);
     SW_ASSERT1(value <= 40, value);
-    bargraph->upper = 0;
-    bargraph->middle = 0;
-    bargraph->lower = bargraph_get_u16_helper(value > 16 ? 16 : value);
-    // Prevent overflow by only assigning if more than 16
-    if (value > 16) {
-        value -= 16;
-        bargraph->middle = bargraph_get_u16_helper(value > 16 ? 16 : value);
-        // Another protection against overflow
-        if (value > 16) {
-            value -= 16;
-            bargraph->upper = bargraph_get_u16_helper(value > 16 ? 16 : value);
-        }
-    }
-    bargraph->upper = little_to_big16(reverse_bit_order(bargraph->upper));
-    bargraph->middle = little_to_big16(reverse_bit_order(bargraph->middle));
-    bargraph->lower = little_to_big16(reverse_bit_order(bargraph->lower));
-
+    // Level fills are precomputed in the wire order, see bargraph_table.c
+    *bargraph = BARGRAPH_LEVEL_TABLE[value];
 }
 
 uint16_t bargraph_get_u16_helper(uint32_t value) {
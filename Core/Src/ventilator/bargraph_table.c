@@ -0,0 +1,142 @@
+/*
+ * bargraph_table.c:
+ *
+ * Bargraph words for each level, generated by Test/bargraph_generator.c. Do not edit, regenerate with
+ * "make -f Makefile.bargraph generate_bargraph_table" from the Test directory.
+ */
+#include <ventilator/bargraph.h>
+
+// Level fill of the green bargraphs, in wire order
+const GreenBarGraph BARGRAPH_LEVEL_TABLE[BARGRAPH_DISPLAY_HEIGHT + 1] = {
+    {0x0000, 0x0000, 0x0000}, // 0
+    {0x0000, 0x0000, 0x8000}, // 1
+    {0x0000, 0x0000, 0xC000}, // 2
+    {0x0000, 0x0000, 0xE000}, // 3
+    {0x0000, 0x0000, 0xF000}, // 4
+    {0x0000, 0x0000, 0xF800}, // 5
+    {0x0000, 0x0000, 0xFC00}, // 6
+    {0x0000, 0x0000, 0xFE00}, // 7
+    {0x0000, 0x0000, 0xFF00}, // 8
+    {0x0000, 0x0000, 0xFF80}, // 9
+    {0x0000, 0x0000, 0xFFC0}, // 10
+    {0x0000, 0x0000, 0xFFE0}, // 11
+    {0x0000, 0x0000, 0xFFF0}, // 12
+    {0x0000, 0x0000, 0xFFF8}, // 13
+    {0x0000, 0x0000, 0xFFFC}, // 14
+    {0x0000, 0x0000, 0xFFFE}, // 15
+    {0x0000, 0x0000, 0xFFFF}, // 16
+    {0x0000, 0x8000, 0xFFFF}, // 17
+    {0x0000, 0xC000, 0xFFFF}, // 18
+    {0x0000, 0xE000, 0xFFFF}, // 19
+    {0x0000, 0xF000, 0xFFFF}, // 20
+    {0x0000, 0xF800, 0xFFFF}, // 21
+    {0x0000, 0xFC00, 0xFFFF}, // 22
+    {0x0000, 0xFE00, 0xFFFF}, // 23
+    {0x0000, 0xFF00, 0xFFFF}, // 24
+    {0x0000, 0xFF80, 0xFFFF}, // 25
+    {0x0000, 0xFFC0, 0xFFFF}, // 26
+    {0x0000, 0xFFE0, 0xFFFF}, // 27
+    {0x0000, 0xFFF0, 0xFFFF}, // 28
+    {0x0000, 0xFFF8, 0xFFFF}, // 29
+    {0x0000, 0xFFFC, 0xFFFF}, // 30
+    {0x0000, 0xFFFE, 0xFFFF}, // 31
+    {0x0000, 0xFFFF, 0xFFFF}, // 32
+    {0x8000, 0xFFFF, 0xFFFF}, // 33
+    {0xC000, 0xFFFF, 0xFFFF}, // 34
+    {0xE000, 0xFFFF, 0xFFFF}, // 35
+    {0xF000, 0xFFFF, 0xFFFF}, // 36
+    {0xF800, 0xFFFF, 0xFFFF}, // 37
+    {0xFC00, 0xFFFF, 0xFFFF}, // 38
+    {0xFE00, 0xFFFF, 0xFFFF}, // 39
+    {0xFF00, 0xFFFF, 0xFFFF}  // 40
+};
+
+// Single point of the red/green green bargraph, in bit order
+const GreenBarGraph BARGRAPH_POINT_TABLE[BARGRAPH_DISPLAY_HEIGHT + 1] = {
+    {0x0000, 0x0000, 0x0000}, // 0
+    {0x0000, 0x0000, 0x0001}, // 1
+    {0x0000, 0x0000, 0x0002}, // 2
+    {0x0000, 0x0000, 0x0004}, // 3
+    {0x0000, 0x0000, 0x0008}, // 4
+    {0x0000, 0x0000, 0x0010}, // 5
+    {0x0000, 0x0000, 0x0020}, // 6
+    {0x0000, 0x0000, 0x0040}, // 7
+    {0x0000, 0x0000, 0x0080}, // 8
+    {0x0000, 0x0000, 0x0100}, // 9
+    {0x0000, 0x0000, 0x0200}, // 10
+    {0x0000, 0x0000, 0x0400}, // 11
+    {0x0000, 0x0000, 0x0800}, // 12
+    {0x0000, 0x0000, 0x1000}, // 13
+    {0x0000, 0x0000, 0x2000}, // 14
+    {0x0000, 0x0000, 0x4000}, // 15
+    {0x0000, 0x0000, 0x8000}, // 16
+    {0x0000, 0x0001, 0x0000}, // 17
+    {0x0000, 0x0002, 0x0000}, // 18
+    {0x0000, 0x0004, 0x0000}, // 19
+    {0x0000, 0x0008, 0x0000}, // 20
+    {0x0000, 0x0010, 0x0000}, // 21
+    {0x0000, 0x0020, 0x0000}, // 22
+    {0x0000, 0x0040, 0x0000}, // 23
+    {0x0000, 0x0080, 0x0000}, // 24
+    {0x0000, 0x0100, 0x0000}, // 25
+    {0x0000, 0x0200, 0x0000}, // 26
+    {0x0000, 0x0400, 0x0000}, // 27
+    {0x0000, 0x0800, 0x0000}, // 28
+    {0x0000, 0x1000, 0x0000}, // 29
+    {0x0000, 0x2000, 0x0000}, // 30
+    {0x0000, 0x4000, 0x0000}, // 31
+    {0x0000, 0x8000, 0x0000}, // 32
+    {0x0001, 0x0000, 0x0000}, // 33
+    {0x0002, 0x0000, 0x0000}, // 34
+    {0x0004, 0x0000, 0x0000}, // 35
+    {0x0008, 0x0000, 0x0000}, // 36
+    {0x0010, 0x0000, 0x0000}, // 37
+    {0x0020, 0x0000, 0x0000}, // 38
+    {0x0040, 0x0000, 0x0000}, // 39
+    {0x0080, 0x0000, 0x0000}  // 40
+};
+
+// Single point of the red/green red bargraph, in wire order
+const GreenBarGraph BARGRAPH_RED_POINT_TABLE[BARGRAPH_DISPLAY_HEIGHT + 1] = {
+    {0x0000, 0x0000, 0x0000}, // 0
+    {0x0000, 0x0000, 0x8000}, // 1
+    {0x0000, 0x0000, 0x4000}, // 2
+    {0x0000, 0x0000, 0x2000}, // 3
+    {0x0000, 0x0000, 0x1000}, // 4
+    {0x0000, 0x0000, 0x0800}, // 5
+    {0x0000, 0x0000, 0x0400}, // 6
+    {0x0000, 0x0000, 0x0200}, // 7
+    {0x0000, 0x0000, 0x0100}, // 8
+    {0x0000, 0x0000, 0x0080}, // 9
+    {0x0000, 0x0000, 0x0040}, // 10
+    {0x0000, 0x0000, 0x0020}, // 11
+    {0x0000, 0x0000, 0x0010}, // 12
+    {0x0000, 0x0000, 0x0008}, // 13
+    {0x0000, 0x0000, 0x0004}, // 14
+    {0x0000, 0x0000, 0x0002}, // 15
+    {0x0000, 0x0000, 0x0001}, // 16
+    {0x0000, 0x8000, 0x0000}, // 17
+    {0x0000, 0x4000, 0x0000}, // 18
+    {0x0000, 0x2000, 0x0000}, // 19
+    {0x0000, 0x1000, 0x0000}, // 20
+    {0x0000, 0x0800, 0x0000}, // 21
+    {0x0000, 0x0400, 0x0000}, // 22
+    {0x0000, 0x0200, 0x0000}, // 23
+    {0x0000, 0x0100, 0x0000}, // 24
+    {0x0000, 0x0080, 0x0000}, // 25
+    {0x0000, 0x0040, 0x0000}, // 26
+    {0x0000, 0x0020, 0x0000}, // 27
+    {0x0000, 0x0010, 0x0000}, // 28
+    {0x0000, 0x0008, 0x0000}, // 29
+    {0x0000, 0x0004, 0x0000}, // 30
+    {0x0000, 0x0002, 0x0000}, // 31
+    {0x0000, 0x0001, 0x0000}, // 32
+    {0x0080, 0x0000, 0x0000}, // 33
+    {0x0040, 0x0000, 0x0000}, // 34
+    {0x0020, 0x0000, 0x0000}, // 35
+    {0x0010, 0x0000, 0x0000}, // 36
+    {0x0008, 0x0000, 0x0000}, // 37
+    {0x0004, 0x0000, 0x0000}, // 38
+    {0x0002, 0x0000, 0x0000}, // 39
+    {0x0001, 0x0000, 0x0000}  // 40
+};
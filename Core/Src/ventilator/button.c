@@ -13,6 +13,21 @@
 #include <string.h>
 #include <swassert.h>
 
+// Button table, in ButtonId order
+STATIC const ButtonConfig BUTTON_TABLE[BUTTON_ID_NUM_BUTTONS] = {
+    [BUTTON_ID_SET_FIO_ALARM] = {BUTTON_TYPE_TOGGLE,                   0, BUTTON_MASK_SET_FIO_ALARM, 0},
+    [BUTTON_ID_SET_PEEP]      = {BUTTON_TYPE_TOGGLE,                   0, BUTTON_MASK_SET_PEEP,      0},
+    [BUTTON_ID_SET_TV]        = {BUTTON_TYPE_TOGGLE,                   0, BUTTON_MASK_SET_TV,        0},
+    [BUTTON_ID_SET_BUR]       = {BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD, 0, BUTTON_MASK_SET_BUR,       BUTTON_DELAY},
+    [BUTTON_ID_SET_PEAK]      = {BUTTON_TYPE_TOGGLE,                   0, BUTTON_MASK_SET_PEAK,      0},
+    [BUTTON_ID_SET_ITIME]     = {BUTTON_TYPE_TOGGLE,                   0, BUTTON_MASK_SET_ITIME,     0},
+    [BUTTON_ID_POWER_DOWN]    = {BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD, 0, BUTTON_MASK_POWER_DOWN,    POWER_OFF_DELAY},
+    [BUTTON_ID_ALRM_SILENCE]  = {BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD, 0, BUTTON_MASK_ALRM_SILENCE,  ALARM_CLEAR_DELAY},
+    [BUTTON_ID_GET_PLAT]      = {BUTTON_TYPE_MOMENTARY,                0, BUTTON_MASK_GET_PLAT,      0},
+    [BUTTON_ID_ADJ_DWN]       = {BUTTON_TYPE_MOMENTARY,                0, BUTTON_MASK_ADJ_DWN,       0},
+    [BUTTON_ID_ADJ_UP]        = {BUTTON_TYPE_MOMENTARY,                0, BUTTON_MASK_ADJ_UP,        0}
+};
+
 STATIC ButtonState m_button_state[BUTTON_ID_NUM_BUTTONS];
 STATIC ButtonId m_button_in_progress;
 STATIC ButtonId m_adjust_button_in_progress;
@@ -20,94 +35,207 @@ STATIC uint32_t m_edit_timeout;
 
 STATIC McpHandle m_button_mcp_handle;
 
+STATIC volatile bool m_button_edge_pending;  // Set by the expander interrupt, cleared once the capture is read
+STATIC volatile uint32_t m_button_edge_tick; // HAL tick of the most recent expander interrupt
+STATIC bool m_button_settling;               // Captured edge is waiting out the debounce time
+STATIC uint16_t m_button_capture;            // INTCAP value latched from the last edge
+STATIC uint16_t m_button_reading;            // Debounced button reading
+STATIC bool m_button_detected;               // The last detection read the expander, and m_button_reading is this cycle's
+
+/**
+ * Expander read queued on the I2C queue.
+ */
+typedef enum {
+    BUTTON_READ_NONE,
+    BUTTON_READ_CAPTURE, // INTFA/B, INTCAPA/B of an edge
+    BUTTON_READ_CONFIRM  // GPIOA/B once the debounce time has passed
+} ButtonRead;
+
+STATIC ButtonRead m_button_read;                       // Read queued and not yet collected
+STATIC volatile bool m_button_read_done;               // Set by the I2C queue once the read completes
+STATIC volatile HAL_StatusTypeDef m_button_read_status;
+STATIC uint16_t m_button_read_buffer[2];               // Destination of the queued read
+STATIC uint32_t m_button_read_faults;                  // Consecutive cycles with a failed read, or a read outstanding from an earlier cycle
+
+// Button events, queued by decode_button_state and taken by process_buttons. The indices run free, and wrap with the queue.
+STATIC ButtonEvent m_button_events[BUTTON_EVENT_QUEUE_SIZE];
+STATIC volatile uint8_t m_button_event_head;  // Next entry written by the producer
+STATIC volatile uint8_t m_button_event_tail;  // Next entry read by the consumer
+STATIC volatile bool m_button_events_lost;    // An event was dropped on a full queue, the consumer resyncs from the positions
+STATIC PanelButtons m_button_positions;       // Buttons down in the last decoded reading
+STATIC PanelButtons m_button_down;            // Buttons down as applied from the events
+STATIC uint16_t m_button_live;                // Buttons out of IDLE after the last processing, a bit per ButtonId
+
 
 void init_button_state(void) {
+    uint32_t i = 0;
     SW_ASSERT(mcp23017_init(&m_button_mcp_handle, 0x24, 1) == HAL_OK);
-    // initialize button state
-    m_button_state[BUTTON_ID_SET_FIO_ALARM].type = BUTTON_TYPE_TOGGLE;
-    m_button_state[BUTTON_ID_SET_FIO_ALARM].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_SET_FIO_ALARM].wait = 0;
-    m_button_state[BUTTON_ID_SET_FIO_ALARM].count = 0;
-
-    m_button_state[BUTTON_ID_SET_PEEP].type = BUTTON_TYPE_TOGGLE;
-    m_button_state[BUTTON_ID_SET_PEEP].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_SET_PEEP].wait = 0;
-    m_button_state[BUTTON_ID_SET_PEEP].count = 0;
-
-    m_button_state[BUTTON_ID_SET_TV].type = BUTTON_TYPE_TOGGLE;
-    m_button_state[BUTTON_ID_SET_TV].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_SET_TV].wait = 0;
-    m_button_state[BUTTON_ID_SET_TV].count = 0;
-
-    m_button_state[BUTTON_ID_SET_BUR].type = BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD;
-    m_button_state[BUTTON_ID_SET_BUR].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_SET_BUR].wait = BUTTON_DELAY;
-    m_button_state[BUTTON_ID_SET_BUR].count = 0;
-
-    m_button_state[BUTTON_ID_SET_PEAK].type = BUTTON_TYPE_TOGGLE;
-    m_button_state[BUTTON_ID_SET_PEAK].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_SET_PEAK].wait = 0;
-    m_button_state[BUTTON_ID_SET_PEAK].count = 0;
-
-    m_button_state[BUTTON_ID_SET_ITIME].type = BUTTON_TYPE_TOGGLE;
-    m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_SET_ITIME].wait = 0;
-    m_button_state[BUTTON_ID_SET_ITIME].count = 0;
-
-    m_button_state[BUTTON_ID_POWER_DOWN].type = BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD;
-    m_button_state[BUTTON_ID_POWER_DOWN].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_POWER_DOWN].wait = POWER_OFF_DELAY;
-    m_button_state[BUTTON_ID_POWER_DOWN].count = 0;
-
-    m_button_state[BUTTON_ID_ALRM_SILENCE].type = BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD;
-    m_button_state[BUTTON_ID_ALRM_SILENCE].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_ALRM_SILENCE].wait = ALARM_CLEAR_DELAY;
-    m_button_state[BUTTON_ID_ALRM_SILENCE].count = 0;
-
-    m_button_state[BUTTON_ID_GET_PLAT].type = BUTTON_TYPE_MOMENTARY;
-    m_button_state[BUTTON_ID_GET_PLAT].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_GET_PLAT].wait = 0;
-    m_button_state[BUTTON_ID_GET_PLAT].count = 0;
-
-    m_button_state[BUTTON_ID_ADJ_DWN].type = BUTTON_TYPE_MOMENTARY;
-    m_button_state[BUTTON_ID_ADJ_DWN].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_ADJ_DWN].wait = 0;
-    m_button_state[BUTTON_ID_ADJ_DWN].count = 0;
-
-    m_button_state[BUTTON_ID_ADJ_UP].type = BUTTON_TYPE_MOMENTARY;
-    m_button_state[BUTTON_ID_ADJ_UP].state = BUTTON_STATE_IDLE;
-    m_button_state[BUTTON_ID_ADJ_UP].wait = 0;
-    m_button_state[BUTTON_ID_ADJ_UP].count = 0;
+    // Take the initial reading, which also clears any interrupt raised before the EXTI was listening
+    SW_ASSERT(mcp23017_read_reg(&m_button_mcp_handle, REG_GPIOA, (uint8_t*)&m_button_reading, 2) == HAL_OK);
+    m_button_capture = m_button_reading;
+    m_button_settling = false;
+    m_button_edge_pending = false;
+    m_button_read = BUTTON_READ_NONE;
+    m_button_read_done = false;
+    m_button_read_faults = 0;
+    m_button_detected = false;
+    // initialize button state, the type and wait of each button are in the button table
+    for (i = 0; i < BUTTON_ID_NUM_BUTTONS; i++) {
+        m_button_state[i].state = BUTTON_STATE_IDLE;
+        m_button_state[i].count = 0;
+    }
     m_button_in_progress = BUTTON_NONE;
     m_adjust_button_in_progress = BUTTON_NONE;
     m_edit_timeout = 0;
+    m_button_event_head = 0;
+    m_button_event_tail = 0;
+    m_button_events_lost = false;
+    m_button_positions = 0;
+    m_button_down = 0;
+    m_button_live = (1 << BUTTON_ID_NUM_BUTTONS) - 1; // Run every numerical edit once to settle the display modes
+}
+
+void button_interrupt(void) {
+    m_button_edge_tick = HAL_GetTick();
+    m_button_edge_pending = true;
+}
+
+/**
+ * I2C queue completion of an expander read.
+ */
+void button_read_complete(HAL_StatusTypeDef status, void* context) {
+    (void) context;
+    m_button_read_status = status;
+    m_button_read_done = true;
+}
+
+/**
+ * Queue an expander read, returning false if the queue is full.
+ */
+bool button_queue_read(ButtonRead read, uint8_t reg, uint8_t size) {
+    m_button_read_done = false;
+    m_button_read = read;
+    if (mcp23017_read_reg_async(&m_button_mcp_handle, reg, (uint8_t*)m_button_read_buffer, size, button_read_complete, NULL) != HAL_OK) {
+        m_button_read = BUTTON_READ_NONE;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Collect the result of a completed expander read. Returns false when the read failed. Failures are counted by the I2C queue.
+ */
+bool button_collect_read(void) {
+    ButtonRead read = m_button_read;
+    if ((read == BUTTON_READ_NONE) || !m_button_read_done) {
+        return true;
+    }
+    m_button_read = BUTTON_READ_NONE;
+    if (m_button_read_status != HAL_OK) {
+        // Retry a failed capture, a failed confirmation is retried as the debounce time has already passed
+        m_button_edge_pending = m_button_edge_pending || (read == BUTTON_READ_CAPTURE);
+        return false;
+    }
+    if (read == BUTTON_READ_CAPTURE) {
+        m_button_capture = m_button_read_buffer[1];
+        m_button_settling = true;
+    }
+    // Accept a confirmation matching the capture, unless a new edge arrived while it was read
+    else if (!m_button_edge_pending) {
+        if (m_button_read_buffer[0] == m_button_capture) {
+            m_button_reading = m_button_capture;
+            m_button_settling = false;
+        } else {
+            // Still bouncing, restart the debounce time from the confirmation
+            m_button_capture = m_button_read_buffer[0];
+            m_button_edge_tick = HAL_GetTick();
+        }
+    }
+    return true;
 }
 
 bool detect_button_state(PanelButtons* val) {
-    static uint16_t last_reading = 0;  // Static tracking of last reading on the button.
-    static uint16_t last_reading_same_count = 0;  // Count of reading the buttons exactly
-    uint16_t buttonsm = 0; //Masked buttons readings
-    uint16_t buttons1 = 0;
-    uint16_t buttons2 = 0;
-    uint16_t buttons3 = 0;
+    bool success = true;
+    bool outstanding = false;
     SW_ASSERT(val != NULL);
-    // Buttons are read three times sequentially in order to determine the truth of the state of the button. This is
-    // the most basic button de-bounce. Every one of the three reads must return the same value, or an error is reported
-    // and the buttons must be read again.
-    SW_ASSERT(mcp23017_read_reg(&m_button_mcp_handle, REG_GPIOA, (uint8_t*)&buttons1, 2) == HAL_OK);
-    SW_ASSERT(mcp23017_read_reg(&m_button_mcp_handle, REG_GPIOA, (uint8_t*)&buttons2, 2) == HAL_OK);
-    SW_ASSERT(mcp23017_read_reg(&m_button_mcp_handle, REG_GPIOA, (uint8_t*)&buttons3, 2) == HAL_OK);
-    buttonsm = (buttons1 & 0x3BFC); // Complete used button mask
-
-    // Check for error status, or inconsistent reads
-    if ((buttons1 != buttons2) || (buttons2 != buttons3) || (buttons1 != buttons3)) {
-        p_uartDebug.fswStats.switchI2CErrors++;
+    // Expander reads are queued on the I2C queue and collected once complete, normally by the next cycle. The result of a read
+    // queued by the last cycle is collected before queuing the next read, and again after in case the read has already completed.
+    success = button_collect_read();
+    outstanding = (m_button_read != BUTTON_READ_NONE);
+    if (!outstanding) {
+        // The expander raises its INT line on any change of the button inputs, and holds it until the capture is read. A high line
+        // without a pending edge means an edge was missed (i.e. raised while the last capture was being read), so it is treated as a
+        // new edge.
+        if (!m_button_edge_pending && (HAL_GPIO_ReadPin(GPIOB, BTN_INTA_Pin) == GPIO_PIN_SET)) {
+            button_interrupt();
+        }
+        // Latch the interrupt flags and captured inputs of a new edge. This clears the expander interrupt so any further bounce
+        // raises a new edge, restarting the debounce time.
+        if (m_button_edge_pending) {
+            m_button_edge_pending = false;
+            if (!button_queue_read(BUTTON_READ_CAPTURE, REG_INTFA, 2 * sizeof(uint16_t))) {
+                m_button_edge_pending = true;
+                success = false;
+            }
+        }
+        // Confirm the capture once no edge has been seen for the debounce time. The inputs are read once to confirm they still
+        // match the capture, as changes while the interrupt is already raised are not captured.
+        else if (m_button_settling && ((HAL_GetTick() - m_button_edge_tick) >= BUTTON_DEBOUNCE_MS)) {
+            success = button_queue_read(BUTTON_READ_CONFIRM, REG_GPIOA, sizeof(uint16_t)) && success;
+        }
+        success = button_collect_read() && success;
+    }
+    // A dead expander, or a read the I2C queue never completes, would leave the panel ignoring the operator. Reads dropped by a
+    // reset of the I2C queue complete as failed, so both are counted here and trip a machine fault as the blocking reads did.
+    if (!success || outstanding) {
+        m_button_read_faults += 1;
+        SW_ASSERT1(m_button_read_faults < BUTTON_READ_FAULT_CYCLES, m_button_read_faults);
+    } else {
+        m_button_read_faults = 0;
+    }
+    if (!success) {
         return false;
     }
+    decode_button_state(m_button_reading, val);
+    return true;
+}
+
+/**
+ * Queue a button event. A full queue drops the event and flags the loss, as the consumer can resync from the positions.
+ */
+STATIC void button_event_put(ButtonId id, ButtonEventType type) {
+    uint8_t head = m_button_event_head;
+    if ((uint8_t)(head - m_button_event_tail) >= BUTTON_EVENT_QUEUE_SIZE) {
+        m_button_events_lost = true;
+        return;
+    }
+    m_button_events[head & (BUTTON_EVENT_QUEUE_SIZE - 1)].id = id;
+    m_button_events[head & (BUTTON_EVENT_QUEUE_SIZE - 1)].type = type;
+    m_button_event_head = head + 1; // Publish the entry once written
+}
+
+bool button_event_take(ButtonEvent* event) {
+    SW_ASSERT(event != NULL);
+    uint8_t tail = m_button_event_tail;
+    if (tail == m_button_event_head) {
+        return false;
+    }
+    *event = m_button_events[tail & (BUTTON_EVENT_QUEUE_SIZE - 1)];
+    m_button_event_tail = tail + 1; // Release the entry once read
+    return true;
+}
+
+void decode_button_state(uint16_t reading, PanelButtons* val) {
+    static uint16_t last_reading_same_count = 0;  // Count of reading the buttons exactly
+    PanelButtons buttons = reading & BUTTON_MASK_ALL;
+    PanelButtons changed = panel_buttons_changed(buttons, m_button_positions);
+    uint32_t i = 0;
+    SW_ASSERT(val != NULL);
+
     // Implement button-stuck count. If any series of button presses remains continuously pressed for the full set of cycles will set a fault.
     // This is considered rare unless: buttons are sticking (true positive) or a user is attempting to fault the machine (false positive). There
     // is no way to distinguish between a permanently stuck button and a user holding a button down for the detection window.
-    else if ((last_reading & buttonsm) != 0) {
+    if ((m_button_positions & buttons) != 0) {
         last_reading_same_count += 1;
         SW_ASSERT(last_reading_same_count < BUTTON_STUCK_CYCLES); // Trip a machine fault if we have seen held down buttons for 60 seconds
     }
@@ -115,33 +243,14 @@ bool detect_button_state(PanelButtons* val) {
     else {
         last_reading_same_count = 0;
     }
-    last_reading = buttons1;
-    (void) memset(val, 0, sizeof(PanelButtons));
-    // Never trust ordering in bit fields
-    val->SET_FIO_ALRM_B = (buttons1 & 0x0080)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->SET_PEEP_B =     (buttons1 & 0x0040)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->SET_TV_B =       (buttons1 & 0x0020)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->SET_BUR_B =      (buttons1 & 0x0010)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->SET_PEAK_B =     (buttons1 & 0x0008)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->SET_ITIME_B =    (buttons1 & 0x0004)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->POWER_DOWN_B =   (buttons1 & 0x2000)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->ALRM_SILENCE_B = (buttons1 & 0x1000)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->GET_PLAT_B =     (buttons1 & 0x0800)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->ADJ_DWN_B =      (buttons1 & 0x0200)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    val->ADJ_UP_B =       (buttons1 & 0x0100)?BUTTON_POS_ON:BUTTON_POS_OFF;
-    // summary; BUTTON_POS_ON means at least one set
-    val->ALL_BUTTONS = ((val->SET_FIO_ALRM_B) ||
-                        (val->SET_PEEP_B) ||
-                        (val->SET_TV_B) ||
-                        (val->SET_BUR_B) ||
-                        (val->SET_PEAK_B) ||
-                        (val->SET_ITIME_B) ||
-                        (val->POWER_DOWN_B) ||
-                        (val->ALRM_SILENCE_B) ||
-                        (val->GET_PLAT_B) ||
-                        (val->ADJ_DWN_B) ||
-                        (val->ADJ_UP_B)) ? BUTTON_POS_ON : BUTTON_POS_OFF;
-    return true;
+    // Queue an event for each button that changed since the last reading
+    for (i = 0; (i < BUTTON_ID_NUM_BUTTONS) && (changed != 0); i++) {
+        if (panel_button_down(changed, BUTTON_TABLE[i].mask)) {
+            button_event_put((ButtonId)i, panel_button_down(buttons, BUTTON_TABLE[i].mask) ? BUTTON_EVENT_PRESS : BUTTON_EVENT_RELEASE);
+        }
+    }
+    m_button_positions = buttons;
+    *val = buttons;
 }
 
 bool isAdjustActionable(ButtonId id) {
@@ -199,12 +308,12 @@ void updateButtonPressSm(ButtonId id) {
     if (isButtonActionable(id)) {
         switch (m_button_state[id].state) {
             case BUTTON_STATE_IDLE:
-                switch (m_button_state[id].type) {
+                switch (BUTTON_TABLE[id].type) {
                     case BUTTON_TYPE_PRESS_TO_HOLD: // fall through
                     case BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD:
                         // copy the wait time to the countdown and switch state to in press progress
                         m_button_state[id].state = BUTTON_STATE_PRESS_TO_HOLD;
-                        m_button_state[id].count = m_button_state[id].wait;
+                        m_button_state[id].count = BUTTON_TABLE[id].wait;
                         break;
                     case BUTTON_TYPE_TOGGLE:
                         // if state is idle, switch to waiting for release
@@ -214,7 +323,7 @@ void updateButtonPressSm(ButtonId id) {
                         m_button_state[id].state = BUTTON_STATE_WAITING_FOR_RELEASE_IDLE;
                         break;
                     default:
-                        SW_ASSERT1(0,m_button_state[id].type);
+                        SW_ASSERT1(0,BUTTON_TABLE[id].type);
                         return; // for code checkers
                 }
                 m_button_in_progress = id;
@@ -222,7 +331,7 @@ void updateButtonPressSm(ButtonId id) {
             case BUTTON_STATE_PRESS_TO_HOLD:
                 // if state is in progress, count down time to hold
                 if (0 == --m_button_state[id].count) {
-                    if (BUTTON_TYPE_PRESS_TO_HOLD == m_button_state[id].type) {
+                    if (BUTTON_TYPE_PRESS_TO_HOLD == BUTTON_TABLE[id].type) {
                         // change to modify state
                         m_button_state[m_button_in_progress].state = BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY;
                         // start beep
@@ -280,7 +389,7 @@ void updateButtonReleaseSm(void) {
     else if (m_button_in_progress != BUTTON_NONE) {
         switch (m_button_state[m_button_in_progress].state) {
             case BUTTON_STATE_PRESS_TO_HOLD:
-                if (BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD == m_button_state[m_button_in_progress].type) {
+                if (BUTTON_TYPE_TOGGLE_AND_PRESS_TO_HOLD == BUTTON_TABLE[m_button_in_progress].type) {
                     // button is toggled instead of held, so go to modify state
                     m_button_state[m_button_in_progress].state = BUTTON_STATE_MODIFY;
                     (void) sound_start(SOUND_BEEP);
@@ -303,7 +412,7 @@ void updateButtonReleaseSm(void) {
                 break;
             case BUTTON_STATE_WAITING_FOR_RELEASE_IDLE:
                  // if the button was waiting to be released, go to idle state
-                 if (BUTTON_TYPE_MOMENTARY == m_button_state[m_button_in_progress].type) {
+                 if (BUTTON_TYPE_MOMENTARY == BUTTON_TABLE[m_button_in_progress].type) {
                      m_button_state[m_button_in_progress].state = BUTTON_STATE_MOMENTARY_DONE;
                  } else {
                      m_button_state[m_button_in_progress].state = BUTTON_STATE_IDLE;
@@ -335,69 +444,42 @@ void updateButtonReleaseSm(void) {
     }
 }
 
-void run_button_state_machines(PanelButtons* val) {
-    SW_ASSERT(val);
-    // If button is released, update any waiting button presses otherwise processes each button that could
-    // be set, looking for which one was pressed.
-    if (BUTTON_POS_OFF == val->ALL_BUTTONS) {
+/**
+ * Run the state machines on the buttons held. Only the first button held in ButtonId order is run.
+ */
+STATIC void button_run_state_machines(PanelButtons down) {
+    uint32_t id = 0;
+    // If button is released, update any waiting button presses otherwise processes the button that was pressed
+    if (down == 0) {
         updateButtonReleaseSm();
         SW_ASSERT(m_edit_timeout < 0xFFFFFFFF); // Fail if about to overflow
         m_edit_timeout += 1; // Increase in-action timeout
     } else {
         m_edit_timeout = 0; // A button is currently pressed, this resets the timeout
-        // SET_FIO_ALRM_B
-        if (BUTTON_POS_ON == val->SET_FIO_ALRM_B) {
-            updateButtonPressSm(BUTTON_ID_SET_FIO_ALARM);
-        }
-        // SET_PEEP_B
-        else if (BUTTON_POS_ON == val->SET_PEEP_B) {
-            updateButtonPressSm(BUTTON_ID_SET_PEEP);
-        }
-        // SET_TV_B
-        else if (BUTTON_POS_ON == val->SET_TV_B) {
-            updateButtonPressSm(BUTTON_ID_SET_TV);
-        }
-        // SET_BUR_B
-        else if (BUTTON_POS_ON == val->SET_BUR_B) {
-            updateButtonPressSm(BUTTON_ID_SET_BUR);
-        }
-        // SET_PEAK_B
-        else if (BUTTON_POS_ON == val->SET_PEAK_B) {
-            updateButtonPressSm(BUTTON_ID_SET_PEAK);
-        }
-        // SET_ITIME_B
-        else if (BUTTON_POS_ON == val->SET_ITIME_B) {
-            updateButtonPressSm(BUTTON_ID_SET_ITIME);
-        }
-        // POWER_DOWN_B
-        else if (BUTTON_POS_ON == val->POWER_DOWN_B) {
-            updateButtonPressSm(BUTTON_ID_POWER_DOWN);
+        while (!panel_button_down(down, BUTTON_TABLE[id].mask)) {
+            id++;
         }
-        // ALRM_SILENCE_B
-        else if (BUTTON_POS_ON == val->ALRM_SILENCE_B) {
-            updateButtonPressSm(BUTTON_ID_ALRM_SILENCE);
-        }
-        // GET_PLAT_B
-        else if (BUTTON_POS_ON == val->GET_PLAT_B) {
-            updateButtonPressSm(BUTTON_ID_GET_PLAT);
-        }
-        // ADJ_DWN_B
-        else if (BUTTON_POS_ON == val->ADJ_DWN_B) {
-            updateAdjustPressSm(BUTTON_ID_ADJ_DWN);
-        }
-        // ADJ_UP_B
-        else if (BUTTON_POS_ON == val->ADJ_UP_B) {
-            updateAdjustPressSm(BUTTON_ID_ADJ_UP);
-        }
-        // Expected some press
-        else {
-            SW_ASSERT(0);
+        if (id < BUTTON_ID_ADJ_DWN) {
+            updateButtonPressSm((ButtonId)id);
+        } else {
+            updateAdjustPressSm((ButtonId)id);
         }
     }
     run_special_button_states();
 }
 
+void run_button_state_machines(PanelButtons val) {
+    // Only the buttons of the table are run
+    button_run_state_machines(val & BUTTON_MASK_ALL);
+}
+
 void run_special_button_states() {
+    // Nothing to act on while the special buttons are idle
+    if ((m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_IDLE) &&
+        (m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_IDLE) &&
+        (m_button_state[BUTTON_ID_GET_PLAT].state == BUTTON_STATE_IDLE)) {
+        return;
+    }
     // act on non-display related buttons
 
     // check power button state.
@@ -537,32 +619,88 @@ void update_fio2_numerical_states(ButtonPressState state, NumericalValue* fio2)
 
 void run_buttons() {
     PanelButtons buttons;
-    if (detect_button_state(&buttons)) {
-        // Process the button state and detect the
-        run_button_state_machines(&buttons);
-        // Update the button state for the 4 buttons that all operate similarly
-        // Must reset display here for non-handled cases
+    m_button_detected = detect_button_state(&buttons);
+    if (m_button_detected) {
+        process_buttons();
+    }
+}
+
+bool button_reading(uint16_t* reading) {
+    SW_ASSERT(reading != NULL);
+    *reading = m_button_reading;
+    return m_button_detected;
+}
+
+/**
+ * Mask of the buttons out of IDLE, a bit per ButtonId.
+ */
+STATIC uint16_t button_live_mask(void) {
+    uint16_t mask = 0;
+    uint32_t i = 0;
+    for (i = 0; i < BUTTON_ID_NUM_BUTTONS; i++) {
+        mask |= (m_button_state[i].state != BUTTON_STATE_IDLE) ? (1 << i) : 0;
+    }
+    return mask;
+}
+
+void process_buttons(void) {
+    ButtonEvent event;
+    bool events = false;
+    uint16_t live = 0;
+    // Apply the queued events to the buttons held
+    while (button_event_take(&event)) {
+        m_button_down = (event.type == BUTTON_EVENT_PRESS) ? (m_button_down | BUTTON_TABLE[event.id].mask) :
+                                                             (m_button_down & ~BUTTON_TABLE[event.id].mask);
+        events = true;
+    }
+    if (m_button_events_lost) {
+        m_button_events_lost = false;
+        m_button_down = m_button_positions;
+        events = true;
+    }
+    // Idle: nothing changed, nothing held, and every state machine rests in IDLE
+    if (!events && (m_button_down == 0) && (m_button_live == 0)) {
+        return;
+    }
+    // Process the button state and detect the
+    button_run_state_machines(m_button_down);
+    // Numerical edits run for the buttons out of IDLE, and once more as they return to it to restore the display mode
+    live = m_button_live | button_live_mask();
+    // Update the button state for the 4 buttons that all operate similarly
+    // Must reset display here for non-handled cases
+    if ((live & (1 << BUTTON_ID_SET_PEEP)) != 0) {
         p_numericalValues.PEEP.mode = DISPLAY_SETPOINT;
-        p_numericalValues.ins_time.mode = DISPLAY_SETPOINT;
-        p_numericalValues.tidal_volume.mode = DISPLAY_SETPOINT;
-        p_numericalValues.peak_pressure.mode = DISPLAY_SETPOINT;
         update_button_numerical_state(m_button_state[BUTTON_ID_SET_PEEP].state, &p_numericalValues.PEEP);
+    }
+    if ((live & (1 << BUTTON_ID_SET_ITIME)) != 0) {
+        p_numericalValues.ins_time.mode = DISPLAY_SETPOINT;
         update_button_numerical_state(m_button_state[BUTTON_ID_SET_ITIME].state,&p_numericalValues.ins_time);
+    }
+    if ((live & (1 << BUTTON_ID_SET_TV)) != 0) {
+        p_numericalValues.tidal_volume.mode = DISPLAY_SETPOINT;
         update_button_numerical_state(m_button_state[BUTTON_ID_SET_TV].state,   &p_numericalValues.tidal_volume);
+    }
+    if ((live & (1 << BUTTON_ID_SET_PEAK)) != 0) {
+        p_numericalValues.peak_pressure.mode = DISPLAY_SETPOINT;
         update_button_numerical_state(m_button_state[BUTTON_ID_SET_PEAK].state, &p_numericalValues.peak_pressure);
+    }
+    if ((live & (1 << BUTTON_ID_SET_BUR)) != 0) {
         update_backup_rate_numerical_states(m_button_state[BUTTON_ID_SET_BUR].state, &p_numericalValues.backup_rate,  &p_numericalValues.resp_rate);
+    }
+    if ((live & (1 << BUTTON_ID_SET_FIO_ALARM)) != 0) {
         update_fio2_numerical_states(m_button_state[BUTTON_ID_SET_FIO_ALARM].state, &p_numericalValues.FIO2);
-        // Extra safety checks amount to PEEP / PEAK inversion. This forces the values to prevent inversion on the active button.
-        // If PEEP is active, its edit-point *may not* go above peak pressure's current setpoint
-        if ((m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_MODIFY) &&
-            (p_numericalValues.PEEP.editval > p_numericalValues.peak_pressure.setpoint)) {
-            p_numericalValues.PEEP.editval = p_numericalValues.peak_pressure.setpoint;
-        }
-        // If peak pressure is active, its edit-point *may not* go above peak pressure's current setpoint
-        else if ((m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_MODIFY) &&
-                 (p_numericalValues.peak_pressure.editval < p_numericalValues.PEEP.setpoint)) {
-            p_numericalValues.peak_pressure.editval = p_numericalValues.PEEP.setpoint;
-        }
     }
+    // Extra safety checks amount to PEEP / PEAK inversion. This forces the values to prevent inversion on the active button.
+    // If PEEP is active, its edit-point *may not* go above peak pressure's current setpoint
+    if ((m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_MODIFY) &&
+        (p_numericalValues.PEEP.editval > p_numericalValues.peak_pressure.setpoint)) {
+        p_numericalValues.PEEP.editval = p_numericalValues.peak_pressure.setpoint;
+    }
+    // If peak pressure is active, its edit-point *may not* go above peak pressure's current setpoint
+    else if ((m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_MODIFY) &&
+             (p_numericalValues.peak_pressure.editval < p_numericalValues.PEEP.setpoint)) {
+        p_numericalValues.peak_pressure.editval = p_numericalValues.PEEP.setpoint;
+    }
+    m_button_live = button_live_mask();
 }
 
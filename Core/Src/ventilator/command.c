@@ -0,0 +1,249 @@
+/*
+ * command.c:
+ *
+ * Implementation of the debug UART command channel. Frames are found in place in the RX ring between the read index
+ * and the DMA write index: the scan looks for the sync bytes, waits until the whole frame has arrived, and checks its
+ * CRC over the ring. A command's fields are only copied out of the ring as it runs. The scan stops after one frame so
+ * that only one command runs, and at most one CRC is checked, each cycle. A trend page read holds further parsing
+ * until its reply is queued.
+ */
+#include <string.h>
+#include <swassert.h>
+#include <ventilator/command.h>
+#include <ventilator/crc.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/parameters.h>
+#include <ventilator/profiler.h>
+#include <ventilator/trend.h>
+#include <ventilator/trace.h>
+#include <ventilator/panel_public.h>
+
+STATIC uint8_t m_command_rx[COMMAND_RX_SIZE];     // Written circularly by the RX DMA
+STATIC uint32_t m_command_read = 0;               // Index of the next byte to parse, the start of any frame
+STATIC uint32_t m_command_payload = 0;            // Index of the payload of the command being run
+STATIC uint8_t m_command_length = 0;              // Payload length of the command being run
+STATIC uint32_t m_command_errors = 0;             // Frames failing their CRC, or too long for the ring
+STATIC uint32_t m_command_invalid = 0;            // Unknown or malformed commands
+STATIC CommandTrendPage m_command_page;           // Reply of the trend page read
+STATIC volatile bool m_command_reading = false;   // A trend page read is queued
+STATIC volatile bool m_command_read_done = false; // The read completed with m_command_read_status
+STATIC volatile EepromStatus m_command_read_status = EEPROM_OK;
+
+void command_init(void) {
+    m_command_read = 0;
+    m_command_errors = 0;
+    m_command_invalid = 0;
+    m_command_reading = false;
+    m_command_read_done = false;
+    SW_ASSERT(command_dma_start(m_command_rx, COMMAND_RX_SIZE) == HAL_OK);
+}
+
+/**
+ * Byte of the RX ring, the index wrapping around it.
+ */
+uint8_t command_byte(uint32_t index) {
+    return m_command_rx[index & (COMMAND_RX_SIZE - 1)];
+}
+
+/**
+ * crc16 of bytes of the RX ring, which may wrap around its end.
+ */
+uint16_t command_crc(uint32_t index, uint32_t size) {
+    uint32_t offset = index & (COMMAND_RX_SIZE - 1);
+    uint32_t first = ((offset + size) > COMMAND_RX_SIZE) ? (COMMAND_RX_SIZE - offset) : size;
+    return crc16_update(crc16(&m_command_rx[offset], first), m_command_rx, size - first);
+}
+
+/**
+ * Copy the start of the running command's payload out of the RX ring, into the field it is used as.
+ */
+void command_payload(void* data, uint32_t size) {
+    uint32_t first = ((m_command_payload + size) > COMMAND_RX_SIZE) ? (COMMAND_RX_SIZE - m_command_payload) : size;
+    SW_ASSERT1(size <= m_command_length, size);
+    (void) memcpy(data, &m_command_rx[m_command_payload], first);
+    (void) memcpy((uint8_t*)data + first, m_command_rx, size - first);
+}
+
+/**
+ * Queue a reply. A reply dropped on a full telemetry ring is retried by the host.
+ */
+void command_reply(uint8_t type, const void* payload, uint8_t size) {
+    (void) telemetry_send(type | FRAME_TYPE_REPLY, payload, size);
+}
+
+/**
+ * Reject an unknown or malformed command.
+ */
+void command_reject(uint8_t type) {
+    m_command_invalid += 1;
+    (void) telemetry_send(FRAME_TYPE_REJECTED, &type, sizeof(type));
+}
+
+/**
+ * Read or set a parameter. Only the EEPROM_INIT_* records are settable. A set value is used at once and staged in the
+ * parameter block, which is written back until the EEPROM holds the values the controller uses.
+ */
+void command_parameter(uint8_t type, CommandParameter* parameter) {
+    int32_t values[PARAMETER_COUNT];
+    uint32_t i = 0;
+    uint32_t record = parameter->record;
+    parameter->status = COMMAND_OK;
+    if ((record == EEPROM_ALIVE_MINUTES) && (type == FRAME_TYPE_GET_PARAMETER)) {
+        parameter->value = (int32_t)p_aliveMinutes;
+    } else if ((record < PARAMETER_FIRST_RECORD) || (record >= EEPROM_NUM_RECORDS)) {
+        parameter->status = COMMAND_INVALID;
+    } else {
+        int32_t* field = parameters_field(&p_panel_packet.parameters, PARAMETER_INDEX(record));
+        if (type == FRAME_TYPE_SET_PARAMETER) {
+            for (i = 0; i < PARAMETER_COUNT; i++) {
+                values[i] = *parameters_field(&p_panel_packet.parameters, i);
+            }
+            values[PARAMETER_INDEX(record)] = parameter->value;
+            parameters_write(values);
+            *field = parameter->value;
+        }
+        parameter->value = *field;
+    }
+    command_reply(type, parameter, sizeof(CommandParameter));
+}
+
+/**
+ * Completion of the trend page read, may be called from interrupt context.
+ */
+void command_page_read(EepromStatus status, void* context) {
+    (void) context;
+    m_command_read_status = status;
+    m_command_read_done = true;
+}
+
+/**
+ * Queue the reply of a completed trend page read.
+ */
+void command_page_reply(void) {
+    m_command_page.status = (m_command_read_status == EEPROM_OK) ? COMMAND_OK : COMMAND_FAILED;
+    m_command_reading = false;
+    m_command_read_done = false;
+    command_reply(FRAME_TYPE_GET_TREND_PAGE, &m_command_page, sizeof(m_command_page));
+}
+
+/**
+ * Queue the read of a trend page, answered once the read completes.
+ */
+void command_trend_page(uint16_t age) {
+    (void) memset(&m_command_page, 0, sizeof(m_command_page));
+    m_command_page.age = age;
+    m_command_page.count = (uint16_t)trend_page_count();
+    m_command_reading = true;
+    m_command_read_done = false;
+    EepromStatus status = trend_queue_read_page(age, m_command_page.data, command_page_read, NULL);
+    if (status != EEPROM_OK) {
+        m_command_reading = false;
+        m_command_page.status = (status == EEPROM_BUSY) ? COMMAND_BUSY : COMMAND_INVALID;
+        command_reply(FRAME_TYPE_GET_TREND_PAGE, &m_command_page, sizeof(m_command_page));
+    } else if (m_command_read_done) {
+        command_page_reply();
+    }
+}
+
+/**
+ * Run the command found in the ring.
+ * uint8_t type: FrameType of the command
+ */
+void command_run(uint8_t type) {
+    uint8_t length = m_command_length;
+    CommandParameter parameter;
+    uint8_t flag = 0;
+    uint16_t age = 0;
+    switch (type) {
+        case FRAME_TYPE_GET_PARAMETER: // fall through
+        case FRAME_TYPE_SET_PARAMETER:
+            if (length != sizeof(parameter)) {
+                break;
+            }
+            command_payload(&parameter, sizeof(parameter));
+            command_parameter(type, &parameter);
+            return;
+        case FRAME_TYPE_GET_STATS:
+            if (length > 1) {
+                break;
+            }
+            command_reply(type, telemetry_status(), sizeof(TelemetryStatus));
+            if (length == 1) {
+                command_payload(&flag, sizeof(flag));
+            }
+            if (flag != 0) {
+                profiler_reset();
+            }
+            return;
+        case FRAME_TYPE_GET_TREND_PAGE:
+            if (length < sizeof(age)) {
+                break;
+            }
+            command_payload(&age, sizeof(age));
+            command_trend_page(age);
+            return;
+        case FRAME_TYPE_SET_TRACE:
+            if (length != 1) {
+                break;
+            }
+            command_payload(&flag, sizeof(flag));
+            trace_capture(flag != 0);
+            command_reply(type, &flag, sizeof(flag));
+            return;
+        default:
+            break;
+    }
+    command_reject(type);
+}
+
+void command_cycle(void) {
+    // Commands wait in the ring while a trend page is read
+    if (m_command_reading) {
+        if (m_command_read_done) {
+            command_page_reply();
+        }
+        return;
+    }
+    // The DMA counter runs down from the ring size, reloading as it wraps
+    uint32_t write = (COMMAND_RX_SIZE - command_dma_remaining()) & (COMMAND_RX_SIZE - 1);
+    while (m_command_read != write) {
+        uint32_t available = (write - m_command_read) & (COMMAND_RX_SIZE - 1);
+        // Skip to the sync bytes. A repeated first sync byte may still start a frame.
+        if ((command_byte(m_command_read) != FRAME_SYNC_FIRST) ||
+            ((available > 1) && (command_byte(m_command_read + 1) != FRAME_SYNC_SECOND))) {
+            m_command_read = (m_command_read + 1) & (COMMAND_RX_SIZE - 1);
+            continue;
+        }
+        if (available < FRAME_HEADER_SIZE) {
+            return;
+        }
+        uint8_t type = command_byte(m_command_read + 2);
+        uint32_t length = command_byte(m_command_read + 3);
+        uint32_t end = m_command_read + FRAME_HEADER_SIZE + length;
+        // A frame the ring cannot hold is dropped, as is one failing its CRC, resuming the scan after its first byte
+        if ((length + FRAME_OVERHEAD) >= COMMAND_RX_SIZE) {
+            m_command_errors += 1;
+            m_command_read = (m_command_read + 1) & (COMMAND_RX_SIZE - 1);
+            continue;
+        }
+        // Wait in place for the rest of the frame
+        if (available < (length + FRAME_OVERHEAD)) {
+            return;
+        }
+        uint16_t crc = (uint16_t)(command_byte(end) | (command_byte(end + 1) << 8));
+        if (command_crc(m_command_read + 2, length + 2) != crc) {
+            m_command_errors += 1;
+            m_command_read = (m_command_read + 1) & (COMMAND_RX_SIZE - 1);
+            return;
+        }
+        m_command_payload = (m_command_read + FRAME_HEADER_SIZE) & (COMMAND_RX_SIZE - 1);
+        m_command_length = (uint8_t)length;
+        m_command_read = (end + FRAME_CRC_SIZE) & (COMMAND_RX_SIZE - 1);
+        command_run(type);
+        return;
+    }
+}
+
+uint32_t command_rejected(void) {
+    return m_command_errors + m_command_invalid;
+}
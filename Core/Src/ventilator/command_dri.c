@@ -0,0 +1,29 @@
+/*
+ * command_dri.c:
+ *
+ * USART1 circular RX DMA for the command channel. As with the TX DMA, the channel is started directly rather than
+ * through HAL_UART_Receive_DMA, leaving the channel's interrupts disabled: the ring is only ever read by polling the
+ * DMA counter. The USART1 interrupt is not enabled, so receive errors are cleared when polling, as an overrun left set
+ * stops reception.
+ */
+#include <stm32f0xx_hal.h>
+#include <ventilator/command.h>
+#include <ventilator/panel_public.h>
+
+extern DMA_HandleTypeDef hdma_usart1_rx;
+
+HAL_StatusTypeDef command_dma_start(uint8_t* data, uint16_t size) {
+    HAL_StatusTypeDef status = HAL_DMA_Start(&hdma_usart1_rx, (uint32_t)(uintptr_t)&huart1.Instance->RDR,
+                                             (uint32_t)(uintptr_t)data, size);
+    if (status == HAL_OK) {
+        __HAL_UART_CLEAR_FLAG(&huart1, UART_CLEAR_OREF | UART_CLEAR_NEF | UART_CLEAR_FEF);
+        SET_BIT(huart1.Instance->CR3, USART_CR3_DMAR);
+    }
+    return status;
+}
+
+uint16_t command_dma_remaining(void) {
+    // Bytes with noise or framing errors are still received, and parsed frames fail their CRC
+    __HAL_UART_CLEAR_FLAG(&huart1, UART_CLEAR_OREF | UART_CLEAR_NEF | UART_CLEAR_FEF);
+    return (uint16_t)__HAL_DMA_GET_COUNTER(&hdma_usart1_rx);
+}
@@ -6,10 +6,22 @@
 #include <string.h>
 #include <ventilator/constants.h>
 #include <ventilator/types.h>
+#include <ventilator/alarm.h>
+#include <ventilator/controller.h>
+#include <ventilator/profiler.h>
 
+STATIC uint32_t m_controller_max_latency = 0; // Longest exchange in profiler ticks
+
+// Reciprocal of 98 for pascal_to_cmh2O: ceil(2^38 / 98). The product error stays below one for every 31 bit magnitude.
+#define PASCAL_PER_CMH2O_RECIPROCAL 2804876602u
+#define PASCAL_PER_CMH2O_SHIFT 38
 
 int32_t pascal_to_cmh2O(int32_t pascal) {
-    return pascal/98; //Exact conversion "/ 98.0665" has less error then one digit across range
+    //Exact conversion "/ 98.0665" has less error then one digit across range. Divides by 98 with a reciprocal multiply
+    // on the magnitude, truncating toward zero as "pascal/98" does.
+    uint32_t magnitude = (pascal < 0) ? (0u - (uint32_t)pascal) : (uint32_t)pascal;
+    uint32_t quotient = (uint32_t)(((uint64_t)magnitude * PASCAL_PER_CMH2O_RECIPROCAL) >> PASCAL_PER_CMH2O_SHIFT);
+    return (pascal < 0) ? -(int32_t)quotient : (int32_t)quotient;
 }
 
 int32_t cmh2O_to_pascal(int32_t cmh2o) {
@@ -17,10 +29,18 @@ int32_t cmh2O_to_pascal(int32_t cmh2o) {
 }
 
 int32_t bpm_to_ms_period(int32_t bpm) {
-    //Integer rounding doesn't work in reciprocals, so do floats, and round at the end.
-    float bpmf = bpm;
-    bpmf = (60.0f * 1000.0f)/bpmf;
-    return (int32_t)(bpmf + 0.5f);
+    // No FPU, so the reciprocal is rounded in integers: 60000/bpm + 1/2 == (120000 + bpm) / (2 * bpm). Matches the
+    // truncation of the original float calculation "(int32_t)(60000.0f/bpm + 0.5f)" for every input, including negative
+    // inputs where the half is subtracted from the magnitude before truncating toward zero.
+    uint32_t magnitude = (bpm < 0) ? (0u - (uint32_t)bpm) : (uint32_t)bpm;
+    if (magnitude == 0) {
+        return INT32_MAX; // Float reciprocal of zero saturates
+    } else if (magnitude > (2 * MS_PER_MINUTE)) {
+        return 0; // Period rounds to zero, also keeps 2 * magnitude in range
+    } else if (bpm < 0) {
+        return -(int32_t)(((2 * MS_PER_MINUTE) - magnitude) / (2 * magnitude));
+    }
+    return (int32_t)(((2 * MS_PER_MINUTE) + magnitude) / (2 * magnitude));
 }
 
 void prepare_panel_packet(panel_packet_t* packet, NumericalValues* values, PowerState power_state, uint8_t plateau_count, uint8_t halt_vent) {
@@ -54,7 +74,7 @@ void process_control_packet(controller_packet_t* packet, NumericalValues* values
 
     sensor_data_t sensors = packet->sensors;
     // Raw sensor values
-    values->alarms.machine_fault.status = (packet->error_field != 0) ? ALARM_SET : ALARM_OFF;
+    alarm_set_status(&values->alarms, ALARM_INDEX(machine_fault), (packet->error_field != 0) ? ALARM_SET : ALARM_OFF);
     values->tidal_volume.val = sensors.tidal_volume;
     values->minute_volume.val = sensors.minute_volume;
     values->tidal_volume_last.val = sensors.last_breath_tidal_volume;
@@ -71,18 +91,33 @@ void process_control_packet(controller_packet_t* packet, NumericalValues* values
     values->peep_pressure_average.val = pascal_to_cmh2O(sensors.peep_pressure_average);
 }
 
+const controller_packet_t* controller_last_packet(void) {
+    return &p_controler_packet;
+}
+
 HAL_StatusTypeDef do_controller_cycle(void) {
-    // Prepare for communication with the controller
-    (void) memset(&p_controler_packet, 0, sizeof(controller_packet_t));
+    // Prepare for communication with the controller. The incoming packet is only processed after a good exchange, which
+    // overwrites all of it, so it need not be cleared.
     prepare_panel_packet(&p_panel_packet, &p_numericalValues, p_powerState, p_doPlateau, p_haltVentilation);
     if (p_doPlateau > 0) {
         p_doPlateau = p_doPlateau - 1;
     }
-    // Send packet and receive response
-    HAL_StatusTypeDef status = if_txrx_packet(&hspi1, &p_panel_packet, &p_controler_packet, HAL_MAX_DELAY);
+    // Send packet and receive response, bounded so a stuck link cannot consume the cycle
+    uint32_t start = profiler_timestamp();
+    HAL_StatusTypeDef status = if_txrx_packet(&hspi1, &p_panel_packet, &p_controler_packet, CONTROLLER_SPI_TIMEOUT_MS);
+    uint32_t latency = profiler_timestamp() - start;
+    // Only convert to microseconds on a new maximum, the M0 has no hardware divide
+    if (latency > m_controller_max_latency) {
+        m_controller_max_latency = latency;
+        p_uartDebug.fswStats.controlMaxLatency = latency / PROFILE_TICKS_PER_US;
+    }
     // On good communication process the returned packet
     if (status == HAL_OK) {
         process_control_packet(&p_controler_packet, &p_numericalValues);
+    } else if (status == HAL_TIMEOUT) {
+        p_uartDebug.fswStats.controlSpiTimeouts++;
+    } else {
+        p_uartDebug.fswStats.controlSpiErrors++;
     }
     return status;
  }
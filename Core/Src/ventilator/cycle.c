@@ -16,7 +16,15 @@
 #include <ventilator/controller.h>
 #include <ventilator/watchdog.h>
 #include <ventilator/eeprom.h>
+#include <ventilator/alive_journal.h>
+#include <ventilator/parameters.h>
+#include <ventilator/trend.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/command.h>
 #include <ventilator/alarm.h>
+#include <ventilator/profiler.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/trace.h>
 
 // TEST_MODE always has an attached controller
 #ifndef TEST_MODE
@@ -29,17 +37,27 @@ void cycle(void) {
     static uint32_t cycle_count = 1; // Start at one, so increments only happen at 1 minute
     static uint32_t powering_cycle_count = 0; // Count to stay in powering state
     HAL_StatusTypeDef status = HAL_OK;
+    profiler_start(PROFILE_STAGE_WAIT);
     spin_on_incoming_watchdog();
+    profiler_stop(PROFILE_STAGE_WAIT);
+    profiler_start(PROFILE_STAGE_CYCLE);
     stroke_outgoing_watchdog(); // Note that we are still alive
+    i2c_queue_cycle(); // Recover the I2C bus if a transaction has stalled
+    eeprom_cycle(); // Advance queued EEPROM writes, polling for the end of a write cycle
+    parameters_cycle(); // Write back changed parameters once held, or retry a write that failed
+    trend_cycle(); // Queue the unwritten part of the trend log page
 // TEST_MODE performs basic hardware tests to validate the panel
 #ifdef TEST_MODE
     doTestCycle();
+    profiler_stop(PROFILE_STAGE_CYCLE);
     return;
 #endif
 
     // Communicate with the SPI controller here. Wait to do the rest of the cycle until we get the first HAL_OK from the controller. That
     // represents it is online and we should de-blank.
+    profiler_start(PROFILE_STAGE_CONTROLLER);
     status = do_controller_cycle();
+    profiler_stop(PROFILE_STAGE_CONTROLLER);
     if (status == HAL_OK) {
         CONTROLLER_ATTACHED = 1;
         reset_fail_safe_timer();
@@ -49,23 +67,37 @@ void cycle(void) {
         // Update alive-time in minutes count
         if ((cycle_count % (CYCLES_PER_SECOND * 60)) == 0) {
             p_aliveMinutes += 1;
-            SW_ASSERT(writeEeprom(EEPROM_ALIVE_MINUTES, p_aliveMinutes) == EEPROM_OK);
+            SW_ASSERT(alive_journal_record(p_aliveMinutes) == EEPROM_OK); // Queued, spread across the journal pages
+            trend_minute(p_aliveMinutes);
         }
         SW_ASSERT((p_aliveMinutes/60) < 2688);
         // Sound cycling should happen before any alarm setups or beeps
+        profiler_start(PROFILE_STAGE_SOUND);
         SW_ASSERT(sound_cycle() == HAL_OK);  // Always stroke sound first
+        profiler_stop(PROFILE_STAGE_SOUND);
         // Detect and handle button presses
+        profiler_start(PROFILE_STAGE_BUTTONS);
         run_buttons();
+        profiler_stop(PROFILE_STAGE_BUTTONS);
         // Run the detection for the alarm state as the last step before updating the display
+        profiler_start(PROFILE_STAGE_ALARM);
         alarm_run(&p_numericalValues, p_powerState);
+        profiler_stop(PROFILE_STAGE_ALARM);
+        // Trends are only kept while ventilating
+        if (p_powerState == POWER_ON_STATE) {
+            trend_sample(&p_numericalValues);
+        }
     }
     // Process display setup, blanking if we have not attached yet
+    profiler_start(PROFILE_STAGE_DISPLAY);
     run_display(!CONTROLLER_ATTACHED, p_aliveMinutes/60);
+    profiler_stop(PROFILE_STAGE_DISPLAY);
     // Powering on state machine creates a powering-on time to display the hour count.
     // Power off state resets cycle count time
     if (p_powerState == POWER_OFF_STATE) {
         powering_cycle_count = 0;
         cycle_count = 1;
+        parameters_flush(); // Nothing is held back in RAM while off
     }
     // Powering on before the power on time
     else if ((p_powerState == POWERING_STATE) && (powering_cycle_count < POWERING_ON_TIME)) {
@@ -77,4 +109,10 @@ void cycle(void) {
         p_powerState = POWER_ON_STATE;
         cycle_count += 1;
     }
+    // Record the inputs of the cycle for a replay, when capturing
+    trace_cycle(status, CONTROLLER_ATTACHED);
+    // Run a command from the debug UART, then queue the status frame behind its reply. Both are sent by DMA.
+    command_cycle();
+    telemetry_cycle();
+    profiler_stop(PROFILE_STAGE_CYCLE);
 }
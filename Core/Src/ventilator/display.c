@@ -8,6 +8,7 @@
 #include <ventilator/numerical.h>
 #include <ventilator/bargraph.h>
 #include <ventilator/mcp23017.h>
+#include <ventilator/i2c_queue.h>
 #include <ventilator/alarm.h>
 #include <ventilator/panel_public.h>
 #include <ventilator/types.h>
@@ -19,9 +20,17 @@
 
 STATIC uint32_t blink_cycle_count = 0;
 STATIC Display m_display;
+STATIC uint16_t m_display_tx[DISPLAY_U16_COUNT]; // Image being clocked out by DMA, stable while m_display is refilled
+STATIC GreenBarGraph m_display_red_committed;     // Red bargraph last written to the I2C expanders
+STATIC uint32_t m_display_forced = DISPLAY_DIRTY_ALL; // Devices to write regardless of content
+STATIC uint32_t m_display_refresh_count = 0;
+STATIC volatile uint32_t m_display_failed = DISPLAY_DIRTY_NONE; // Red writes the I2C queue reported as failed
 
 void display_init(void) {
     (void) memset(&m_display, 0, sizeof(Display));
+    m_display_forced = DISPLAY_DIRTY_ALL;
+    m_display_refresh_count = 0;
+    m_display_failed = DISPLAY_DIRTY_NONE;
     // Initialize each display output I2C
     SW_ASSERT(mcp23017_init(&m_display.mcp_lower, 0x20, 0) == HAL_OK);
     SW_ASSERT(mcp23017_init(&m_display.mcp_middle, 0x21, 0) == HAL_OK);
@@ -37,10 +46,11 @@ void display_init(void) {
 }
 
 void display_machine_fault(void) {
-    // Hail Mary machine fault to LED
+    // Hail Mary machine fault to LED. Drop queued I2C traffic, so the blocking writes own the bus.
+    i2c_queue_reset();
     display_init();
     m_display.alarm  = 1 << DISPLAY_ALARM_MACH_FALT_SHIFT;
-    (void) display_raw_send(); // Machine fault ignores failures
+    (void) display_raw_send_blocking(); // Machine fault ignores failures
 }
 
 uint32_t display_get_value_helper(NumericalValue value) {
@@ -74,39 +84,76 @@ void display_fill_output_helper(NumericalValues* values) {
     m_display.ins_time = m_display.ins_time | 1 << 12;
 
     // Assign normal green bargraphs
-    uint32_t scaled_tidal = bargraph_scaled_value(values->tidal_volume.val, BARGRAPH_TIDAL_SHIFT, BARGRAPH_TIDAL_HEIGHT);
-    uint32_t scaled_pressure = bargraph_scaled_value(values->pressure.val, BARGRAPH_PRESSURE_SHIFT, BARGRAPH_PRESSURE_HEIGHT);
+    uint32_t scaled_tidal = bargraph_scaled_tidal(values->tidal_volume.val);
+    uint32_t scaled_pressure = bargraph_scaled_pressure(values->pressure.val);
 
     bargraph_assign_value(&m_display.pressure, scaled_pressure);
     bargraph_assign_value(&m_display.tidal, scaled_tidal);
     // Assign the triple point red-green bargraph points
-    uint32_t scaled_pressure_lower = bargraph_scaled_value(values->pressure_min.val, BARGRAPH_PRESSURE_SHIFT, BARGRAPH_PRESSURE_HEIGHT);
-    uint32_t scaled_pressure_middle = bargraph_scaled_value(values->pressure_mean.val, BARGRAPH_PRESSURE_SHIFT, BARGRAPH_PRESSURE_HEIGHT);
-    uint32_t scaled_pressure_upper = bargraph_scaled_value(values->peak_pressure.val, BARGRAPH_PRESSURE_SHIFT, BARGRAPH_PRESSURE_HEIGHT);
-    uint32_t scaled_pressure_plateau = bargraph_scaled_value(values->pressure_plat.val, BARGRAPH_PRESSURE_SHIFT, BARGRAPH_PRESSURE_HEIGHT);
+    uint32_t scaled_pressure_lower = bargraph_scaled_pressure(values->pressure_min.val);
+    uint32_t scaled_pressure_middle = bargraph_scaled_pressure(values->pressure_mean.val);
+    uint32_t scaled_pressure_upper = bargraph_scaled_pressure(values->peak_pressure.val);
+    uint32_t scaled_pressure_plateau = bargraph_scaled_pressure(values->pressure_plat.val);
     bargraph_assign_red_green_value(&m_display.red_green_green, &m_display.red_green_red, scaled_pressure_upper, scaled_pressure_middle, scaled_pressure_lower,
                                     scaled_pressure_plateau);
-    //display->alarm = (uint16_t)values->alarms;
-    m_display.alarm =
-            ((values->alarms.disconnect.status != ALARM_OFF && values->alarms.disconnect.status != ALARM_BLINK_OFF) << DISPLAY_ALARM_DISCONNECT_SHIFT) |
-            ((values->alarms.tidal_vol.status != ALARM_OFF  && values->alarms.tidal_vol.status != ALARM_BLINK_OFF)  << DISPLAY_ALARM_TIDAL_VOL_SHIFT) |
-            ((values->alarms.peak_press.status != ALARM_OFF && values->alarms.peak_press.status != ALARM_BLINK_OFF) << DISPLAY_ALARM_PEAK_PRES_SHIFT) |
-            ((values->alarms.resp_rate.status != ALARM_OFF  && values->alarms.resp_rate.status != ALARM_BLINK_OFF)  << DISPLAY_ALARM_RESP_RATE_SHIFT) |
-            ((values->alarms.peep.status != ALARM_OFF       && values->alarms.peep.status != ALARM_BLINK_OFF)       << DISPLAY_ALARM_PEEP_PRES_SHIFT) |
-            ((values->alarms.fio2.status != ALARM_OFF       && values->alarms.fio2.status != ALARM_BLINK_OFF)       << DISPLAY_ALARM_FIO2_PERC_SHIFT) |
-            ((values->alarms.machine_fault.status != ALARM_OFF && values->alarms.machine_fault.status != ALARM_BLINK_OFF) << DISPLAY_ALARM_MACH_FALT_SHIFT) |
-            ((values->alarms.low_power.status != ALARM_OFF  && values->alarms.low_power.status != ALARM_BLINK_OFF)  << DISPLAY_ALARM_LOW_POWER_SHIFT) |
-            ((values->alarms.power_off.status != ALARM_OFF  && values->alarms.power_off.status != ALARM_BLINK_OFF)  << DISPLAY_ALARM_POWER_OFF_SHIFT);
+    // The alarm masks share the bit positions of the alarm LEDs
+    m_display.alarm = alarm_masks()->visible;
 }
 
-HAL_StatusTypeDef display_raw_send(void) {
-    SW_ASSERT(m_display.spi); // Check display has been initialized
+/**
+ * Latch the shifted-out image onto the display outputs and ensure the blank pin is low so the data doesn't get stopped at the output
+ * gate.
+ */
+void display_latch(void) {
+    HAL_GPIO_WritePin(GPIOB, m_display.latch, GPIO_PIN_SET);   //ON LATCH
+    HAL_GPIO_WritePin(GPIOB, m_display.latch, GPIO_PIN_RESET);  // OFF LATCH
+    HAL_GPIO_WritePin(GPIOB, m_display.blank, GPIO_PIN_RESET); // BLANK OFF
+}
+
+/**
+ * I2C queue completion of a red bargraph write. The context carries the dirty flag of the device, which is marked as failed.
+ */
+void display_write_red_complete(HAL_StatusTypeDef status, void* context) {
+    if (status != HAL_OK) {
+        m_display_failed |= (uint32_t)(uintptr_t)context;
+    }
+}
+
+/**
+ * Write one red bargraph word to its I2C expander when dirty, recording it as committed once written or queued. A write that
+ * finds the I2C queue full is deferred: it stays dirty and is retried on the next send, without failing this one. Writes are
+ * queued on the I2C queue unless blocking, which is only used on machine fault.
+ */
+HAL_StatusTypeDef display_write_red(uint32_t dirty, uint32_t flag, McpHandle* mcp, uint16_t* word, uint16_t* committed, bool blocking) {
+    HAL_StatusTypeDef status = HAL_OK;
+    if ((dirty & flag) == 0) {
+        return HAL_OK;
+    }
+    if (blocking) {
+        status = mcp23017_write_reg(mcp, REG_GPIOA, (uint8_t*)word, sizeof(uint16_t));
+    } else {
+        status = mcp23017_write_reg_async(mcp, REG_GPIOA, (uint8_t*)word, sizeof(uint16_t), display_write_red_complete,
+                                          (void*)(uintptr_t)flag);
+    }
+    if (status == HAL_OK) {
+        *committed = *word;
+    } else {
+        m_display_forced |= flag;
+    }
+    return ((status == HAL_BUSY) && !blocking) ? HAL_OK : status;
+}
+
+/**
+ * Write out the dirty I2C red bargraph words and update the alarm-bright LED.
+ */
+HAL_StatusTypeDef display_raw_send_i2c(uint32_t dirty, bool blocking) {
     HAL_StatusTypeDef timstat = HAL_OK;
-    // Write out the the SPI, and all three I2C devices. If any of these fail, the device could be displaying incorrect or miss-leading values.
-    HAL_StatusTypeDef stat0 = HAL_SPI_Transmit(m_display.spi, (uint8_t*)(&m_display), DISPLAY_U16_COUNT, HAL_MAX_DELAY);
-    HAL_StatusTypeDef stat1 = mcp23017_write_reg(&m_display.mcp_lower, REG_GPIOA, (uint8_t*)(&m_display.red_green_red.lower), sizeof(uint16_t));
-    HAL_StatusTypeDef stat2 = mcp23017_write_reg(&m_display.mcp_middle, REG_GPIOA, (uint8_t*)(&m_display.red_green_red.middle), sizeof(uint16_t));
-    HAL_StatusTypeDef stat3 = mcp23017_write_reg(&m_display.mcp_upper, REG_GPIOA, (uint8_t*)(&m_display.red_green_red.upper), sizeof(uint16_t));
+    HAL_StatusTypeDef stat1 = display_write_red(dirty, DISPLAY_DIRTY_MCP_LOWER, &m_display.mcp_lower, &m_display.red_green_red.lower,
+                                                &m_display_red_committed.lower, blocking);
+    HAL_StatusTypeDef stat2 = display_write_red(dirty, DISPLAY_DIRTY_MCP_MIDDLE, &m_display.mcp_middle, &m_display.red_green_red.middle,
+                                                &m_display_red_committed.middle, blocking);
+    HAL_StatusTypeDef stat3 = display_write_red(dirty, DISPLAY_DIRTY_MCP_UPPER, &m_display.mcp_upper, &m_display.red_green_red.upper,
+                                                &m_display_red_committed.upper, blocking);
     // Start the alarm-bright LED iff any alarm LED is on, otherwise the PWM should be stopped. In this way, the light is only on when
     // 1+ lesser LEDs is illuminated.  Flash it as the inverse of the screen blink (mostly off, short on)
     if (((m_display.alarm & ~(1 << DISPLAY_ALARM_POWER_OFF_SHIFT)) != 0) && (blink_cycle_count < DISPLAY_BLINK_OFF_CYCLES)) {
@@ -114,12 +161,69 @@ HAL_StatusTypeDef display_raw_send(void) {
     } else {
         timstat = HAL_TIM_PWM_Stop(&htim2, TIM_CHANNEL_1);
     }
-    // Commit display by setting the latch pins on and off to latch the data, and then ensure that the blank pin is low so the
-    // data doesn't get stopped at the output gate.
-    HAL_GPIO_WritePin(GPIOB, m_display.latch, GPIO_PIN_SET);   //ON LATCH
-    HAL_GPIO_WritePin(GPIOB, m_display.latch, GPIO_PIN_RESET);  // OFF LATCH
-    HAL_GPIO_WritePin(GPIOB, m_display.blank, GPIO_PIN_RESET); // BLANK OFF
-    return (timstat == HAL_OK && stat0 == HAL_OK && stat1 == HAL_OK && stat2 == HAL_OK && stat3 == HAL_OK)? HAL_OK : HAL_ERROR;
+    return (timstat == HAL_OK && stat1 == HAL_OK && stat2 == HAL_OK && stat3 == HAL_OK)? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * Compare the display image against the last committed image, returning the dirty flags of each device that must be written.
+ */
+uint32_t display_dirty_flags(void) {
+    uint32_t dirty = m_display_forced;
+    dirty |= (memcmp(m_display_tx, &m_display, sizeof(m_display_tx)) != 0) ? DISPLAY_DIRTY_SPI : DISPLAY_DIRTY_NONE;
+    dirty |= (m_display.red_green_red.lower != m_display_red_committed.lower) ? DISPLAY_DIRTY_MCP_LOWER : DISPLAY_DIRTY_NONE;
+    dirty |= (m_display.red_green_red.middle != m_display_red_committed.middle) ? DISPLAY_DIRTY_MCP_MIDDLE : DISPLAY_DIRTY_NONE;
+    dirty |= (m_display.red_green_red.upper != m_display_red_committed.upper) ? DISPLAY_DIRTY_MCP_UPPER : DISPLAY_DIRTY_NONE;
+    return dirty;
+}
+
+HAL_StatusTypeDef display_raw_send(void) {
+    SW_ASSERT(m_display.spi); // Check display has been initialized
+    HAL_StatusTypeDef stat0 = HAL_OK;
+    // Red writes that failed on the I2C queue since the last send are rewritten, and reported as a failure of this send
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t failed = m_display_failed;
+    m_display_failed = DISPLAY_DIRTY_NONE;
+    __set_PRIMASK(primask);
+    m_display_forced |= failed;
+    // Periodically rewrite everything as a safety net against the hardware losing its state
+    if (m_display_refresh_count == 0) {
+        m_display_forced = DISPLAY_DIRTY_ALL;
+    }
+    m_display_refresh_count = (m_display_refresh_count + 1) % DISPLAY_REFRESH_CYCLES;
+    uint32_t dirty = display_dirty_flags();
+    m_display_forced = DISPLAY_DIRTY_NONE;
+    // Write out the the SPI, and the changed I2C devices. If any of these fail, the device could be displaying incorrect or miss-leading
+    // values. The SPI words are copied so the DMA reads a stable image, and latched from display_transmit_complete once shifted out. The
+    // copy is also the committed image used to detect changes. A transfer still running a cycle later means the SPI is stuck, and is
+    // reported as a failure.
+    if ((dirty & DISPLAY_DIRTY_SPI) != 0) {
+        stat0 = HAL_ERROR;
+        if (HAL_SPI_GetState(m_display.spi) == HAL_SPI_STATE_READY) {
+            (void) memcpy(m_display_tx, &m_display, sizeof(m_display_tx));
+            stat0 = HAL_SPI_Transmit_DMA(m_display.spi, (uint8_t*)m_display_tx, DISPLAY_U16_COUNT);
+        }
+        if (stat0 != HAL_OK) {
+            m_display_forced |= DISPLAY_DIRTY_SPI;
+        }
+    }
+    HAL_StatusTypeDef stat1 = display_raw_send_i2c(dirty, false);
+    return (stat0 == HAL_OK && stat1 == HAL_OK && failed == DISPLAY_DIRTY_NONE)? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef display_raw_send_blocking(void) {
+    SW_ASSERT(m_display.spi); // Check display has been initialized
+    // Stop any DMA transfer in flight so that the blocking transfer owns the SPI
+    (void) HAL_SPI_Abort(m_display.spi);
+    HAL_StatusTypeDef stat0 = HAL_SPI_Transmit(m_display.spi, (uint8_t*)(&m_display), DISPLAY_U16_COUNT, HAL_MAX_DELAY);
+    HAL_StatusTypeDef stat1 = display_raw_send_i2c(DISPLAY_DIRTY_ALL, true);
+    display_latch();
+    m_display_forced = DISPLAY_DIRTY_ALL; // Committed image no longer tracks the hardware
+    return (stat0 == HAL_OK && stat1 == HAL_OK)? HAL_OK : HAL_ERROR;
+}
+
+void display_transmit_complete(void) {
+    display_latch();
 }
 
 void display_send_update(NumericalValues *values) {
@@ -144,8 +248,14 @@ void run_display(bool force_blank, uint32_t alive_hours) {
     }
 }
 
+const Display* display_image(void) {
+    return &m_display;
+}
+
 void display_blank(void) {
     HAL_GPIO_WritePin(m_display.gpio_port, m_display.blank, GPIO_PIN_SET);
+    // Only a latch releases the blank, so the next send must write the shift registers
+    m_display_forced |= DISPLAY_DIRTY_SPI;
 }
 
 void display_standby(uint32_t upper, uint32_t lower) {
@@ -2,33 +2,53 @@
 #include <ventilator/types.h>
 #include <ventilator/panel_public.h>
 #include <ventilator/constants.h>
+#include <ventilator/i2c_queue.h>
 #include <swassert.h>
 #include <stm32f0xx_hal.h>
 #include <assert.h>
+#include <string.h>
 
-EepromStatus readEeprom(const EepromRecordId id, uint32_t *val) {
-    SW_ASSERT(val);
-    SW_ASSERT1(id < EEPROM_NUM_RECORDS,id);
+/**
+ * State of the write at the head of the queue.
+ */
+typedef enum {
+    EEPROM_STATE_IDLE,    // No write started
+    EEPROM_STATE_WRITE,   // Data queued or on the bus
+    EEPROM_STATE_PROGRAM, // Device running its write cycle, poll next cycle
+    EEPROM_STATE_POLL     // Acknowledge poll queued or on the bus
+} EepromState;
 
-    uint16_t addr = little_to_big16(id * EEPROM_PAGE_SIZE);
+/**
+ * A queued write.
+ */
+typedef struct {
+    uint16_t address;
+    uint16_t size;
+    uint8_t* data;
+    uint8_t inline_data[EEPROM_WRITE_INLINE_SIZE];
+    EepromCallback callback;
+    void* context;
+} EepromWrite;
 
-    // first, do a dummy write to set the device internal address (spec page 10)
-    HAL_StatusTypeDef stat = HAL_I2C_Master_Transmit(&hi2c1, EEPROM_I2C_ADDR, (uint8_t*)&addr, sizeof(uint16_t), HAL_MAX_DELAY);
-    switch (stat) {
-        case HAL_OK:
-            break; // HAL OK is only valid status
-        case HAL_BUSY: // fall through
-        case HAL_TIMEOUT:
-            return EEPROM_BUSY;
-        case HAL_ERROR:
-            return EEPROM_ERROR;
-        default:
-            SW_ASSERT1(0,stat);
-            return EEPROM_ERROR;
-    }
+STATIC EepromWrite m_eeprom_writes[EEPROM_WRITE_QUEUE_DEPTH];
+STATIC uint8_t m_eeprom_head = 0;
+STATIC volatile uint8_t m_eeprom_count = 0;
+STATIC volatile EepromState m_eeprom_state = EEPROM_STATE_IDLE;
+STATIC uint32_t m_eeprom_polls = 0;        // Polls of the current write cycle
+STATIC uint8_t m_eeprom_poll_data = 0;     // Byte read by a poll, unused
+STATIC EepromStatus m_eeprom_last_status = EEPROM_OK;
+STATIC uint32_t m_eeprom_failures = 0;
+STATIC volatile bool m_eeprom_reading = false; // A queued read is pending
+STATIC EepromCallback m_eeprom_read_callback = NULL;
+STATIC void* m_eeprom_read_context = NULL;
 
-    // once the address is set, do a read to get the data
-    stat = HAL_I2C_Master_Receive(&hi2c1, EEPROM_I2C_ADDR, (uint8_t*)val, sizeof(uint32_t), HAL_MAX_DELAY);
+void eeprom_write_sent(HAL_StatusTypeDef status, void* context);
+void eeprom_poll_done(HAL_StatusTypeDef status, void* context);
+
+/**
+ * Convert the HAL status of an EEPROM transaction to an EepromStatus.
+ */
+EepromStatus eeprom_status(HAL_StatusTypeDef stat) {
     switch (stat) {
         case HAL_OK:
             return EEPROM_OK;
@@ -44,28 +64,218 @@ EepromStatus readEeprom(const EepromRecordId id, uint32_t *val) {
     return EEPROM_ERROR; // for code checkers, shouldn't get here
 }
 
+EepromStatus readEeprom(const EepromRecordId id, uint32_t *val) {
+    SW_ASSERT(val);
+    SW_ASSERT1(id < EEPROM_NUM_RECORDS,id);
+    return eeprom_read_bytes(id * EEPROM_PAGE_SIZE, (uint8_t*)val, sizeof(uint32_t));
+}
+
 EepromStatus writeEeprom(const EepromRecordId id, const uint32_t val) {
     SW_ASSERT1(id < EEPROM_NUM_RECORDS,id);
+    // The value is copied into the write queue
+    return eeprom_write_bytes(id * EEPROM_PAGE_SIZE, (uint8_t*)&val, sizeof(uint32_t), NULL, NULL);
+}
 
-    uint16_t data[3];
-    data[0] = little_to_big16(id * EEPROM_PAGE_SIZE); // first 16-bit word is address
-    data[1] = val;
-    data[2] = val >> 16;
+EepromStatus eeprom_read_bytes(uint16_t address, uint8_t* data, uint16_t size) {
+    SW_ASSERT(data);
+    SW_ASSERT1((address + size) <= (EEPROM_PAGE_COUNT * EEPROM_PAGE_SIZE), address);
+    // The device does not acknowledge during a write cycle, so let queued writes finish first
+    (void) eeprom_flush();
 
-    // write data (spec page 8)
-    HAL_StatusTypeDef stat = HAL_I2C_Master_Transmit(&hi2c1, EEPROM_I2C_ADDR, (uint8_t*)&data, sizeof(data), HAL_MAX_DELAY);
+    // A dummy write sets the device internal address (spec page 10), followed by a read to get the data. Sequential
+    // reads continue across pages. This waits on the I2C queue, so it is only used at initialization.
+    I2cTransaction transaction = {0};
+    transaction.addr = EEPROM_I2C_ADDR;
+    transaction.mem_addr = address;
+    transaction.mem_addr_size = sizeof(uint16_t);
+    transaction.op = I2C_OP_MEM_READ;
+    transaction.size = size;
+    transaction.data = data;
+    return eeprom_status(i2c_queue_transfer(I2C_PRIORITY_LOW, &transaction));
+}
 
-    switch (stat) {
-        case HAL_OK:
-            return EEPROM_OK;
-        case HAL_BUSY: // fall through
-        case HAL_TIMEOUT:
+/**
+ * Completion of a queued read.
+ */
+void eeprom_read_done(HAL_StatusTypeDef status, void* context) {
+    (void) context;
+    m_eeprom_reading = false;
+    if (m_eeprom_read_callback != NULL) {
+        m_eeprom_read_callback(eeprom_status(status), m_eeprom_read_context);
+    }
+}
+
+EepromStatus eeprom_queue_read(uint16_t address, uint8_t* data, uint16_t size, EepromCallback callback, void* context) {
+    SW_ASSERT(data);
+    SW_ASSERT1((address + size) <= (EEPROM_PAGE_COUNT * EEPROM_PAGE_SIZE), address);
+    // The device does not acknowledge during a write cycle. Writes queued after the read run after it on the I2C queue.
+    if (m_eeprom_reading || !eeprom_idle()) {
+        return EEPROM_BUSY;
+    }
+    I2cTransaction transaction = {0};
+    transaction.addr = EEPROM_I2C_ADDR;
+    transaction.mem_addr = address;
+    transaction.mem_addr_size = sizeof(uint16_t);
+    transaction.op = I2C_OP_MEM_READ;
+    transaction.size = size;
+    transaction.data = data;
+    transaction.callback = eeprom_read_done;
+    m_eeprom_read_callback = callback;
+    m_eeprom_read_context = context;
+    m_eeprom_reading = true;
+    if (i2c_queue_submit(I2C_PRIORITY_LOW, &transaction) != HAL_OK) {
+        m_eeprom_reading = false;
+        return EEPROM_BUSY;
+    }
+    return EEPROM_OK;
+}
+
+/**
+ * Start the write at the head of the queue (spec page 8). The write is queued behind any display and button traffic.
+ * Must be called with interrupts disabled.
+ */
+void eeprom_start_write(void) {
+    EepromWrite* write = &m_eeprom_writes[m_eeprom_head];
+    I2cTransaction transaction = {0};
+    transaction.addr = EEPROM_I2C_ADDR;
+    transaction.mem_addr = write->address;
+    transaction.mem_addr_size = sizeof(uint16_t);
+    transaction.op = I2C_OP_MEM_WRITE;
+    transaction.size = write->size;
+    transaction.data = write->data;
+    transaction.callback = eeprom_write_sent;
+    m_eeprom_state = EEPROM_STATE_WRITE;
+    // A full I2C queue leaves the write to be started by the next cycle
+    if (i2c_queue_submit(I2C_PRIORITY_LOW, &transaction) != HAL_OK) {
+        m_eeprom_state = EEPROM_STATE_IDLE;
+    }
+}
+
+/**
+ * Poll the device for the end of the write cycle of the head write. The device does not acknowledge its address until
+ * the write cycle is complete (spec page 9). Must be called with interrupts disabled.
+ */
+void eeprom_start_poll(void) {
+    I2cTransaction transaction = {0};
+    transaction.addr = EEPROM_I2C_ADDR;
+    transaction.mem_addr = m_eeprom_writes[m_eeprom_head].address;
+    transaction.mem_addr_size = sizeof(uint16_t);
+    transaction.op = I2C_OP_POLL;
+    transaction.size = sizeof(m_eeprom_poll_data);
+    transaction.data = &m_eeprom_poll_data;
+    transaction.callback = eeprom_poll_done;
+    m_eeprom_state = EEPROM_STATE_POLL;
+    m_eeprom_polls += 1;
+    if (i2c_queue_submit(I2C_PRIORITY_LOW, &transaction) != HAL_OK) {
+        m_eeprom_state = EEPROM_STATE_PROGRAM;
+    }
+}
+
+/**
+ * Remove the head write, report its status, and start the next write.
+ */
+void eeprom_finish(EepromStatus status) {
+    // Copy out the write, so the callback may queue into the freed slot
+    EepromWrite write = m_eeprom_writes[m_eeprom_head];
+    m_eeprom_head = (m_eeprom_head + 1) % EEPROM_WRITE_QUEUE_DEPTH;
+    m_eeprom_count -= 1;
+    m_eeprom_state = EEPROM_STATE_IDLE;
+    m_eeprom_last_status = status;
+    if (status != EEPROM_OK) {
+        m_eeprom_failures += 1;
+    }
+    if (write.callback != NULL) {
+        write.callback(status, write.context);
+    }
+    if ((m_eeprom_state == EEPROM_STATE_IDLE) && (m_eeprom_count != 0)) {
+        eeprom_start_write();
+    }
+}
+
+void eeprom_write_sent(HAL_StatusTypeDef status, void* context) {
+    (void) context;
+    // Data is latched, the device now runs its write cycle
+    if (status == HAL_OK) {
+        m_eeprom_state = EEPROM_STATE_PROGRAM;
+        m_eeprom_polls = 0;
+    } else {
+        eeprom_finish(EEPROM_ERROR);
+    }
+}
+
+void eeprom_poll_done(HAL_StatusTypeDef status, void* context) {
+    (void) context;
+    if (status == HAL_OK) {
+        eeprom_finish(EEPROM_OK);
+    } else if (m_eeprom_polls >= EEPROM_WRITE_TIMEOUT_CYCLES) {
+        eeprom_finish(EEPROM_ERROR);
+    } else {
+        m_eeprom_state = EEPROM_STATE_PROGRAM; // Still programming, poll again next cycle
+    }
+}
+
+EepromStatus eeprom_write_bytes(uint16_t address, uint8_t* data, uint16_t size, EepromCallback callback, void* context) {
+    SW_ASSERT(data);
+    SW_ASSERT1((address + size) <= (EEPROM_PAGE_COUNT * EEPROM_PAGE_SIZE), address);
+    // Page writes wrap within the page (spec page 8), so a write may not cross one
+    SW_ASSERT2(((address % EEPROM_PAGE_SIZE) + size) <= EEPROM_PAGE_SIZE, address, size);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (m_eeprom_count >= EEPROM_WRITE_QUEUE_DEPTH) {
+        __set_PRIMASK(primask);
+        return EEPROM_BUSY;
+    }
+    EepromWrite* write = &m_eeprom_writes[(m_eeprom_head + m_eeprom_count) % EEPROM_WRITE_QUEUE_DEPTH];
+    write->address = address;
+    write->size = size;
+    write->data = data;
+    write->callback = callback;
+    write->context = context;
+    // Short writes are held in the queue so the caller's buffer is free once queued
+    if (size <= EEPROM_WRITE_INLINE_SIZE) {
+        (void) memcpy(write->inline_data, data, size);
+        write->data = write->inline_data;
+    }
+    m_eeprom_count += 1;
+    if (m_eeprom_state == EEPROM_STATE_IDLE) {
+        eeprom_start_write();
+    }
+    __set_PRIMASK(primask);
+    return EEPROM_OK;
+}
+
+void eeprom_cycle(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    // Writes and polls on the I2C queue always complete through their callback, even when dropped by a reset
+    if (m_eeprom_state == EEPROM_STATE_PROGRAM) {
+        eeprom_start_poll();
+    } else if ((m_eeprom_state == EEPROM_STATE_IDLE) && (m_eeprom_count != 0)) {
+        eeprom_start_write();
+    }
+    __set_PRIMASK(primask);
+}
+
+EepromStatus eeprom_flush(void) {
+    uint32_t start = HAL_GetTick();
+    while (!eeprom_idle()) {
+        if ((HAL_GetTick() - start) >= EEPROM_FLUSH_TIMEOUT_MS) {
             return EEPROM_BUSY;
-        case HAL_ERROR:
-            return EEPROM_ERROR;
-        default:
-            SW_ASSERT1(0,stat);
-            break;
+        }
+        HAL_Delay(1);
+        eeprom_cycle();
     }
-    return EEPROM_ERROR; // for code checkers, shouldn't get here
+    return m_eeprom_last_status;
+}
+
+bool eeprom_idle(void) {
+    return (m_eeprom_count == 0);
+}
+
+EepromStatus eeprom_last_status(void) {
+    return m_eeprom_last_status;
+}
+
+uint32_t eeprom_failures(void) {
+    return m_eeprom_failures;
 }
@@ -0,0 +1,81 @@
+/*
+ * frame.c:
+ *
+ * Implementation of the debug UART framing. See frame.h for the layout.
+ */
+#include <string.h>
+#include <swassert.h>
+#include <ventilator/crc.h>
+#include <ventilator/frame.h>
+
+uint32_t frame_encode(uint8_t* data, uint8_t type, const void* payload, uint8_t size) {
+    SW_ASSERT(data != NULL);
+    SW_ASSERT1(size <= FRAME_PAYLOAD_MAX, size);
+    data[0] = FRAME_SYNC_FIRST;
+    data[1] = FRAME_SYNC_SECOND;
+    data[2] = type;
+    data[3] = size;
+    if (size != 0) {
+        (void) memcpy(&data[FRAME_HEADER_SIZE], payload, size);
+    }
+    uint16_t crc = crc16(&data[2], size + 2);
+    data[FRAME_HEADER_SIZE + size] = (uint8_t)crc;
+    data[FRAME_HEADER_SIZE + size + 1] = (uint8_t)(crc >> 8);
+    return size + FRAME_OVERHEAD;
+}
+
+void frame_parser_reset(FrameParser* parser) {
+    SW_ASSERT(parser != NULL);
+    parser->state = FRAME_PARSE_SYNC_FIRST;
+    parser->errors = 0;
+}
+
+bool frame_parse(FrameParser* parser, uint8_t byte) {
+    switch (parser->state) {
+        case FRAME_PARSE_SYNC_FIRST:
+            parser->state = (byte == FRAME_SYNC_FIRST) ? FRAME_PARSE_SYNC_SECOND : FRAME_PARSE_SYNC_FIRST;
+            break;
+        case FRAME_PARSE_SYNC_SECOND:
+            // A repeated first sync byte may still start a frame
+            parser->state = (byte == FRAME_SYNC_SECOND) ? FRAME_PARSE_TYPE :
+                            ((byte == FRAME_SYNC_FIRST) ? FRAME_PARSE_SYNC_SECOND : FRAME_PARSE_SYNC_FIRST);
+            break;
+        case FRAME_PARSE_TYPE:
+            parser->type = byte;
+            parser->state = FRAME_PARSE_LENGTH;
+            break;
+        case FRAME_PARSE_LENGTH:
+            parser->length = byte;
+            parser->count = 0;
+            if (byte > FRAME_PAYLOAD_MAX) {
+                parser->errors += 1;
+                parser->state = FRAME_PARSE_SYNC_FIRST;
+            } else {
+                parser->state = (byte == 0) ? FRAME_PARSE_CRC_LOW : FRAME_PARSE_PAYLOAD;
+            }
+            break;
+        case FRAME_PARSE_PAYLOAD:
+            parser->payload[parser->count++] = byte;
+            parser->state = (parser->count < parser->length) ? FRAME_PARSE_PAYLOAD : FRAME_PARSE_CRC_LOW;
+            break;
+        case FRAME_PARSE_CRC_LOW:
+            parser->crc = byte;
+            parser->state = FRAME_PARSE_CRC_HIGH;
+            break;
+        case FRAME_PARSE_CRC_HIGH: {
+            parser->crc |= (uint16_t)(byte << 8);
+            parser->state = FRAME_PARSE_SYNC_FIRST;
+            uint8_t header[2] = {parser->type, parser->length};
+            uint16_t crc = crc16_update(crc16(header, sizeof(header)), parser->payload, parser->length);
+            if (crc == parser->crc) {
+                return true;
+            }
+            parser->errors += 1;
+            break;
+        }
+        default:
+            parser->state = FRAME_PARSE_SYNC_FIRST;
+            break;
+    }
+    return false;
+}
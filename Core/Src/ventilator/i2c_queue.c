@@ -0,0 +1,276 @@
+/*
+ * i2c_queue.c:
+ *
+ * Implementation of the I2C transaction queue. Memory transactions are run as two sequential frames: the register or
+ * memory address is sent first, followed by the data. Reads send the data frame with a repeated start, writes continue
+ * the first frame. Each frame completes from the I2C interrupt which starts the next frame or transaction.
+ */
+#include <string.h>
+#include <swassert.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/panel_public.h>
+
+/**
+ * State of the transaction at the head of the active queue.
+ */
+typedef enum {
+    I2C_STATE_IDLE,  // No transaction selected
+    I2C_STATE_START, // Current frame must be started
+    I2C_STATE_BUSY,  // Current frame is on the bus, waiting on the interrupt
+    I2C_STATE_DONE   // Current frame has completed with m_i2c_status
+} I2cState;
+
+/**
+ * Frames of a memory transaction.
+ */
+typedef enum {
+    I2C_FRAME_ADDRESS,
+    I2C_FRAME_DATA
+} I2cFrame;
+
+STATIC I2cTransaction m_i2c_queue[I2C_PRIORITY_COUNT][I2C_QUEUE_DEPTH];
+STATIC uint8_t m_i2c_head[I2C_PRIORITY_COUNT];
+STATIC uint8_t m_i2c_count[I2C_PRIORITY_COUNT];
+STATIC volatile I2cState m_i2c_state = I2C_STATE_IDLE;
+STATIC volatile HAL_StatusTypeDef m_i2c_status = HAL_OK;
+STATIC I2cPriority m_i2c_active = I2C_PRIORITY_HIGH; // Queue holding the current transaction at its head
+STATIC I2cFrame m_i2c_frame = I2C_FRAME_ADDRESS;
+STATIC uint8_t m_i2c_header[2];                      // Address frame of the current transaction
+STATIC uint32_t m_i2c_busy_cycles = 0;               // Cycles the current frame has been on the bus
+STATIC bool m_i2c_running = false;                   // Guards i2c_queue_run against completions raised while starting a frame
+STATIC uint32_t m_i2c_errors[I2C_DEVICE_COUNT];
+
+STATIC volatile bool m_i2c_transfer_done = false;    // Completion of the i2c_queue_transfer transaction
+STATIC volatile HAL_StatusTypeDef m_i2c_transfer_status = HAL_OK;
+
+void i2c_queue_init(void) {
+    (void) memset(m_i2c_queue, 0, sizeof(m_i2c_queue));
+    (void) memset(m_i2c_head, 0, sizeof(m_i2c_head));
+    (void) memset(m_i2c_count, 0, sizeof(m_i2c_count));
+    (void) memset(m_i2c_errors, 0, sizeof(m_i2c_errors));
+    m_i2c_state = I2C_STATE_IDLE;
+    m_i2c_running = false;
+    m_i2c_busy_cycles = 0;
+}
+
+/**
+ * Map a bus address to its device for error accounting.
+ */
+I2cDevice i2c_queue_device(uint16_t addr) {
+    switch (addr >> 1) {
+        case 0x20:
+            return I2C_DEVICE_DISPLAY_LOWER;
+        case 0x21:
+            return I2C_DEVICE_DISPLAY_MIDDLE;
+        case 0x22:
+            return I2C_DEVICE_DISPLAY_UPPER;
+        case 0x24:
+            return I2C_DEVICE_BUTTONS;
+        case 0x50:
+            return I2C_DEVICE_EEPROM;
+        default:
+            break;
+    }
+    return I2C_DEVICE_OTHER;
+}
+
+/**
+ * Start the current frame of the transaction at the head of the active queue.
+ */
+HAL_StatusTypeDef i2c_queue_start_frame(void) {
+    I2cTransaction* transaction = &m_i2c_queue[m_i2c_active][m_i2c_head[m_i2c_active]];
+    if (m_i2c_frame == I2C_FRAME_ADDRESS) {
+        // Memory address is sent big-endian. Reads end the frame without a stop so the data follows a repeated start.
+        m_i2c_header[0] = (transaction->mem_addr_size == 2) ? (transaction->mem_addr >> 8) : transaction->mem_addr;
+        m_i2c_header[1] = transaction->mem_addr;
+        return HAL_I2C_Master_Seq_Transmit_IT(&hi2c1, transaction->addr, m_i2c_header, transaction->mem_addr_size,
+                                              (transaction->op != I2C_OP_MEM_WRITE) ? I2C_FIRST_FRAME : I2C_FIRST_AND_NEXT_FRAME);
+    } else if (transaction->op != I2C_OP_MEM_WRITE) {
+        return HAL_I2C_Master_Seq_Receive_IT(&hi2c1, transaction->addr, transaction->data, transaction->size, I2C_LAST_FRAME);
+    }
+    return HAL_I2C_Master_Seq_Transmit_IT(&hi2c1, transaction->addr, transaction->data, transaction->size, I2C_LAST_FRAME);
+}
+
+/**
+ * Remove the current transaction from its queue, count its failure and call back its owner.
+ */
+void i2c_queue_finish(HAL_StatusTypeDef status) {
+    // Copy out the transaction, so the callback may submit into the freed slot
+    I2cTransaction transaction = m_i2c_queue[m_i2c_active][m_i2c_head[m_i2c_active]];
+    m_i2c_head[m_i2c_active] = (m_i2c_head[m_i2c_active] + 1) % I2C_QUEUE_DEPTH;
+    m_i2c_count[m_i2c_active] -= 1;
+    m_i2c_state = I2C_STATE_IDLE;
+    if ((status != HAL_OK) && (transaction.op != I2C_OP_POLL)) {
+        I2cDevice device = i2c_queue_device(transaction.addr);
+        m_i2c_errors[device] += 1;
+        if (device <= I2C_DEVICE_BUTTONS) {
+            p_uartDebug.fswStats.switchI2CErrors++;
+        }
+    }
+    if (transaction.callback != NULL) {
+        transaction.callback(status, transaction.context);
+    }
+}
+
+/**
+ * Advance the queue as far as possible: finish completed frames, select the next transaction, and start frames. Stops once a frame
+ * is on the bus, or the queue is empty. Must be called with the I2C interrupt unable to preempt it.
+ */
+void i2c_queue_run(void) {
+    // A completion raised from within a HAL start call is picked up by the loop of the outer call
+    if (m_i2c_running) {
+        return;
+    }
+    m_i2c_running = true;
+    while (true) {
+        if (m_i2c_state == I2C_STATE_DONE) {
+            if ((m_i2c_status == HAL_OK) && (m_i2c_frame == I2C_FRAME_ADDRESS)) {
+                m_i2c_frame = I2C_FRAME_DATA;
+                m_i2c_state = I2C_STATE_START;
+            } else {
+                i2c_queue_finish(m_i2c_status);
+            }
+        }
+        if (m_i2c_state == I2C_STATE_IDLE) {
+            // High priority transactions always go first
+            if (m_i2c_count[I2C_PRIORITY_HIGH] != 0) {
+                m_i2c_active = I2C_PRIORITY_HIGH;
+            } else if (m_i2c_count[I2C_PRIORITY_LOW] != 0) {
+                m_i2c_active = I2C_PRIORITY_LOW;
+            } else {
+                break;
+            }
+            m_i2c_frame = I2C_FRAME_ADDRESS;
+            m_i2c_state = I2C_STATE_START;
+        }
+        if (m_i2c_state == I2C_STATE_START) {
+            m_i2c_state = I2C_STATE_BUSY;
+            m_i2c_busy_cycles = 0;
+            HAL_StatusTypeDef status = i2c_queue_start_frame();
+            if (status != HAL_OK) {
+                m_i2c_status = status;
+                m_i2c_state = I2C_STATE_DONE;
+            }
+        }
+        if (m_i2c_state == I2C_STATE_BUSY) {
+            break;
+        }
+    }
+    m_i2c_running = false;
+}
+
+HAL_StatusTypeDef i2c_queue_submit(I2cPriority priority, const I2cTransaction* transaction) {
+    SW_ASSERT1(priority < I2C_PRIORITY_COUNT, priority);
+    SW_ASSERT(transaction != NULL);
+    SW_ASSERT(transaction->data != NULL);
+    SW_ASSERT1((transaction->mem_addr_size == 1) || (transaction->mem_addr_size == 2), transaction->mem_addr_size);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (m_i2c_count[priority] >= I2C_QUEUE_DEPTH) {
+        __set_PRIMASK(primask);
+        return HAL_BUSY;
+    }
+    I2cTransaction* slot = &m_i2c_queue[priority][(m_i2c_head[priority] + m_i2c_count[priority]) % I2C_QUEUE_DEPTH];
+    *slot = *transaction;
+    // Short writes are held in the queue so the caller's buffer is free once submitted
+    if ((slot->op == I2C_OP_MEM_WRITE) && (slot->size <= I2C_QUEUE_INLINE_SIZE)) {
+        (void) memcpy(slot->inline_data, transaction->data, slot->size);
+        slot->data = slot->inline_data;
+    }
+    m_i2c_count[priority] += 1;
+    i2c_queue_run();
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+/**
+ * Completion callback of i2c_queue_transfer.
+ */
+void i2c_queue_transfer_done(HAL_StatusTypeDef status, void* context) {
+    (void) context;
+    m_i2c_transfer_status = status;
+    m_i2c_transfer_done = true;
+}
+
+HAL_StatusTypeDef i2c_queue_transfer(I2cPriority priority, I2cTransaction* transaction) {
+    SW_ASSERT(transaction != NULL);
+    m_i2c_transfer_done = false;
+    transaction->callback = i2c_queue_transfer_done;
+    transaction->context = NULL;
+    if (i2c_queue_submit(priority, transaction) != HAL_OK) {
+        return HAL_BUSY;
+    }
+    uint32_t start = HAL_GetTick();
+    while (!m_i2c_transfer_done) {
+        if ((HAL_GetTick() - start) >= I2C_QUEUE_BLOCKING_TIMEOUT_MS) {
+            i2c_queue_reset();
+            return HAL_TIMEOUT;
+        }
+    }
+    return m_i2c_transfer_status;
+}
+
+void i2c_queue_complete(HAL_StatusTypeDef status) {
+    // Ignore spurious completions, i.e. those of a frame dropped by a reset
+    if (m_i2c_state != I2C_STATE_BUSY) {
+        return;
+    }
+    m_i2c_status = status;
+    m_i2c_state = I2C_STATE_DONE;
+    i2c_queue_run();
+}
+
+/**
+ * Reset the I2C peripheral, abandoning any frame on the bus.
+ */
+void i2c_queue_reset_bus(void) {
+    (void) HAL_I2C_DeInit(&hi2c1);
+    (void) HAL_I2C_Init(&hi2c1);
+}
+
+void i2c_queue_cycle(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (m_i2c_state == I2C_STATE_BUSY) {
+        m_i2c_busy_cycles += 1;
+        // A frame that never completes would stall all devices. Reset the bus and fail the transaction.
+        if (m_i2c_busy_cycles >= I2C_QUEUE_TIMEOUT_CYCLES) {
+            m_i2c_state = I2C_STATE_IDLE;
+            i2c_queue_reset_bus();
+            m_i2c_status = HAL_TIMEOUT;
+            m_i2c_state = I2C_STATE_DONE;
+            i2c_queue_run();
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+void i2c_queue_reset(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    // Abandon the frame on the bus first, so its late completion is ignored
+    bool started = (m_i2c_state != I2C_STATE_IDLE);
+    m_i2c_state = I2C_STATE_IDLE;
+    i2c_queue_reset_bus();
+    // Fail every dropped transaction to its owner, the started one first. Transactions submitted from those callbacks are
+    // not started, and are dropped in turn, so the queue is empty on return.
+    m_i2c_running = true;
+    if (started) {
+        i2c_queue_finish(HAL_TIMEOUT);
+    }
+    while (!i2c_queue_idle()) {
+        m_i2c_active = (m_i2c_count[I2C_PRIORITY_HIGH] != 0) ? I2C_PRIORITY_HIGH : I2C_PRIORITY_LOW;
+        i2c_queue_finish(HAL_TIMEOUT);
+    }
+    m_i2c_running = false;
+    __set_PRIMASK(primask);
+}
+
+bool i2c_queue_idle(void) {
+    return (m_i2c_state == I2C_STATE_IDLE) && (m_i2c_count[I2C_PRIORITY_HIGH] == 0) && (m_i2c_count[I2C_PRIORITY_LOW] == 0);
+}
+
+uint32_t i2c_queue_errors(I2cDevice device) {
+    SW_ASSERT1(device < I2C_DEVICE_COUNT, device);
+    return m_i2c_errors[device];
+}
@@ -65,48 +65,5 @@ void initialize_numeric_values(NumericalValues* values) {
     values->resp_rate.editval = INITIAL_RESPR_INIT;
     values->resp_rate.mode = DISPLAY_VALUE;
 
-    values->alarms.disconnect.status = ALARM_OFF;
-    values->alarms.disconnect.count = 0;
-    values->alarms.disconnect.latch_time = INITIAL_DISCONNECT_LATCH;
-    values->alarms.disconnect.trip_time = INITIAL_DISCONNECT_TRIP;
-
-    values->alarms.fio2.status = ALARM_OFF;
-    values->alarms.fio2.count = 0;
-    values->alarms.fio2.latch_time = INITIAL_FIO2_LATCH;
-    values->alarms.fio2.trip_time = INITIAL_FIO2_TRIP;
-
-    values->alarms.low_power.status = ALARM_OFF;
-    values->alarms.low_power.count = 0;
-    values->alarms.low_power.latch_time = INITIAL_LOWPOW_LATCH;
-    values->alarms.low_power.trip_time = INITIAL_LOWPOW_TRIP;
-
-    values->alarms.machine_fault.status = ALARM_OFF;
-    values->alarms.machine_fault.count = 0;
-    values->alarms.machine_fault.latch_time = INITIAL_MACHINEFAULT_LATCH;
-    values->alarms.machine_fault.trip_time = INITIAL_MACHINEFAULT_TRIP;
-
-    values->alarms.peak_press.status = ALARM_OFF;
-    values->alarms.peak_press.count = 0;
-    values->alarms.peak_press.latch_time = INITIAL_PEAK_LATCH;
-    values->alarms.peak_press.trip_time = INITIAL_PEAK_TRIP;
-
-    values->alarms.peep.status = ALARM_OFF;
-    values->alarms.peep.count = 0;
-    values->alarms.peep.latch_time = INITIAL_PEEP_LATCH;
-    values->alarms.peep.trip_time = INITIAL_PEEP_TRIP;
-
-    values->alarms.power_off.status = ALARM_OFF;
-    values->alarms.power_off.count = 0;
-    values->alarms.power_off.latch_time = INITIAL_POWEROFF_LATCH;
-    values->alarms.power_off.trip_time = INITIAL_POWEROFF_TRIP;
-
-    values->alarms.resp_rate.status = ALARM_OFF;
-    values->alarms.resp_rate.count = 0;
-    values->alarms.resp_rate.latch_time = INITIAL_RESPRATE_LATCH;
-    values->alarms.resp_rate.trip_time = INITIAL_RESPRATE_TRIP;
-
-    values->alarms.tidal_vol.status = ALARM_OFF;
-    values->alarms.tidal_vol.count = 0;
-    values->alarms.tidal_vol.latch_time = INITIAL_TIDALVOL_LATCH;
-    values->alarms.tidal_vol.trip_time = INITIAL_TIDALVOL_TRIP;
+    // Alarms are left off with zero counts by the clear above, their timings are in the alarm table
 }
@@ -6,6 +6,7 @@
  */
 #include <swassert.h>
 #include <ventilator/mcp23017.h>
+#include <ventilator/i2c_queue.h>
 #include <ventilator/panel_public.h>
 
 HAL_StatusTypeDef mcp23017_init(McpHandle* handle, uint8_t addr, bool is_input) {
@@ -22,9 +23,22 @@ HAL_StatusTypeDef mcp23017_init(McpHandle* handle, uint8_t addr, bool is_input)
     uint8_t reg[2] = {0,0};
     // Configure switch MCP23017 input
     if (is_input) {
-        // IOCON - default values are correct
+        // IOCON - mirror INTA/INTB so the single INTA line reports both ports, and drive it active-high to match the
+        // rising-edge EXTI on the panel side
+        reg[0] = MCP_IOCON_MIRROR | MCP_IOCON_INTPOL;
+        stat = mcp23017_write_reg(handle, REG_IOCON, reg, 1);
+        if (stat != HAL_OK) {
+            return stat;
+        }
         // IODIR A/B - all are inputs - default is input
         // IPOL A/B - normal polarity is correct - switches are pulled down when open
+        // INTCON A/B - compare against the previous value so both press and release raise an interrupt
+        reg[0] = 0x00;
+        reg[1] = 0x00;
+        stat = mcp23017_write_reg(handle, REG_INTCONA, reg, 2);
+        if (stat != HAL_OK) {
+            return stat;
+        }
         // GPINTENA/A - interrupt on change to latch the value
         reg[0] = 0xFF;
         reg[1] = 0xFF;
@@ -32,10 +46,6 @@ HAL_StatusTypeDef mcp23017_init(McpHandle* handle, uint8_t addr, bool is_input)
         if (stat != HAL_OK) {
             return stat;
         }
-        stat = mcp23017_write_reg(handle, REG_INTCONA, reg, 2);
-        if (stat != HAL_OK) {
-            return stat;
-        }
         // Pin direction "output"
         stat = mcp23017_write_reg(handle, REG_IODIRA, reg, 2);
         if (stat != HAL_OK) {
@@ -97,3 +107,38 @@ HAL_StatusTypeDef mcp23017_write_reg(McpHandle* handle, const uint8_t device_reg
             handle->timeout);
     return stat;
 }
+
+HAL_StatusTypeDef mcp23017_read_reg_async(McpHandle* handle, const uint8_t device_reg_addr, uint8_t* val, const uint8_t num_addrs,
+                                          I2cCallback callback, void* context) {
+    SW_ASSERT(handle);
+    SW_ASSERT(val);
+    SW_ASSERT2((device_reg_addr + num_addrs) <= REG_OLATB + 1, device_reg_addr, num_addrs);
+    I2cTransaction transaction = {0};
+    transaction.addr = handle->addr;
+    transaction.mem_addr = device_reg_addr;
+    transaction.mem_addr_size = 1;
+    transaction.op = I2C_OP_MEM_READ;
+    transaction.size = num_addrs;
+    transaction.data = val;
+    transaction.callback = callback;
+    transaction.context = context;
+    return i2c_queue_submit(I2C_PRIORITY_HIGH, &transaction);
+}
+
+HAL_StatusTypeDef mcp23017_write_reg_async(McpHandle* handle, const uint8_t device_reg_addr, uint8_t* val, const uint8_t num_addrs,
+                                           I2cCallback callback, void* context) {
+    SW_ASSERT(handle);
+    SW_ASSERT(val);
+    SW_ASSERT2((device_reg_addr + num_addrs) <= REG_OLATB + 1, device_reg_addr, num_addrs);
+    SW_ASSERT1(num_addrs <= I2C_QUEUE_INLINE_SIZE, num_addrs); // Value is copied into the queue
+    I2cTransaction transaction = {0};
+    transaction.addr = handle->addr;
+    transaction.mem_addr = device_reg_addr;
+    transaction.mem_addr_size = 1;
+    transaction.op = I2C_OP_MEM_WRITE;
+    transaction.size = num_addrs;
+    transaction.data = val;
+    transaction.callback = callback;
+    transaction.context = context;
+    return i2c_queue_submit(I2C_PRIORITY_HIGH, &transaction);
+}
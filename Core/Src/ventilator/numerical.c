@@ -48,6 +48,16 @@ STATIC uint16_t R_DIGIT_TO_SEGMENT[DIGIT_COUNT] = {
 
 
 
+uint32_t numerical_divide_by_10(uint32_t value) {
+    // 205/2048 = 0.10009..., exact for [0, 1028]
+    return (value * 205) >> 11;
+}
+
+uint32_t numerical_divide_by_100(uint32_t value) {
+    // 41/4096 = 0.010009..., exact for [0, 1098]
+    return (value * 41) >> 12;
+}
+
 uint16_t l_numerical_digit_to_segment_helper(uint32_t digit) {
     SW_ASSERT(digit < DIGIT_COUNT);
     return L_DIGIT_TO_SEGMENT[digit];
@@ -69,7 +79,8 @@ void numerical_set_two_digit(TwoDigit* two_digit, int32_t value) {
     if (value == BLANK_CONSTANT) {
         *two_digit = 0x0000;
     } else {
-        *two_digit = l_numerical_digit_to_segment_helper(value/10) | r_numerical_digit_to_segment_helper(value % 10);
+        uint32_t tens = numerical_divide_by_10(value);
+        *two_digit = l_numerical_digit_to_segment_helper(tens) | r_numerical_digit_to_segment_helper(value - (tens * 10));
     }
 }
 
@@ -143,11 +154,16 @@ void numerical_set_three_digit(ThreeDigit* three_digit, int32_t value) {
         three_digit->high = 0x0000;
         three_digit->low = 0x0000;
     } else {
+        // Split into digits without the software divide
+        uint32_t hundreds = numerical_divide_by_100(value);
+        uint32_t tens = numerical_divide_by_10(value);
+        uint32_t middle = tens - (hundreds * 10);
+        uint32_t ones = value - (tens * 10);
         // Assert that all indexing values are in-bound before indexing into array
-        SW_ASSERT((value / 100) < DIGIT_COUNT);
-        SW_ASSERT(((value % 100)/10) < DIGIT_COUNT);
-        SW_ASSERT((value % 10) < DIGIT_COUNT);
-        uint32_t digits = L_3DIGIT_TO_SEGMENT[value/100] | C_3DIGIT_TO_SEGMENT[(value%100)/10] | R_3DIGIT_TO_SEGMENT[value%10];
+        SW_ASSERT(hundreds < DIGIT_COUNT);
+        SW_ASSERT(middle < DIGIT_COUNT);
+        SW_ASSERT(ones < DIGIT_COUNT);
+        uint32_t digits = L_3DIGIT_TO_SEGMENT[hundreds] | C_3DIGIT_TO_SEGMENT[middle] | R_3DIGIT_TO_SEGMENT[ones];
         three_digit->high = (uint16_t)(digits >> 16);
         three_digit->low = (uint16_t)digits;
     }
@@ -14,27 +14,38 @@
 #include <string.h>
 #include <ventilator/watchdog.h>
 #include <ventilator/eeprom.h>
+#include <ventilator/alive_journal.h>
+#include <ventilator/parameters.h>
+#include <ventilator/trend.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/command.h>
+#include <ventilator/profiler.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/trace.h>
 
 const bool LOAD_FROM_EEPROM = true; // Set to 0 to use compile-time values and rewrite EEPROM to the defaults
+const bool TRACE_FROM_BOOT = false; // Set to capture a trace of every cycle from boot, for an exact replay
 
-int32_t panel_load_eeprom_value_or_default(EepromRecordId record, int32_t default_value) {
-    int32_t eeprom = 0xFFFFFFFF;
-    // On a compiled value of 0, we will write out to the EEPROM the default values. This *must* pass.
-    if (!LOAD_FROM_EEPROM) {
-        SW_ASSERT(writeEeprom(record, default_value) == EEPROM_OK);
-        HAL_Delay(10);
-    }
-    EepromStatus status = readEeprom(record, (uint32_t*)(&eeprom));
-    // On success, load the value, otherwise keep the previous value
-    if (status == EEPROM_OK) {
-        SW_ASSERT(LOAD_FROM_EEPROM || default_value == eeprom); //Check that the loading code reads back correctly
-        return eeprom;
-    }
-    return default_value;
-}
-
+// Compiled defaults of the parameter block, in record order
+STATIC const int32_t PARAMETER_DEFAULTS[PARAMETER_COUNT] = {
+    INITIAL_DEFAULT_SENSITIVITY,   // EEPROM_INIT_INHALE_SENSITIVITY
+    INITIAL_BREATH_DETECT_HOLD_OFF,// EEPROM_INIT_BREATH_DETECT_HOLD_OFF
+    INITIAL_PLATEAU_SAMPLE_OFFSET, // EEPROM_INIT_PLATEAU_SAMPLE_OFFSET_TIME
+    30591, // EEPROM_INIT_PCTRL_KP uV/sqrt(Pa)
+    84127, // EEPROM_INIT_PCTRL_KI uV/sqrt(Pa)-s
+    1835,  // EEPROM_INIT_PCTRL_KD uV/sqrt(Pa)/s
+    3183,  // EEPROM_INIT_PCTRL_D_FILT_CUTOFF mHz
+    1000,  // EEPROM_INIT_PCTRL_SHAPE_FILT_CUTOFF mHz
+    -59,   // EEPROM_INIT_PCTRL_INT_L_LIMIT sqrt(Pa)-s
+    59,    // EEPROM_INIT_PCTRL_INT_U_LIMIT sqrt(Pa)-s
+    0,     // EEPROM_INIT_PCTRL_DELAY steps
+    0,     // EEPROM_INIT_PCTRL_SIN_AMP mV
+    0      // EEPROM_INIT_PCTRL_SIN_F mHz
+};
 
 void panel_init(void) {
+    // Initialize the I2C queue shared by the display, buttons, and EEPROM before any of them are used
+    i2c_queue_init();
     // Global value initialization
     p_doCycle = 0;
     p_doPlateau = 0;
@@ -45,23 +56,22 @@ void panel_init(void) {
 
     // Clear the panel packet first and then initialize the defaulted parameters
     (void) memset(&p_panel_packet, 0, sizeof(panel_packet_t));
-    p_panel_packet.parameters.inhale_sensitivity = panel_load_eeprom_value_or_default(EEPROM_INIT_INHALE_SENSITIVITY, INITIAL_DEFAULT_SENSITIVITY);
-    p_panel_packet.parameters.breath_detect_hold_off_time = panel_load_eeprom_value_or_default(EEPROM_INIT_BREATH_DETECT_HOLD_OFF, INITIAL_BREATH_DETECT_HOLD_OFF);
-    p_panel_packet.parameters.plateau_sample_offset_time = panel_load_eeprom_value_or_default(EEPROM_INIT_PLATEAU_SAMPLE_OFFSET_TIME, INITIAL_PLATEAU_SAMPLE_OFFSET);
-
-    // Initial pctrl parameters
-    p_panel_packet.parameters.pctrl_kp = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_KP, 30591); //uV/sqrt(Pa)
-    p_panel_packet.parameters.pctrl_ki = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_KI, 84127); //uV/sqrt(Pa)-s
-    p_panel_packet.parameters.pctrl_kd = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_KD, 1835);  //uV/sqrt(Pa)/s
-    p_panel_packet.parameters.pctrl_d_filt_cutoff = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_D_FILT_CUTOFF, 3183); //mHz
-    p_panel_packet.parameters.pctrl_shape_filt_cutoff = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_SHAPE_FILT_CUTOFF, 1000); //mHz
-    p_panel_packet.parameters.pctrl_int_l_limit = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_INT_L_LIMIT, -59); //sqrt(Pa)-s
-    p_panel_packet.parameters.pctrl_int_u_limit = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_INT_U_LIMIT,  59); //sqrt(Pa)-s
-    p_panel_packet.parameters.pctrl_delay = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_DELAY, 0);     //steps
-    p_panel_packet.parameters.pctrl_sin_amp = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_SIN_AMP, 0); //mV
-    p_panel_packet.parameters.pctrl_sin_f = panel_load_eeprom_value_or_default(EEPROM_INIT_PCTRL_SIN_F, 0);     //mHz
+    // All parameters come from one read of the parameter block, falling back per-field to the defaults
+    int32_t parameters[PARAMETER_COUNT];
+    uint32_t i = 0;
+    (void) parameters_load(parameters, PARAMETER_DEFAULTS, LOAD_FROM_EEPROM);
+    for (i = 0; i < PARAMETER_COUNT; i++) {
+        *parameters_field(&p_panel_packet.parameters, i) = parameters[i];
+    }
 
-    p_aliveMinutes = panel_load_eeprom_value_or_default(EEPROM_ALIVE_MINUTES, 0);
+    // Alive-time is kept in the wear-leveled journal, restarting it from zero when not loading from the EEPROM
+    p_aliveMinutes = alive_journal_load();
+    if (!LOAD_FROM_EEPROM) {
+        p_aliveMinutes = 0;
+        SW_ASSERT(alive_journal_record(p_aliveMinutes) == EEPROM_OK);
+    }
+    // Trend records continue after the newest page of the log
+    trend_init();
 
     // Initialize the sound module
     sound_init(&htim1);
@@ -71,4 +81,8 @@ void panel_init(void) {
     // Initialize the button state
     init_button_state();
     init_fail_safe_timer(&htim6);
+    profiler_reset();
+    telemetry_init();
+    trace_init(TRACE_FROM_BOOT);
+    command_init();
 }
@@ -0,0 +1,152 @@
+/*
+ * parameters.c:
+ *
+ * Implementation of the CRC protected parameter block.
+ */
+#include <string.h>
+#include <swassert.h>
+#include <ventilator/crc.h>
+#include <ventilator/parameters.h>
+#include <ventilator/panel_public.h>
+#include <ventilator/types.h>
+
+STATIC int32_t m_parameter_values[PARAMETER_COUNT]; // Staging copy of the last values written
+STATIC bool m_parameter_staged = false;             // Staging copy holds values, so unchanged writes are skipped
+STATIC ParameterBlock m_parameter_block;            // Block being written, held until the write completes
+STATIC volatile bool m_parameter_writing = false;
+STATIC volatile bool m_parameter_dirty = false;     // Staging copy not yet written, written back by parameters_cycle
+STATIC volatile uint32_t m_parameter_dirty_cycles = 0; // Cycles the staging copy has been held dirty
+
+// Offset of the field of parameters_t holding each value, in record order
+STATIC const uint8_t PARAMETER_FIELDS[PARAMETER_COUNT] = {
+    offsetof(parameters_t, inhale_sensitivity),          // EEPROM_INIT_INHALE_SENSITIVITY
+    offsetof(parameters_t, breath_detect_hold_off_time), // EEPROM_INIT_BREATH_DETECT_HOLD_OFF
+    offsetof(parameters_t, plateau_sample_offset_time),  // EEPROM_INIT_PLATEAU_SAMPLE_OFFSET_TIME
+    offsetof(parameters_t, pctrl_kp),                    // EEPROM_INIT_PCTRL_KP
+    offsetof(parameters_t, pctrl_ki),                    // EEPROM_INIT_PCTRL_KI
+    offsetof(parameters_t, pctrl_kd),                    // EEPROM_INIT_PCTRL_KD
+    offsetof(parameters_t, pctrl_d_filt_cutoff),         // EEPROM_INIT_PCTRL_D_FILT_CUTOFF
+    offsetof(parameters_t, pctrl_shape_filt_cutoff),     // EEPROM_INIT_PCTRL_SHAPE_FILT_CUTOFF
+    offsetof(parameters_t, pctrl_int_l_limit),           // EEPROM_INIT_PCTRL_INT_L_LIMIT
+    offsetof(parameters_t, pctrl_int_u_limit),           // EEPROM_INIT_PCTRL_INT_U_LIMIT
+    offsetof(parameters_t, pctrl_delay),                 // EEPROM_INIT_PCTRL_DELAY
+    offsetof(parameters_t, pctrl_sin_amp),               // EEPROM_INIT_PCTRL_SIN_AMP
+    offsetof(parameters_t, pctrl_sin_f)                  // EEPROM_INIT_PCTRL_SIN_F
+};
+static_assert(sizeof(parameters_t) <= 0xFF, "Parameter field offsets must fit a byte");
+
+/**
+ * CRC of a block, covering all bytes before the CRC.
+ */
+uint32_t parameters_crc(const ParameterBlock* block) {
+    return crc16((const uint8_t*)block, offsetof(ParameterBlock, crc));
+}
+
+EepromStatus parameters_read(int32_t* values) {
+    ParameterBlock block;
+    SW_ASSERT(values != NULL);
+    EepromStatus status = eeprom_read_bytes(EEPROM_PARAMETER_PAGE * EEPROM_PAGE_SIZE, (uint8_t*)&block, sizeof(block));
+    if (status != EEPROM_OK) {
+        return status;
+    }
+    if ((block.version != PARAMETER_BLOCK_VERSION) || (block.crc != parameters_crc(&block))) {
+        return EEPROM_ERROR;
+    }
+    (void) memcpy(values, block.values, sizeof(block.values));
+    return EEPROM_OK;
+}
+
+/**
+ * Completion of a block write.
+ */
+void parameters_write_complete(EepromStatus status, void* context) {
+    (void) context;
+    // A failed block dirties the staging copy again, retried on the next cycle so the values in use reach the EEPROM
+    if (status != EEPROM_OK) {
+        p_uartDebug.fswStats.parameterWriteFailures++;
+        m_parameter_dirty = true;
+        m_parameter_dirty_cycles = PARAMETER_WRITE_BACK_CYCLES;
+    }
+    m_parameter_writing = false;
+}
+
+/**
+ * Queue the write of the staging copy as a block.
+ */
+void parameters_queue_write(void) {
+    m_parameter_block.version = PARAMETER_BLOCK_VERSION;
+    (void) memcpy(m_parameter_block.values, m_parameter_values, sizeof(m_parameter_block.values));
+    m_parameter_block.crc = parameters_crc(&m_parameter_block);
+    m_parameter_writing = true;
+    m_parameter_dirty = false;
+    // A full EEPROM queue leaves the staging copy dirty for the next cycle
+    if (eeprom_write_bytes(EEPROM_PARAMETER_PAGE * EEPROM_PAGE_SIZE, (uint8_t*)&m_parameter_block, sizeof(m_parameter_block),
+                           parameters_write_complete, NULL) != EEPROM_OK) {
+        m_parameter_writing = false;
+        m_parameter_dirty = true;
+    }
+}
+
+void parameters_write(const int32_t* values) {
+    SW_ASSERT(values != NULL);
+    if (m_parameter_staged && (memcmp(m_parameter_values, values, sizeof(m_parameter_values)) == 0)) {
+        return;
+    }
+    (void) memcpy(m_parameter_values, values, sizeof(m_parameter_values));
+    m_parameter_staged = true;
+    // Held from the first change, so later changes coalesce into the same block write
+    if (!m_parameter_dirty) {
+        m_parameter_dirty = true;
+        m_parameter_dirty_cycles = 0;
+    }
+}
+
+void parameters_cycle(void) {
+    if (!m_parameter_dirty || m_parameter_writing) {
+        return;
+    }
+    if (m_parameter_dirty_cycles < PARAMETER_WRITE_BACK_CYCLES) {
+        m_parameter_dirty_cycles += 1;
+        return;
+    }
+    parameters_queue_write();
+}
+
+void parameters_flush(void) {
+    if (m_parameter_dirty) {
+        m_parameter_dirty_cycles = PARAMETER_WRITE_BACK_CYCLES;
+    }
+    parameters_cycle();
+}
+
+bool parameters_dirty(void) {
+    return m_parameter_dirty || m_parameter_writing;
+}
+
+bool parameters_load(int32_t* values, const int32_t* defaults, bool load) {
+    uint32_t i = 0;
+    SW_ASSERT(values != NULL);
+    SW_ASSERT(defaults != NULL);
+    if (load && (parameters_read(values) == EEPROM_OK)) {
+        (void) memcpy(m_parameter_values, values, sizeof(m_parameter_values));
+        m_parameter_staged = true;
+        return true;
+    }
+    // Fall back field by field, migrating values from the legacy records
+    for (i = 0; i < PARAMETER_COUNT; i++) {
+        uint32_t legacy = 0xFFFFFFFF;
+        values[i] = defaults[i];
+        if (load && (readEeprom(PARAMETER_FIRST_RECORD + i, &legacy) == EEPROM_OK) && (legacy != 0xFFFFFFFF)) {
+            values[i] = (int32_t)legacy;
+        }
+    }
+    parameters_write(values);
+    parameters_flush();
+    return false;
+}
+
+int32_t* parameters_field(parameters_t* parameters, uint32_t index) {
+    SW_ASSERT(parameters != NULL);
+    SW_ASSERT1(index < PARAMETER_COUNT, index);
+    return (int32_t*)((uint8_t*)parameters + PARAMETER_FIELDS[index]);
+}
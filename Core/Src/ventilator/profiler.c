@@ -0,0 +1,80 @@
+/*
+ * profiler.c:
+ *
+ * Implementation of the cycle-time profiler.
+ */
+#include <string.h>
+#include <swassert.h>
+#include <ventilator/profiler.h>
+#include <ventilator/panel_public.h>
+
+STATIC ProfileStats m_profile_stats[PROFILE_STAGE_COUNT];
+STATIC uint32_t m_profile_starts[PROFILE_STAGE_COUNT];
+
+void profiler_reset(void) {
+    uint32_t i = 0;
+    (void) memset(m_profile_stats, 0, sizeof(m_profile_stats));
+    for (i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        m_profile_stats[i].min = UINT32_MAX;
+    }
+    p_uartDebug.fswStats.maxCycle = 0;
+}
+
+uint32_t profiler_histogram_bin(uint32_t ticks) {
+    uint32_t bin = 0;
+    ticks = ticks >> (PROFILE_HISTOGRAM_BASE_SHIFT + 1);
+    // No hardware CLZ on the M0, walk up the powers of two instead
+    while ((ticks != 0) && (bin < (PROFILE_HISTOGRAM_BINS - 1))) {
+        ticks = ticks >> 1;
+        bin++;
+    }
+    return bin;
+}
+
+void profiler_record(ProfileStage stage, uint32_t ticks) {
+    SW_ASSERT1(stage < PROFILE_STAGE_COUNT, stage);
+    // Asserts do not halt the host builds, so a bad stage must not index past the stats
+    if (stage >= PROFILE_STAGE_COUNT) {
+        return;
+    }
+    ProfileStats* stats = &m_profile_stats[stage];
+    stats->last = ticks;
+    stats->min = (ticks < stats->min) ? ticks : stats->min;
+    stats->max = (ticks > stats->max) ? ticks : stats->max;
+    stats->count += 1;
+    stats->total += ticks;
+    stats->histogram[profiler_histogram_bin(ticks)] += 1;
+}
+
+void profiler_start(ProfileStage stage) {
+    SW_ASSERT1(stage < PROFILE_STAGE_COUNT, stage);
+    if (stage >= PROFILE_STAGE_COUNT) {
+        return;
+    }
+    m_profile_starts[stage] = profiler_timestamp();
+}
+
+uint32_t profiler_stop(ProfileStage stage) {
+    SW_ASSERT1(stage < PROFILE_STAGE_COUNT, stage);
+    if (stage >= PROFILE_STAGE_COUNT) {
+        return 0;
+    }
+    uint32_t elapsed = profiler_timestamp() - m_profile_starts[stage];
+    profiler_record(stage, elapsed);
+    // Only convert to microseconds on a new maximum, the M0 has no hardware divide
+    if ((stage == PROFILE_STAGE_CYCLE) && (elapsed == m_profile_stats[stage].max)) {
+        p_uartDebug.fswStats.maxCycle = elapsed / PROFILE_TICKS_PER_US;
+    }
+    return elapsed;
+}
+
+const ProfileStats* profiler_get_stats(ProfileStage stage) {
+    SW_ASSERT1(stage < PROFILE_STAGE_COUNT, stage);
+    return &m_profile_stats[stage];
+}
+
+uint32_t profiler_mean(ProfileStage stage) {
+    SW_ASSERT1(stage < PROFILE_STAGE_COUNT, stage);
+    const ProfileStats* stats = &m_profile_stats[stage];
+    return (stats->count == 0) ? 0 : (uint32_t) (stats->total / stats->count);
+}
@@ -0,0 +1,28 @@
+/*
+ * profiler_dri.c:
+ *
+ * Hardware timestamp for the profiler. Combines the HAL millisecond tick with the SysTick down-counter to get a
+ * free-running count of CPU clock ticks without using another hardware timer. Also read with interrupts disabled,
+ * around the sleep of the idle wait, when a SysTick wrap may be pending and not yet counted in the millisecond tick.
+ */
+#include <stdbool.h>
+#include <stm32f0xx_hal.h>
+#include <ventilator/profiler.h>
+
+uint32_t profiler_timestamp(void) {
+    uint32_t tick = 0;
+    uint32_t count = 0;
+    bool pending = false;
+    uint32_t reload = SysTick->LOAD;
+    // Re-read if the SysTick interrupt advanced the millisecond tick, or the counter wrapped, between the reads
+    do {
+        tick = HAL_GetTick();
+        pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+        count = SysTick->VAL;
+    } while ((tick != HAL_GetTick()) || (pending != ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0)));
+    // A pending wrap is already in the counter, but not yet in the tick
+    if (pending) {
+        tick += 1;
+    }
+    return (tick * (reload + 1)) + (reload - count);
+}
@@ -0,0 +1,126 @@
+/*
+ * telemetry.c:
+ *
+ * Implementation of the telemetry ring buffer. The main loop adds frames at the head, and DMA transfers drain the
+ * ring from the tail. Indices run freely and are masked into the ring, so head - tail is the bytes held even across
+ * wraps. A transfer never crosses the end of the ring, so a wrapped frame is sent as two transfers.
+ */
+#include <string.h>
+#include <swassert.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/panel_public.h>
+
+STATIC uint8_t m_telemetry_ring[TELEMETRY_RING_SIZE];
+STATIC volatile uint32_t m_telemetry_head = 0;    // Index after the last queued byte, advanced by the main loop
+STATIC volatile uint32_t m_telemetry_tail = 0;    // Index of the first unsent byte, advanced by the DMA interrupt
+STATIC volatile uint32_t m_telemetry_sending = 0; // Bytes of the transfer on the DMA, 0 when idle
+STATIC uint32_t m_telemetry_stall_cycles = 0;     // Cycles the current transfer has taken
+STATIC uint32_t m_telemetry_sequence = 0;
+STATIC uint32_t m_telemetry_dropped = 0;
+// Kept off the stack, which is only 0x400 bytes. Only used from the main loop
+STATIC uint8_t m_telemetry_frame[FRAME_PAYLOAD_MAX + FRAME_OVERHEAD];
+STATIC TelemetryStatus m_telemetry_status;
+
+void telemetry_init(void) {
+    m_telemetry_head = 0;
+    m_telemetry_tail = 0;
+    m_telemetry_sending = 0;
+    m_telemetry_stall_cycles = 0;
+    m_telemetry_sequence = 0;
+    m_telemetry_dropped = 0;
+}
+
+/**
+ * Start a transfer of the bytes from the tail up to the head or the end of the ring. Must be called with interrupts
+ * disabled.
+ */
+void telemetry_start(void) {
+    uint32_t offset = m_telemetry_tail & (TELEMETRY_RING_SIZE - 1);
+    uint32_t size = m_telemetry_head - m_telemetry_tail;
+    if ((m_telemetry_sending != 0) || (size == 0)) {
+        return;
+    }
+    size = ((offset + size) > TELEMETRY_RING_SIZE) ? (TELEMETRY_RING_SIZE - offset) : size;
+    m_telemetry_sending = size;
+    m_telemetry_stall_cycles = 0;
+    // A transfer that could not start is retried by the next frame or cycle
+    if (telemetry_dma_start(&m_telemetry_ring[offset], size) != HAL_OK) {
+        m_telemetry_sending = 0;
+    }
+}
+
+void telemetry_sent(void) {
+    m_telemetry_tail += m_telemetry_sending;
+    m_telemetry_sending = 0;
+    telemetry_start();
+}
+
+HAL_StatusTypeDef telemetry_send(uint8_t type, const void* payload, uint8_t size) {
+    uint32_t length = frame_encode(m_telemetry_frame, type, payload, size);
+    if ((TELEMETRY_RING_SIZE - (m_telemetry_head - m_telemetry_tail)) < length) {
+        m_telemetry_dropped += 1;
+        return HAL_BUSY;
+    }
+    // Copy in up to the end of the ring, and the rest from the start
+    uint32_t offset = m_telemetry_head & (TELEMETRY_RING_SIZE - 1);
+    uint32_t first = ((offset + length) > TELEMETRY_RING_SIZE) ? (TELEMETRY_RING_SIZE - offset) : length;
+    (void) memcpy(&m_telemetry_ring[offset], m_telemetry_frame, first);
+    (void) memcpy(m_telemetry_ring, &m_telemetry_frame[first], length - first);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    m_telemetry_head += length;
+    telemetry_start();
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+const TelemetryStatus* telemetry_status(void) {
+    TelemetryStatus* status = &m_telemetry_status;
+    uint32_t i = 0;
+    const NumericalValue* readings = (const NumericalValue*)&p_numericalValues;
+    const Alarm* alarms = (const Alarm*)&p_numericalValues.alarms;
+    (void) memset(status, 0, sizeof(TelemetryStatus));
+    status->sequence = m_telemetry_sequence;
+    status->dropped = m_telemetry_dropped;
+    status->alive_minutes = p_aliveMinutes;
+    status->fsw_stats = p_uartDebug.fswStats;
+    for (i = 0; i < TELEMETRY_READING_COUNT; i++) {
+        status->readings[i] = readings[i].val;
+    }
+    for (i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        const ProfileStats* stats = profiler_get_stats((ProfileStage)i);
+        status->stage_last[i] = stats->last;
+        status->stage_max[i] = stats->max;
+    }
+    for (i = 0; i < TELEMETRY_ALARM_COUNT; i++) {
+        status->alarms[i] = alarms[i].status;
+    }
+    status->power_state = p_powerState;
+    // Time not slept in the period from the start of one wait to the next
+    uint32_t period = status->stage_last[PROFILE_STAGE_WAIT] + status->stage_last[PROFILE_STAGE_CYCLE];
+    uint32_t idle = status->stage_last[PROFILE_STAGE_IDLE];
+    if ((period != 0) && (idle <= period)) {
+        status->load = (uint16_t)((((uint64_t)(period - idle)) * 1000) / period);
+    }
+    return status;
+}
+
+void telemetry_cycle(void) {
+    // A transfer far longer than the ring takes to send has stalled, abort it so the ring drains again
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if ((m_telemetry_sending != 0) && (++m_telemetry_stall_cycles > TELEMETRY_STALL_CYCLES)) {
+        telemetry_dma_abort();
+        m_telemetry_sending = 0;
+        m_telemetry_tail = m_telemetry_head;
+        m_telemetry_dropped += 1;
+    }
+    __set_PRIMASK(primask);
+    const TelemetryStatus* status = telemetry_status();
+    m_telemetry_sequence += 1;
+    (void) telemetry_send(FRAME_TYPE_STATUS, status, sizeof(TelemetryStatus));
+}
+
+uint32_t telemetry_dropped(void) {
+    return m_telemetry_dropped;
+}
@@ -0,0 +1,36 @@
+/*
+ * telemetry_dri.c:
+ *
+ * USART1 TX DMA for the telemetry ring. The DMA channel is started directly rather than through
+ * HAL_UART_Transmit_DMA, as the HAL would wait on the USART1 transmit complete interrupt, which is not enabled, before
+ * accepting the next transfer. The channel's completion interrupt is handled in DMA1_Channel2_3_IRQHandler.
+ */
+#include <stm32f0xx_hal.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/panel_public.h>
+
+extern DMA_HandleTypeDef hdma_usart1_tx;
+
+/**
+ * DMA completion and error callback, the transfer is finished either way.
+ */
+void telemetry_dma_complete(DMA_HandleTypeDef* hdma) {
+    telemetry_sent();
+}
+
+HAL_StatusTypeDef telemetry_dma_start(const uint8_t* data, uint16_t size) {
+    hdma_usart1_tx.XferCpltCallback = telemetry_dma_complete;
+    hdma_usart1_tx.XferHalfCpltCallback = NULL;
+    hdma_usart1_tx.XferErrorCallback = telemetry_dma_complete;
+    HAL_StatusTypeDef status = HAL_DMA_Start_IT(&hdma_usart1_tx, (uint32_t)(uintptr_t)data,
+                                                 (uint32_t)(uintptr_t)&huart1.Instance->TDR, size);
+    if (status == HAL_OK) {
+        SET_BIT(huart1.Instance->CR3, USART_CR3_DMAT);
+    }
+    return status;
+}
+
+void telemetry_dma_abort(void) {
+    CLEAR_BIT(huart1.Instance->CR3, USART_CR3_DMAT);
+    (void) HAL_DMA_Abort(&hdma_usart1_tx);
+}
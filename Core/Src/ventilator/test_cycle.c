@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <ventilator/button.h>
 #include <ventilator/cycle.h>
+#include <ventilator/alarm.h>
 #include <string.h>
 #include <ventilator/panel_public.h>
 #include <swassert.h>
@@ -292,39 +293,39 @@ bool doTestCycle(void) {
             }
             break;
         case TEST_DISCONNECT_LED:
-            p_numericalValues.alarms.disconnect.status = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(disconnect), ALARM_LATCH);
             testState = TEST_PEEP_LED;
             break;
         case TEST_PEEP_LED:
-            p_numericalValues.alarms.peep.status = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(peep), ALARM_LATCH);
             testState = TEST_TIDAL_LED;
             break;
         case TEST_TIDAL_LED:
-            p_numericalValues.alarms.tidal_vol.status = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(tidal_vol), ALARM_LATCH);
             testState = TEST_PEAK_LED;
             break;
         case TEST_PEAK_LED:
-            p_numericalValues.alarms.peak_press.status = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(peak_press), ALARM_LATCH);
             testState = TEST_RESP_LED;
             break;
         case TEST_RESP_LED:
-            p_numericalValues.alarms.resp_rate.status = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(resp_rate), ALARM_LATCH);
             testState = TEST_FI02_LED;
             break;
         case TEST_FI02_LED:
-            p_numericalValues.alarms.fio2.status = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(fio2), ALARM_LATCH);
             testState = TEST_POWER_OFF;
             break;
         case TEST_POWER_OFF:
-            p_numericalValues.alarms.power_off.status = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(power_off), ALARM_LATCH);
             testState = TEST_LO_PWER_LED;
             break;
         case TEST_LO_PWER_LED:
-            p_numericalValues.alarms.low_power.status  = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(low_power), ALARM_LATCH);
             testState = TEST_FAULT_LED;
             break;
         case TEST_FAULT_LED:
-            p_numericalValues.alarms.machine_fault.status  = ALARM_LATCH;
+            alarm_set_status(&p_numericalValues.alarms, ALARM_INDEX(machine_fault), ALARM_LATCH);
             testState = TEST_TIDAL_BAR;
             currDigit = 0;
             inc = 0;
@@ -444,37 +445,37 @@ bool doTestCycle(void) {
                 if (!status) {
                     break;
                 }
-                if (buttons.SET_FIO_ALRM_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM)) {
                     dispVal = 1;
                 }
-                if (buttons.SET_PEEP_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_SET_PEEP)) {
                     dispVal = 2;
                 }
-                if (buttons.SET_TV_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_SET_TV)) {
                     dispVal = 3;
                 }
-                if (buttons.SET_BUR_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_SET_BUR)) {
                     dispVal = 4;
                 }
-                if (buttons.SET_PEAK_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_SET_PEAK)) {
                     dispVal = 5;
                 }
-                if (buttons.SET_ITIME_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_SET_ITIME)) {
                     dispVal = 6;
                 }
-                if (buttons.POWER_DOWN_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_POWER_DOWN)) {
                     dispVal = 7;
                 }
-                if (buttons.ALRM_SILENCE_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_ALRM_SILENCE)) {
                     dispVal = 8;
                 }
-                if (buttons.GET_PLAT_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_GET_PLAT)) {
                     dispVal = 9;
                 }
-                if (buttons.ADJ_UP_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_ADJ_UP)) {
                     dispVal = 11;
                 }
-                if (buttons.ADJ_DWN_B) {
+                if (panel_button_down(buttons, BUTTON_MASK_ADJ_DWN)) {
                     dispVal = 10;
                     testState = TEST_FI02;
                     // exit back to test state
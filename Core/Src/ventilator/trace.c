@@ -0,0 +1,86 @@
+/*
+ * trace.c:
+ *
+ * Implementation of the trace capture. The packet of the last record delivered to the telemetry ring is kept, and the
+ * next records only carry the packet when it differs, or the keyframe countdown has run out.
+ */
+#include <string.h>
+#include <swassert.h>
+#include <ventilator/trace.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/controller.h>
+#include <ventilator/button.h>
+#include <ventilator/display.h>
+#include <ventilator/crc.h>
+#include <ventilator/panel_public.h>
+
+STATIC bool m_trace_capturing = false;
+STATIC bool m_trace_starting = false;      // Next record starts the capture
+STATIC uint32_t m_trace_cycle = 0;         // Cycles since init
+STATIC uint32_t m_trace_keyframe = 0;      // Records until the packet is sent regardless
+STATIC controller_packet_t m_trace_packet; // Packet of the last record delivered with one
+
+void trace_init(bool capture) {
+    m_trace_cycle = 0;
+    trace_capture(capture);
+}
+
+void trace_capture(bool capture) {
+    m_trace_capturing = capture;
+    m_trace_starting = capture;
+    m_trace_keyframe = 0;
+}
+
+uint16_t trace_display_crc(void) {
+    const Display* display = display_image();
+    uint16_t crc = crc16((const uint8_t*)display, DISPLAY_U16_COUNT * sizeof(uint16_t));
+    return crc16_update(crc, (const uint8_t*)&display->red_green_red, sizeof(display->red_green_red));
+}
+
+void trace_cycle(HAL_StatusTypeDef controller_status, bool attached) {
+    TraceRecord record;
+    uint32_t i = 0;
+    uint16_t buttons = 0;
+    const Alarm* alarms = (const Alarm*)&p_numericalValues.alarms;
+    const controller_packet_t* packet = controller_last_packet();
+    m_trace_cycle += 1;
+    if (!m_trace_capturing) {
+        return;
+    }
+    (void) memset(&record, 0, sizeof(record));
+    record.cycle = m_trace_cycle;
+    record.flags = (controller_status == HAL_OK) ? TRACE_FLAG_CONTROLLER_OK : 0;
+    if (attached) {
+        record.flags |= TRACE_FLAG_ATTACHED;
+        if (button_reading(&buttons)) {
+            record.flags |= TRACE_FLAG_BUTTONS;
+            record.buttons = buttons;
+        }
+    }
+    // Inputs only change between cycles, so this is the level alarm_run read
+    if (HAL_GPIO_ReadPin(GPIOB, LOW_BATTERY_Pin) == GPIO_PIN_RESET) {
+        record.flags |= TRACE_FLAG_LOW_BATTERY;
+    }
+    record.display_crc = trace_display_crc();
+    record.alive_hours = (uint16_t)(p_aliveMinutes / 60);
+    record.power_state = p_powerState;
+    for (i = 0; i < TRACE_ALARM_COUNT; i++) {
+        record.alarms[i] = alarms[i].status;
+    }
+    // The packet is sent when it changed, at keyframes, and to start the capture
+    uint8_t size = TRACE_RECORD_SHORT_SIZE;
+    bool full = m_trace_starting || (m_trace_keyframe == 0) || (memcmp(packet, &m_trace_packet, sizeof(controller_packet_t)) != 0);
+    if (full) {
+        record.flags |= TRACE_FLAG_PACKET | (m_trace_starting ? TRACE_FLAG_START : 0);
+        record.packet = *packet;
+        size = sizeof(TraceRecord);
+    }
+    // A dropped packet is not referenced by the next records, so it is sent again
+    if ((telemetry_send(FRAME_TYPE_TRACE, &record, size) == HAL_OK) && full) {
+        m_trace_packet = *packet;
+        m_trace_starting = false;
+        m_trace_keyframe = TRACE_KEYFRAME_CYCLES - 1;
+    } else if (m_trace_keyframe > 0) {
+        m_trace_keyframe -= 1;
+    }
+}
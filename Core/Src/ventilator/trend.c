@@ -0,0 +1,363 @@
+/*
+ * trend.c:
+ *
+ * Implementation of the EEPROM trend log. See trend.h for the layout.
+ */
+#include <string.h>
+#include <swassert.h>
+#include <ventilator/trend.h>
+
+static_assert(sizeof(Alarms) == (TREND_ALARM_COUNT * sizeof(Alarm)), "Alarms must only hold alarms");
+static_assert(((TREND_ALARM_COUNT - 1) << 3) <= 0xF8, "Alarm index must fit an event byte");
+static_assert(TREND_PAGE_PAYLOAD < 0xFF, "Record size must not be the erased value");
+
+// Aggregates of the current minute
+STATIC TrendRecord m_trend_current;
+STATIC int64_t m_trend_sums[TREND_QUANTITY_COUNT];
+STATIC uint32_t m_trend_samples = 0;
+STATIC uint8_t m_trend_alarm_status[TREND_ALARM_COUNT];
+// Closed record waiting to be placed into the page
+STATIC TrendRecord m_trend_pending;
+STATIC bool m_trend_pending_valid = false;
+// Current page, mirrored in RAM while records are appended
+STATIC uint8_t m_trend_page[EEPROM_PAGE_SIZE];
+STATIC TrendRecord m_trend_previous;         // Record the next record of the page is encoded against
+STATIC uint32_t m_trend_fill = 0;            // Bytes of the page used, 0 when no page is open
+STATIC volatile uint32_t m_trend_written = 0; // Bytes of the page written to the EEPROM
+STATIC uint32_t m_trend_write_end = 0;       // Bytes of the page written once the write on the bus completes
+STATIC volatile bool m_trend_writing = false;
+STATIC uint32_t m_trend_sequence = 0;        // Sequence of the open page, or of the next page when none is open
+STATIC uint32_t m_trend_dropped = 0;
+
+STATIC const TrendRecord TREND_ZERO_RECORD = {0}; // Base of the first record of a page
+
+/**
+ * EEPROM address of a page of the log.
+ */
+uint16_t trend_address(uint32_t sequence) {
+    return (EEPROM_TREND_FIRST_PAGE + (sequence % EEPROM_TREND_PAGES)) * EEPROM_PAGE_SIZE;
+}
+
+/**
+ * Read the sequence starting a ring page.
+ * uint32_t index: page within the ring
+ * uint32_t* sequence: (output) sequence read
+ * return: true when read and valid for the page
+ */
+bool trend_read_sequence(uint32_t index, uint32_t* sequence) {
+    uint16_t address = (EEPROM_TREND_FIRST_PAGE + index) * EEPROM_PAGE_SIZE;
+    if (eeprom_read_bytes(address, (uint8_t*)sequence, sizeof(uint32_t)) != EEPROM_OK) {
+        return false;
+    }
+    return (*sequence != 0xFFFFFFFF) && ((*sequence % EEPROM_TREND_PAGES) == index);
+}
+
+void trend_init(void) {
+    uint32_t first = 0;
+    uint32_t sequence = 0;
+    m_trend_samples = 0;
+    m_trend_pending_valid = false;
+    m_trend_fill = 0;
+    m_trend_written = 0;
+    m_trend_writing = false;
+    (void) memset(m_trend_alarm_status, ALARM_OFF, sizeof(m_trend_alarm_status));
+    if (!trend_read_sequence(0, &first)) {
+        // As in the alive journal, a torn write starting a pass leaves the newest page ending the previous pass
+        m_trend_sequence = trend_read_sequence(EEPROM_TREND_PAGES - 1, &sequence) ? (sequence + 1) : 0;
+        return;
+    }
+    uint32_t low = 0;
+    uint32_t high = EEPROM_TREND_PAGES - 1;
+    while (low < high) {
+        uint32_t middle = (low + high + 1) >> 1;
+        if (trend_read_sequence(middle, &sequence) && (sequence == (first + middle))) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    // Continue in a fresh page, the rest of the newest page is left unused
+    m_trend_sequence = first + low + 1;
+}
+
+void trend_sample(const NumericalValues* values) {
+    uint32_t i = 0;
+    SW_ASSERT(values != NULL);
+    const int32_t samples[TREND_QUANTITY_COUNT] = {
+        values->pressure.val, values->tidal_volume_last.val, values->resp_rate.val, values->FIO2.val
+    };
+    for (i = 0; i < TREND_QUANTITY_COUNT; i++) {
+        TrendAggregate* aggregate = &m_trend_current.aggregates[i];
+        if ((m_trend_samples == 0) || (samples[i] < aggregate->min)) {
+            aggregate->min = samples[i];
+        }
+        if ((m_trend_samples == 0) || (samples[i] > aggregate->max)) {
+            aggregate->max = samples[i];
+        }
+        m_trend_sums[i] = (m_trend_samples == 0) ? samples[i] : (m_trend_sums[i] + samples[i]);
+    }
+    if (m_trend_samples == 0) {
+        m_trend_current.event_count = 0;
+    }
+    m_trend_samples += 1;
+    // Alarms blink by switching between the blink phases every few cycles, which is not a transition
+    const Alarm* alarms = (const Alarm*)&values->alarms;
+    for (i = 0; i < TREND_ALARM_COUNT; i++) {
+        uint8_t status = (alarms[i].status == ALARM_BLINK_OFF) ? ALARM_BLINK_ON : alarms[i].status;
+        if (status == m_trend_alarm_status[i]) {
+            continue;
+        }
+        m_trend_alarm_status[i] = status;
+        if (m_trend_current.event_count < TREND_EVENTS_MAX) {
+            m_trend_current.events[m_trend_current.event_count].alarm = i;
+            m_trend_current.events[m_trend_current.event_count].status = status;
+            m_trend_current.event_count += 1;
+        }
+    }
+}
+
+void trend_minute(uint32_t minute) {
+    uint32_t i = 0;
+    if (m_trend_samples == 0) {
+        return;
+    }
+    if (m_trend_pending_valid) {
+        m_trend_dropped += 1;
+    }
+    // 64bit division, once a minute
+    for (i = 0; i < TREND_QUANTITY_COUNT; i++) {
+        m_trend_current.aggregates[i].mean = (int32_t)(m_trend_sums[i] / (int64_t)m_trend_samples);
+    }
+    m_trend_current.minute = minute;
+    m_trend_pending = m_trend_current;
+    m_trend_pending_valid = true;
+    m_trend_samples = 0;
+}
+
+/**
+ * Encode an unsigned varint, seven bits a byte with the high bit set on all but the last byte.
+ * return: bytes written, up to 5
+ */
+uint32_t trend_put_varint(uint8_t* data, uint32_t value) {
+    uint32_t size = 0;
+    while (value >= 0x80) {
+        data[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    data[size++] = (uint8_t)value;
+    return size;
+}
+
+/**
+ * Decode an unsigned varint, not reading past end.
+ * return: bytes read, 0 when malformed
+ */
+uint32_t trend_get_varint(const uint8_t* data, const uint8_t* end, uint32_t* value) {
+    uint32_t size = 0;
+    *value = 0;
+    while ((data + size) < end && size < 5) {
+        uint8_t byte = data[size];
+        *value |= (uint32_t)(byte & 0x7F) << (7 * size);
+        size += 1;
+        if ((byte & 0x80) == 0) {
+            return size;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Zig-zag mapping of a signed delta, so small deltas of either sign encode to short varints.
+ */
+uint32_t trend_zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t trend_unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/**
+ * Encode a record against the previous record of its page, or against zero when starting a page.
+ * const TrendRecord* record: record to encode
+ * const TrendRecord* previous: previous record, NULL to start a page
+ * uint8_t* data: (output) TREND_RECORD_MAX_SIZE bytes
+ * return: size of the record, including its size byte
+ */
+uint32_t trend_encode(const TrendRecord* record, const TrendRecord* previous, uint8_t* data) {
+    uint32_t size = 1;
+    uint32_t i = 0;
+    previous = (previous == NULL) ? &TREND_ZERO_RECORD : previous;
+    size += trend_put_varint(&data[size], record->minute - previous->minute);
+    for (i = 0; i < TREND_QUANTITY_COUNT; i++) {
+        const TrendAggregate* aggregate = &record->aggregates[i];
+        const TrendAggregate* last = &previous->aggregates[i];
+        size += trend_put_varint(&data[size], trend_zigzag((int32_t)((uint32_t)aggregate->min - (uint32_t)last->min)));
+        size += trend_put_varint(&data[size], trend_zigzag((int32_t)((uint32_t)aggregate->max - (uint32_t)last->max)));
+        size += trend_put_varint(&data[size], trend_zigzag((int32_t)((uint32_t)aggregate->mean - (uint32_t)last->mean)));
+    }
+    data[size++] = record->event_count;
+    for (i = 0; i < record->event_count; i++) {
+        data[size++] = (uint8_t)((record->events[i].alarm << 3) | (record->events[i].status & 0x7));
+    }
+    data[0] = (uint8_t)size;
+    return size;
+}
+
+/**
+ * Decode a zig-zag varint delta, and apply it to the previous value.
+ * return: true when decoded
+ */
+bool trend_get_delta(const uint8_t** next, const uint8_t* end, int32_t previous, int32_t* value) {
+    uint32_t delta = 0;
+    uint32_t size = trend_get_varint(*next, end, &delta);
+    *next += size;
+    *value = (int32_t)((uint32_t)previous + (uint32_t)trend_unzigzag(delta));
+    return size != 0;
+}
+
+/**
+ * Decode a record against the previous record of its page, or against zero for the first record.
+ * return: true when the record decoded exactly to its size
+ */
+bool trend_decode_record(const uint8_t* data, const TrendRecord* previous, TrendRecord* record) {
+    const uint8_t* end = data + data[0];
+    const uint8_t* next = data + 1;
+    uint32_t minutes = 0;
+    uint32_t size = 0;
+    uint32_t i = 0;
+    previous = (previous == NULL) ? &TREND_ZERO_RECORD : previous;
+    size = trend_get_varint(next, end, &minutes);
+    next += size;
+    record->minute = previous->minute + minutes;
+    bool valid = (size != 0);
+    for (i = 0; (i < TREND_QUANTITY_COUNT) && valid; i++) {
+        TrendAggregate* aggregate = &record->aggregates[i];
+        const TrendAggregate* last = &previous->aggregates[i];
+        valid = trend_get_delta(&next, end, last->min, &aggregate->min) &&
+                trend_get_delta(&next, end, last->max, &aggregate->max) &&
+                trend_get_delta(&next, end, last->mean, &aggregate->mean);
+    }
+    if (!valid || (next >= end) || (*next > TREND_EVENTS_MAX) || ((next + 1 + *next) != end)) {
+        return false;
+    }
+    record->event_count = *next++;
+    for (i = 0; i < record->event_count; i++) {
+        record->events[i].alarm = next[i] >> 3;
+        record->events[i].status = next[i] & 0x7;
+    }
+    return true;
+}
+
+uint32_t trend_decode(const uint8_t* data, TrendRecord* records, uint32_t max_records) {
+    uint32_t offset = TREND_PAGE_HEADER_SIZE;
+    uint32_t count = 0;
+    SW_ASSERT(data != NULL);
+    SW_ASSERT(records != NULL);
+    while ((count < max_records) && (offset < EEPROM_PAGE_SIZE)) {
+        uint8_t size = data[offset];
+        // Erased tail, or a size running past the page
+        if ((size < 2) || (size == 0xFF) || ((offset + size) > EEPROM_PAGE_SIZE)) {
+            break;
+        }
+        if (!trend_decode_record(&data[offset], (count == 0) ? NULL : &records[count - 1], &records[count])) {
+            break;
+        }
+        offset += size;
+        count += 1;
+    }
+    return count;
+}
+
+/**
+ * Completion of a page write.
+ */
+void trend_write_complete(EepromStatus status, void* context) {
+    (void) context;
+    if (status == EEPROM_OK) {
+        m_trend_written = m_trend_write_end;
+    }
+    m_trend_writing = false;
+}
+
+/**
+ * Place the pending record at the end of the open page, or start a new page once the open page is written.
+ */
+void trend_place(void) {
+    uint8_t data[TREND_RECORD_MAX_SIZE];
+    uint32_t size = 0;
+    if (m_trend_fill != 0) {
+        size = trend_encode(&m_trend_pending, &m_trend_previous, data);
+        if ((m_trend_fill + size) > EEPROM_PAGE_SIZE) {
+            // A new page may only be started once the open page is in the EEPROM
+            if (m_trend_written < m_trend_fill) {
+                return;
+            }
+            m_trend_sequence += 1;
+            m_trend_fill = 0;
+        }
+    }
+    if (m_trend_fill == 0) {
+        size = trend_encode(&m_trend_pending, NULL, data);
+        if (size > TREND_PAGE_PAYLOAD) {
+            m_trend_dropped += 1;
+            m_trend_pending_valid = false;
+            return;
+        }
+        // The first write covers the whole page, erasing the records of the previous pass
+        (void) memset(m_trend_page, 0xFF, sizeof(m_trend_page));
+        (void) memcpy(m_trend_page, &m_trend_sequence, sizeof(uint32_t));
+        m_trend_fill = TREND_PAGE_HEADER_SIZE;
+        m_trend_written = 0;
+    }
+    (void) memcpy(&m_trend_page[m_trend_fill], data, size);
+    m_trend_fill += size;
+    m_trend_previous = m_trend_pending;
+    m_trend_pending_valid = false;
+}
+
+void trend_cycle(void) {
+    // Bytes on the bus must not change, so nothing is placed while writing
+    if (m_trend_writing) {
+        return;
+    }
+    if (m_trend_pending_valid) {
+        trend_place();
+    }
+    if (m_trend_written < m_trend_fill) {
+        uint32_t start = m_trend_written;
+        uint32_t size = (start == 0) ? EEPROM_PAGE_SIZE : (m_trend_fill - start);
+        m_trend_write_end = m_trend_fill;
+        m_trend_writing = true;
+        if (eeprom_write_bytes(trend_address(m_trend_sequence) + start, &m_trend_page[start], size,
+                               trend_write_complete, NULL) != EEPROM_OK) {
+            m_trend_writing = false;
+        }
+    }
+}
+
+uint32_t trend_page_count(void) {
+    // The open page is counted, the next page is not
+    uint32_t pages = m_trend_sequence + ((m_trend_fill != 0) ? 1 : 0);
+    return (pages < EEPROM_TREND_PAGES) ? pages : EEPROM_TREND_PAGES;
+}
+
+EepromStatus trend_queue_read_page(uint32_t age, uint8_t* data, EepromCallback callback, void* context) {
+    SW_ASSERT(data != NULL);
+    SW_ASSERT(callback != NULL);
+    uint32_t count = trend_page_count();
+    if (age >= count) {
+        return EEPROM_ERROR;
+    }
+    uint32_t sequence = m_trend_sequence + ((m_trend_fill != 0) ? 1 : 0) - count + age;
+    if ((m_trend_fill != 0) && (sequence == m_trend_sequence)) {
+        (void) memcpy(data, m_trend_page, EEPROM_PAGE_SIZE);
+        callback(EEPROM_OK, context);
+        return EEPROM_OK;
+    }
+    return eeprom_queue_read(trend_address(sequence), data, EEPROM_PAGE_SIZE, callback, context);
+}
+
+uint32_t trend_dropped(void) {
+    return m_trend_dropped;
+}
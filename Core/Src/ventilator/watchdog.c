@@ -10,6 +10,7 @@
 #include <ventilator/constants.h>
 #include <ventilator/watchdog.h>
 #include <ventilator/panel_public.h>
+#include <ventilator/profiler.h>
 
 TIM_HandleTypeDef* TIMER;
 
@@ -24,14 +25,28 @@ void stroke_outgoing_watchdog(void) {
 }
 
 void spin_on_incoming_watchdog() {
-    // Spin waiting for the cycle.  Trip if the fail-safe clock enters failed state
-    do {
-        SW_ASSERT(p_doFail != FAIL_SAFE_CLOCK_FAILED);
-    } while (p_doCycle == 0);
+    uint32_t idle = 0;
+    // Sleep waiting for the cycle, woken by the incoming watchdog EXTI, the fail-safe timer, or any other interrupt.
+    // The flags are checked with interrupts disabled, so an edge arriving just before the WFI ends the sleep at once
+    // rather than being slept through. Only the sleep itself is counted as idle, the waking interrupt is serviced
+    // after the second timestamp.
+    __disable_irq();
+    while ((p_doCycle == 0) && (p_doFail != FAIL_SAFE_CLOCK_FAILED)) {
+        uint32_t start = profiler_timestamp();
+        __WFI();
+        idle += profiler_timestamp() - start;
+        __enable_irq();
+        __ISB();
+        __disable_irq();
+    }
+    __enable_irq();
+    // Trip if the fail-safe clock enters failed state
+    SW_ASSERT(p_doFail != FAIL_SAFE_CLOCK_FAILED);
     // Reset the ISR flag
     p_doCycle = 0;
+    profiler_record(PROFILE_STAGE_IDLE, idle);
 }
 
 void reset_fail_safe_timer(void) {
-    TIMER->Instance->CNT = 1; // Reset the fatal-timeout clock when a "good" packet is received
+    __HAL_TIM_SET_COUNTER(TIMER, 1); // Reset the fatal-timeout clock when a "good" packet is received
 }
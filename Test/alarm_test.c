@@ -10,35 +10,45 @@ int sound_timer = 0;
 extern uint32_t ALARM_SOUND_COUNTDOWN;
 extern NumericalValues p_numericalValues;
 extern uint8_t p_haltVentilation;
+extern const AlarmDescriptor ALARM_TABLE[ALARM_COUNT];
 
 int test_alarm_run_state() {
     Alarm alarm_test;
+    AlarmDescriptor descriptor_test;
     memset(&alarm_test, 0, sizeof(alarm_test));
-    alarm_test.trip_time = 50;
-    alarm_test.latch_time = 100;
+    memset(&descriptor_test, 0, sizeof(descriptor_test));
+    descriptor_test.trip_time = 50;
+    descriptor_test.latch_time = 100;
     int ret = 0;
     // Walk through the alarm states
     for (int i = 0; i < 150; i++) {
         AlarmStatus stat = (i < 49) ? ALARM_OFF : ((i < 99) ? ALARM_SET : ALARM_LATCH);
-        ret = alarm_run_state(&alarm_test, 1);  // Base test always tripped
+        ret = alarm_run_state(&alarm_test, &descriptor_test, 1);  // Base test always tripped
         TEST_ASSERT(alarm_test.status == stat, "Status check failed");
         TEST_ASSERT(ret == (i >= 49), "Return check failed");
     }
     // Reset count to verify it stays latched after latching above
     alarm_test.count = 0;
     for (int i = 0; i < 150; i++) {
-        ret = alarm_run_state(&alarm_test, 1); // Base test always tripped
+        ret = alarm_run_state(&alarm_test, &descriptor_test, 1); // Base test always tripped
         TEST_ASSERT(alarm_test.status == ALARM_LATCH, "Permanent latch failed");
         TEST_ASSERT(ret == 1, "Permanent fail failed");
     }
     // Not tripped tests: stays latched
-    ret = alarm_run_state(&alarm_test, 0);
+    ret = alarm_run_state(&alarm_test, &descriptor_test, 0);
     TEST_ASSERT(alarm_test.status == ALARM_LATCH, "Permanent latch failed");
     TEST_ASSERT(ret == 1, "Permanent fail failed to tone");
 
+    // Count saturates rather than wrapping
+    alarm_test.count = UINT16_MAX - 1;
+    for (int i = 0; i < 3; i++) {
+        ret = alarm_run_state(&alarm_test, &descriptor_test, 1);
+        TEST_ASSERT(alarm_test.count == UINT16_MAX && alarm_test.status == ALARM_LATCH, "Count did not saturate");
+    }
+
     // Set alarm will clear
     alarm_test.status = ALARM_SET;
-    ret = alarm_run_state(&alarm_test, 0);
+    ret = alarm_run_state(&alarm_test, &descriptor_test, 0);
     TEST_ASSERT(alarm_test.status == ALARM_OFF, "Auto clear set alarm failed");
     TEST_ASSERT(ret == 0, "Auto clear failed to clear tone");
     return 0;
@@ -115,6 +125,7 @@ int test_alarm_clear() {
 int test_alarm_run() {
     NumericalValues values;
     memset(&values, 0, sizeof(values)); // All counts are set to zero.  One out-of-val will trigger
+    values.peak_pressure_average.val = 1; // Peak pressure has no trip time in the alarm table, so trips at once
     PowerState state = POWER_OFF_STATE;
     ALARM_SOUND_COUNTDOWN = 0;
     alarm_run(&values, state); //Should not trip
@@ -160,15 +171,10 @@ void initialize_alarm_values(NumericalValues* values, int alarm) {
     GPIO_READ_TEST_VALUE = alarm ? 0 : 1;  // Good battery
     // Forced to alarm, set all counts for alarms to the latch value
     if (alarm) {
-        Alarms* alarms = &values->alarms;
-        alarms->disconnect.count = alarms->disconnect.latch_time;
-        alarms->fio2.count = alarms->fio2.latch_time;
-        alarms->low_power.count = alarms->low_power.latch_time;
-        alarms->machine_fault.count = alarms->machine_fault.latch_time;
-        alarms->peak_press.count = alarms->peak_press.latch_time;
-        alarms->peep.count = alarms->peep.latch_time;
-        alarms->resp_rate.count = alarms->resp_rate.latch_time;
-        alarms->tidal_vol.count = alarms->tidal_vol.latch_time;
+        Alarm* alarms = (Alarm*)&values->alarms;
+        for (int i = 0; i < ALARM_COUNT; i++) {
+            alarms[i].count = ALARM_TABLE[i].latch_time;
+        }
     }
 }
 
@@ -519,6 +525,45 @@ int test_alarm_all() {
     return 0;
 }
 
+int test_alarm_masks() {
+    NumericalValues values;
+    const AlarmMasks* masks = alarm_masks();
+    uint16_t detected = 0;
+    int i = 0;
+    // Forced alarms are latched, visible and sounding at their LED bits
+    initialize_alarm_values(&values, 1);
+    int tone = alarm_detect(&values);
+    SW_ASSERT_FLAG = 0;
+    TEST_ASSERT(tone == (masks->sounding != 0), "Tone not the sounding mask");
+    for (i = 0; i < ALARM_COUNT; i++) {
+        if (ALARM_TABLE[i].check != ALARM_CHECK_NONE) {
+            detected |= 1 << ALARM_TABLE[i].shift;
+        }
+    }
+    TEST_ASSERT(masks->visible == detected && masks->latched == detected && masks->sounding == detected,
+                "Forced alarms not in the masks");
+    TEST_ASSERT((masks->visible & (1 << DISPLAY_ALARM_POWER_OFF_SHIFT)) == 0, "Undetected alarm visible");
+    // Setting a status outside the state machines updates its bits, keeping the others
+    alarm_set_status(&values.alarms, ALARM_INDEX(power_off), ALARM_LATCH);
+    TEST_ASSERT(values.alarms.power_off.status == ALARM_LATCH, "Status not set");
+    TEST_ASSERT(masks->visible == (detected | (1 << DISPLAY_ALARM_POWER_OFF_SHIFT)), "Set status not visible");
+    alarm_set_status(&values.alarms, ALARM_INDEX(disconnect), ALARM_BLINK_OFF);
+    TEST_ASSERT((masks->visible & (1 << DISPLAY_ALARM_DISCONNECT_SHIFT)) == 0, "Blink off phase visible");
+    TEST_ASSERT(masks->blinking == (1 << DISPLAY_ALARM_DISCONNECT_SHIFT), "Blinking alarm not in the mask");
+    TEST_ASSERT((masks->latched & (1 << DISPLAY_ALARM_DISCONNECT_SHIFT)) == 0, "Blinking alarm latched");
+    // Halting ventilation blinks the PEEP alarm
+    initialize_alarm_values(&values, 0);
+    values.pressure.val = 99;
+    (void) alarm_detect(&values);
+    TEST_ASSERT(masks->blinking == (1 << DISPLAY_ALARM_PEEP_PRES_SHIFT), "Halt ventilation not blinking");
+    TEST_ASSERT(masks->visible == (1 << DISPLAY_ALARM_PEEP_PRES_SHIFT), "Halt ventilation not visible");
+    // Clearing clears the masks
+    alarm_clear(&values.alarms);
+    TEST_ASSERT((masks->visible | masks->sounding | masks->latched | masks->blinking) == 0, "Masks not cleared");
+    p_haltVentilation = false;
+    return 0;
+}
+
 int main(int argc, char** argv) {
     TEST(test_alarm_run_state);
     TEST(test_alarm_silence);
@@ -534,5 +579,6 @@ int main(int argc, char** argv) {
     TEST(test_alarm_detect_low_power);
     TEST(test_alarm_detect_sw_assert);
     TEST(test_alarm_all);
+    TEST(test_alarm_masks);
 
 }
@@ -0,0 +1,141 @@
+/**
+ * alive_journal_test.c:
+ *
+ * Test the alive-minutes journal finds its newest entry, spreads its writes, and survives torn writes.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/alive_journal.h>
+#include <ventilator/i2c_queue.h>
+
+/**
+ * Erase the EEPROM and set the legacy alive-minutes record.
+ */
+void reset_eeprom(uint32_t legacy_minutes) {
+    i2c_queue_init();
+    I2C_TEST_DEFER_COMPLETE = 0;
+    I2C_TEST_EEPROM_BUSY = 0;
+    (void) memset(I2C_TEST_EEPROM, 0xFF, sizeof(I2C_TEST_EEPROM));
+    (void) memset(I2C_TEST_EEPROM_PAGE_WRITES, 0, sizeof(I2C_TEST_EEPROM_PAGE_WRITES));
+    (void) memcpy(&I2C_TEST_EEPROM[EEPROM_ALIVE_MINUTES * EEPROM_PAGE_SIZE], &legacy_minutes, sizeof(legacy_minutes));
+}
+
+/**
+ * Record a count, and run the cycle that completes its write.
+ */
+EepromStatus record(uint32_t minutes) {
+    EepromStatus status = alive_journal_record(minutes);
+    eeprom_cycle();
+    return status;
+}
+
+/**
+ * Entry stored in a journal page.
+ */
+AliveJournalEntry* journal_page(uint32_t index) {
+    return (AliveJournalEntry*)&I2C_TEST_EEPROM[(EEPROM_JOURNAL_FIRST_PAGE + index) * EEPROM_PAGE_SIZE];
+}
+
+int test_alive_journal_seed() {
+    TEST_START("alive journal seeds from the legacy record");
+    reset_eeprom(1234);
+    TEST_ASSERT(alive_journal_load() == 1234, "Legacy count not loaded");
+    TEST_ASSERT(alive_journal_sequence() == 0, "Empty journal did not start at zero");
+    TEST_ASSERT(record(1235) == EEPROM_OK, "Record failed");
+    TEST_ASSERT(alive_journal_load() == 1235, "Recorded count not loaded");
+    TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[EEPROM_ALIVE_MINUTES] == 0, "Legacy record written");
+    // A blank EEPROM starts from zero
+    reset_eeprom(ALIVE_JOURNAL_ERASED);
+    TEST_ASSERT(alive_journal_load() == 0, "Erased legacy record loaded");
+    return 0;
+}
+
+int test_alive_journal_search() {
+    TEST_START("alive journal finds the newest entry with a binary search");
+    uint32_t minutes = 0;
+    reset_eeprom(0);
+    (void) alive_journal_load();
+    // Stop after every count of entries across several passes of the ring
+    for (minutes = 1; minutes <= (3 * EEPROM_JOURNAL_PAGES + 5); minutes++) {
+        TEST_ASSERT(record(minutes) == EEPROM_OK, "Record failed");
+        I2C_READ_TEST_COUNT = 0;
+        TEST_ASSERT(alive_journal_load() == minutes, "Newest entry not found");
+        TEST_ASSERT(alive_journal_sequence() == minutes, "Sequence not continued");
+        // First page, plus a read per halving of the ring
+        TEST_ASSERT(I2C_READ_TEST_COUNT <= 8, "Search read too many pages");
+    }
+    return 0;
+}
+
+int test_alive_journal_wear() {
+    TEST_START("alive journal spreads writes across its pages");
+    uint32_t minutes = 0;
+    uint32_t page = 0;
+    reset_eeprom(0);
+    (void) alive_journal_load();
+    // A year of minutes
+    for (minutes = 1; minutes <= 525600; minutes++) {
+        TEST_ASSERT(record(minutes) == EEPROM_OK, "Record failed");
+    }
+    for (page = 0; page < EEPROM_PAGE_COUNT; page++) {
+        uint32_t expected = 0;
+        if ((page >= EEPROM_JOURNAL_FIRST_PAGE) && (page < (EEPROM_JOURNAL_FIRST_PAGE + EEPROM_JOURNAL_PAGES))) {
+            expected = (525600 + EEPROM_JOURNAL_PAGES - 1 - (page - EEPROM_JOURNAL_FIRST_PAGE)) / EEPROM_JOURNAL_PAGES;
+        }
+        TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[page] == expected, "Writes not spread evenly");
+    }
+    TEST_ASSERT(alive_journal_load() == 525600, "Newest entry not found");
+    return 0;
+}
+
+int test_alive_journal_torn() {
+    TEST_START("alive journal falls back past a torn write");
+    uint32_t minutes = 0;
+    reset_eeprom(0);
+    (void) alive_journal_load();
+    for (minutes = 1; minutes <= (EEPROM_JOURNAL_PAGES + 10); minutes++) {
+        (void) record(minutes);
+    }
+    // Newest entry is in page 9
+    journal_page(9)->minutes = 0x1234;
+    TEST_ASSERT(alive_journal_load() == (EEPROM_JOURNAL_PAGES + 9), "Torn entry not skipped");
+    TEST_ASSERT(record(EEPROM_JOURNAL_PAGES + 10) == EEPROM_OK, "Record failed");
+    TEST_ASSERT(alive_journal_load() == (EEPROM_JOURNAL_PAGES + 10), "Rewritten entry not found");
+    // Torn write starting a pass
+    reset_eeprom(0);
+    (void) alive_journal_load();
+    for (minutes = 1; minutes <= (2 * EEPROM_JOURNAL_PAGES + 1); minutes++) {
+        (void) record(minutes);
+    }
+    (void) memset(journal_page(0), 0xFF, sizeof(AliveJournalEntry));
+    TEST_ASSERT(alive_journal_load() == (2 * EEPROM_JOURNAL_PAGES), "Entry ending the pass not found");
+    TEST_ASSERT(alive_journal_sequence() == (2 * EEPROM_JOURNAL_PAGES), "Sequence not continued into the first page");
+    return 0;
+}
+
+int test_alive_journal_failed_write() {
+    TEST_START("alive journal retries a failed write in the same page");
+    reset_eeprom(0);
+    (void) alive_journal_load();
+    (void) record(1);
+    I2C_TEST_DEFER_COMPLETE = 1;
+    TEST_ASSERT(alive_journal_record(2) == EEPROM_OK, "Record failed");
+    TEST_ASSERT(alive_journal_record(3) == EEPROM_BUSY, "Record accepted while writing");
+    i2c_queue_complete(HAL_OK);    // Address
+    i2c_queue_complete(HAL_ERROR); // Data not acknowledged
+    TEST_ASSERT(alive_journal_sequence() == 1, "Sequence advanced past a failed write");
+    I2C_TEST_DEFER_COMPLETE = 0;
+    TEST_ASSERT(record(3) == EEPROM_OK, "Record failed");
+    TEST_ASSERT(journal_page(1)->minutes == 3, "Retry not written to the same page");
+    TEST_ASSERT(alive_journal_load() == 3, "Retried entry not found");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_alive_journal_seed);
+    TEST(test_alive_journal_search);
+    TEST(test_alive_journal_wear);
+    TEST(test_alive_journal_torn);
+    TEST(test_alive_journal_failed_write);
+}
@@ -0,0 +1,109 @@
+/**
+ * bargraph_generator.c:
+ *
+ * Host generator of Core/Src/ventilator/bargraph_table.c. Computes the wire-order words of every bargraph level and
+ * single point, so the firmware copies a table entry rather than building and bit-reversing the words each cycle.
+ *
+ * Usage (from the Test directory): make -f Makefile.bargraph generate_bargraph_table
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+enum {
+    LEVELS = 41,        // Levels 0 to BARGRAPH_DISPLAY_HEIGHT
+    BITS_PER_WORD = 16
+};
+
+/**
+ * Words of a bargraph, bit N - 1 of the 48 bit value is LED N counting from the bottom.
+ */
+typedef struct {
+    uint16_t upper;
+    uint16_t middle;
+    uint16_t lower;
+} Words;
+
+/**
+ * Reverse the bits within each byte of a word.
+ */
+uint16_t reverse_bytes(uint16_t word) {
+    uint16_t output = 0;
+    int i = 0;
+    for (i = 0; i < 8; i++) {
+        if (word & (1 << i)) {
+            output |= 1 << (7 - i);
+        }
+        if (word & (1 << (i + 8))) {
+            output |= 1 << (15 - i);
+        }
+    }
+    return output;
+}
+
+/**
+ * Swap the bytes of a word.
+ */
+uint16_t swap_bytes(uint16_t word) {
+    return (uint16_t)((word << 8) | (word >> 8));
+}
+
+/**
+ * Words with LEDs first to last (1-based, inclusive) set.
+ */
+Words led_range(int first, int last) {
+    Words words = {0, 0, 0};
+    int led = 0;
+    for (led = first; led <= last; led++) {
+        if (led > (2 * BITS_PER_WORD)) {
+            words.upper |= 1 << (led - (2 * BITS_PER_WORD) - 1);
+        } else if (led > BITS_PER_WORD) {
+            words.middle |= 1 << (led - BITS_PER_WORD - 1);
+        } else {
+            words.lower |= 1 << (led - 1);
+        }
+    }
+    return words;
+}
+
+/**
+ * Convert to the expander wire order. (A LSB) represents the high order bits for the lower 2 words, but the lower bits
+ * for the upper word. (B MSB) represents the lower order bits for the lower 2 words, and is disconnected on the upper
+ * word. All individual bytes have reversed-ordered bits.
+ * int swap_upper: the byte order of the upper word is swapped on the green bargraphs, but not on the red graph
+ */
+Words wire_order(Words words, int swap_upper) {
+    words.upper = reverse_bytes(words.upper);
+    words.upper = swap_upper ? swap_bytes(words.upper) : words.upper;
+    words.middle = swap_bytes(reverse_bytes(words.middle));
+    words.lower = swap_bytes(reverse_bytes(words.lower));
+    return words;
+}
+
+void print_table(const char* description, const char* name, int point, int wire, int swap_upper) {
+    int level = 0;
+    printf("\n// %s\n", description);
+    printf("const GreenBarGraph %s[BARGRAPH_DISPLAY_HEIGHT + 1] = {\n", name);
+    for (level = 0; level < LEVELS; level++) {
+        Words words = led_range(point ? level : 1, level);
+        if (wire) {
+            words = wire_order(words, swap_upper);
+        }
+        printf("    {0x%04X, 0x%04X, 0x%04X}%s // %d\n", words.upper, words.middle, words.lower, (level < LEVELS - 1) ? "," : " ",
+               level);
+    }
+    printf("};\n");
+}
+
+int main(int argc, char** argv) {
+    printf("/*\n");
+    printf(" * bargraph_table.c:\n");
+    printf(" *\n");
+    printf(" * Bargraph words for each level, generated by Test/bargraph_generator.c. Do not edit, regenerate with\n");
+    printf(" * \"make -f Makefile.bargraph generate_bargraph_table\" from the Test directory.\n");
+    printf(" */\n");
+    printf("#include <ventilator/bargraph.h>\n");
+    print_table("Level fill of the green bargraphs, in wire order", "BARGRAPH_LEVEL_TABLE", 0, 1, 1);
+    print_table("Single point of the red/green green bargraph, in bit order", "BARGRAPH_POINT_TABLE", 1, 0, 0);
+    print_table("Single point of the red/green red bargraph, in wire order", "BARGRAPH_RED_POINT_TABLE", 1, 1, 0);
+    return 0;
+}
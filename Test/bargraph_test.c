@@ -69,6 +69,26 @@ int test_bargraph_scaling() {
     return 0;
 }
 
+int test_bargraph_reciprocal_scaling() {
+    TEST_START("reciprocal bargraph scaling matches division");
+    int32_t value = 0;
+    int32_t extremes[] = {INT32_MIN, INT32_MIN + 1, -1, INT32_MAX - 1, INT32_MAX};
+    // Every value between below and above the charts
+    for (value = -1000; value < 2000; value++) {
+        TEST_ASSERT(bargraph_scaled_tidal(value) == bargraph_scaled_value(value, BARGRAPH_TIDAL_SHIFT, BARGRAPH_TIDAL_HEIGHT),
+                    "Tidal scaling differs from division");
+        TEST_ASSERT(bargraph_scaled_pressure(value) == bargraph_scaled_value(value, BARGRAPH_PRESSURE_SHIFT, BARGRAPH_PRESSURE_HEIGHT),
+                    "Pressure scaling differs from division");
+    }
+    for (value = 0; value < (int32_t)(sizeof(extremes)/sizeof(extremes[0])); value++) {
+        TEST_ASSERT(bargraph_scaled_tidal(extremes[value]) == bargraph_scaled_value(extremes[value], BARGRAPH_TIDAL_SHIFT, BARGRAPH_TIDAL_HEIGHT),
+                    "Tidal scaling differs from division at extreme");
+        TEST_ASSERT(bargraph_scaled_pressure(extremes[value]) == bargraph_scaled_value(extremes[value], BARGRAPH_PRESSURE_SHIFT, BARGRAPH_PRESSURE_HEIGHT),
+                    "Pressure scaling differs from division at extreme");
+    }
+    return 0;
+}
+
 int test_bargraph_values() {
     TEST_START("bargraph value population");
     int i = 0;
@@ -91,6 +111,28 @@ int test_bargraph_values() {
     return 0;
 }
 
+int test_bargraph_tables() {
+    TEST_START("bargraph tables match the bit reversed words");
+    int i = 0;
+    for (i = 0; i < 41; i++) {
+        // Build the level and points as computed before the tables
+        uint16_t lower = bargraph_get_u16_helper(i > 16 ? 16 : i);
+        uint16_t middle = bargraph_get_u16_helper(i > 32 ? 16 : (i > 16 ? i - 16 : 0));
+        uint16_t upper = bargraph_get_u16_helper(i > 32 ? i - 32 : 0);
+        TEST_ASSERT(BARGRAPH_LEVEL_TABLE[i].upper == little_to_big16(reverse_bit_order(upper)), "Level table upper word wrong");
+        TEST_ASSERT(BARGRAPH_LEVEL_TABLE[i].middle == little_to_big16(reverse_bit_order(middle)), "Level table middle word wrong");
+        TEST_ASSERT(BARGRAPH_LEVEL_TABLE[i].lower == little_to_big16(reverse_bit_order(lower)), "Level table lower word wrong");
+        uint64_t point = (i == 0) ? 0 : (((uint64_t)1) << (i - 1));
+        GreenBarGraph expected = {(uint16_t)(point >> 32), (uint16_t)(point >> 16), (uint16_t)point};
+        TEST_ASSERT(BARGRAPH_POINT_TABLE[i].upper == expected.upper && BARGRAPH_POINT_TABLE[i].middle == expected.middle &&
+                    BARGRAPH_POINT_TABLE[i].lower == expected.lower, "Point table wrong");
+        TEST_ASSERT(BARGRAPH_RED_POINT_TABLE[i].upper == reverse_bit_order(expected.upper), "Red table upper word wrong");
+        TEST_ASSERT(BARGRAPH_RED_POINT_TABLE[i].middle == little_to_big16(reverse_bit_order(expected.middle)), "Red table middle word wrong");
+        TEST_ASSERT(BARGRAPH_RED_POINT_TABLE[i].lower == little_to_big16(reverse_bit_order(expected.lower)), "Red table lower word wrong");
+    }
+    return 0;
+}
+
 int test_bargraph_red_green_values() {
     TEST_START("bargraph value population for red/green bargraph");
     int i = 0, j = 0, k = 0, h =0 , bit = 0;
@@ -131,6 +173,8 @@ int main(int argc, char** argv) {
     TEST(test_reverse_byte);
     TEST(test_reverse_bit_order);
     TEST(test_bargraph_values);
+    TEST(test_bargraph_tables);
     TEST(test_bargraph_red_green_values);
     TEST(test_bargraph_scaling);
+    TEST(test_bargraph_reciprocal_scaling);
 }
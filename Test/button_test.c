@@ -8,13 +8,30 @@
 #include "test.h"
 #include <stdint.h>
 #include <ventilator/button.h>
+#include <ventilator/i2c_queue.h>
 #include <ventilator/panel_public.h>
 #include <ventilator/panel.h>
 #include <string.h>
 
 extern ButtonState m_button_state[BUTTON_ID_NUM_BUTTONS];
+extern const ButtonConfig BUTTON_TABLE[BUTTON_ID_NUM_BUTTONS];
 extern ButtonId m_button_in_progress;
 extern ButtonId m_adjust_button_in_progress;
+extern uint32_t m_edit_timeout;
+extern PanelButtons m_button_down;
+extern uint32_t m_button_read_faults;
+
+/**
+ * Set the button expander capture and input registers as seen over I2C
+ */
+void set_button_expander(uint16_t capture, uint16_t inputs) {
+    I2C_READ_TEST_REGS[REG_INTFA] = 0xFF;
+    I2C_READ_TEST_REGS[REG_INTFB] = 0xFF;
+    I2C_READ_TEST_REGS[REG_INTCAPA] = capture & 0xFF;
+    I2C_READ_TEST_REGS[REG_INTCAPB] = capture >> 8;
+    I2C_READ_TEST_REGS[REG_GPIOA] = inputs & 0xFF;
+    I2C_READ_TEST_REGS[REG_GPIOB] = inputs >> 8;
+}
 
 
 
@@ -88,7 +105,7 @@ int test_is_adj_actionable() {
 
 int test_fio2_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
     p_numericalValues.FIO2.setpoint = 0;
     p_numericalValues.FIO2.val = 32;
     TEST_ASSERT(p_numericalValues.FIO2.setpoint != p_numericalValues.FIO2.val, "Setpoint set to val");
@@ -96,54 +113,46 @@ int test_fio2_state() {
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.SET_FIO_ALRM_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_FIO_ALARM;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.SET_FIO_ALRM_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_FIO_ALARM;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.SET_FIO_ALRM_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_FIO_ALARM;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_FIO_ALRM_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_FIO_ALARM;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_MODIFY, "Bad state transition");
 
-    buttons.SET_FIO_ALRM_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_FIO_ALARM;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.SET_FIO_ALRM_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_FIO_ALARM;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Test edit-mode timeout
-    buttons.SET_FIO_ALRM_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_FIO_ALARM;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_FIO_ALRM_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_FIO_ALARM;
+    run_button_state_machines(buttons);
 
     int i = 0;
     for (i = 0; i < EDIT_TIMEOUT; i++) {
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_MODIFY, "Bad state transition");
-        run_button_state_machines(&buttons);// Do nothing
+        run_button_state_machines(buttons);// Do nothing
     }
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_IDLE, "Bad timeout transition");
     return 0;
@@ -151,59 +160,51 @@ int test_fio2_state() {
 
 int test_itime_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_FIO_ALARM;
     m_button_state[BUTTON_ID_SET_FIO_ALARM].state = BUTTON_STATE_MODIFY;
-    buttons.SET_ITIME_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_ITIME;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_FIO_ALARM].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.SET_ITIME_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_ITIME;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.SET_ITIME_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_ITIME;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_ITIME_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_ITIME;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_MODIFY, "Bad state transition");
 
-    buttons.SET_ITIME_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_ITIME;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.SET_ITIME_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_ITIME;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Test edit-mode timeout
-    buttons.SET_ITIME_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_ITIME;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_ITIME_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_ITIME;
+    run_button_state_machines(buttons);
 
     int i = 0;
     for (i = 0; i < EDIT_TIMEOUT; i++) {
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_MODIFY, "Bad state transition");
-        run_button_state_machines(&buttons);// Do nothing
+        run_button_state_machines(buttons);// Do nothing
     }
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_ITIME].state == BUTTON_STATE_IDLE, "Bad timeout transition");
 
@@ -213,59 +214,51 @@ int test_itime_state() {
 
 int test_peak_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.SET_PEAK_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_PEAK;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.SET_PEAK_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_PEAK;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.SET_PEAK_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_PEAK;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_PEAK_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_PEAK;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_MODIFY, "Bad state transition");
 
-    buttons.SET_PEAK_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_PEAK;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.SET_PEAK_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_PEAK;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Test edit-mode timeout
-    buttons.SET_PEAK_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_PEAK;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_PEAK_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_PEAK;
+    run_button_state_machines(buttons);
 
     int i = 0;
     for (i = 0; i < EDIT_TIMEOUT; i++) {
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_MODIFY, "Bad state transition");
-        run_button_state_machines(&buttons);// Do nothing
+        run_button_state_machines(buttons);// Do nothing
     }
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEAK].state == BUTTON_STATE_IDLE, "Bad timeout transition");
 
@@ -275,59 +268,51 @@ int test_peak_state() {
 
 int test_peep_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.SET_PEEP_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_PEEP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.SET_PEEP_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_PEEP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.SET_PEEP_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_PEEP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_PEEP_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_PEEP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_MODIFY, "Bad state transition");
 
-    buttons.SET_PEEP_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_PEEP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.SET_PEEP_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_PEEP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Test edit-mode timeout
-    buttons.SET_PEEP_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_PEEP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_PEEP_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_PEEP;
+    run_button_state_machines(buttons);
 
     int i = 0;
     for (i = 0; i < EDIT_TIMEOUT; i++) {
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_MODIFY, "Bad state transition");
-        run_button_state_machines(&buttons);// Do nothing
+        run_button_state_machines(buttons);// Do nothing
     }
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_PEEP].state == BUTTON_STATE_IDLE, "Bad timeout transition");
 
@@ -336,59 +321,51 @@ int test_peep_state() {
 
 int test_tv_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.SET_TV_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_TV;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.SET_TV_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_TV;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.SET_TV_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_TV;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_TV_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_TV;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_MODIFY, "Bad state transition");
 
-    buttons.SET_TV_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_TV;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.SET_TV_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_TV;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Test edit-mode timeout
-    buttons.SET_TV_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_TV;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Bad state transition");
 
-    buttons.SET_TV_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_TV;
+    run_button_state_machines(buttons);
 
     int i = 0;
     for (i = 0; i < EDIT_TIMEOUT; i++) {
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_MODIFY, "Bad state transition");
-        run_button_state_machines(&buttons);// Do nothing
+        run_button_state_machines(buttons);// Do nothing
     }
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_TV].state == BUTTON_STATE_IDLE, "Bad timeout transition");
 
@@ -397,33 +374,29 @@ int test_tv_state() {
 
 int test_plat_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.GET_PLAT_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_GET_PLAT;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_GET_PLAT].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.GET_PLAT_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_GET_PLAT;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_GET_PLAT].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.GET_PLAT_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_GET_PLAT;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_GET_PLAT].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.GET_PLAT_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_GET_PLAT;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_GET_PLAT].state == BUTTON_STATE_IDLE, "Bad state transition");
     TEST_ASSERT(p_doPlateau == DO_PLATEAU_SENDS, "Failed to process momentary");
 
@@ -432,58 +405,50 @@ int test_plat_state() {
 
 int test_bur_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.SET_BUR_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.SET_BUR_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.SET_BUR_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_PRESS_TO_HOLD, "Bad state transition");
 
-    buttons.SET_BUR_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_MODIFY, "Bad state transition");
 
-    buttons.SET_BUR_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.SET_BUR_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Test edit-mode timeout
-    buttons.SET_BUR_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_PRESS_TO_HOLD, "Bad state transition");
 
-    buttons.SET_BUR_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     int i = 0;
     for (i = 0; i < EDIT_TIMEOUT; i++) {
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_MODIFY, "Bad state transition");
-        run_button_state_machines(&buttons);// Do nothing
+        run_button_state_machines(buttons);// Do nothing
     }
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_IDLE, "Bad timeout transition");
 
@@ -493,73 +458,63 @@ int test_bur_state() {
 
 int test_bur_hold_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.SET_BUR_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.SET_BUR_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
     int i = 0;
-    for (i = 0; i < m_button_state[BUTTON_ID_SET_BUR].wait; i++) {
-        buttons.SET_BUR_B = BUTTON_POS_ON;
-        buttons.ALL_BUTTONS = BUTTON_POS_ON;
-        run_button_state_machines(&buttons);
+    for (i = 0; i < BUTTON_TABLE[BUTTON_ID_SET_BUR].wait; i++) {
+        buttons |= BUTTON_MASK_SET_BUR;
+        run_button_state_machines(buttons);
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_PRESS_TO_HOLD, "Bad state transition");
     }
-    buttons.SET_BUR_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_WAITING_FOR_RELEASE_PRESS_TO_MODIFY, "Bad state transition");
 
 
-    buttons.SET_BUR_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_PRESS_TO_MODIFY, "Bad state transition");
 
-    buttons.SET_BUR_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.SET_BUR_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine to test timeout
-    for (i = 0; i < m_button_state[BUTTON_ID_SET_BUR].wait; i++) {
-        buttons.SET_BUR_B = BUTTON_POS_ON;
-        buttons.ALL_BUTTONS = BUTTON_POS_ON;
-        run_button_state_machines(&buttons);
+    for (i = 0; i < BUTTON_TABLE[BUTTON_ID_SET_BUR].wait; i++) {
+        buttons |= BUTTON_MASK_SET_BUR;
+        run_button_state_machines(buttons);
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_PRESS_TO_HOLD, "Bad state transition");
     }
-    buttons.SET_BUR_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_WAITING_FOR_RELEASE_PRESS_TO_MODIFY, "Bad state transition");
 
 
-    buttons.SET_BUR_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_SET_BUR;
+    run_button_state_machines(buttons);
 
     for (i = 0; i < EDIT_TIMEOUT; i++) {
         TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_PRESS_TO_MODIFY, "Bad state transition");
-        run_button_state_machines(&buttons);// Do nothing
+        run_button_state_machines(buttons);// Do nothing
     }
     TEST_ASSERT(m_button_state[BUTTON_ID_SET_BUR].state == BUTTON_STATE_IDLE, "Bad timeout transition");
 
@@ -569,33 +524,29 @@ int test_bur_hold_state() {
 
 int test_power_press_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
     p_powerState = POWER_OFF_STATE;
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.POWER_DOWN_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_POWER_DOWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.POWER_DOWN_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_POWER_DOWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.POWER_DOWN_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_POWER_DOWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_PRESS_TO_HOLD, "Bad state transition");
 
-    buttons.POWER_DOWN_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_POWER_DOWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_IDLE, "Bad state transition");
     TEST_ASSERT(p_powerState == POWERING_STATE, "Didn't power on");
 
@@ -604,41 +555,36 @@ int test_power_press_state() {
 
 int test_power_hold_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.POWER_DOWN_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_POWER_DOWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.POWER_DOWN_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_POWER_DOWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
     int i = 0;
-    for (i = 0; i < m_button_state[BUTTON_ID_POWER_DOWN].wait; i++) {
-        buttons.POWER_DOWN_B = BUTTON_POS_ON;
-        buttons.ALL_BUTTONS = BUTTON_POS_ON;
-        run_button_state_machines(&buttons);
+    for (i = 0; i < BUTTON_TABLE[BUTTON_ID_POWER_DOWN].wait; i++) {
+        buttons |= BUTTON_MASK_POWER_DOWN;
+        run_button_state_machines(buttons);
         TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_PRESS_TO_HOLD, "Bad state transition");
     }
-    buttons.POWER_DOWN_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_POWER_DOWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
     TEST_ASSERT(p_powerState == POWER_OFF_STATE, "Powered off state");
 
-    buttons.POWER_DOWN_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_POWER_DOWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_POWER_DOWN].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     return 0;
@@ -647,7 +593,7 @@ int test_power_hold_state() {
 
 int test_alarm_press_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
     p_numericalValues.alarms.tidal_vol.status = ALARM_LATCH;
     sound_start(SOUND_CONSTANT);
     TEST_ASSERT(sound_running, "Sound not on");
@@ -655,29 +601,25 @@ int test_alarm_press_state() {
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.ALRM_SILENCE_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_ALRM_SILENCE;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.ALRM_SILENCE_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_ALRM_SILENCE;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
-    buttons.ALRM_SILENCE_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_ALRM_SILENCE;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_PRESS_TO_HOLD, "Bad state transition");
 
 
-    buttons.ALRM_SILENCE_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_ALRM_SILENCE;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_IDLE, "Bad state transition");
     TEST_ASSERT(p_numericalValues.alarms.tidal_vol.status == ALARM_LATCH, "Not latched still");
     TEST_ASSERT(!sound_running, "Sound not off");
@@ -687,7 +629,7 @@ int test_alarm_press_state() {
 
 int test_alarm_hold_state() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
     p_numericalValues.alarms.tidal_vol.status = ALARM_LATCH;
     sound_start(SOUND_CONSTANT);
     TEST_ASSERT(sound_running, "Sound not on");
@@ -695,36 +637,31 @@ int test_alarm_hold_state() {
     // Check that a press is ignored when another button is active
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
-    buttons.ALRM_SILENCE_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_ALRM_SILENCE;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.ALRM_SILENCE_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_ALRM_SILENCE;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_IDLE, "Bad state transition");
 
     // Walk the state machine through
     int i = 0;
-    for (i = 0; i < m_button_state[BUTTON_ID_ALRM_SILENCE].wait; i++) {
-        buttons.ALRM_SILENCE_B = BUTTON_POS_ON;
-        buttons.ALL_BUTTONS = BUTTON_POS_ON;
-        run_button_state_machines(&buttons);
+    for (i = 0; i < BUTTON_TABLE[BUTTON_ID_ALRM_SILENCE].wait; i++) {
+        buttons |= BUTTON_MASK_ALRM_SILENCE;
+        run_button_state_machines(buttons);
         TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_PRESS_TO_HOLD, "Bad state transition");
     }
-    buttons.ALRM_SILENCE_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_ALRM_SILENCE;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
     TEST_ASSERT(!sound_running, "Sound not off");
 
-    buttons.ALRM_SILENCE_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_ALRM_SILENCE;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ALRM_SILENCE].state == BUTTON_STATE_IDLE, "Bad state transition");
     TEST_ASSERT(p_numericalValues.alarms.tidal_vol.status == ALARM_OFF, "Alarm not off");
 
@@ -733,7 +670,7 @@ int test_alarm_hold_state() {
 
 int test_adj_up() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
@@ -742,28 +679,24 @@ int test_adj_up() {
     m_adjust_button_in_progress = BUTTON_ID_ADJ_DWN;
     m_button_state[BUTTON_ID_ADJ_DWN].state = BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY;
 
-    buttons.ADJ_UP_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_ADJ_UP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ADJ_UP].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_adjust_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_ADJ_DWN].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.ADJ_UP_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_ADJ_UP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ADJ_UP].state == BUTTON_STATE_IDLE, "Bad state transition");
 
 
-    buttons.ADJ_UP_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_ADJ_UP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ADJ_UP].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
-    buttons.ADJ_UP_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_ADJ_UP;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ADJ_UP].state == BUTTON_STATE_MOMENTARY_DONE, "Bad state transition");
 
     return 0;
@@ -772,7 +705,7 @@ int test_adj_up() {
 
 int test_adj_dn() {
     PanelButtons buttons;
-    memset(&buttons, 0, sizeof(buttons));
+    buttons = 0;
 
     m_button_in_progress = BUTTON_ID_SET_ITIME;
     m_button_state[BUTTON_ID_SET_ITIME].state = BUTTON_STATE_MODIFY;
@@ -781,29 +714,25 @@ int test_adj_dn() {
     m_adjust_button_in_progress = BUTTON_ID_ADJ_UP;
     m_button_state[BUTTON_ID_ADJ_UP].state = BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY;
 
-    buttons.ADJ_DWN_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_ADJ_DWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ADJ_DWN].state == BUTTON_STATE_IDLE, "Bad state transition");
     m_adjust_button_in_progress = BUTTON_NONE;
     m_button_state[BUTTON_ID_ADJ_UP].state = BUTTON_STATE_IDLE;
 
     // No press makes no transition
-    buttons.ADJ_DWN_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_ADJ_DWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ADJ_DWN].state == BUTTON_STATE_IDLE, "Bad state transition");
 
 
-    buttons.ADJ_DWN_B = BUTTON_POS_ON;
-    buttons.ALL_BUTTONS = BUTTON_POS_ON;
-    run_button_state_machines(&buttons);
+    buttons |= BUTTON_MASK_ADJ_DWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ADJ_DWN].state == BUTTON_STATE_WAITING_FOR_RELEASE_IDLE, "Bad state transition");
 
 
-    buttons.ADJ_DWN_B = BUTTON_POS_OFF;
-    buttons.ALL_BUTTONS = BUTTON_POS_OFF;
-    run_button_state_machines(&buttons);
+    buttons &= ~BUTTON_MASK_ADJ_DWN;
+    run_button_state_machines(buttons);
     TEST_ASSERT(m_button_state[BUTTON_ID_ADJ_DWN].state == BUTTON_STATE_MOMENTARY_DONE, "Bad state transition");
 
     return 0;
@@ -983,6 +912,204 @@ int test_updates() {
     return 0;
 }
 
+int test_detect_button_edges() {
+    int i = 0;
+    PanelButtons buttons;
+    TEST_START("button detection on expander edges");
+    GPIO_READ_TEST_VALUE = GPIO_PIN_RESET; // Expander interrupt line low
+    HAL_TICK_TEST_VALUE = 1000;
+    set_button_expander(0, 0);
+    init_button_state();
+    // Idle cycles do not touch the bus
+    I2C_READ_TEST_COUNT = 0;
+    for (i = 0; i < 100; i++) {
+        HAL_TICK_TEST_VALUE += 20;
+        TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+        TEST_ASSERT(buttons == 0, "Button detected while idle");
+    }
+    TEST_ASSERT(I2C_READ_TEST_COUNT == 0, "Idle cycles read the expander");
+    // Press FIO2, the edge is captured but not accepted until the debounce time passes
+    set_button_expander(0x0080, 0x0080);
+    button_interrupt();
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(I2C_READ_TEST_COUNT == 1, "Edge capture not read");
+    TEST_ASSERT(!panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM), "Button accepted before debounce");
+    HAL_TICK_TEST_VALUE += BUTTON_DEBOUNCE_MS - 1;
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(!panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM), "Button accepted before debounce");
+    // A bounce restarts the debounce time
+    button_interrupt();
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    HAL_TICK_TEST_VALUE += BUTTON_DEBOUNCE_MS - 1;
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(!panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM), "Button accepted before debounce after bounce");
+    HAL_TICK_TEST_VALUE += 1;
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM), "Button not accepted after debounce");
+    TEST_ASSERT(buttons != 0, "Button summary not set");
+    TEST_ASSERT(I2C_READ_TEST_COUNT == 3, "Expected two captures and one confirmation read");
+    // Held button does not touch the bus
+    I2C_READ_TEST_COUNT = 0;
+    for (i = 0; i < 10; i++) {
+        HAL_TICK_TEST_VALUE += 20;
+        TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+        TEST_ASSERT(panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM), "Held button not reported");
+    }
+    TEST_ASSERT(I2C_READ_TEST_COUNT == 0, "Held button read the expander");
+    // Inputs changed again after the capture, reading restarts debounce from the confirmation
+    set_button_expander(0x0000, 0x0100);
+    button_interrupt();
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    HAL_TICK_TEST_VALUE += BUTTON_DEBOUNCE_MS;
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM), "Mismatched confirmation accepted");
+    HAL_TICK_TEST_VALUE += BUTTON_DEBOUNCE_MS;
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(!panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM), "Release not accepted");
+    TEST_ASSERT(panel_button_down(buttons, BUTTON_MASK_ADJ_UP), "Confirmed press not accepted");
+    // A raised interrupt line without a captured edge is treated as an edge
+    set_button_expander(0, 0);
+    GPIO_READ_TEST_VALUE = GPIO_PIN_SET;
+    I2C_READ_TEST_COUNT = 0;
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(I2C_READ_TEST_COUNT == 1, "Raised interrupt line not captured");
+    GPIO_READ_TEST_VALUE = GPIO_PIN_RESET;
+    HAL_TICK_TEST_VALUE += BUTTON_DEBOUNCE_MS;
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(buttons == 0, "Release not accepted");
+    GPIO_READ_TEST_VALUE = 1;
+    return 0;
+}
+
+int test_detect_button_read_faults() {
+    int i = 0;
+    uint8_t fault = 0;
+    PanelButtons buttons;
+    TEST_START("button detection faults on a dead or stalled expander");
+    GPIO_READ_TEST_VALUE = GPIO_PIN_RESET;
+    HAL_TICK_TEST_VALUE = 1000;
+    set_button_expander(0x0080, 0x0080);
+    init_button_state();
+    i2c_queue_init();
+    // A read dropped by a reset of the I2C queue is failed, and the capture retried
+    I2C_TEST_DEFER_COMPLETE = 1;
+    button_interrupt();
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    i2c_queue_reset();
+    I2C_TEST_DEFER_COMPLETE = 0;
+    TEST_ASSERT(!detect_button_state(&buttons), "Dropped read not failed");
+    TEST_ASSERT(detect_button_state(&buttons), "Capture not retried");
+    HAL_TICK_TEST_VALUE += BUTTON_DEBOUNCE_MS;
+    TEST_ASSERT(detect_button_state(&buttons), "Detect failed");
+    TEST_ASSERT(panel_button_down(buttons, BUTTON_MASK_SET_FIO_ALARM), "Button not accepted after dropped read");
+    // Failed reads are tolerated until they persist
+    I2C_TEST_DEFER_COMPLETE = 1;
+    button_interrupt();
+    for (i = 0; i < BUTTON_READ_FAULT_CYCLES - 1; i++) {
+        detect_button_state(&buttons);
+        i2c_queue_complete(HAL_ERROR);
+    }
+    TEST_ASSERT(!detect_button_state(&buttons), "Failed read not reported");
+    i2c_queue_complete(HAL_ERROR);
+    detect_button_state(&buttons);
+    fault = SW_ASSERT_FLAG;
+    SW_ASSERT_FLAG = 0; // Expected assert, cleared before checking
+    TEST_ASSERT(fault, "Dead expander did not fault");
+    // A read that never completes faults as well
+    i2c_queue_init();
+    init_button_state();
+    button_interrupt();
+    for (i = 0; i < BUTTON_READ_FAULT_CYCLES; i++) {
+        detect_button_state(&buttons);
+    }
+    TEST_ASSERT(m_button_read_faults == BUTTON_READ_FAULT_CYCLES - 1, "Outstanding read not counted");
+    detect_button_state(&buttons);
+    fault = SW_ASSERT_FLAG;
+    SW_ASSERT_FLAG = 0;
+    TEST_ASSERT(fault, "Stalled read did not fault");
+    I2C_TEST_DEFER_COMPLETE = 0;
+    i2c_queue_init();
+    GPIO_READ_TEST_VALUE = 1;
+    return 0;
+}
+
+int test_decode_button_table() {
+    int i = 0;
+    PanelButtons buttons;
+    PanelButtons last = 0;
+    TEST_START("button positions decoded in the expander bit order");
+    init_button_state();
+    // Each button is read from its own bit, and the bits outside the table are ignored
+    for (i = 0; i < BUTTON_ID_NUM_BUTTONS; i++) {
+        decode_button_state(BUTTON_TABLE[i].mask | 0xC403, &buttons);
+        TEST_ASSERT(buttons == BUTTON_TABLE[i].mask, "Bad button position");
+        TEST_ASSERT(panel_buttons_changed(buttons, last) == BUTTON_TABLE[i].mask, "Bad changed buttons");
+        decode_button_state(0xC403, &buttons);
+        TEST_ASSERT(buttons == 0, "Unused bits decoded as a button");
+        last = buttons;
+    }
+    TEST_ASSERT(BUTTON_MASK_ALL == 0x3BFC, "Bad button mask");
+    // Hold times of the press to hold buttons
+    TEST_ASSERT(BUTTON_TABLE[BUTTON_ID_SET_BUR].wait == BUTTON_DELAY, "Bad backup rate hold time");
+    TEST_ASSERT(BUTTON_TABLE[BUTTON_ID_POWER_DOWN].wait == POWER_OFF_DELAY, "Bad power hold time");
+    TEST_ASSERT(BUTTON_TABLE[BUTTON_ID_ALRM_SILENCE].wait == ALARM_CLEAR_DELAY, "Bad alarm hold time");
+    init_button_state();
+    return 0;
+}
+
+int test_button_events() {
+    int i = 0;
+    PanelButtons buttons;
+    ButtonEvent event;
+    TEST_START("button events queued on position changes and processed");
+    p_powerState = POWER_ON_STATE;
+    init_button_state();
+    // First processing settles the display modes, later idle cycles run nothing
+    process_buttons();
+    m_edit_timeout = 0;
+    for (i = 0; i < 10; i++) {
+        decode_button_state(0, &buttons);
+        process_buttons();
+    }
+    TEST_ASSERT(m_edit_timeout == 0, "Idle cycles ran the state machines");
+    // A press and a release queue one event each, an unchanged reading none
+    decode_button_state(0x0080, &buttons);
+    decode_button_state(0x0080, &buttons);
+    TEST_ASSERT(button_event_take(&event), "Press not queued");
+    TEST_ASSERT(event.id == BUTTON_ID_SET_FIO_ALARM && event.type == BUTTON_EVENT_PRESS, "Bad press event");
+    TEST_ASSERT(!button_event_take(&event), "Unchanged reading queued an event");
+    decode_button_state(0x0000, &buttons);
+    TEST_ASSERT(button_event_take(&event), "Release not queued");
+    TEST_ASSERT(event.id == BUTTON_ID_SET_FIO_ALARM && event.type == BUTTON_EVENT_RELEASE, "Bad release event");
+    // Processing the events walks the state machine
+    decode_button_state(0x0080, &buttons);
+    process_buttons();
+    TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_WAITING_FOR_RELEASE_MODIFY, "Press not processed");
+    decode_button_state(0x0000, &buttons);
+    process_buttons();
+    TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_MODIFY, "Release not processed");
+    TEST_ASSERT(p_numericalValues.FIO2.mode == DISPLAY_EDIT_WITH_VALUE, "Edit not processed");
+    // A live state machine keeps running without events, and its edit restores the display mode on the timeout
+    for (i = 0; i < EDIT_TIMEOUT; i++) {
+        process_buttons();
+    }
+    TEST_ASSERT(m_button_state[BUTTON_ID_SET_FIO_ALARM].state == BUTTON_STATE_IDLE, "Timeout not run");
+    TEST_ASSERT(p_numericalValues.FIO2.mode == DISPLAY_VALUE, "Display mode not restored");
+    // A full queue drops events, and the held buttons resync from the positions
+    for (i = 0; i < BUTTON_EVENT_QUEUE_SIZE; i++) {
+        decode_button_state(((i % 2) == 0) ? 0x0100 : 0x0000, &buttons);
+    }
+    decode_button_state(0x0180, &buttons);
+    process_buttons();
+    TEST_ASSERT(m_button_down == (BUTTON_MASK_SET_FIO_ALARM | BUTTON_MASK_ADJ_UP), "Held buttons not resynced");
+    TEST_ASSERT(!button_event_take(&event), "Queue not drained");
+    decode_button_state(0x0000, &buttons);
+    process_buttons();
+    TEST_ASSERT(m_button_down == 0, "Release after resync not applied");
+    init_button_state();
+    return 0;
+}
+
 int main(int argc, char** argv) {
     sound_init(&htim1);
     init_button_state();
@@ -1033,5 +1160,9 @@ int main(int argc, char** argv) {
     init_button_state();
     // Update state values
     TEST(test_updates);
+    TEST(test_detect_button_edges);
+    TEST(test_detect_button_read_faults);
+    TEST(test_decode_button_table);
+    TEST(test_button_events);
 }
 
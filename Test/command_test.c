@@ -0,0 +1,316 @@
+/**
+ * command_test.c:
+ *
+ * Test the debug UART command channel parses commands in place in the circular RX ring, runs one command a cycle,
+ * sets parameters through the parameter block, and answers trend page reads without waiting on the EEPROM.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/command.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/parameters.h>
+#include <ventilator/trend.h>
+#include <ventilator/trace.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/panel_public.h>
+
+uint8_t* rx_test_ring = NULL;
+uint16_t rx_test_remaining = COMMAND_RX_SIZE;
+bool tx_test_busy = false;
+const uint8_t* tx_test_data = NULL;
+uint16_t tx_test_size = 0;
+uint8_t sent[1 << 16];
+uint32_t sent_size = 0;
+int trace_test_capture = -1;
+
+uint32_t profiler_timestamp(void) {
+    return 0;
+}
+
+void trace_capture(bool capture) {
+    trace_test_capture = capture ? 1 : 0;
+}
+
+HAL_StatusTypeDef command_dma_start(uint8_t* data, uint16_t size) {
+    rx_test_ring = data;
+    rx_test_remaining = size;
+    return HAL_OK;
+}
+
+uint16_t command_dma_remaining(void) {
+    return rx_test_remaining;
+}
+
+HAL_StatusTypeDef telemetry_dma_start(const uint8_t* data, uint16_t size) {
+    tx_test_busy = true;
+    tx_test_data = data;
+    tx_test_size = size;
+    return HAL_OK;
+}
+
+void telemetry_dma_abort(void) {
+    tx_test_busy = false;
+}
+
+/**
+ * Receive a frame from the host, as the RX DMA would.
+ */
+void host_send(uint8_t type, const void* payload, uint8_t size) {
+    uint8_t frame[FRAME_PAYLOAD_MAX + FRAME_OVERHEAD];
+    uint32_t length = frame_encode(frame, type, payload, size);
+    uint32_t i = 0;
+    for (i = 0; i < length; i++) {
+        rx_test_ring[COMMAND_RX_SIZE - rx_test_remaining] = frame[i];
+        rx_test_remaining = (rx_test_remaining == 1) ? COMMAND_RX_SIZE : (rx_test_remaining - 1);
+    }
+}
+
+/**
+ * Run a cycle of the command channel, sending the replies.
+ * return: replies sent
+ */
+uint32_t run_cycle(void) {
+    FrameParser parser;
+    uint32_t i = 0;
+    uint32_t replies = 0;
+    sent_size = 0;
+    eeprom_cycle();
+    command_cycle();
+    while (tx_test_busy) {
+        tx_test_busy = false;
+        (void) memcpy(&sent[sent_size], tx_test_data, tx_test_size);
+        sent_size += tx_test_size;
+        telemetry_sent();
+    }
+    frame_parser_reset(&parser);
+    for (i = 0; i < sent_size; i++) {
+        replies += frame_parse(&parser, sent[i]) ? 1 : 0;
+    }
+    return replies;
+}
+
+/**
+ * Find the reply sent by the last cycle.
+ * uint8_t type: type of the reply
+ * void* payload: (output) payload of the reply
+ * uint8_t size: expected payload size
+ * return: true when found
+ */
+bool find_reply(uint8_t type, void* payload, uint8_t size) {
+    FrameParser parser;
+    uint32_t i = 0;
+    frame_parser_reset(&parser);
+    for (i = 0; i < sent_size; i++) {
+        if (frame_parse(&parser, sent[i]) && (parser.type == type) && (parser.length == size)) {
+            (void) memcpy(payload, parser.payload, size);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Read a page of the log to compare the replies against. Frames complete as queued, so the read is done on return.
+ */
+EepromStatus expected_status = EEPROM_BUSY;
+void expected_read(EepromStatus status, void* context) {
+    (void) context;
+    expected_status = status;
+}
+EepromStatus read_page(uint32_t age, uint8_t* data) {
+    expected_status = EEPROM_BUSY;
+    EepromStatus status = trend_queue_read_page(age, data, expected_read, NULL);
+    if (status != EEPROM_OK) {
+        return status;
+    }
+    return expected_status;
+}
+
+/**
+ * Send a parameter command, and read its reply. Without a reply, the status is not a CommandStatus.
+ */
+CommandParameter parameter_command(uint8_t type, uint8_t record, int32_t value) {
+    CommandParameter parameter = {0};
+    parameter.record = record;
+    parameter.value = value;
+    host_send(type, &parameter, sizeof(parameter));
+    (void) run_cycle();
+    (void) memset(&parameter, 0xA5, sizeof(parameter));
+    (void) find_reply(type | FRAME_TYPE_REPLY, &parameter, sizeof(parameter));
+    return parameter;
+}
+
+/**
+ * Erase the EEPROM and start the channel with the default parameters.
+ */
+void reset_command(void) {
+    uint32_t i = 0;
+    i2c_queue_init();
+    I2C_TEST_DEFER_COMPLETE = 0;
+    I2C_TEST_EEPROM_BUSY = 0;
+    (void) memset(I2C_TEST_EEPROM, 0xFF, sizeof(I2C_TEST_EEPROM));
+    (void) memset(&p_panel_packet, 0, sizeof(p_panel_packet));
+    for (i = 0; i < PARAMETER_COUNT; i++) {
+        *parameters_field(&p_panel_packet.parameters, i) = (int32_t)(i * 100);
+    }
+    tx_test_busy = false;
+    telemetry_init();
+    command_init();
+    trend_init();
+}
+
+int test_command_parameters() {
+    TEST_START("command channel reads and sets parameters through the parameter block");
+    int32_t values[PARAMETER_COUNT];
+    uint32_t i = 0;
+    reset_command();
+    TEST_ASSERT(PARAMETER_INDEX(EEPROM_INIT_PCTRL_KP) == 3, "Record index changed");
+    CommandParameter reply = parameter_command(FRAME_TYPE_GET_PARAMETER, EEPROM_INIT_PCTRL_KP, 0);
+    TEST_ASSERT(reply.status == COMMAND_OK && reply.value == 300, "Parameter not read");
+    reply = parameter_command(FRAME_TYPE_SET_PARAMETER, EEPROM_INIT_PCTRL_KP, 30591);
+    TEST_ASSERT(reply.status == COMMAND_OK && reply.value == 30591, "Parameter not set");
+    TEST_ASSERT(p_panel_packet.parameters.pctrl_kp == 30591, "Controller not given the parameter");
+    // A second set while the block is programmed is used at once, and staged for the next block
+    parameters_flush();
+    I2C_TEST_EEPROM_BUSY = 3;
+    reply = parameter_command(FRAME_TYPE_SET_PARAMETER, EEPROM_INIT_PCTRL_KI, -5);
+    TEST_ASSERT(reply.status == COMMAND_OK && p_panel_packet.parameters.pctrl_ki == -5,
+                "Set refused while the block is written");
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK && parameters_dirty(), "Staged set lost");
+    parameters_flush();
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK && !parameters_dirty(), "Block not written");
+    TEST_ASSERT(parameters_read(values) == EEPROM_OK, "Block not valid");
+    for (i = 0; i < PARAMETER_COUNT; i++) {
+        TEST_ASSERT(values[i] == *parameters_field(&p_panel_packet.parameters, i), "Block does not hold the parameters");
+    }
+    // Alive minutes are read only, and records past the block do not exist
+    p_aliveMinutes = 1234;
+    reply = parameter_command(FRAME_TYPE_GET_PARAMETER, EEPROM_ALIVE_MINUTES, 0);
+    TEST_ASSERT(reply.status == COMMAND_OK && reply.value == 1234, "Alive minutes not read");
+    reply = parameter_command(FRAME_TYPE_SET_PARAMETER, EEPROM_ALIVE_MINUTES, 0);
+    TEST_ASSERT(reply.status == COMMAND_INVALID, "Alive minutes set");
+    reply = parameter_command(FRAME_TYPE_GET_PARAMETER, EEPROM_NUM_RECORDS, 0);
+    TEST_ASSERT(reply.status == COMMAND_INVALID, "Missing record read");
+    return 0;
+}
+
+int test_command_rate_limit() {
+    TEST_START("command channel runs one command a cycle and resynchronizes");
+    CommandParameter parameter = {0};
+    uint8_t garbage[] = {FRAME_SYNC_FIRST, FRAME_SYNC_SECOND, FRAME_TYPE_GET_PARAMETER, sizeof(parameter), 1, 2, 3};
+    uint8_t type = 0;
+    uint32_t i = 0;
+    reset_command();
+    TEST_ASSERT(run_cycle() == 0, "Reply without a command");
+    parameter.record = EEPROM_INIT_PCTRL_KD;
+    host_send(FRAME_TYPE_GET_PARAMETER, &parameter, sizeof(parameter));
+    host_send(FRAME_TYPE_GET_STATS, NULL, 0);
+    host_send(FRAME_TYPE_GET_PARAMETER, &parameter, sizeof(parameter) - 1);
+    host_send(0x42, NULL, 0);
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_GET_PARAMETER | FRAME_TYPE_REPLY, &parameter, sizeof(parameter)),
+                "Parameter not answered alone");
+    TelemetryStatus status;
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_GET_STATS | FRAME_TYPE_REPLY, &status, sizeof(status)),
+                "Stats not answered alone");
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_REJECTED, &type, sizeof(type)) &&
+                type == FRAME_TYPE_GET_PARAMETER, "Short command not rejected");
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_REJECTED, &type, sizeof(type)) && type == 0x42,
+                "Unknown command not rejected");
+    TEST_ASSERT(run_cycle() == 0 && command_rejected() == 2, "Rejections not counted");
+    // A truncated frame is dropped by its CRC, one check a cycle, and the frames it ran into are still received
+    for (i = 0; i < sizeof(garbage); i++) {
+        rx_test_ring[COMMAND_RX_SIZE - rx_test_remaining] = garbage[i];
+        rx_test_remaining -= 1;
+    }
+    host_send(FRAME_TYPE_GET_PARAMETER, &parameter, sizeof(parameter));
+    host_send(FRAME_TYPE_GET_PARAMETER, &parameter, sizeof(parameter));
+    TEST_ASSERT(run_cycle() == 0 && command_rejected() == 3, "Truncated frame not dropped");
+    TEST_ASSERT(run_cycle() == 1 && run_cycle() == 1, "Frames after the truncated frame lost");
+    // A frame longer than the ring is dropped without waiting for it
+    garbage[3] = COMMAND_RX_SIZE;
+    for (i = 0; i < sizeof(garbage); i++) {
+        rx_test_ring[COMMAND_RX_SIZE - rx_test_remaining] = garbage[i];
+        rx_test_remaining = (rx_test_remaining == 1) ? COMMAND_RX_SIZE : (rx_test_remaining - 1);
+    }
+    host_send(FRAME_TYPE_GET_PARAMETER, &parameter, sizeof(parameter));
+    TEST_ASSERT(run_cycle() == 1 && command_rejected() == 4, "Oversized frame not dropped");
+    // Commands keep flowing as the DMA wraps around the ring many times
+    for (i = 0; i < 100; i++) {
+        parameter.record = EEPROM_INIT_INHALE_SENSITIVITY + (i % PARAMETER_COUNT);
+        host_send(FRAME_TYPE_GET_PARAMETER, &parameter, sizeof(parameter));
+        TEST_ASSERT(run_cycle() == 1, "Command lost at a wrap");
+        TEST_ASSERT(find_reply(FRAME_TYPE_GET_PARAMETER | FRAME_TYPE_REPLY, &parameter, sizeof(parameter)), "No reply");
+        TEST_ASSERT(parameter.value == (int32_t)((i % PARAMETER_COUNT) * 100), "Wrong parameter answered");
+    }
+    TEST_ASSERT(command_rejected() == 4, "Wrapped commands rejected");
+    // Trace capture is switched on and off, echoing the byte
+    uint8_t capture = 1;
+    host_send(FRAME_TYPE_SET_TRACE, &capture, sizeof(capture));
+    capture = 0;
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_SET_TRACE | FRAME_TYPE_REPLY, &capture, sizeof(capture)) &&
+                capture == 1 && trace_test_capture == 1, "Trace capture not started");
+    capture = 0;
+    host_send(FRAME_TYPE_SET_TRACE, &capture, sizeof(capture));
+    TEST_ASSERT(run_cycle() == 1 && trace_test_capture == 0, "Trace capture not stopped");
+    host_send(FRAME_TYPE_SET_TRACE, NULL, 0);
+    TEST_ASSERT(run_cycle() == 1 && command_rejected() == 5, "Empty trace command not rejected");
+    return 0;
+}
+
+int test_command_trend_page() {
+    TEST_START("command channel reads trend pages without waiting on the EEPROM");
+    NumericalValues values;
+    CommandTrendPage page;
+    uint8_t expected[EEPROM_PAGE_SIZE];
+    uint16_t age = 0;
+    uint32_t minute = 0;
+    reset_command();
+    (void) memset(&values, 0, sizeof(values));
+    // Fill a few pages of the log
+    while (trend_page_count() < 3) {
+        values.pressure.val = (int32_t)(minute * 37);
+        trend_sample(&values);
+        trend_minute(++minute);
+        trend_cycle();
+        (void) run_cycle();
+    }
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK, "Log not written");
+    // The current page is answered from RAM in the same cycle
+    age = (uint16_t)(trend_page_count() - 1);
+    host_send(FRAME_TYPE_GET_TREND_PAGE, &age, sizeof(age));
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_GET_TREND_PAGE | FRAME_TYPE_REPLY, &page, sizeof(page)),
+                "Current page not answered");
+    TEST_ASSERT(read_page(age, expected) == EEPROM_OK, "Page not read");
+    TEST_ASSERT(page.status == COMMAND_OK && page.age == age && page.count == 3, "Bad page reply");
+    TEST_ASSERT(memcmp(page.data, expected, EEPROM_PAGE_SIZE) == 0, "Current page differs");
+    // An older page waits on the bus, holding later commands in the ring
+    age = 0;
+    I2C_TEST_DEFER_COMPLETE = 1;
+    host_send(FRAME_TYPE_GET_TREND_PAGE, &age, sizeof(age));
+    host_send(FRAME_TYPE_GET_STATS, NULL, 0);
+    TEST_ASSERT(run_cycle() == 0, "Page answered before it was read");
+    TEST_ASSERT(run_cycle() == 0, "Command run during the page read");
+    i2c_queue_complete(HAL_OK); // Address
+    i2c_queue_complete(HAL_OK); // Data
+    I2C_TEST_DEFER_COMPLETE = 0;
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_GET_TREND_PAGE | FRAME_TYPE_REPLY, &page, sizeof(page)),
+                "Old page not answered");
+    TEST_ASSERT(read_page(age, expected) == EEPROM_OK, "Page not read");
+    TEST_ASSERT(page.status == COMMAND_OK && memcmp(page.data, expected, EEPROM_PAGE_SIZE) == 0, "Old page differs");
+    TelemetryStatus status;
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_GET_STATS | FRAME_TYPE_REPLY, &status, sizeof(status)),
+                "Held command not run");
+    // Pages past the log are refused
+    age = 3;
+    host_send(FRAME_TYPE_GET_TREND_PAGE, &age, sizeof(age));
+    TEST_ASSERT(run_cycle() == 1 && find_reply(FRAME_TYPE_GET_TREND_PAGE | FRAME_TYPE_REPLY, &page, sizeof(page)) &&
+                page.status == COMMAND_INVALID, "Missing page not refused");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_command_parameters);
+    TEST(test_command_rate_limit);
+    TEST(test_command_trend_page);
+}
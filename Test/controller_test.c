@@ -1,7 +1,20 @@
 #include <stdint.h>
 #include <string.h>
 #include <test.h>
+#include <ventilator/alarm.h>
 #include <ventilator/controller.h>
+#include <ventilator/profiler.h>
+
+extern int CONTROLLER_TXRX_TEST_STATUS;
+extern controller_packet_t CONTROLLER_TXRX_TEST_PACKET;
+extern const AlarmDescriptor ALARM_TABLE[ALARM_COUNT];
+uint32_t fake_timestamp = 0;
+
+uint32_t profiler_timestamp(void) {
+    // Each exchange is bracketed by two timestamps, so an exchange takes 50us
+    fake_timestamp += 50 * PROFILE_TICKS_PER_US;
+    return fake_timestamp;
+}
 
 
 int test_pascal_to_cmh2O() {
@@ -18,6 +31,25 @@ int test_pascal_to_cmh2O() {
     return 0;
 }
 
+int test_pascal_to_cmh2O_exhaustive() {
+    TEST_START("reciprocal pascal_to_cmh2O matches division");
+    int64_t i = 0;
+    // Every value of the sensor range
+    for (i = -(1 << 24); i <= (1 << 24); i++) {
+        TEST_ASSERT(pascal_to_cmh2O((int32_t)i) == ((int32_t)i) / 98, "Conversion differs from division");
+    }
+    // The reciprocal only ever rounds the magnitude up, and by an error that grows with it. Within each run of 98
+    // magnitudes sharing a quotient the last has the largest error and is closest to the next quotient, so checking it
+    // across the whole int32_t range covers every input.
+    for (i = 97; i <= INT32_MAX; i += 98) {
+        TEST_ASSERT(pascal_to_cmh2O((int32_t)i) == ((int32_t)i) / 98, "Conversion differs from division");
+        TEST_ASSERT(pascal_to_cmh2O((int32_t)-i) == ((int32_t)-i) / 98, "Negative conversion differs from division");
+    }
+    TEST_ASSERT(pascal_to_cmh2O(INT32_MAX) == INT32_MAX / 98, "Largest input wrong");
+    TEST_ASSERT(pascal_to_cmh2O(INT32_MIN) == INT32_MIN / 98, "Smallest input wrong");
+    return 0;
+}
+
 int test_cmh2O_to_pascal() {
     // These conversions need to be accurate from 0 to 100 cmH20, as it is the
     // valid range of the display.  We'll step by 1cmH20 of a Pascal
@@ -52,6 +84,30 @@ int test_bpm_to_ms_period() {
     return 0;
 }
 
+/**
+ * Original float conversion, the reference for the integer conversion.
+ */
+int32_t bpm_to_ms_period_float(int32_t bpm) {
+    float bpmf = bpm;
+    bpmf = (60.0f * 1000.0f)/bpmf;
+    return (int32_t)(bpmf + 0.5f);
+}
+
+int test_bpm_to_ms_period_exhaustive() {
+    TEST_START("integer bpm_to_ms_period matches float version");
+    // Whole uint16_t period range, and negative results of subtracting the breath period adjustment, and beyond the point
+    // where the result rounds to zero
+    for (int32_t i = -200000; i <= 200000; i++) {
+        if (i != 0) {
+            TEST_ASSERT(bpm_to_ms_period(i) == bpm_to_ms_period_float(i), "Integer conversion differs from float");
+        }
+    }
+    TEST_ASSERT(bpm_to_ms_period(0) == INT32_MAX, "Zero does not saturate");
+    TEST_ASSERT(bpm_to_ms_period(INT32_MAX) == 0, "Largest input wrong");
+    TEST_ASSERT(bpm_to_ms_period(INT32_MIN) == 0, "Smallest input wrong");
+    return 0;
+}
+
 int test_panel_packet_helper(PowerState power, AlarmStatus machine_fault, uint8_t plateau_count, int sw_assert, int halt) {
     NumericalValues values;
     memset(&values, 0, sizeof(values));
@@ -166,13 +222,53 @@ int test_process_control_packet() {
         }
         TEST_ASSERT(expt_byte == test_byte, "Byte-per-byte check failed");
     }
+    // Controller errors reach the alarm masks without waiting for alarm_detect
+    uint16_t fault_bit = (uint16_t)(1 << ALARM_TABLE[ALARM_INDEX(machine_fault)].shift);
+    TEST_ASSERT((alarm_masks()->visible & fault_bit) == 0, "Machine fault visible without an error");
+    packet.error_field = 1;
+    process_control_packet(&packet, &tested);
+    TEST_ASSERT(tested.alarms.machine_fault.status == ALARM_SET, "Machine fault not set");
+    TEST_ASSERT((alarm_masks()->visible & fault_bit) != 0, "Machine fault missing from the masks");
+    packet.error_field = 0;
+    process_control_packet(&packet, &tested);
+    TEST_ASSERT((alarm_masks()->visible & fault_bit) == 0, "Machine fault still in the masks");
+    return 0;
+}
+
+int test_do_controller_cycle() {
+    TEST_START("controller exchange processes only good packets");
+    memset(&p_numericalValues, 0, sizeof(p_numericalValues));
+    memset(&p_uartDebug, 0, sizeof(p_uartDebug));
+    memset(&CONTROLLER_TXRX_TEST_PACKET, 0, sizeof(CONTROLLER_TXRX_TEST_PACKET));
+    CONTROLLER_TXRX_TEST_PACKET.sensors.tidal_volume = 500;
+    CONTROLLER_TXRX_TEST_STATUS = HAL_OK;
+    TEST_ASSERT(do_controller_cycle() == HAL_OK, "Exchange failed");
+    TEST_ASSERT(p_numericalValues.tidal_volume.val == 500, "Packet not processed");
+    TEST_ASSERT(controller_last_packet()->sensors.tidal_volume == 500, "Packet not received");
+    CONTROLLER_TXRX_TEST_PACKET.sensors.tidal_volume = 600;
+    TEST_ASSERT(do_controller_cycle() == HAL_OK, "Exchange failed");
+    TEST_ASSERT(controller_last_packet()->sensors.tidal_volume == 600, "Newer packet not received");
+    // Failures leave the values alone
+    CONTROLLER_TXRX_TEST_STATUS = HAL_ERROR;
+    TEST_ASSERT(do_controller_cycle() == HAL_ERROR, "Failure not returned");
+    CONTROLLER_TXRX_TEST_STATUS = HAL_TIMEOUT;
+    TEST_ASSERT(do_controller_cycle() == HAL_TIMEOUT, "Timeout not returned");
+    TEST_ASSERT(do_controller_cycle() == HAL_TIMEOUT, "Timeout not returned");
+    TEST_ASSERT(p_numericalValues.tidal_volume.val == 600, "Failed packet processed");
+    TEST_ASSERT(p_uartDebug.fswStats.controlSpiErrors == 1, "Error not counted");
+    TEST_ASSERT(p_uartDebug.fswStats.controlSpiTimeouts == 2, "Timeouts not counted");
+    TEST_ASSERT(p_uartDebug.fswStats.controlMaxLatency == 50, "Latency not recorded");
+    CONTROLLER_TXRX_TEST_STATUS = HAL_OK;
     return 0;
 }
 
 int main(int argc, char** argv) {
     TEST(test_pascal_to_cmh2O);
+    TEST(test_pascal_to_cmh2O_exhaustive);
     TEST(test_cmh2O_to_pascal);
     TEST(test_bpm_to_ms_period);
+    TEST(test_bpm_to_ms_period_exhaustive);
     TEST(test_prepare_panel_packet);
     TEST(test_process_control_packet);
+    TEST(test_do_controller_cycle);
 }
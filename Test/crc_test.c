@@ -0,0 +1,51 @@
+/**
+ * crc_test.c:
+ *
+ * Test the CRC-16/CCITT-FALSE table against the standard check value and a bitwise calculation.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <ventilator/crc.h>
+
+/**
+ * Bitwise CRC for comparison against the table.
+ */
+uint16_t crc16_bitwise(const uint8_t* data, uint32_t size) {
+    uint16_t crc = CRC16_INITIAL;
+    uint32_t i = 0, bit = 0;
+    for (i = 0; i < size; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+int test_crc16_check_value() {
+    TEST_START("CRC-16 check value");
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT(crc16(check, sizeof(check)) == 0x29B1, "Check value wrong");
+    TEST_ASSERT(crc16(check, 0) == CRC16_INITIAL, "Empty CRC wrong");
+    // Built in pieces
+    TEST_ASSERT(crc16_update(crc16(check, 4), &check[4], sizeof(check) - 4) == 0x29B1, "Continued CRC wrong");
+    return 0;
+}
+
+int test_crc16_bitwise() {
+    TEST_START("CRC-16 table matches bitwise calculation");
+    uint8_t data[300];
+    uint32_t i = 0;
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)((i * 37) + (i >> 3));
+    }
+    for (i = 0; i <= sizeof(data); i++) {
+        TEST_ASSERT(crc16(data, i) == crc16_bitwise(data, i), "Table CRC differs from bitwise CRC");
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_crc16_check_value);
+    TEST(test_crc16_bitwise);
+}
@@ -0,0 +1,154 @@
+/**
+ * display_test.c:
+ *
+ * Test that the display only writes the devices whose content changed.
+ */
+#include "test.h"
+#include <string.h>
+#include <stdint.h>
+#include <ventilator/display.h>
+#include <ventilator/constants.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/alarm.h>
+
+AlarmMasks masks_test;
+
+const AlarmMasks* alarm_masks(void) {
+    return &masks_test;
+}
+
+/**
+ * Send the display and check the number of SPI and I2C writes it caused.
+ */
+int send_and_count(int spi, int i2c) {
+    SPI_TRANSMIT_TEST_COUNT = 0;
+    I2C_WRITE_TEST_COUNT = 0;
+    if (display_raw_send() != HAL_OK) {
+        return 0;
+    }
+    return (SPI_TRANSMIT_TEST_COUNT == spi) && (I2C_WRITE_TEST_COUNT == i2c);
+}
+
+int test_display_unchanged() {
+    int i = 0;
+    TEST_START("display skips unchanged writes");
+    display_init();
+    TEST_ASSERT(send_and_count(1, 3), "First send did not write all devices");
+    for (i = 1; i < DISPLAY_REFRESH_CYCLES; i++) {
+        TEST_ASSERT(send_and_count(0, 0), "Unchanged display was written");
+    }
+    return 0;
+}
+
+int test_display_per_device() {
+    TEST_START("display writes only changed devices");
+    display_init();
+    TEST_ASSERT(send_and_count(1, 3), "First send did not write all devices");
+    m_display.FIO2 = 0x1234;
+    TEST_ASSERT(send_and_count(1, 0), "Shift-register change not written alone");
+    TEST_ASSERT(send_and_count(0, 0), "Committed shift-register change rewritten");
+    m_display.red_green_red.middle = 0x0010;
+    TEST_ASSERT(send_and_count(0, 1), "Middle expander change not written alone");
+    m_display.red_green_red.lower = 0x0001;
+    m_display.red_green_red.upper = 0x8000;
+    TEST_ASSERT(send_and_count(0, 2), "Lower and upper expander changes not written");
+    m_display.tidal.upper = 0x0100;
+    m_display.red_green_red.upper = 0x0000;
+    TEST_ASSERT(send_and_count(1, 1), "Mixed change not written");
+    TEST_ASSERT(send_and_count(0, 0), "Committed changes rewritten");
+    return 0;
+}
+
+int test_display_forced_refresh() {
+    int i = 0, j = 0;
+    TEST_START("display forced refresh");
+    display_init();
+    for (j = 0; j < 3; j++) {
+        TEST_ASSERT(send_and_count(1, 3), "Refresh did not write all devices");
+        for (i = 1; i < DISPLAY_REFRESH_CYCLES; i++) {
+            TEST_ASSERT(send_and_count(0, 0), "Unchanged display was written");
+        }
+    }
+    return 0;
+}
+
+int test_display_blank() {
+    TEST_START("display rewrites shift registers after blank");
+    display_init();
+    TEST_ASSERT(send_and_count(1, 3), "First send did not write all devices");
+    display_blank();
+    TEST_ASSERT(send_and_count(1, 0), "Blank not released by a shift-register write");
+    TEST_ASSERT(send_and_count(0, 0), "Unchanged display was written");
+    return 0;
+}
+
+int test_display_failed_write() {
+    TEST_START("display reports and rewrites failed expander writes");
+    display_init();
+    TEST_ASSERT(send_and_count(1, 3), "First send did not write all devices");
+    m_display.red_green_red.middle = 0x0010;
+    I2C_TEST_DEFER_COMPLETE = 1;
+    TEST_ASSERT(display_raw_send() == HAL_OK, "Queued write reported as failed");
+    i2c_queue_complete(HAL_OK);    // Register address
+    i2c_queue_complete(HAL_ERROR); // Data not acknowledged
+    I2C_TEST_DEFER_COMPLETE = 0;
+    I2C_WRITE_TEST_COUNT = 0;
+    TEST_ASSERT(display_raw_send() == HAL_ERROR, "Failed write not reported");
+    TEST_ASSERT(I2C_WRITE_TEST_COUNT == 1, "Failed write not rewritten");
+    TEST_ASSERT(send_and_count(0, 0), "Rewritten device written again");
+    return 0;
+}
+
+int test_display_queue_full() {
+    TEST_START("display defers expander writes while the I2C queue is full");
+    uint8_t data[2] = {0, 0};
+    I2cTransaction transaction = {0};
+    int i = 0;
+    display_init();
+    TEST_ASSERT(send_and_count(1, 3), "First send did not write all devices");
+    // Fill the high priority queue behind a transaction that has not completed
+    I2C_TEST_DEFER_COMPLETE = 1;
+    transaction.addr = 0x24 << 1;
+    transaction.mem_addr_size = 1;
+    transaction.op = I2C_OP_MEM_READ;
+    transaction.data = data;
+    transaction.size = sizeof(data);
+    for (i = 0; i <= I2C_QUEUE_DEPTH; i++) {
+        (void) i2c_queue_submit(I2C_PRIORITY_HIGH, &transaction);
+    }
+    TEST_ASSERT(i2c_queue_submit(I2C_PRIORITY_HIGH, &transaction) == HAL_BUSY, "Queue not full");
+    m_display.red_green_red.upper = 0x0100;
+    TEST_ASSERT(send_and_count(0, 0), "Write on a full queue failed the send");
+    // Drained queue takes the deferred write on the next send
+    i2c_queue_init();
+    I2C_TEST_DEFER_COMPLETE = 0;
+    TEST_ASSERT(send_and_count(0, 1), "Deferred write not retried");
+    TEST_ASSERT(send_and_count(0, 0), "Retried device written again");
+    return 0;
+}
+
+int test_display_alarm_masks() {
+    NumericalValues values;
+    TEST_START("display alarm LEDs are the visible alarm mask");
+    display_init();
+    (void) memset(&values, 0, sizeof(values));
+    (void) memset(&masks_test, 0, sizeof(masks_test));
+    masks_test.visible = (1 << DISPLAY_ALARM_DISCONNECT_SHIFT) | (1 << DISPLAY_ALARM_LOW_POWER_SHIFT);
+    masks_test.blinking = 1 << DISPLAY_ALARM_PEEP_PRES_SHIFT; // In the off phase of the blink
+    display_send_update(&values);
+    TEST_ASSERT(display_image()->alarm == masks_test.visible, "Alarm LEDs not the visible mask");
+    masks_test.visible = 0;
+    display_send_update(&values);
+    TEST_ASSERT(display_image()->alarm == 0, "Alarm LEDs left on");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_display_unchanged);
+    TEST(test_display_per_device);
+    TEST(test_display_forced_refresh);
+    TEST(test_display_blank);
+    TEST(test_display_failed_write);
+    TEST(test_display_queue_full);
+    TEST(test_display_alarm_masks);
+}
@@ -0,0 +1,137 @@
+/**
+ * eeprom_test.c:
+ *
+ * Test the EEPROM write queue runs writes in order, polls across cycles for the end of the write cycle, and reports
+ * failures.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/eeprom.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/constants.h>
+
+int completed_count = 0;
+uintptr_t completed_context[EEPROM_WRITE_QUEUE_DEPTH + 1];
+EepromStatus completed_status[EEPROM_WRITE_QUEUE_DEPTH + 1];
+
+void record_completion(EepromStatus status, void* context) {
+    completed_context[completed_count] = (uintptr_t)context;
+    completed_status[completed_count] = status;
+    completed_count++;
+}
+
+/**
+ * Erase the EEPROM and flush anything left queued by an earlier test.
+ */
+void reset_eeprom(void) {
+    I2C_TEST_DEFER_COMPLETE = 0;
+    I2C_TEST_EEPROM_BUSY = 0;
+    (void) eeprom_flush();
+    i2c_queue_init();
+    completed_count = 0;
+    (void) memset(I2C_TEST_EEPROM, 0xFF, sizeof(I2C_TEST_EEPROM));
+    (void) memset(I2C_TEST_EEPROM_PAGE_WRITES, 0, sizeof(I2C_TEST_EEPROM_PAGE_WRITES));
+}
+
+/**
+ * Queue a 4 byte write with the context used to identify its completion.
+ */
+EepromStatus write(uint16_t address, uint32_t value, uintptr_t context) {
+    return eeprom_write_bytes(address, (uint8_t*)&value, sizeof(value), record_completion, (void*)context);
+}
+
+int test_eeprom_write_polled() {
+    uint32_t value = 0;
+    TEST_START("EEPROM write completes on the poll of a later cycle");
+    reset_eeprom();
+    TEST_ASSERT(write(0x40, 0x12345678, 1) == EEPROM_OK, "Write not queued");
+    TEST_ASSERT(memcmp(&I2C_TEST_EEPROM[0x40], &(uint32_t){0x12345678}, sizeof(uint32_t)) == 0, "Data not sent");
+    TEST_ASSERT(completed_count == 0 && !eeprom_idle(), "Completed before the write cycle");
+    // Device is still programming on the first two polls
+    I2C_TEST_EEPROM_BUSY = 2;
+    eeprom_cycle();
+    eeprom_cycle();
+    TEST_ASSERT(completed_count == 0, "Completed while the device was programming");
+    eeprom_cycle();
+    TEST_ASSERT(completed_count == 1 && completed_status[0] == EEPROM_OK, "Write not completed on acknowledge");
+    TEST_ASSERT(eeprom_idle() && eeprom_last_status() == EEPROM_OK, "Status not reported");
+    TEST_ASSERT(i2c_queue_errors(I2C_DEVICE_EEPROM) == 0, "Polls counted as bus errors");
+    TEST_ASSERT(readEeprom(1, &value) == EEPROM_OK && value == 0x12345678, "Value not read back");
+    return 0;
+}
+
+int test_eeprom_write_order() {
+    int i = 0;
+    TEST_START("EEPROM writes run one at a time in order");
+    reset_eeprom();
+    for (i = 0; i < EEPROM_WRITE_QUEUE_DEPTH; i++) {
+        TEST_ASSERT(write(i * EEPROM_PAGE_SIZE, i, i) == EEPROM_OK, "Write not queued");
+    }
+    TEST_ASSERT(write(0, 0, i) == EEPROM_BUSY, "Full queue accepted write");
+    TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[0] == 1 && I2C_TEST_EEPROM_PAGE_WRITES[1] == 0, "Write started during a write cycle");
+    for (i = 0; i < EEPROM_WRITE_QUEUE_DEPTH; i++) {
+        eeprom_cycle();
+        TEST_ASSERT(completed_count == (i + 1) && completed_context[i] == (uintptr_t)i, "Writes completed out of order");
+    }
+    TEST_ASSERT(eeprom_idle(), "Queue not drained");
+    return 0;
+}
+
+int test_eeprom_write_timeout() {
+    int i = 0;
+    TEST_START("EEPROM write fails when never acknowledged");
+    reset_eeprom();
+    uint32_t failures = eeprom_failures();
+    TEST_ASSERT(write(0, 1, 1) == EEPROM_OK, "Write not queued");
+    I2C_TEST_EEPROM_BUSY = EEPROM_WRITE_TIMEOUT_CYCLES;
+    for (i = 0; i < EEPROM_WRITE_TIMEOUT_CYCLES - 1; i++) {
+        eeprom_cycle();
+    }
+    TEST_ASSERT(completed_count == 0, "Timed out early");
+    eeprom_cycle();
+    TEST_ASSERT(completed_count == 1 && completed_status[0] == EEPROM_ERROR, "Timeout not reported");
+    TEST_ASSERT(eeprom_failures() == (failures + 1) && eeprom_last_status() == EEPROM_ERROR, "Failure not counted");
+    return 0;
+}
+
+int test_eeprom_write_dropped() {
+    TEST_START("EEPROM write fails when dropped by an I2C queue reset");
+    reset_eeprom();
+    I2C_TEST_DEFER_COMPLETE = 1;
+    TEST_ASSERT(write(0, 1, 1) == EEPROM_OK, "Write not queued");
+    TEST_ASSERT(write(EEPROM_PAGE_SIZE, 2, 2) == EEPROM_OK, "Write not queued");
+    i2c_queue_reset();
+    I2C_TEST_DEFER_COMPLETE = 0;
+    // The running write fails, and the queued write it starts is dropped in turn
+    TEST_ASSERT(completed_count == 2 && completed_status[0] == EEPROM_ERROR && completed_status[1] == EEPROM_ERROR,
+                "Dropped writes not failed");
+    TEST_ASSERT(i2c_queue_idle() && eeprom_idle(), "Writes left after reset");
+    // Next write runs
+    TEST_ASSERT(write(0, 3, 3) == EEPROM_OK, "Write not queued");
+    eeprom_cycle();
+    TEST_ASSERT(completed_count == 3 && completed_status[2] == EEPROM_OK, "Next write did not run");
+    return 0;
+}
+
+int test_eeprom_flush() {
+    TEST_START("EEPROM flush waits out queued writes");
+    reset_eeprom();
+    TEST_ASSERT(writeEeprom(EEPROM_INIT_PCTRL_KP, 30591) == EEPROM_OK, "Write not queued");
+    TEST_ASSERT(writeEeprom(EEPROM_INIT_PCTRL_KI, 84127) == EEPROM_OK, "Write not queued");
+    I2C_TEST_EEPROM_BUSY = 3;
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK && eeprom_idle(), "Writes not flushed");
+    // Never acknowledged
+    TEST_ASSERT(writeEeprom(EEPROM_INIT_PCTRL_KD, 1835) == EEPROM_OK, "Write not queued");
+    I2C_TEST_EEPROM_BUSY = EEPROM_WRITE_TIMEOUT_CYCLES;
+    TEST_ASSERT(eeprom_flush() == EEPROM_ERROR, "Failed write not reported by flush");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_eeprom_write_polled);
+    TEST(test_eeprom_write_order);
+    TEST(test_eeprom_write_timeout);
+    TEST(test_eeprom_write_dropped);
+    TEST(test_eeprom_flush);
+}
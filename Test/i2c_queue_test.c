@@ -0,0 +1,180 @@
+/**
+ * i2c_queue_test.c:
+ *
+ * Test the I2C transaction queue ordering, callbacks, and error accounting.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/panel_public.h>
+
+int completed_count = 0;
+uintptr_t completed_context[I2C_PRIORITY_COUNT * I2C_QUEUE_DEPTH + 1];
+HAL_StatusTypeDef completed_status[I2C_PRIORITY_COUNT * I2C_QUEUE_DEPTH + 1];
+
+void record_completion(HAL_StatusTypeDef status, void* context) {
+    completed_context[completed_count] = (uintptr_t)context;
+    completed_status[completed_count] = status;
+    completed_count++;
+}
+
+/**
+ * Setup the queue and fakes for a test.
+ */
+void reset_queue(int defer) {
+    i2c_queue_init();
+    completed_count = 0;
+    I2C_TEST_DEFER_COMPLETE = defer;
+    I2C_READ_TEST_COUNT = 0;
+    I2C_WRITE_TEST_COUNT = 0;
+    p_uartDebug.fswStats.switchI2CErrors = 0;
+}
+
+/**
+ * Submit a transaction to the given 7bit address, with the context used to identify its completion.
+ */
+HAL_StatusTypeDef submit(I2cPriority priority, uint8_t addr, uint8_t op, uint8_t* data, uint16_t size, uintptr_t context) {
+    I2cTransaction transaction = {0};
+    transaction.addr = addr << 1;
+    transaction.mem_addr = 0x10;
+    transaction.mem_addr_size = 1;
+    transaction.op = op;
+    transaction.size = size;
+    transaction.data = data;
+    transaction.callback = record_completion;
+    transaction.context = (void*)context;
+    return i2c_queue_submit(priority, &transaction);
+}
+
+/**
+ * Complete both frames of the running transaction.
+ */
+void complete_transaction(void) {
+    i2c_queue_complete(HAL_OK);
+    i2c_queue_complete(HAL_OK);
+}
+
+int test_i2c_queue_transfers() {
+    uint8_t read[2] = {0, 0};
+    uint8_t write[2] = {0xAB, 0xCD};
+    TEST_START("I2C queue reads and writes");
+    reset_queue(0);
+    I2C_READ_TEST_REGS[0x10] = 0x12;
+    I2C_READ_TEST_REGS[0x11] = 0x34;
+    TEST_ASSERT(submit(I2C_PRIORITY_HIGH, 0x24, I2C_OP_MEM_READ, read, 2, 1) == HAL_OK, "Read not queued");
+    TEST_ASSERT(completed_count == 1 && completed_status[0] == HAL_OK && completed_context[0] == 1, "Read not completed");
+    TEST_ASSERT(read[0] == 0x12 && read[1] == 0x34, "Read data wrong");
+    TEST_ASSERT(submit(I2C_PRIORITY_LOW, 0x50, I2C_OP_MEM_WRITE, write, 2, 2) == HAL_OK, "Write not queued");
+    TEST_ASSERT(completed_count == 2 && completed_status[1] == HAL_OK && completed_context[1] == 2, "Write not completed");
+    TEST_ASSERT(I2C_READ_TEST_COUNT == 1 && I2C_WRITE_TEST_COUNT == 1, "Wrong data frames sent");
+    TEST_ASSERT(i2c_queue_idle(), "Queue not idle");
+    return 0;
+}
+
+int test_i2c_queue_priority() {
+    uint8_t data[4] = {0, 0, 0, 0};
+    TEST_START("I2C queue runs high priority first");
+    reset_queue(1);
+    TEST_ASSERT(submit(I2C_PRIORITY_LOW, 0x50, I2C_OP_MEM_WRITE, data, 4, 1) == HAL_OK, "Write not queued");
+    TEST_ASSERT(submit(I2C_PRIORITY_HIGH, 0x20, I2C_OP_MEM_WRITE, data, 2, 2) == HAL_OK, "Write not queued");
+    TEST_ASSERT(submit(I2C_PRIORITY_LOW, 0x50, I2C_OP_MEM_WRITE, data, 4, 3) == HAL_OK, "Write not queued");
+    TEST_ASSERT(submit(I2C_PRIORITY_HIGH, 0x24, I2C_OP_MEM_READ, data, 4, 4) == HAL_OK, "Read not queued");
+    TEST_ASSERT(completed_count == 0, "Completed without interrupt");
+    // Running low priority transaction is not preempted
+    while (!i2c_queue_idle()) {
+        complete_transaction();
+    }
+    TEST_ASSERT(completed_count == 4, "Not all transactions completed");
+    TEST_ASSERT(completed_context[0] == 1 && completed_context[1] == 2 && completed_context[2] == 4 && completed_context[3] == 3,
+                "Transactions completed out of order");
+    return 0;
+}
+
+int test_i2c_queue_full() {
+    int i = 0;
+    uint8_t data[2] = {0, 0};
+    TEST_START("I2C queue refuses transactions when full");
+    reset_queue(1);
+    for (i = 0; i < I2C_QUEUE_DEPTH; i++) {
+        TEST_ASSERT(submit(I2C_PRIORITY_LOW, 0x50, I2C_OP_MEM_WRITE, data, 2, i) == HAL_OK, "Write not queued");
+    }
+    TEST_ASSERT(submit(I2C_PRIORITY_LOW, 0x50, I2C_OP_MEM_WRITE, data, 2, i) == HAL_BUSY, "Full queue accepted write");
+    TEST_ASSERT(submit(I2C_PRIORITY_HIGH, 0x20, I2C_OP_MEM_WRITE, data, 2, i) == HAL_OK, "High priority write refused");
+    complete_transaction();
+    TEST_ASSERT(submit(I2C_PRIORITY_LOW, 0x50, I2C_OP_MEM_WRITE, data, 2, i) == HAL_OK, "Write refused after completion");
+    return 0;
+}
+
+int test_i2c_queue_errors() {
+    uint8_t data[2] = {0, 0};
+    TEST_START("I2C queue counts errors per device");
+    reset_queue(1);
+    submit(I2C_PRIORITY_HIGH, 0x24, I2C_OP_MEM_READ, data, 2, 1);
+    submit(I2C_PRIORITY_LOW, 0x50, I2C_OP_MEM_WRITE, data, 2, 2);
+    submit(I2C_PRIORITY_HIGH, 0x21, I2C_OP_MEM_WRITE, data, 2, 3);
+    i2c_queue_complete(HAL_ERROR); // Buttons address not acknowledged
+    i2c_queue_complete(HAL_OK);    // Display middle address
+    i2c_queue_complete(HAL_ERROR); // Display middle data not acknowledged
+    i2c_queue_complete(HAL_ERROR); // EEPROM address not acknowledged
+    TEST_ASSERT(completed_count == 3, "Failed transactions not completed");
+    TEST_ASSERT(completed_status[0] == HAL_ERROR && completed_status[1] == HAL_ERROR && completed_status[2] == HAL_ERROR,
+                "Failure not reported");
+    TEST_ASSERT(i2c_queue_errors(I2C_DEVICE_BUTTONS) == 1, "Button error not counted");
+    TEST_ASSERT(i2c_queue_errors(I2C_DEVICE_DISPLAY_MIDDLE) == 1, "Display error not counted");
+    TEST_ASSERT(i2c_queue_errors(I2C_DEVICE_EEPROM) == 1, "EEPROM error not counted");
+    TEST_ASSERT(i2c_queue_errors(I2C_DEVICE_DISPLAY_LOWER) == 0, "Idle device error counted");
+    TEST_ASSERT(p_uartDebug.fswStats.switchI2CErrors == 2, "Expander errors not counted in telemetry");
+    return 0;
+}
+
+int test_i2c_queue_timeout() {
+    int i = 0;
+    uint8_t data[2] = {0, 0};
+    TEST_START("I2C queue recovers a stalled transaction");
+    reset_queue(1);
+    submit(I2C_PRIORITY_HIGH, 0x22, I2C_OP_MEM_WRITE, data, 2, 1);
+    submit(I2C_PRIORITY_HIGH, 0x20, I2C_OP_MEM_WRITE, data, 2, 2);
+    for (i = 0; i < I2C_QUEUE_TIMEOUT_CYCLES - 1; i++) {
+        i2c_queue_cycle();
+    }
+    TEST_ASSERT(completed_count == 0, "Timed out early");
+    i2c_queue_cycle();
+    TEST_ASSERT(completed_count == 1 && completed_status[0] == HAL_TIMEOUT, "Stalled transaction not failed");
+    TEST_ASSERT(i2c_queue_errors(I2C_DEVICE_DISPLAY_UPPER) == 1, "Timeout not counted");
+    complete_transaction();
+    TEST_ASSERT(completed_count == 2 && completed_status[1] == HAL_OK, "Next transaction did not run");
+    // A late completion of a reset frame is ignored
+    i2c_queue_complete(HAL_OK);
+    TEST_ASSERT(completed_count == 2 && i2c_queue_idle(), "Late completion not ignored");
+    return 0;
+}
+
+int test_i2c_queue_reset() {
+    uint8_t data[2] = {0, 0};
+    TEST_START("I2C queue reset fails dropped transactions");
+    reset_queue(1);
+    submit(I2C_PRIORITY_LOW, 0x50, I2C_OP_MEM_WRITE, data, 2, 1);
+    submit(I2C_PRIORITY_HIGH, 0x20, I2C_OP_MEM_WRITE, data, 2, 2);
+    submit(I2C_PRIORITY_HIGH, 0x24, I2C_OP_MEM_READ, data, 2, 3);
+    i2c_queue_reset();
+    TEST_ASSERT(completed_count == 3, "Dropped transactions not called back");
+    TEST_ASSERT(completed_status[0] == HAL_TIMEOUT && completed_status[1] == HAL_TIMEOUT && completed_status[2] == HAL_TIMEOUT,
+                "Dropped transactions not failed");
+    TEST_ASSERT(completed_context[0] == 1 && completed_context[1] == 2 && completed_context[2] == 3,
+                "Dropped transactions called back out of order");
+    TEST_ASSERT(i2c_queue_idle(), "Queue not empty after reset");
+    // A late completion of the abandoned frame is ignored
+    i2c_queue_complete(HAL_OK);
+    TEST_ASSERT(completed_count == 3, "Late completion not ignored");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_i2c_queue_transfers);
+    TEST(test_i2c_queue_priority);
+    TEST(test_i2c_queue_full);
+    TEST(test_i2c_queue_errors);
+    TEST(test_i2c_queue_timeout);
+    TEST(test_i2c_queue_reset);
+}
@@ -0,0 +1,114 @@
+/**
+ * numerical_bench.c:
+ *
+ * Host benchmark of the numerical display formatting. Formats every display of a cycle with the previous divide based
+ * formatting, counting its divide and modulo operations (each a call into the software divide on the Cortex-M0), and
+ * with the current multiply-shift formatting. Checks both produce identical output and reports the divides removed.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <time.h>
+#include <ventilator/numerical.h>
+
+extern uint16_t L_DIGIT_TO_SEGMENT[DIGIT_COUNT];
+extern uint16_t R_DIGIT_TO_SEGMENT[DIGIT_COUNT];
+extern uint32_t L_3DIGIT_TO_SEGMENT[DIGIT_COUNT];
+extern uint32_t C_3DIGIT_TO_SEGMENT[DIGIT_COUNT];
+extern uint32_t R_3DIGIT_TO_SEGMENT[DIGIT_COUNT];
+
+enum {
+    BENCH_TWO_DIGIT_DISPLAYS = 7,   // Two digit displays in Display
+    BENCH_THREE_DIGIT_DISPLAYS = 1, // Three digit displays in Display
+    BENCH_CYCLES = 1000000
+};
+
+uint32_t divide_count = 0;
+
+uint32_t counted_divide(uint32_t value, uint32_t divisor) {
+    divide_count++;
+    return value / divisor;
+}
+
+uint32_t counted_modulo(uint32_t value, uint32_t divisor) {
+    divide_count++;
+    return value % divisor;
+}
+
+/**
+ * Previous two digit formatting.
+ */
+TwoDigit legacy_two_digit(uint32_t value) {
+    return L_DIGIT_TO_SEGMENT[counted_divide(value, 10)] | R_DIGIT_TO_SEGMENT[counted_modulo(value, 10)];
+}
+
+/**
+ * Previous three digit formatting, including the divides in its index assertions.
+ */
+uint32_t legacy_three_digit(uint32_t value) {
+    SW_ASSERT(counted_divide(value, 100) < DIGIT_COUNT);
+    SW_ASSERT(counted_divide(counted_modulo(value, 100), 10) < DIGIT_COUNT);
+    SW_ASSERT(counted_modulo(value, 10) < DIGIT_COUNT);
+    return L_3DIGIT_TO_SEGMENT[counted_divide(value, 100)] | C_3DIGIT_TO_SEGMENT[counted_divide(counted_modulo(value, 100), 10)] |
+           R_3DIGIT_TO_SEGMENT[counted_modulo(value, 10)];
+}
+
+int main(int argc, char** argv) {
+    uint32_t i = 0, j = 0;
+    uint32_t checksum = 0;
+    TwoDigit two_digit = 0;
+    ThreeDigit three_digit = {0, 0};
+    // Bit-identical output over the full display ranges
+    for (i = 0; i <= 999; i++) {
+        numerical_set_three_digit(&three_digit, i);
+        if (((((uint32_t)three_digit.high) << 16) | three_digit.low) != legacy_three_digit(i)) {
+            fprintf(stderr, "FAILED: three digit output differs at %u\n", i);
+            return 1;
+        }
+        if (i <= 99) {
+            numerical_set_two_digit(&two_digit, i);
+            if (two_digit != legacy_two_digit(i)) {
+                fprintf(stderr, "FAILED: two digit output differs at %u\n", i);
+                return 1;
+            }
+        }
+    }
+    // Divides per cycle, every display is formatted once a cycle
+    divide_count = 0;
+    for (j = 0; j < BENCH_TWO_DIGIT_DISPLAYS; j++) {
+        checksum += legacy_two_digit(j * 13);
+    }
+    for (j = 0; j < BENCH_THREE_DIGIT_DISPLAYS; j++) {
+        checksum += legacy_three_digit(j * 137 + 500);
+    }
+    uint32_t divides_per_cycle = divide_count;
+    // Host timing of the two paths, only indicative of the target
+    clock_t start = clock();
+    for (i = 0; i < BENCH_CYCLES; i++) {
+        for (j = 0; j < BENCH_TWO_DIGIT_DISPLAYS; j++) {
+            checksum += legacy_two_digit((i + j) % 100);
+        }
+        for (j = 0; j < BENCH_THREE_DIGIT_DISPLAYS; j++) {
+            checksum += legacy_three_digit((i + j) % 1000);
+        }
+    }
+    clock_t legacy = clock() - start;
+    start = clock();
+    for (i = 0; i < BENCH_CYCLES; i++) {
+        for (j = 0; j < BENCH_TWO_DIGIT_DISPLAYS; j++) {
+            numerical_set_two_digit(&two_digit, (i + j) % 100);
+            checksum += two_digit;
+        }
+        for (j = 0; j < BENCH_THREE_DIGIT_DISPLAYS; j++) {
+            numerical_set_three_digit(&three_digit, (i + j) % 1000);
+            checksum += three_digit.low;
+        }
+    }
+    clock_t current = clock() - start;
+    printf("Numerical formatting, %d two digit and %d three digit displays per cycle:\n", BENCH_TWO_DIGIT_DISPLAYS,
+           BENCH_THREE_DIGIT_DISPLAYS);
+    printf("  Software divides per cycle: %u before, 0 after (%u per second at %d cycles per second)\n", divides_per_cycle,
+           divides_per_cycle * 50, 50);
+    printf("  Host time for %d cycles: %ld us before, %ld us after (checksum %u)\n", BENCH_CYCLES,
+           (long)(legacy * 1000000 / CLOCKS_PER_SEC), (long)(current * 1000000 / CLOCKS_PER_SEC), checksum);
+    return 0;
+}
@@ -10,6 +10,9 @@
 
 extern uint16_t L_DIGIT_TO_SEGMENT[DIGIT_COUNT];
 extern uint16_t R_DIGIT_TO_SEGMENT[DIGIT_COUNT];
+extern uint32_t L_3DIGIT_TO_SEGMENT[DIGIT_COUNT];
+extern uint32_t C_3DIGIT_TO_SEGMENT[DIGIT_COUNT];
+extern uint32_t R_3DIGIT_TO_SEGMENT[DIGIT_COUNT];
 
 int test_numerical_set_two_digit() {
     TEST_START("numeral to 2-digit display");
@@ -42,8 +45,41 @@ int test_numerical_set_three_digit() {
     return 0;
 }
 
+int test_numerical_divide() {
+    TEST_START("multiply-shift divides");
+    uint32_t i = 0;
+    for (i = 0; i <= 1028; i++) {
+        TEST_ASSERT(numerical_divide_by_10(i) == i / 10, "Divide by 10 failed");
+    }
+    for (i = 0; i <= 1098; i++) {
+        TEST_ASSERT(numerical_divide_by_100(i) == i / 100, "Divide by 100 failed");
+    }
+    return 0;
+}
+
+int test_numerical_three_digit_tables() {
+    TEST_START("numeral to 3-digit display matches digit tables");
+    int i = 0;
+    ThreeDigit testable;
+    numerical_set_three_digit(&testable, BLANK_CONSTANT);
+    TEST_ASSERT((testable.high == 0) && (testable.low == 0), "Blank not blank");
+    for (i = -2; i <= 1000; i++) {
+        if (i == (int)BLANK_CONSTANT) {
+            continue;
+        }
+        int clamped = (i < 0) ? 0 : ((i > 999) ? 999 : i);
+        numerical_set_three_digit(&testable, i);
+        uint32_t full_value = (((uint32_t)testable.high) << 16) | ((uint32_t)testable.low);
+        uint32_t expected = L_3DIGIT_TO_SEGMENT[clamped / 100] | C_3DIGIT_TO_SEGMENT[(clamped % 100) / 10] |
+                            R_3DIGIT_TO_SEGMENT[clamped % 10];
+        TEST_ASSERT(full_value == expected, "Unexpected 3-digit result");
+    }
+    return 0;
+}
 
 int main(int argc, char** argv) {
     TEST(test_numerical_set_two_digit);
 //    TEST(test_numerical_set_three_digit);
+    TEST(test_numerical_divide);
+    TEST(test_numerical_three_digit_tables);
 }
@@ -0,0 +1,246 @@
+/**
+ * parameters_test.c:
+ *
+ * Test the parameter block loads in a single read, and falls back per-field when not valid. Test writes are staged in
+ * RAM and coalesced into one block write.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/parameters.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/panel_public.h>
+
+extern bool m_parameter_staged;
+extern bool m_parameter_writing;
+extern bool m_parameter_dirty;
+extern uint32_t m_parameter_dirty_cycles;
+uint32_t parameters_crc(const ParameterBlock* block);
+
+int32_t TEST_DEFAULTS[PARAMETER_COUNT] = {-490, 1, 2, 30591, 84127, 1835, 3183, 1000, -59, 59, 0, 0, 0};
+
+/**
+ * Erase the EEPROM.
+ */
+void reset_eeprom(void) {
+    i2c_queue_init();
+    m_parameter_staged = false;
+    m_parameter_writing = false;
+    m_parameter_dirty = false;
+    m_parameter_dirty_cycles = 0;
+    I2C_TEST_DEFER_COMPLETE = 0;
+    I2C_TEST_EEPROM_BUSY = 0;
+    (void) memset(I2C_TEST_EEPROM, 0xFF, sizeof(I2C_TEST_EEPROM));
+    (void) memset(I2C_TEST_EEPROM_PAGE_WRITES, 0, sizeof(I2C_TEST_EEPROM_PAGE_WRITES));
+}
+
+/**
+ * Set a legacy per-record value.
+ */
+void set_legacy(EepromRecordId record, int32_t value) {
+    (void) memcpy(&I2C_TEST_EEPROM[record * EEPROM_PAGE_SIZE], &value, sizeof(value));
+}
+
+int test_parameters_single_read() {
+    TEST_START("parameter block loads with one read");
+    int32_t values[PARAMETER_COUNT];
+    int32_t written[PARAMETER_COUNT];
+    uint32_t i = 0;
+    reset_eeprom();
+    for (i = 0; i < PARAMETER_COUNT; i++) {
+        written[i] = (int32_t)(i * 1000) - 5;
+    }
+    parameters_write(written);
+    parameters_flush();
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK, "Block not written");
+    TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[EEPROM_PARAMETER_PAGE] == 1, "Block not written to its page");
+    I2C_READ_TEST_COUNT = 0;
+    TEST_ASSERT(parameters_load(values, TEST_DEFAULTS, true), "Valid block not loaded");
+    TEST_ASSERT(I2C_READ_TEST_COUNT == 1, "Block not loaded with a single read");
+    TEST_ASSERT(memcmp(values, written, sizeof(values)) == 0, "Loaded values differ");
+    return 0;
+}
+
+int test_parameters_corrupt() {
+    TEST_START("parameter block rejected on CRC mismatch");
+    int32_t values[PARAMETER_COUNT];
+    reset_eeprom();
+    TEST_ASSERT(parameters_read(values) == EEPROM_ERROR, "Erased block accepted");
+    parameters_write(TEST_DEFAULTS);
+    parameters_flush();
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK, "Block not written");
+    TEST_ASSERT(parameters_read(values) == EEPROM_OK, "Written block rejected");
+    // Single bit flipped in a value
+    I2C_TEST_EEPROM[(EEPROM_PARAMETER_PAGE * EEPROM_PAGE_SIZE) + 9] ^= 0x10;
+    TEST_ASSERT(parameters_read(values) == EEPROM_ERROR, "Corrupt block accepted");
+    return 0;
+}
+
+int test_parameters_fallback() {
+    TEST_START("parameter load falls back per-field and rewrites the block");
+    int32_t values[PARAMETER_COUNT];
+    uint32_t i = 0;
+    reset_eeprom();
+    // Some fields have legacy records, the rest are erased
+    set_legacy(EEPROM_INIT_PCTRL_KP, 12345);
+    set_legacy(EEPROM_INIT_PCTRL_INT_L_LIMIT, -70);
+    TEST_ASSERT(!parameters_load(values, TEST_DEFAULTS, true), "Erased block reported valid");
+    for (i = 0; i < PARAMETER_COUNT; i++) {
+        int32_t expected = TEST_DEFAULTS[i];
+        expected = (i == PARAMETER_INDEX(EEPROM_INIT_PCTRL_KP)) ? 12345 : expected;
+        expected = (i == PARAMETER_INDEX(EEPROM_INIT_PCTRL_INT_L_LIMIT)) ? -70 : expected;
+        TEST_ASSERT(values[i] == expected, "Field did not fall back as expected");
+    }
+    // Migrated into the block
+    (void) memset(values, 0, sizeof(values));
+    TEST_ASSERT(parameters_load(values, TEST_DEFAULTS, true), "Rewritten block not valid");
+    TEST_ASSERT(values[PARAMETER_INDEX(EEPROM_INIT_PCTRL_KP)] == 12345, "Migrated value lost");
+    // Not loading rewrites the defaults
+    TEST_ASSERT(!parameters_load(values, TEST_DEFAULTS, false), "Block used when not loading");
+    TEST_ASSERT(memcmp(values, TEST_DEFAULTS, sizeof(values)) == 0, "Defaults not used");
+    TEST_ASSERT(parameters_load(values, TEST_DEFAULTS, true), "Rewritten block not valid");
+    TEST_ASSERT(memcmp(values, TEST_DEFAULTS, sizeof(values)) == 0, "Defaults not written");
+    return 0;
+}
+
+int test_parameters_write_retry() {
+    TEST_START("failed parameter block write is counted and retried");
+    int32_t values[PARAMETER_COUNT];
+    reset_eeprom();
+    p_uartDebug.fswStats.parameterWriteFailures = 0;
+    // Device does not acknowledge the write
+    I2C_TEST_EEPROM_BUSY = 1;
+    parameters_write(TEST_DEFAULTS);
+    parameters_flush();
+    TEST_ASSERT(eeprom_flush() == EEPROM_ERROR, "Write did not fail");
+    TEST_ASSERT(p_uartDebug.fswStats.parameterWriteFailures == 1, "Failure not counted");
+    TEST_ASSERT(parameters_dirty(), "Failed block not kept dirty");
+    TEST_ASSERT(parameters_read(values) == EEPROM_ERROR, "Failed block written");
+    // Next cycle writes it
+    parameters_cycle();
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK, "Block not written");
+    TEST_ASSERT(!parameters_dirty(), "Written block still dirty");
+    TEST_ASSERT(parameters_read(values) == EEPROM_OK, "Retried block not valid");
+    TEST_ASSERT(memcmp(values, TEST_DEFAULTS, sizeof(values)) == 0, "Retried block differs");
+    TEST_ASSERT(p_uartDebug.fswStats.parameterWriteFailures == 1, "Success counted as a failure");
+    // Clean block is not rewritten
+    parameters_cycle();
+    TEST_ASSERT(eeprom_idle(), "Clean block rewritten");
+    return 0;
+}
+
+/**
+ * Run cycles of the parameter write back and the EEPROM writes.
+ */
+void run_cycles(uint32_t cycles) {
+    uint32_t i = 0;
+    for (i = 0; i < cycles; i++) {
+        eeprom_cycle();
+        parameters_cycle();
+    }
+}
+
+int test_parameters_write_back() {
+    TEST_START("parameter writes are staged and coalesced into one block write");
+    int32_t values[PARAMETER_COUNT];
+    int32_t tuned[PARAMETER_COUNT];
+    uint32_t i = 0;
+    reset_eeprom();
+    (void) memcpy(tuned, TEST_DEFAULTS, sizeof(tuned));
+    // Changes held for the write back period, each cycle changing the gain
+    for (i = 0; i < PARAMETER_WRITE_BACK_CYCLES; i++) {
+        tuned[PARAMETER_INDEX(EEPROM_INIT_PCTRL_KP)] = (int32_t)i;
+        parameters_write(tuned);
+        run_cycles(1);
+    }
+    TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[EEPROM_PARAMETER_PAGE] == 0 && parameters_dirty(), "Block written early");
+    run_cycles(1);
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK && !parameters_dirty(), "Block not written back");
+    TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[EEPROM_PARAMETER_PAGE] == 1, "Changes not coalesced");
+    TEST_ASSERT(parameters_read(values) == EEPROM_OK && memcmp(values, tuned, sizeof(values)) == 0,
+                "Last values not written");
+    // Unchanged values are not written again
+    parameters_write(tuned);
+    TEST_ASSERT(!parameters_dirty(), "Unchanged values dirtied the block");
+    // Changes while a block is in flight go to the next block
+    I2C_TEST_DEFER_COMPLETE = 1;
+    tuned[PARAMETER_INDEX(EEPROM_INIT_PCTRL_KI)] = 77;
+    parameters_write(tuned);
+    parameters_flush();
+    tuned[PARAMETER_INDEX(EEPROM_INIT_PCTRL_KI)] = 78;
+    parameters_write(tuned);
+    i2c_queue_complete(HAL_OK); // Address
+    i2c_queue_complete(HAL_OK); // Data
+    I2C_TEST_DEFER_COMPLETE = 0;
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK && parameters_dirty(), "Change during the write lost");
+    // Powering off writes it back at once
+    parameters_flush();
+    TEST_ASSERT(eeprom_flush() == EEPROM_OK && !parameters_dirty(), "Block not flushed");
+    TEST_ASSERT(parameters_read(values) == EEPROM_OK && values[PARAMETER_INDEX(EEPROM_INIT_PCTRL_KI)] == 78,
+                "Flushed block differs");
+    return 0;
+}
+
+/**
+ * Write a block straight to the EEPROM, as before the staging copy.
+ */
+void write_block_direct(const int32_t* values) {
+    static ParameterBlock block;
+    block.version = PARAMETER_BLOCK_VERSION;
+    (void) memcpy(block.values, values, sizeof(block.values));
+    block.crc = parameters_crc(&block);
+    (void) eeprom_write_bytes(EEPROM_PARAMETER_PAGE * EEPROM_PAGE_SIZE, (uint8_t*)&block, sizeof(block), NULL, NULL);
+}
+
+/**
+ * Simulate a day of cycles: every minute the host refreshes the parameters unchanged, and once an hour the
+ * proportional gain is tuned over five seconds, changing every cycle.
+ * return: I2C writes to the EEPROM, including write cycle polls
+ */
+uint32_t simulate_day(bool staged) {
+    int32_t values[PARAMETER_COUNT];
+    uint32_t cycle = 0;
+    reset_eeprom();
+    (void) memcpy(values, TEST_DEFAULTS, sizeof(values));
+    I2C_WRITE_TEST_COUNT = 0;
+    for (cycle = 0; cycle < (CYCLES_PER_SECOND * 60 * 60 * 24); cycle++) {
+        uint32_t hour_cycle = cycle % (CYCLES_PER_SECOND * 60 * 60);
+        bool tune = (hour_cycle < (CYCLES_PER_SECOND * 5));
+        if (tune) {
+            values[PARAMETER_INDEX(EEPROM_INIT_PCTRL_KP)] = (int32_t)hour_cycle;
+        }
+        if (tune || ((cycle % (CYCLES_PER_SECOND * 60)) == 0)) {
+            if (staged) {
+                parameters_write(values);
+            } else {
+                write_block_direct(values);
+            }
+        }
+        run_cycles(1);
+    }
+    parameters_flush();
+    (void) eeprom_flush();
+    return (uint32_t)I2C_WRITE_TEST_COUNT;
+}
+
+int test_parameters_day() {
+    TEST_START("staged parameter writes cut EEPROM traffic over a simulated day");
+    int32_t values[PARAMETER_COUNT];
+    uint32_t direct = simulate_day(false);
+    uint32_t staged = simulate_day(true);
+    TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[EEPROM_PARAMETER_PAGE] == 24, "Not one block write per tuning");
+    TEST_ASSERT(parameters_read(values) == EEPROM_OK &&
+                values[PARAMETER_INDEX(EEPROM_INIT_PCTRL_KP)] == ((CYCLES_PER_SECOND * 5) - 1),
+                "Tuned gain not written");
+    TEST_ASSERT((staged * 50) < direct, "EEPROM traffic not cut");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_parameters_single_read);
+    TEST(test_parameters_corrupt);
+    TEST(test_parameters_fallback);
+    TEST(test_parameters_write_retry);
+    TEST(test_parameters_write_back);
+    TEST(test_parameters_day);
+}
@@ -0,0 +1,89 @@
+/**
+ * profiler_test.c:
+ *
+ * Test the cycle-time profiler statistics against a faked timestamp.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <ventilator/profiler.h>
+#include <ventilator/panel_public.h>
+
+uint32_t fake_timestamp = 0;
+
+uint32_t profiler_timestamp(void) {
+    return fake_timestamp;
+}
+
+int test_profiler_histogram_bin() {
+    uint32_t i = 0;
+    TEST_START("profiler histogram bins");
+    TEST_ASSERT(profiler_histogram_bin(0) == 0, "Zero not in first bin");
+    TEST_ASSERT(profiler_histogram_bin((1 << (PROFILE_HISTOGRAM_BASE_SHIFT + 1)) - 1) == 0, "Bin 0 upper edge wrong");
+    for (i = 1; i < PROFILE_HISTOGRAM_BINS - 1; i++) {
+        uint32_t low = 1 << (PROFILE_HISTOGRAM_BASE_SHIFT + i);
+        TEST_ASSERT(profiler_histogram_bin(low) == i, "Bin lower edge wrong");
+        TEST_ASSERT(profiler_histogram_bin((low << 1) - 1) == i, "Bin upper edge wrong");
+    }
+    TEST_ASSERT(profiler_histogram_bin(UINT32_MAX) == PROFILE_HISTOGRAM_BINS - 1, "Large sample not in last bin");
+    return 0;
+}
+
+int test_profiler_stats() {
+    uint32_t i = 0;
+    TEST_START("profiler min/max/mean");
+    profiler_reset();
+    TEST_ASSERT(profiler_mean(PROFILE_STAGE_DISPLAY) == 0, "Mean of empty stage not zero");
+    for (i = 1; i <= 100; i++) {
+        profiler_start(PROFILE_STAGE_DISPLAY);
+        fake_timestamp += i * 100;
+        TEST_ASSERT(profiler_stop(PROFILE_STAGE_DISPLAY) == i * 100, "Elapsed time wrong");
+    }
+    const ProfileStats* stats = profiler_get_stats(PROFILE_STAGE_DISPLAY);
+    TEST_ASSERT(stats->count == 100, "Count wrong");
+    TEST_ASSERT(stats->min == 100, "Min wrong");
+    TEST_ASSERT(stats->max == 10000, "Max wrong");
+    TEST_ASSERT(stats->last == 10000, "Last wrong");
+    TEST_ASSERT(profiler_mean(PROFILE_STAGE_DISPLAY) == 5050, "Mean wrong");
+    uint32_t total = 0;
+    for (i = 0; i < PROFILE_HISTOGRAM_BINS; i++) {
+        total += stats->histogram[i];
+    }
+    TEST_ASSERT(total == 100, "Histogram does not account for all samples");
+    TEST_ASSERT(profiler_get_stats(PROFILE_STAGE_SOUND)->count == 0, "Other stage recorded samples");
+    return 0;
+}
+
+int test_profiler_wrap() {
+    TEST_START("profiler timestamp wrap");
+    profiler_reset();
+    fake_timestamp = UINT32_MAX - 10;
+    profiler_start(PROFILE_STAGE_ALARM);
+    fake_timestamp += 100;
+    TEST_ASSERT(profiler_stop(PROFILE_STAGE_ALARM) == 100, "Elapsed time wrong across wrap");
+    return 0;
+}
+
+int test_profiler_max_cycle() {
+    TEST_START("profiler maxCycle");
+    profiler_reset();
+    profiler_start(PROFILE_STAGE_CYCLE);
+    fake_timestamp += 480 * PROFILE_TICKS_PER_US;
+    profiler_stop(PROFILE_STAGE_CYCLE);
+    TEST_ASSERT(p_uartDebug.fswStats.maxCycle == 480, "maxCycle not in microseconds");
+    profiler_start(PROFILE_STAGE_CYCLE);
+    fake_timestamp += 100 * PROFILE_TICKS_PER_US;
+    profiler_stop(PROFILE_STAGE_CYCLE);
+    TEST_ASSERT(p_uartDebug.fswStats.maxCycle == 480, "maxCycle lowered by shorter cycle");
+    profiler_start(PROFILE_STAGE_CYCLE);
+    fake_timestamp += 15000 * PROFILE_TICKS_PER_US;
+    profiler_stop(PROFILE_STAGE_CYCLE);
+    TEST_ASSERT(p_uartDebug.fswStats.maxCycle == 15000, "maxCycle not raised");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_profiler_histogram_bin);
+    TEST(test_profiler_stats);
+    TEST(test_profiler_wrap);
+    TEST(test_profiler_max_cycle);
+}
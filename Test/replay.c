@@ -0,0 +1,129 @@
+/**
+ * replay.c:
+ *
+ * Replay of trace records. The packet of the last record carrying one stands in for the records without, and is
+ * dropped on a gap until the next keyframe. The power state each cycle starts in is the one recorded by the cycle
+ * before, as the powering on count of cycle is not replayed.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <replay.h>
+#include <ventilator/controller.h>
+#include <ventilator/button.h>
+#include <ventilator/display.h>
+#include <ventilator/alarm.h>
+#include <ventilator/sound.h>
+#include <ventilator/initialize.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/frame.h>
+#include <ventilator/panel_public.h>
+
+static controller_packet_t m_replay_packet;
+static bool m_replay_packet_valid = false;
+static uint32_t m_replay_cycle = 0;           // Cycle of the last record
+static PowerState m_replay_power_state = POWER_OFF_STATE;
+
+void replay_init(ReplayStats* stats) {
+    bool verbose = stats->verbose;
+    (void) memset(stats, 0, sizeof(ReplayStats));
+    stats->verbose = verbose;
+    i2c_queue_init();
+    p_doCycle = 0;
+    p_doPlateau = 0;
+    p_powerState = POWER_OFF_STATE;
+    p_haltVentilation = 0;
+    p_aliveMinutes = 0;
+    initialize_numeric_values(&p_numericalValues);
+    (void) memset(&p_panel_packet, 0, sizeof(panel_packet_t));
+    sound_init(&htim1);
+    display_init();
+    display_blank();
+    init_button_state();
+    (void) memset(&m_replay_packet, 0, sizeof(m_replay_packet));
+    m_replay_packet_valid = false;
+    m_replay_cycle = 0;
+    m_replay_power_state = POWER_OFF_STATE;
+}
+
+/**
+ * Count a difference between the replay and the record.
+ */
+static void replay_diff(ReplayStats* stats, uint32_t cycle, const char* what) {
+    if (stats->first_diff_cycle == 0) {
+        stats->first_diff_cycle = cycle;
+    }
+    if (stats->verbose) {
+        printf("cycle %u: %s differs\n", cycle, what);
+    }
+}
+
+bool replay_record(const uint8_t* payload, uint8_t length, ReplayStats* stats) {
+    TraceRecord record;
+    PanelButtons buttons;
+    uint32_t i = 0;
+    const Alarm* alarms = (const Alarm*)&p_numericalValues.alarms;
+    bool matched = true;
+    if ((length != TRACE_RECORD_SHORT_SIZE) && (length != sizeof(TraceRecord))) {
+        stats->malformed += 1;
+        return false;
+    }
+    (void) memset(&record, 0, sizeof(record));
+    (void) memcpy(&record, payload, length);
+    if (stats->records == 0) {
+        stats->from_boot = (record.cycle == 1);
+    } else if (record.cycle != (m_replay_cycle + 1)) {
+        stats->gaps += 1;
+        m_replay_packet_valid = false;
+    }
+    stats->records += 1;
+    m_replay_cycle = record.cycle;
+    if (((record.flags & TRACE_FLAG_PACKET) != 0) && (length == sizeof(TraceRecord))) {
+        m_replay_packet = record.packet;
+        m_replay_packet_valid = true;
+    } else if (!m_replay_packet_valid) {
+        stats->unsynced += 1;
+    }
+    // The cycle, as run by cycle from the controller exchange to the display
+    p_powerState = m_replay_power_state;
+    replay_set_low_battery((record.flags & TRACE_FLAG_LOW_BATTERY) != 0);
+    if (((record.flags & TRACE_FLAG_CONTROLLER_OK) != 0) && m_replay_packet_valid) {
+        process_control_packet(&m_replay_packet, &p_numericalValues);
+    }
+    p_aliveMinutes = record.alive_hours * 60;
+    if ((record.flags & TRACE_FLAG_ATTACHED) != 0) {
+        (void) sound_cycle();
+        if ((record.flags & TRACE_FLAG_BUTTONS) != 0) {
+            decode_button_state(record.buttons, &buttons);
+            process_buttons();
+        }
+        alarm_run(&p_numericalValues, p_powerState);
+    }
+    run_display((record.flags & TRACE_FLAG_ATTACHED) == 0, record.alive_hours);
+    m_replay_power_state = (PowerState)record.power_state;
+    // Compare the outputs of the cycle
+    if (trace_display_crc() != record.display_crc) {
+        stats->display_diffs += 1;
+        replay_diff(stats, record.cycle, "display");
+        matched = false;
+    }
+    for (i = 0; i < TRACE_ALARM_COUNT; i++) {
+        if (alarms[i].status != record.alarms[i]) {
+            stats->alarm_diffs += 1;
+            replay_diff(stats, record.cycle, "alarms");
+            matched = false;
+            break;
+        }
+    }
+    return matched;
+}
+
+void replay_stream(const uint8_t* data, uint32_t size, ReplayStats* stats) {
+    FrameParser parser;
+    uint32_t i = 0;
+    frame_parser_reset(&parser);
+    for (i = 0; i < size; i++) {
+        if (frame_parse(&parser, data[i]) && (parser.type == FRAME_TYPE_TRACE)) {
+            (void) replay_record(parser.payload, parser.length, stats);
+        }
+    }
+}
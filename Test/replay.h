@@ -0,0 +1,69 @@
+/**
+ * replay.h:
+ *
+ * Host replay of a trace captured from the debug UART, see trace.h. Each record is fed through the panel's own
+ * process_control_packet, process_buttons, alarm_run, and run_display in the order cycle runs them, and the display
+ * checksum and alarm statuses it produces are compared with the record. The modules start from their static
+ * initializers, so a replay runs once per process.
+ */
+#ifndef VENTILATOR_PANEL_REPLAY_H_
+#define VENTILATOR_PANEL_REPLAY_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <ventilator/trace.h>
+
+/**
+ * ReplayStats:
+ *
+ * Outcome of a replay.
+ */
+typedef struct {
+    uint32_t records;          // Records replayed
+    uint32_t malformed;        // Trace frames of an unexpected length
+    uint32_t gaps;             // Breaks in the cycle count, from frames dropped or lost
+    uint32_t unsynced;         // Records replayed without their packet, after a gap until the next keyframe
+    uint32_t display_diffs;    // Records where the replayed display differs
+    uint32_t alarm_diffs;      // Records where the replayed alarms differ
+    uint32_t first_diff_cycle; // Cycle of the first difference, zero without one
+    bool from_boot;            // Trace starts at the first cycle, so the replay starts from the same state
+    bool verbose;              // Print each difference
+} ReplayStats;
+
+/**
+ * replay_init:
+ *
+ * Initialize the replayed modules as panel_init does.
+ * ReplayStats* stats: (output) cleared, keeping verbose
+ */
+void replay_init(ReplayStats* stats);
+
+/**
+ * replay_record:
+ *
+ * Replay the cycle of a trace record.
+ * const uint8_t* payload: payload of a FRAME_TYPE_TRACE frame
+ * uint8_t length: payload length
+ * ReplayStats* stats: (in/out) counts of the replay
+ * return: true when the replay matched the record
+ */
+bool replay_record(const uint8_t* payload, uint8_t length, ReplayStats* stats);
+
+/**
+ * replay_stream:
+ *
+ * Replay the trace frames of a raw UART capture, skipping the other frames.
+ * const uint8_t* data: bytes received from the debug UART
+ * uint32_t size: number of bytes
+ * ReplayStats* stats: (in/out) counts of the replay
+ */
+void replay_stream(const uint8_t* data, uint32_t size, ReplayStats* stats);
+
+/**
+ * replay_set_low_battery:
+ *
+ * Drive the low battery input read by alarm_run. Provided by the harness linking the replay.
+ * bool low: input asserted
+ */
+void replay_set_low_battery(bool low);
+
+#endif
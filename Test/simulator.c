@@ -0,0 +1,612 @@
+/*
+ * simulator.c:
+ *
+ * Behavioural model of the board behind the faked HAL, and the boots of the panel. Interrupts are raised from the
+ * sleep of the idle wait, which is the only place the firmware waits for them: DMA completions of the last cycle,
+ * input changes and the expander interrupt, the incoming watchdog, and the fail-safe clock. I2C frames complete as
+ * they are started, as the interrupt driven transfers of the HAL would before the next cycle.
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <test.h>
+#include <simulator.h>
+#include <ventilator/constants.h>
+#include <ventilator/panel.h>
+#include <ventilator/cycle.h>
+#include <ventilator/button.h>
+#include <ventilator/display.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/command.h>
+#include <ventilator/i2c_queue.h>
+#include <ventilator/profiler.h>
+#include <ventilator/trace.h>
+#include <replay.h>
+uint8_t SW_ASSERT_FLAG = 0;
+
+#define EXTERN
+#include <ventilator/panel_public.h>
+#undef EXTERN
+
+volatile FailSafeClockState p_doFail = FAIL_SAFE_CLOCK_UNINITIALIZED;
+
+unsigned int HAL_TICK_TEST_VALUE = 0;
+int SPI_TRANSMIT_TEST_COUNT = 0;
+unsigned int TIM_TEST_COUNTER = 0;
+
+SPI_HandleTypeDef hspi1;
+SPI_HandleTypeDef hspi2;
+I2C_HandleTypeDef hi2c1;
+TIM_HandleTypeDef htim1;
+TIM_HandleTypeDef htim2;
+TIM_HandleTypeDef htim6;
+UART_HandleTypeDef huart1;
+
+/**
+ * Simulator state outliving the boots, in memory shared with the boot processes.
+ */
+typedef struct {
+    uint8_t eeprom[SIM_EEPROM_SIZE];
+    uint32_t page_writes[SIM_EEPROM_PAGES];
+    uint32_t page_wraps;
+    SimResult result;
+    uint32_t uart_size;
+    uint8_t uart[SIM_UART_SIZE];
+} SimWorld;
+
+/**
+ * MCP23017 expander, a register file in IOCON.BANK = 0 order with the address pointer incremented on each byte.
+ */
+typedef struct {
+    uint8_t addr;                  // 7 bit address
+    uint8_t regs[REG_OLATB + 1];
+    uint8_t pointer;
+    uint16_t inputs;               // Levels of the pins, port B in the high byte
+} SimMcp;
+
+/**
+ * 24-series EEPROM, two byte addresses and a write cycle started by the stop of each page write.
+ */
+typedef struct {
+    uint16_t pointer;
+    uint32_t busy_until;           // Tick the write cycle ends
+} SimEeprom;
+
+enum {
+    SIM_MCP_BUTTONS = 3,           // Index of the button expander, after the three display expanders
+    SIM_MCP_COUNT = 4,
+    SIM_MCP_IOCON_MIRROR = 0x40,
+    SIM_MCP_IOCON_INTPOL = 0x02,
+    SIM_EEPROM_ADDR = 0x50,
+    SIM_PROFILE_TICKS_PER_MS = PROFILE_TICKS_PER_US * 1000
+};
+
+static SimWorld* m_sim_world = NULL;
+static SimMcp m_sim_mcp[SIM_MCP_COUNT];
+static SimEeprom m_sim_eeprom;
+static const SimEvent* m_sim_events = NULL;
+static uint32_t m_sim_event_count = 0;
+static uint32_t m_sim_event_next = 0;
+static SimEvent m_sim_inputs;
+static uint32_t m_sim_run_ms = 0;
+static uint32_t m_sim_cycles = 0;
+static bool m_sim_fail_safe = false;      // TIM6 started
+static int m_sim_spi_sent = 0;            // SPI transfers already completed
+static bool m_sim_telemetry_sending = false;
+static bool m_sim_sounding = false;
+static bool m_sim_trace = false;          // Capture a trace from boot
+
+/**
+ * Map the shared state on first use.
+ */
+static SimWorld* sim_world(void) {
+    if (m_sim_world == NULL) {
+        void* world = mmap(NULL, sizeof(SimWorld), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (world == MAP_FAILED) {
+            perror("mmap");
+            return NULL;
+        }
+        m_sim_world = (SimWorld*)world;
+        (void) memset(m_sim_world->eeprom, 0xFF, sizeof(m_sim_world->eeprom));
+    }
+    return m_sim_world;
+}
+
+void sim_reset(void) {
+    SimWorld* world = sim_world();
+    (void) memset(world, 0, sizeof(SimWorld));
+    (void) memset(world->eeprom, 0xFF, sizeof(world->eeprom));
+}
+
+const uint8_t* sim_eeprom(void) {
+    return sim_world()->eeprom;
+}
+
+uint32_t sim_eeprom_page_writes(uint32_t page) {
+    return (page < SIM_EEPROM_PAGES) ? sim_world()->page_writes[page] : 0;
+}
+
+uint32_t sim_eeprom_page_wraps(void) {
+    return sim_world()->page_wraps;
+}
+
+const uint8_t* sim_uart(uint32_t* size) {
+    *size = sim_world()->uart_size;
+    return sim_world()->uart;
+}
+
+void sim_trace_from_boot(bool trace) {
+    m_sim_trace = trace;
+}
+
+/**
+ * End the boot, as the power is cut or the panel has halted on an assert.
+ */
+static void sim_end(bool asserted) {
+    SimResult* result = &m_sim_world->result;
+    result->cycles = m_sim_cycles;
+    result->elapsed_ms = HAL_TICK_TEST_VALUE;
+    result->alive_minutes = p_aliveMinutes;
+    result->power_state = p_powerState;
+    result->alarms = p_numericalValues.alarms;
+    result->asserted = asserted;
+    if (asserted) {
+        result->assert_ms = HAL_TICK_TEST_VALUE;
+    }
+    (void) fflush(stdout);
+    _exit(0);
+}
+
+void sw_assert(const char* file, int line) {
+    printf("ASSERT: %s:%d at %u ms\n", file, line, HAL_TICK_TEST_VALUE);
+    SW_ASSERT_FLAG = 1;
+    (void) snprintf(m_sim_world->result.assert_file, sizeof(m_sim_world->result.assert_file), "%s", file);
+    m_sim_world->result.assert_line = line;
+    sim_end(true);
+}
+
+void sw_assert1(const char* file, int line, int arg1) {
+    printf("ASSERT: with argument %d\n", arg1);
+    sw_assert(file, line);
+}
+
+void sw_assert2(const char* file, int line, int arg1, int arg2) {
+    printf("ASSERT: with arguments %d, %d\n", arg1, arg2);
+    sw_assert(file, line);
+}
+
+void sw_hard_fault(const char* file, int line) {
+    sw_assert(file, line);
+}
+
+/**
+ * Reset an expander to its power-on registers, all pins inputs.
+ */
+static void sim_mcp_reset(SimMcp* mcp, uint8_t addr) {
+    (void) memset(mcp, 0, sizeof(SimMcp));
+    mcp->addr = addr;
+    mcp->regs[REG_IODIRA] = 0xFF;
+    mcp->regs[REG_IODIRB] = 0xFF;
+}
+
+static SimMcp* sim_mcp_find(unsigned short addr) {
+    uint32_t i = 0;
+    for (i = 0; i < SIM_MCP_COUNT; i++) {
+        if ((m_sim_mcp[i].addr << 1) == addr) {
+            return &m_sim_mcp[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Level of the INTA line, reporting both ports when mirrored.
+ */
+static int sim_mcp_int_level(const SimMcp* mcp) {
+    uint8_t iocon = mcp->regs[REG_IOCON];
+    bool active = (mcp->regs[REG_INTFA] != 0) || (((iocon & SIM_MCP_IOCON_MIRROR) != 0) && (mcp->regs[REG_INTFB] != 0));
+    return (active == ((iocon & SIM_MCP_IOCON_INTPOL) != 0)) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+/**
+ * Read a register, reading the inputs or the captures of a port clears its interrupt.
+ */
+static uint8_t sim_mcp_read(SimMcp* mcp, uint8_t reg) {
+    uint32_t port = reg & 1;
+    uint8_t inputs = (uint8_t)(mcp->inputs >> (8 * port));
+    switch (reg) {
+        case REG_GPIOA:
+        case REG_GPIOB:
+            mcp->regs[REG_INTFA + port] = 0;
+            return (uint8_t)(((inputs ^ mcp->regs[REG_IPOLA + port]) & mcp->regs[REG_IODIRA + port]) |
+                             (mcp->regs[REG_OLATA + port] & ~mcp->regs[REG_IODIRA + port]));
+        case REG_INTCAPA:
+        case REG_INTCAPB:
+            mcp->regs[REG_INTFA + port] = 0;
+            return mcp->regs[reg];
+        case REG_IOCON2:
+            return mcp->regs[REG_IOCON];
+        default:
+            break;
+    }
+    return mcp->regs[reg];
+}
+
+static void sim_mcp_write(SimMcp* mcp, uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case REG_GPIOA:
+        case REG_GPIOB:
+            mcp->regs[REG_OLATA + (reg & 1)] = value;
+            break;
+        case REG_INTFA:
+        case REG_INTFB:
+        case REG_INTCAPA:
+        case REG_INTCAPB:
+            break; // Read only
+        case REG_IOCON2:
+            mcp->regs[REG_IOCON] = value;
+            break;
+        default:
+            mcp->regs[reg] = value;
+            break;
+    }
+}
+
+/**
+ * Change the input pins, latching the captures of a port with no interrupt pending. Returns true on a rising edge of
+ * the INTA line, as seen by the EXTI.
+ */
+static bool sim_mcp_inputs(SimMcp* mcp, uint16_t inputs) {
+    uint32_t port = 0;
+    int before = sim_mcp_int_level(mcp);
+    for (port = 0; port < 2; port++) {
+        uint8_t old = (uint8_t)(mcp->inputs >> (8 * port));
+        uint8_t new = (uint8_t)(inputs >> (8 * port));
+        uint8_t intcon = mcp->regs[REG_INTCONA + port];
+        uint8_t tripped = (uint8_t)(((intcon & (new ^ mcp->regs[REG_DEFVALA + port])) | (~intcon & (old ^ new))) &
+                                    mcp->regs[REG_GPINTENA + port] & mcp->regs[REG_IODIRA + port]);
+        if ((tripped != 0) && (mcp->regs[REG_INTFA + port] == 0)) {
+            mcp->regs[REG_INTFA + port] = tripped;
+            mcp->regs[REG_INTCAPA + port] = new ^ mcp->regs[REG_IPOLA + port];
+        }
+    }
+    mcp->inputs = inputs;
+    return (before == GPIO_PIN_RESET) && (sim_mcp_int_level(mcp) == GPIO_PIN_SET);
+}
+
+/**
+ * Complete an I2C frame, calling the queue as the HAL callbacks in main.c do.
+ */
+static int sim_i2c_complete(HAL_StatusTypeDef status) {
+    i2c_queue_complete(status);
+    return HAL_OK;
+}
+
+/**
+ * EEPROM frames. An address frame is not acknowledged during a write cycle, and a page write wraps within its page.
+ */
+static int sim_eeprom_transmit(unsigned char* data, unsigned short size, unsigned int options) {
+    uint32_t i = 0;
+    if ((options == I2C_FIRST_FRAME) || (options == I2C_FIRST_AND_NEXT_FRAME)) {
+        if (HAL_TICK_TEST_VALUE < m_sim_eeprom.busy_until) {
+            return sim_i2c_complete(HAL_ERROR);
+        }
+        m_sim_eeprom.pointer = ((data[0] << 8) | data[1]) % SIM_EEPROM_SIZE;
+        return sim_i2c_complete(HAL_OK);
+    }
+    uint32_t page = m_sim_eeprom.pointer / SIM_EEPROM_PAGE_SIZE;
+    if (((m_sim_eeprom.pointer % SIM_EEPROM_PAGE_SIZE) + size) > SIM_EEPROM_PAGE_SIZE) {
+        m_sim_world->page_wraps += 1;
+    }
+    for (i = 0; i < size; i++) {
+        uint32_t offset = (m_sim_eeprom.pointer + i) % SIM_EEPROM_PAGE_SIZE;
+        m_sim_world->eeprom[(page * SIM_EEPROM_PAGE_SIZE) + offset] = data[i];
+    }
+    m_sim_world->page_writes[page] += 1;
+    m_sim_eeprom.busy_until = HAL_TICK_TEST_VALUE + SIM_EEPROM_WRITE_MS;
+    return sim_i2c_complete(HAL_OK);
+}
+
+int i2c_test_seq_transmit(unsigned short addr, unsigned char* data, unsigned short size, unsigned int options) {
+    uint32_t i = 0;
+    if (addr == (SIM_EEPROM_ADDR << 1)) {
+        return sim_eeprom_transmit(data, size, options);
+    }
+    SimMcp* mcp = sim_mcp_find(addr);
+    if (mcp == NULL) {
+        return sim_i2c_complete(HAL_ERROR);
+    }
+    if ((options == I2C_FIRST_FRAME) || (options == I2C_FIRST_AND_NEXT_FRAME)) {
+        mcp->pointer = data[size - 1] % sizeof(mcp->regs);
+        return sim_i2c_complete(HAL_OK);
+    }
+    for (i = 0; i < size; i++) {
+        sim_mcp_write(mcp, mcp->pointer, data[i]);
+        mcp->pointer = (mcp->pointer + 1) % sizeof(mcp->regs);
+    }
+    return sim_i2c_complete(HAL_OK);
+}
+
+int i2c_test_seq_receive(unsigned short addr, unsigned char* data, unsigned short size) {
+    uint32_t i = 0;
+    if (addr == (SIM_EEPROM_ADDR << 1)) {
+        if (HAL_TICK_TEST_VALUE < m_sim_eeprom.busy_until) {
+            return sim_i2c_complete(HAL_ERROR);
+        }
+        for (i = 0; i < size; i++) {
+            data[i] = m_sim_world->eeprom[m_sim_eeprom.pointer];
+            m_sim_eeprom.pointer = (m_sim_eeprom.pointer + 1) % SIM_EEPROM_SIZE;
+        }
+        return sim_i2c_complete(HAL_OK);
+    }
+    SimMcp* mcp = sim_mcp_find(addr);
+    if (mcp == NULL) {
+        return sim_i2c_complete(HAL_ERROR);
+    }
+    for (i = 0; i < size; i++) {
+        data[i] = sim_mcp_read(mcp, mcp->pointer);
+        mcp->pointer = (mcp->pointer + 1) % sizeof(mcp->regs);
+    }
+    return sim_i2c_complete(HAL_OK);
+}
+
+/**
+ * Blocking register access, only used with the expanders.
+ */
+int i2c_test_mem_read(unsigned short addr, unsigned short reg, unsigned char* data, unsigned short size) {
+    uint32_t i = 0;
+    SimMcp* mcp = sim_mcp_find(addr);
+    if (mcp == NULL) {
+        return HAL_ERROR;
+    }
+    for (i = 0; i < size; i++) {
+        data[i] = sim_mcp_read(mcp, (reg + i) % sizeof(mcp->regs));
+    }
+    return HAL_OK;
+}
+
+int i2c_test_mem_write(unsigned short addr, unsigned short reg, unsigned char* data, unsigned short size) {
+    uint32_t i = 0;
+    SimMcp* mcp = sim_mcp_find(addr);
+    if (mcp == NULL) {
+        return HAL_ERROR;
+    }
+    for (i = 0; i < size; i++) {
+        sim_mcp_write(mcp, (reg + i) % sizeof(mcp->regs), data[i]);
+    }
+    return HAL_OK;
+}
+
+int gpio_test_read_pin(unsigned short pin) {
+    if (pin == BTN_INTA_Pin) {
+        return sim_mcp_int_level(&m_sim_mcp[SIM_MCP_BUTTONS]);
+    } else if (pin == LOW_BATTERY_Pin) {
+        return m_sim_inputs.low_battery ? GPIO_PIN_RESET : GPIO_PIN_SET;
+    }
+    return GPIO_PIN_RESET;
+}
+
+/**
+ * Controller exchange. A ventilating controller reports a patient following the set points sent to it, with the
+ * pressure stepping between the peak and PEEP pressures over each breath.
+ */
+HAL_StatusTypeDef if_txrx_packet(SPI_HandleTypeDef* spi_handle, panel_packet_t* outgoing, controller_packet_t* incoming, uint32_t timeout) {
+    (void) spi_handle;
+    (void) timeout;
+    sensor_data_t* sensors = &incoming->sensors;
+    const parameters_t* parameters = &outgoing->parameters;
+    if (m_sim_inputs.controller == SIM_CONTROLLER_SILENT) {
+        (void) memset(incoming, 0xA5, sizeof(controller_packet_t));
+        return HAL_TIMEOUT;
+    }
+    (void) memset(incoming, 0, sizeof(controller_packet_t));
+    uint32_t period = (parameters->breath_period != 0) ? parameters->breath_period : 1;
+    sensors->breath_period_average = (int32_t)period + BREATH_PERIOD_ADJUSTMENT;
+    sensors->fio2 = p_numericalValues.FIO2.setpoint * 1000;
+    if (m_sim_inputs.controller == SIM_CONTROLLER_DISCONNECTED) {
+        return HAL_OK;
+    }
+    bool inhaling = (HAL_TICK_TEST_VALUE % period) < (uint32_t)parameters->inspiration_time;
+    sensors->tidal_volume = parameters->tidal_volume;
+    sensors->last_breath_tidal_volume = parameters->tidal_volume;
+    sensors->minute_volume = (int32_t)((parameters->tidal_volume * MS_PER_MINUTE) / period);
+    sensors->pressure_last_breath_max = parameters->pip_pressure;
+    sensors->pressure_last_breath_min = parameters->peep_pressure;
+    sensors->pressure_last_breath_mean = (parameters->pip_pressure + parameters->peep_pressure) / 2;
+    sensors->pressure_plateau = parameters->pip_pressure;
+    sensors->pressure_patient = inhaling ? parameters->pip_pressure : parameters->peep_pressure;
+    sensors->peak_pressure_average = parameters->pip_pressure;
+    sensors->peep_pressure_average = parameters->peep_pressure;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef sound_pwm_start(TIM_HandleTypeDef* tim1) {
+    (void) tim1;
+    m_sim_sounding = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef sound_pwm_stop(TIM_HandleTypeDef* tim1) {
+    (void) tim1;
+    m_sim_sounding = false;
+    return HAL_OK;
+}
+
+/**
+ * Debug UART, keeping the bytes sent until the buffer is full.
+ */
+HAL_StatusTypeDef telemetry_dma_start(const uint8_t* data, uint16_t size) {
+    uint32_t kept = SIM_UART_SIZE - m_sim_world->uart_size;
+    kept = (size < kept) ? size : kept;
+    (void) memcpy(&m_sim_world->uart[m_sim_world->uart_size], data, kept);
+    m_sim_world->uart_size += kept;
+    m_sim_telemetry_sending = true;
+    return HAL_OK;
+}
+
+void telemetry_dma_abort(void) {
+    m_sim_telemetry_sending = false;
+}
+
+/**
+ * No host is attached to the command channel, so the ring stays empty.
+ */
+HAL_StatusTypeDef command_dma_start(uint8_t* data, uint16_t size) {
+    (void) data;
+    (void) size;
+    return HAL_OK;
+}
+
+uint16_t command_dma_remaining(void) {
+    return COMMAND_RX_SIZE;
+}
+
+uint32_t profiler_timestamp(void) {
+    return HAL_TICK_TEST_VALUE * SIM_PROFILE_TICKS_PER_MS;
+}
+
+void replay_set_low_battery(bool low) {
+    m_sim_inputs.low_battery = low;
+}
+
+/**
+ * Apply the events that are due, raising the EXTI of the button expander on its interrupt.
+ */
+static void sim_apply_events(void) {
+    while ((m_sim_event_next < m_sim_event_count) && (m_sim_events[m_sim_event_next].at_ms <= HAL_TICK_TEST_VALUE)) {
+        m_sim_inputs = m_sim_events[m_sim_event_next];
+        m_sim_event_next += 1;
+        if (sim_mcp_inputs(&m_sim_mcp[SIM_MCP_BUTTONS], m_sim_inputs.buttons)) {
+            button_interrupt();
+        }
+    }
+}
+
+/**
+ * A millisecond of sleep, woken by the SysTick. The power is cut once the run time is reached.
+ */
+void hal_test_wfi(void) {
+    HAL_TICK_TEST_VALUE += 1;
+    if (HAL_TICK_TEST_VALUE >= m_sim_run_ms) {
+        sim_end(false);
+    }
+    // DMA transfers started by the cycle have finished
+    if (m_sim_spi_sent != SPI_TRANSMIT_TEST_COUNT) {
+        m_sim_spi_sent = SPI_TRANSMIT_TEST_COUNT;
+        display_transmit_complete();
+    }
+    if (m_sim_telemetry_sending) {
+        m_sim_telemetry_sending = false;
+        telemetry_sent();
+    }
+    sim_apply_events();
+    // Incoming watchdog EXTI
+    if ((m_sim_inputs.controller != SIM_CONTROLLER_SILENT) && ((HAL_TICK_TEST_VALUE % SIM_CYCLE_MS) == 0)) {
+        p_doCycle = 1;
+    }
+    // TIM6 update, as in TIM6_DAC_IRQHandler
+    if (m_sim_fail_safe && (++TIM_TEST_COUNTER >= SIM_FAIL_SAFE_MS)) {
+        TIM_TEST_COUNTER = 0;
+        if (p_doFail != FAIL_SAFE_CLOCK_UNINITIALIZED) {
+            p_doFail = FAIL_SAFE_CLOCK_FAILED;
+        }
+    }
+}
+
+/**
+ * Power the board, following the events until the power is cut.
+ */
+static void sim_power(const SimEvent* events, uint32_t count, uint32_t run_ms) {
+    (void) memset(&m_sim_world->result, 0, sizeof(SimResult));
+    sim_mcp_reset(&m_sim_mcp[0], 0x20);
+    sim_mcp_reset(&m_sim_mcp[1], 0x21);
+    sim_mcp_reset(&m_sim_mcp[2], 0x22);
+    sim_mcp_reset(&m_sim_mcp[SIM_MCP_BUTTONS], 0x24);
+    (void) memset(&m_sim_eeprom, 0, sizeof(m_sim_eeprom));
+    (void) memset(&m_sim_inputs, 0, sizeof(m_sim_inputs));
+    m_sim_events = events;
+    m_sim_event_count = count;
+    m_sim_event_next = 0;
+    m_sim_run_ms = run_ms;
+    m_sim_cycles = 0;
+    HAL_TICK_TEST_VALUE = 0;
+    sim_apply_events();
+}
+
+/**
+ * Boot of the panel, as main from reset. Never returns, the boot ends with sim_end.
+ */
+static void sim_run(const SimEvent* events, uint32_t count, uint32_t run_ms) {
+    m_sim_world->uart_size = 0;
+    sim_power(events, count, run_ms);
+    panel_init();
+    if (m_sim_trace) {
+        trace_init(true);
+    }
+    m_sim_world->result.boot_alive_minutes = p_aliveMinutes;
+    m_sim_fail_safe = true;
+    TIM_TEST_COUNTER = 0;
+    p_doFail = FAIL_SAFE_CLOCK_RUNNING;
+    while (1) {
+        m_sim_cycles += 1;
+        cycle();
+    }
+}
+
+/**
+ * Fork the process of a boot, after flushing the output so it is not written twice.
+ */
+static pid_t sim_fork(void) {
+    if (sim_world() == NULL) {
+        return -1;
+    }
+    (void) fflush(stdout);
+    (void) fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+    }
+    return pid;
+}
+
+/**
+ * Wait for the process of a boot to exit.
+ */
+static bool sim_wait(pid_t pid) {
+    int status = 0;
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+        fprintf(stderr, "Simulated boot failed with status 0x%x\n", status);
+        return false;
+    }
+    return true;
+}
+
+bool sim_boot(const SimEvent* events, uint32_t count, uint32_t run_ms, SimResult* result) {
+    pid_t pid = sim_fork();
+    if (pid < 0) {
+        return false;
+    } else if (pid == 0) {
+        sim_run(events, count, run_ms);
+    }
+    if (!sim_wait(pid)) {
+        return false;
+    }
+    *result = m_sim_world->result;
+    return true;
+}
+
+bool sim_isolated(int (*run)(void*), void* context) {
+    pid_t pid = sim_fork();
+    if (pid < 0) {
+        return false;
+    } else if (pid == 0) {
+        sim_power(NULL, 0, SIM_EVENT_NEVER);
+        int status = run(context);
+        (void) fflush(stdout);
+        _exit((status == 0) ? 0 : 1);
+    }
+    return sim_wait(pid) && !m_sim_world->result.asserted;
+}
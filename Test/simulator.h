@@ -0,0 +1,143 @@
+/**
+ * simulator.h:
+ *
+ * Full-system simulator of the panel. The real panel_init and cycle run against a behavioural model of the board: the
+ * MCP23017 expanders as register files, a 24-series EEPROM with its page buffer and write cycle time, a controller
+ * answering if_txrx_packet and ticking the incoming watchdog EXTI, and the TIM6 fail-safe clock. Time only passes while
+ * the firmware sleeps in spin_on_incoming_watchdog, a millisecond per WFI as woken by the SysTick, so hours of
+ * ventilation run in seconds.
+ *
+ * Each boot runs in a forked process, so it starts from the firmware's static initializers as after a reset, and a
+ * power cut or an assert simply ends the process. The EEPROM is shared memory and outlives the boots, as do the bytes
+ * the last boot sent on the debug UART.
+ */
+#ifndef VENTILATOR_PANEL_SIMULATOR_H_
+#define VENTILATOR_PANEL_SIMULATOR_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <ventilator/types.h>
+
+/**
+ * Simulator constants.
+ */
+enum SimConstants {
+    SIM_CYCLE_MS = 20,            // Period of the incoming watchdog, a cycle at 50Hz
+    SIM_FAIL_SAFE_MS = 1000,      // TIM6 period, the fail-safe trips when not reset for this long
+    SIM_EEPROM_SIZE = 32768,      // 24LC256
+    SIM_EEPROM_PAGE_SIZE = 64,
+    SIM_EEPROM_PAGES = SIM_EEPROM_SIZE / SIM_EEPROM_PAGE_SIZE,
+    SIM_EEPROM_WRITE_MS = 5,      // Write cycle time, the device does not acknowledge during it
+    SIM_UART_SIZE = 1 << 22,      // Bytes of the debug UART kept from a boot
+    SIM_EVENT_NEVER = 0xFFFFFFFF
+};
+
+/**
+ * SimController:
+ *
+ * Behaviour of the scripted controller.
+ */
+typedef enum {
+    SIM_CONTROLLER_VENTILATING = 0, // Ticks the watchdog, and reports a patient following the set points
+    SIM_CONTROLLER_DISCONNECTED,    // Ticks the watchdog, and reports no pressure as the circuit is disconnected
+    SIM_CONTROLLER_SILENT           // Stops ticking the watchdog and answering
+} SimController;
+
+/**
+ * SimEvent:
+ *
+ * Inputs of the board from a time after boot, held until the next event.
+ */
+typedef struct {
+    uint32_t at_ms;      // Simulated time after boot the inputs change
+    uint16_t buttons;    // Pressed buttons, in the bit order of the button expander reading
+    uint8_t controller;  // SimController
+    uint8_t low_battery; // Low battery input asserted
+} SimEvent;
+
+/**
+ * SimResult:
+ *
+ * State of the panel when a boot ended, by a power cut or an assert.
+ */
+typedef struct {
+    uint32_t cycles;             // Cycles started
+    uint32_t elapsed_ms;         // Simulated time of the end
+    uint32_t boot_alive_minutes; // Alive-minutes loaded by panel_init
+    uint32_t alive_minutes;      // p_aliveMinutes
+    PowerState power_state;      // p_powerState
+    Alarms alarms;               // p_numericalValues.alarms
+    bool asserted;               // Ended by an assert, rather than the power cut
+    uint32_t assert_ms;          // Simulated time of the assert
+    int assert_line;
+    char assert_file[64];
+} SimResult;
+
+/**
+ * sim_reset:
+ *
+ * Fit a new, erased EEPROM.
+ */
+void sim_reset(void);
+
+/**
+ * sim_boot:
+ *
+ * Power the panel, run it following the events, and cut the power after a time. Events are in time order.
+ * const SimEvent* events: inputs of the board, the first at time 0
+ * uint32_t count: number of events
+ * uint32_t run_ms: simulated time the power is cut
+ * SimResult* result: (output) state at the end of the boot
+ * return: true when the boot ran, false when the simulation itself failed
+ */
+bool sim_boot(const SimEvent* events, uint32_t count, uint32_t run_ms, SimResult* result);
+
+/**
+ * sim_eeprom:
+ *
+ * return: contents of the EEPROM
+ */
+const uint8_t* sim_eeprom(void);
+
+/**
+ * sim_eeprom_page_writes:
+ *
+ * uint32_t page: EEPROM page
+ * return: write cycles of the page since sim_reset
+ */
+uint32_t sim_eeprom_page_writes(uint32_t page);
+
+/**
+ * sim_eeprom_page_wraps:
+ *
+ * return: writes that crossed a page boundary and wrapped within the page, overwriting its start
+ */
+uint32_t sim_eeprom_page_wraps(void);
+
+/**
+ * sim_uart:
+ *
+ * uint32_t* size: (output) bytes sent, up to SIM_UART_SIZE
+ * return: bytes sent on the debug UART by the last boot
+ */
+const uint8_t* sim_uart(uint32_t* size);
+
+/**
+ * sim_trace_from_boot:
+ *
+ * Capture a trace from the first cycle of the next boots, as a panel built with TRACE_FROM_BOOT.
+ * bool trace: true to capture
+ */
+void sim_trace_from_boot(bool trace);
+
+/**
+ * sim_isolated:
+ *
+ * Run a function in a forked process against a freshly powered board, so the firmware's statics start from their
+ * initializers, as for a boot.
+ * int (*run)(void*): function, returning zero on success
+ * void* context: passed to the function
+ * return: true when the function returned zero without an assert
+ */
+bool sim_isolated(int (*run)(void*), void* context);
+
+#endif
@@ -0,0 +1,204 @@
+/**
+ * simulator_test.c:
+ *
+ * Long-horizon scenarios of the whole panel run by the simulator: hours of ventilation recording the alive-minutes
+ * across a reboot, the stuck-button machine fault, the fail-safe clock tripping when the controller goes silent, and
+ * a trace captured from boot replaying exactly.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <simulator.h>
+#include <replay.h>
+#include <ventilator/constants.h>
+#include <ventilator/eeprom.h>
+
+// Button expander bits of the power and alarm silence buttons
+#define SIM_BUTTON_POWER 0x2000
+#define SIM_BUTTON_SILENCE 0x1000
+// Button expander bits of the PEEP and tidal volume set buttons, and the up adjustment
+#define SIM_BUTTON_PEEP 0x0040
+#define SIM_BUTTON_TV 0x0020
+#define SIM_BUTTON_UP 0x0100
+
+const uint32_t POWER_PRESS_MS = 1000;
+const uint32_t MS_PER_HOUR = 60 * 60 * 1000;
+const uint32_t MS_PER_CYCLE = 1000 / CYCLES_PER_SECOND;
+
+/**
+ * Events pressing and releasing the power button, turning the panel on from standby.
+ */
+const SimEvent POWER_ON_EVENTS[] = {
+    {0, 0, SIM_CONTROLLER_VENTILATING, 0},
+    {1000, SIM_BUTTON_POWER, SIM_CONTROLLER_VENTILATING, 0},
+    {1200, 0, SIM_CONTROLLER_VENTILATING, 0}
+};
+
+/**
+ * Check no alarm is raised.
+ */
+bool alarms_off(const Alarms* alarms) {
+    uint32_t i = 0;
+    const Alarm* alarm = (const Alarm*)alarms;
+    for (i = 0; i < (sizeof(Alarms) / sizeof(Alarm)); i++) {
+        if (alarm[i].status != ALARM_OFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Sum the write cycles of a range of EEPROM pages, and find the most written.
+ */
+uint32_t page_writes(uint32_t first, uint32_t count, uint32_t* most) {
+    uint32_t i = 0;
+    uint32_t total = 0;
+    *most = 0;
+    for (i = first; i < (first + count); i++) {
+        uint32_t writes = sim_eeprom_page_writes(i);
+        total += writes;
+        *most = (writes > *most) ? writes : *most;
+    }
+    return total;
+}
+
+int test_simulator_alive_minutes() {
+    TEST_START("simulator ventilates for hours, recording each alive minute once across a reboot");
+    SimResult result;
+    uint32_t most = 0;
+    sim_reset();
+    // Three hours of ventilation, the power cut half a minute after the last whole minute
+    uint32_t run_ms = (3 * MS_PER_HOUR) + POWER_PRESS_MS + 30000;
+    TEST_ASSERT(sim_boot(POWER_ON_EVENTS, 3, run_ms, &result), "Boot failed");
+    TEST_ASSERT(!result.asserted, "Asserted while ventilating");
+    TEST_ASSERT(result.boot_alive_minutes == 0, "Blank EEPROM did not start from zero");
+    TEST_ASSERT(result.cycles == (run_ms / MS_PER_CYCLE), "Cycles missed");
+    TEST_ASSERT(result.power_state == POWER_ON_STATE, "Not powered on");
+    TEST_ASSERT(result.alive_minutes == 180, "Alive minutes not counted");
+    TEST_ASSERT(alarms_off(&result.alarms), "Alarm raised by a patient following the set points");
+    // One journal entry a minute, spread across the journal
+    TEST_ASSERT(page_writes(EEPROM_JOURNAL_FIRST_PAGE, EEPROM_JOURNAL_PAGES, &most) == 180, "Journal not written once a minute");
+    TEST_ASSERT(most == 2, "Journal writes not spread");
+    TEST_ASSERT(sim_eeprom_page_writes(EEPROM_ALIVE_MINUTES) == 0, "Legacy record written");
+    TEST_ASSERT(sim_eeprom_page_wraps() == 0, "Write crossed an EEPROM page");
+    // Reboot into standby, continuing from the journal
+    TEST_ASSERT(sim_boot(POWER_ON_EVENTS, 1, 5000, &result), "Boot failed");
+    TEST_ASSERT(!result.asserted && (result.power_state == POWER_OFF_STATE), "Not in standby");
+    TEST_ASSERT((result.boot_alive_minutes == 180) && (result.alive_minutes == 180), "Alive minutes lost by the reboot");
+    TEST_ASSERT(page_writes(EEPROM_JOURNAL_FIRST_PAGE, EEPROM_JOURNAL_PAGES, &most) == 180, "Journal written in standby");
+    // Another hour continues the count
+    TEST_ASSERT(sim_boot(POWER_ON_EVENTS, 3, MS_PER_HOUR + POWER_PRESS_MS + 30000, &result), "Boot failed");
+    TEST_ASSERT(!result.asserted && (result.alive_minutes == 240), "Alive minutes not continued");
+    TEST_ASSERT(page_writes(EEPROM_JOURNAL_FIRST_PAGE, EEPROM_JOURNAL_PAGES, &most) == 240, "Journal not continued");
+    return 0;
+}
+
+int test_simulator_stuck_button() {
+    TEST_START("simulator trips a machine fault on a button held for 60 seconds");
+    SimResult result;
+    const uint32_t press_ms = 20000;
+    SimEvent events[] = {
+        POWER_ON_EVENTS[0],
+        POWER_ON_EVENTS[1],
+        POWER_ON_EVENTS[2],
+        {press_ms, SIM_BUTTON_SILENCE, SIM_CONTROLLER_VENTILATING, 0},
+        {SIM_EVENT_NEVER, 0, SIM_CONTROLLER_VENTILATING, 0}
+    };
+    sim_reset();
+    // Released a second before the fault
+    events[4].at_ms = press_ms + 59000;
+    TEST_ASSERT(sim_boot(events, 5, press_ms + 70000, &result), "Boot failed");
+    TEST_ASSERT(!result.asserted && (result.power_state == POWER_ON_STATE), "Faulted on a button released in time");
+    // Held until the fault, which ends the boot
+    events[4].at_ms = SIM_EVENT_NEVER;
+    TEST_ASSERT(sim_boot(events, 5, press_ms + 70000, &result), "Boot failed");
+    TEST_ASSERT(result.asserted && (strstr(result.assert_file, "button.c") != NULL), "No stuck button fault");
+    // The hold is seen once debounced, in the cycle after the press
+    uint32_t held_ms = result.assert_ms - press_ms;
+    TEST_ASSERT((held_ms >= 60000) && (held_ms <= (60000 + BUTTON_DEBOUNCE_MS + (2 * MS_PER_CYCLE))), "Fault not after 60 seconds");
+    return 0;
+}
+
+int test_simulator_fail_safe() {
+    TEST_START("simulator trips the fail-safe clock once the controller goes silent");
+    SimResult result;
+    const uint32_t silent_ms = 30000;
+    SimEvent events[] = {
+        POWER_ON_EVENTS[0],
+        POWER_ON_EVENTS[1],
+        POWER_ON_EVENTS[2],
+        {silent_ms, 0, SIM_CONTROLLER_SILENT, 0}
+    };
+    sim_reset();
+    TEST_ASSERT(sim_boot(events, 4, silent_ms + 5000, &result), "Boot failed");
+    TEST_ASSERT(result.asserted && (strstr(result.assert_file, "watchdog.c") != NULL), "Fail-safe did not trip");
+    // A period after the last good packet, of the cycle before the silence. The reset counter starts from one.
+    TEST_ASSERT((result.assert_ms >= (silent_ms - MS_PER_CYCLE + SIM_FAIL_SAFE_MS - 1)) &&
+                (result.assert_ms <= (silent_ms + SIM_FAIL_SAFE_MS)), "Fail-safe not tripped after its period");
+    return 0;
+}
+
+/**
+ * Replay the trace the last boot sent on the debug UART, run isolated as the replay starts from the initializers.
+ */
+int replay_last_boot(void* context) {
+    const SimResult* result = (const SimResult*)context;
+    ReplayStats stats;
+    uint32_t size = 0;
+    const uint8_t* uart = sim_uart(&size);
+    (void) memset(&stats, 0, sizeof(stats));
+    stats.verbose = true;
+    replay_init(&stats);
+    replay_stream(uart, size, &stats);
+    // The power is cut in the wait of the last cycle started
+    TEST_ASSERT(stats.from_boot && (stats.records == (result->cycles - 1)), "Trace incomplete");
+    TEST_ASSERT((stats.malformed == 0) && (stats.gaps == 0) && (stats.unsynced == 0), "Trace frames lost");
+    TEST_ASSERT((stats.display_diffs == 0) && (stats.alarm_diffs == 0), "Replay differs from the panel");
+    return 0;
+}
+
+int test_simulator_replay() {
+    TEST_START("simulator trace captured from boot replays the display and alarms of every cycle");
+    SimResult result;
+    const SimEvent events[] = {
+        POWER_ON_EVENTS[0],
+        POWER_ON_EVENTS[1],
+        POWER_ON_EVENTS[2],
+        // PEEP raised while held, and tidal volume toggled into modify, raised, and set
+        {20000, SIM_BUTTON_PEEP, SIM_CONTROLLER_VENTILATING, 0},
+        {21000, SIM_BUTTON_PEEP | SIM_BUTTON_UP, SIM_CONTROLLER_VENTILATING, 0},
+        {21200, SIM_BUTTON_PEEP, SIM_CONTROLLER_VENTILATING, 0},
+        {23000, 0, SIM_CONTROLLER_VENTILATING, 0},
+        {25000, SIM_BUTTON_TV, SIM_CONTROLLER_VENTILATING, 0},
+        {25200, 0, SIM_CONTROLLER_VENTILATING, 0},
+        {26000, SIM_BUTTON_UP, SIM_CONTROLLER_VENTILATING, 0},
+        {27000, 0, SIM_CONTROLLER_VENTILATING, 0},
+        {28000, SIM_BUTTON_TV, SIM_CONTROLLER_VENTILATING, 0},
+        {28200, 0, SIM_CONTROLLER_VENTILATING, 0},
+        // Circuit disconnected, its alarm silenced, then reconnected
+        {40000, 0, SIM_CONTROLLER_DISCONNECTED, 0},
+        {50000, SIM_BUTTON_SILENCE, SIM_CONTROLLER_DISCONNECTED, 0},
+        {50200, 0, SIM_CONTROLLER_DISCONNECTED, 0},
+        {60000, 0, SIM_CONTROLLER_VENTILATING, 0},
+        // Low battery, and a controller pausing for less than the fail-safe period
+        {65000, 0, SIM_CONTROLLER_VENTILATING, 1},
+        {75000, 0, SIM_CONTROLLER_VENTILATING, 0},
+        {80000, 0, SIM_CONTROLLER_SILENT, 0},
+        {80500, 0, SIM_CONTROLLER_VENTILATING, 0}
+    };
+    sim_reset();
+    sim_trace_from_boot(true);
+    TEST_ASSERT(sim_boot(events, sizeof(events) / sizeof(SimEvent), 90000, &result), "Boot failed");
+    sim_trace_from_boot(false);
+    TEST_ASSERT(!result.asserted && (result.power_state == POWER_ON_STATE), "Not ventilating");
+    TEST_ASSERT(sim_isolated(replay_last_boot, &result), "Replay failed");
+    return 0;
+}
+
+int main() {
+    TEST(test_simulator_alive_minutes);
+    TEST(test_simulator_stuck_button);
+    TEST(test_simulator_fail_safe);
+    TEST(test_simulator_replay);
+}
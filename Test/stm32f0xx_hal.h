@@ -3,7 +3,25 @@
  *
  * Faked stm32f0xx_hal.h header for testing purposes.
  */
+#include <string.h>
 extern int GPIO_READ_TEST_VALUE;
+extern int SPI_TRANSMIT_TEST_COUNT;
+extern int I2C_WRITE_TEST_COUNT;
+extern int I2C_READ_TEST_COUNT;
+extern unsigned char I2C_READ_TEST_REGS[256];
+extern unsigned int HAL_TICK_TEST_VALUE;
+extern int I2C_TEST_DEFER_COMPLETE;
+extern unsigned char I2C_TEST_EEPROM[32768];
+extern unsigned int I2C_TEST_EEPROM_PAGE_WRITES[512];
+extern int I2C_TEST_EEPROM_BUSY;
+int i2c_test_seq_transmit(unsigned short addr, unsigned char* data, unsigned short size, unsigned int options);
+int i2c_test_seq_receive(unsigned short addr, unsigned char* data, unsigned short size);
+int i2c_test_mem_read(unsigned short addr, unsigned short reg, unsigned char* data, unsigned short size);
+int i2c_test_mem_write(unsigned short addr, unsigned short reg, unsigned char* data, unsigned short size);
+int gpio_test_read_pin(unsigned short pin);
+// Only needed by tests linking watchdog.c, i.e. the simulator
+extern unsigned int TIM_TEST_COUNTER;
+void hal_test_wfi(void);
 
 // Override the timer type to become void*
 #define TIM_HandleTypeDef int
@@ -18,27 +36,53 @@ extern int GPIO_READ_TEST_VALUE;
 
 #define HAL_OK 0
 #define HAL_ERROR 1
+#define HAL_BUSY 2
+#define HAL_TIMEOUT 3
 
 #define HAL_MAX_DELAY 0
 
 #define HAL_SPI_Transmit(...) HAL_OK
+#define HAL_SPI_Transmit_DMA(...) (SPI_TRANSMIT_TEST_COUNT++, HAL_OK)
+#define HAL_SPI_Abort(...) HAL_OK
+#define HAL_SPI_GetState(...) HAL_SPI_STATE_READY
+#define HAL_SPI_STATE_READY 1
 #define HAL_I2C_Master_Transmit(...) HAL_OK
 #define HAL_I2C_Master_Receive(...) HAL_OK
 
-#define HAL_I2C_Mem_Read(...) HAL_OK
-#define HAL_I2C_Mem_Write(...) HAL_OK
+#define HAL_I2C_Mem_Read(HANDLE, ADDR, REG, REG_SIZE, VAL, SIZE, TIMEOUT) i2c_test_mem_read((ADDR), (REG), (VAL), (SIZE))
+#define HAL_I2C_Mem_Write(HANDLE, ADDR, REG, REG_SIZE, VAL, SIZE, TIMEOUT) i2c_test_mem_write((ADDR), (REG), (VAL), (SIZE))
+#define HAL_I2C_Master_Seq_Transmit_IT(HANDLE, ADDR, DATA, SIZE, OPTIONS) i2c_test_seq_transmit((ADDR), (DATA), (SIZE), (OPTIONS))
+#define HAL_I2C_Master_Seq_Receive_IT(HANDLE, ADDR, DATA, SIZE, OPTIONS) i2c_test_seq_receive((ADDR), (DATA), (SIZE))
+#define HAL_I2C_DeInit(...) HAL_OK
+#define HAL_I2C_Init(...) HAL_OK
+#define I2C_FIRST_FRAME 1
+#define I2C_FIRST_AND_NEXT_FRAME 2
+#define I2C_LAST_FRAME 3
 
-#define HAL_GPIO_ReadPin(...) GPIO_READ_TEST_VALUE
+#define __get_PRIMASK() 0
+#define __disable_irq()
+#define __set_PRIMASK(MASK) ((void) (MASK))
+#define __enable_irq()
+#define __ISB()
+#define __WFI() hal_test_wfi()
+
+#define HAL_GPIO_ReadPin(PORT, PIN) gpio_test_read_pin(PIN)
 #define HAL_GPIO_WritePin(...) HAL_OK
 #define HAL_GPIO_TogglePin(...) HAL_OK
 
+#define HAL_GetTick() HAL_TICK_TEST_VALUE
+#define HAL_Delay(MS) (HAL_TICK_TEST_VALUE += (MS))
+
 #define HAL_TIM_PWM_Start(...) HAL_OK
 #define HAL_TIM_PWM_Stop(...) HAL_OK
+#define __HAL_TIM_SET_COUNTER(HANDLE, VALUE) (TIM_TEST_COUNTER = (VALUE))
 
 #define GPIOB 0
 #define GPIO_PIN_SET 1
 #define GPIO_PIN_UNSET 0
+#define GPIO_PIN_1 1
 #define GPIO_PIN_12 1
 #define GPIO_PIN_14 1
 #define GPIO_PIN_5 1
+#define GPIO_PIN_10 0x0400
 #define GPIO_PIN_RESET 0
@@ -0,0 +1,96 @@
+/**
+ * telemetry_decoder.c:
+ *
+ * Host decoder of the debug UART telemetry. Reads the raw byte stream, as captured from the UART, and prints a CSV
+ * line per status frame. Gaps in the sequence column are frames dropped on the panel or lost on the line. Replies to
+ * commands are listed on stderr, and the pages of trend page replies are written to a file for trend_decoder. Trace
+ * frames are left to trace_replay.
+ *
+ * Usage (from the Test directory): make -f Makefile.telemetry telemetry_decoder && bin/telemetry_decoder [pages.bin] < uart.bin
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/command.h>
+
+const char* READING_NAMES[TELEMETRY_READING_COUNT] = {
+    "pressure_mean", "pressure_min", "pressure_plat", "pressure", "minute_volume", "resp_rate", "ins_time",
+    "peak_pressure", "peak_pressure_average", "backup_rate", "tidal_volume", "tidal_volume_last", "PEEP",
+    "peep_pressure_average", "FIO2"
+};
+const char* ALARM_NAMES[TELEMETRY_ALARM_COUNT] = {
+    "disconnect", "tidal_vol", "peak_press", "resp_rate", "peep", "fio2", "machine_fault", "low_power", "power_off"
+};
+const char* STAGE_NAMES[PROFILE_STAGE_COUNT] = {"wait", "idle", "controller", "sound", "buttons", "alarm", "display", "cycle"};
+
+/**
+ * List the reply to a command.
+ */
+void print_reply(const FrameParser* parser, FILE* pages) {
+    CommandParameter parameter;
+    CommandTrendPage page;
+    uint8_t command = parser->type & (uint8_t)~FRAME_TYPE_REPLY;
+    if (parser->type == FRAME_TYPE_REJECTED) {
+        fprintf(stderr, "rejected command 0x%02x\n", parser->payload[0]);
+    } else if (((command == FRAME_TYPE_GET_PARAMETER) || (command == FRAME_TYPE_SET_PARAMETER)) &&
+               (parser->length == sizeof(parameter))) {
+        (void) memcpy(&parameter, parser->payload, sizeof(parameter));
+        fprintf(stderr, "parameter %u = %d, status %u\n", parameter.record, parameter.value, parameter.status);
+    } else if ((command == FRAME_TYPE_GET_TREND_PAGE) && (parser->length == sizeof(page))) {
+        (void) memcpy(&page, parser->payload, sizeof(page));
+        fprintf(stderr, "trend page %u of %u, status %u\n", page.age, page.count, page.status);
+        if ((pages != NULL) && (page.status == COMMAND_OK)) {
+            (void) fwrite(page.data, sizeof(page.data), 1, pages);
+        }
+    } else if ((command == FRAME_TYPE_SET_TRACE) && (parser->length == 1)) {
+        fprintf(stderr, "trace capture %s\n", (parser->payload[0] != 0) ? "started" : "stopped");
+    }
+}
+
+int main(int argc, char** argv) {
+    FrameParser parser;
+    TelemetryStatus status;
+    FILE* pages = (argc > 1) ? fopen(argv[1], "wb") : NULL;
+    uint32_t i = 0;
+    int byte = 0;
+    printf("sequence,dropped,alive_minutes,power_state");
+    for (i = 0; i < TELEMETRY_READING_COUNT; i++) {
+        printf(",%s", READING_NAMES[i]);
+    }
+    for (i = 0; i < TELEMETRY_ALARM_COUNT; i++) {
+        printf(",%s", ALARM_NAMES[i]);
+    }
+    for (i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        printf(",%s_max_us", STAGE_NAMES[i]);
+    }
+    printf(",load_permille,spi_errors,spi_timeouts,i2c_errors\n");
+    frame_parser_reset(&parser);
+    while ((byte = getchar()) != EOF) {
+        if (!frame_parse(&parser, (uint8_t)byte)) {
+            continue;
+        }
+        if ((parser.type != FRAME_TYPE_STATUS) || (parser.length != sizeof(status))) {
+            print_reply(&parser, pages);
+            continue;
+        }
+        (void) memcpy(&status, parser.payload, sizeof(status));
+        printf("%u,%u,%u,%u", status.sequence, status.dropped, status.alive_minutes, status.power_state);
+        for (i = 0; i < TELEMETRY_READING_COUNT; i++) {
+            printf(",%d", status.readings[i]);
+        }
+        for (i = 0; i < TELEMETRY_ALARM_COUNT; i++) {
+            printf(",%u", status.alarms[i]);
+        }
+        for (i = 0; i < PROFILE_STAGE_COUNT; i++) {
+            printf(",%u", status.stage_max[i] / PROFILE_TICKS_PER_US);
+        }
+        printf(",%u,%u,%u,%u\n", status.load, status.fsw_stats.controlSpiErrors, status.fsw_stats.controlSpiTimeouts,
+               status.fsw_stats.switchI2CErrors);
+    }
+    fprintf(stderr, "%u corrupt frames\n", parser.errors);
+    if (pages != NULL) {
+        (void) fclose(pages);
+    }
+    return 0;
+}
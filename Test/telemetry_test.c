@@ -0,0 +1,251 @@
+/**
+ * telemetry_test.c:
+ *
+ * Test the debug UART framing resynchronizes on corrupt input, and the telemetry ring sends status frames by DMA
+ * without ever waiting on a stalled host.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/panel_public.h>
+
+uint32_t fake_timestamp = 0;
+int dma_test_status = HAL_OK;
+bool dma_test_busy = false;
+int dma_test_starts = 0;
+int dma_test_aborts = 0;
+const uint8_t* dma_test_data = NULL;
+uint16_t dma_test_size = 0;
+uint8_t sent[1 << 16];
+uint32_t sent_size = 0;
+
+uint32_t profiler_timestamp(void) {
+    return fake_timestamp;
+}
+
+HAL_StatusTypeDef telemetry_dma_start(const uint8_t* data, uint16_t size) {
+    TEST_ASSERT(!dma_test_busy, "Transfer started while busy");
+    dma_test_starts++;
+    dma_test_data = data;
+    dma_test_size = size;
+    dma_test_busy = (dma_test_status == HAL_OK);
+    return dma_test_status;
+}
+
+void telemetry_dma_abort(void) {
+    dma_test_aborts++;
+    dma_test_busy = false;
+}
+
+/**
+ * Complete the DMA transfer, keeping the bytes sent.
+ */
+void complete_dma(void) {
+    if (!dma_test_busy) {
+        return;
+    }
+    (void) memcpy(&sent[sent_size], dma_test_data, dma_test_size);
+    sent_size += dma_test_size;
+    dma_test_busy = false;
+    telemetry_sent();
+}
+
+/**
+ * Complete transfers until the ring is empty.
+ */
+void drain_dma(void) {
+    while (dma_test_busy) {
+        complete_dma();
+    }
+}
+
+/**
+ * Parse the bytes sent, checking the status frames continue the sequence.
+ * return: frames parsed, or -1 on a frame out of sequence
+ */
+int parse_sent(uint32_t first, uint32_t* errors) {
+    FrameParser parser;
+    uint32_t i = 0;
+    int frames = 0;
+    frame_parser_reset(&parser);
+    for (i = 0; i < sent_size; i++) {
+        if (frame_parse(&parser, sent[i])) {
+            TelemetryStatus status;
+            (void) memcpy(&status, parser.payload, sizeof(status));
+            if (status.sequence != (first + frames)) {
+                return -1;
+            }
+            frames++;
+        }
+    }
+    *errors = parser.errors;
+    return frames;
+}
+
+void reset_telemetry(void) {
+    telemetry_init();
+    profiler_reset();
+    dma_test_status = HAL_OK;
+    dma_test_busy = false;
+    dma_test_starts = 0;
+    dma_test_aborts = 0;
+    sent_size = 0;
+}
+
+int test_frame_resync() {
+    TEST_START("frame parser resynchronizes past corrupt bytes");
+    uint8_t stream[4 * (FRAME_PAYLOAD_MAX + FRAME_OVERHEAD)];
+    uint8_t payload[FRAME_PAYLOAD_MAX];
+    FrameParser parser;
+    uint32_t size = 0;
+    uint32_t i = 0;
+    int frames = 0;
+    for (i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)(i ^ FRAME_SYNC_FIRST);
+    }
+    // Noise with a false sync, a repeated sync byte, a corrupt frame, an empty frame, and a full frame
+    stream[size++] = 0x00;
+    stream[size++] = FRAME_SYNC_FIRST;
+    stream[size++] = 0x13;
+    stream[size++] = FRAME_SYNC_FIRST;
+    size += frame_encode(&stream[size], 7, payload, 10);
+    uint32_t corrupt = size + FRAME_HEADER_SIZE + 3;
+    size += frame_encode(&stream[size], 8, payload, 20);
+    stream[corrupt] ^= 0x40;
+    size += frame_encode(&stream[size], 9, payload, 0);
+    size += frame_encode(&stream[size], 10, payload, FRAME_PAYLOAD_MAX);
+    frame_parser_reset(&parser);
+    for (i = 0; i < size; i++) {
+        if (frame_parse(&parser, stream[i])) {
+            uint8_t lengths[] = {10, 0, FRAME_PAYLOAD_MAX};
+            uint8_t types[] = {7, 9, 10};
+            TEST_ASSERT(frames < 3 && parser.type == types[frames] && parser.length == lengths[frames], "Wrong frame parsed");
+            TEST_ASSERT(memcmp(parser.payload, payload, parser.length) == 0, "Payload differs");
+            frames++;
+        }
+    }
+    TEST_ASSERT(frames == 3 && parser.errors == 1, "Corrupt frame not dropped");
+    // Oversized length
+    uint8_t oversized[] = {FRAME_SYNC_FIRST, FRAME_SYNC_SECOND, 1, FRAME_PAYLOAD_MAX + 1};
+    for (i = 0; i < sizeof(oversized); i++) {
+        TEST_ASSERT(!frame_parse(&parser, oversized[i]), "Oversized frame parsed");
+    }
+    TEST_ASSERT(parser.errors == 2 && parser.state == FRAME_PARSE_SYNC_FIRST, "Oversized frame not dropped");
+    return 0;
+}
+
+int test_telemetry_status() {
+    TEST_START("telemetry status frame carries the system state");
+    FrameParser parser;
+    TelemetryStatus status;
+    uint32_t i = 0;
+    bool parsed = false;
+    reset_telemetry();
+    (void) memset(&p_numericalValues, 0, sizeof(p_numericalValues));
+    p_numericalValues.pressure_mean.val = 11;
+    p_numericalValues.pressure.val = -1234;
+    p_numericalValues.FIO2.val = 40;
+    p_numericalValues.alarms.disconnect.status = ALARM_LATCH;
+    p_numericalValues.alarms.power_off.status = ALARM_SET;
+    p_uartDebug.fswStats.switchI2CErrors = 5;
+    p_aliveMinutes = 600;
+    p_powerState = POWER_ON_STATE;
+    profiler_record(PROFILE_STAGE_DISPLAY, 4800);
+    profiler_record(PROFILE_STAGE_DISPLAY, 96);
+    // A 20ms cycle busy for 1.25ms, and for another 1.25ms in interrupts serviced during the wait
+    profiler_record(PROFILE_STAGE_WAIT, 900000);
+    profiler_record(PROFILE_STAGE_IDLE, 840000);
+    profiler_record(PROFILE_STAGE_CYCLE, 60000);
+    telemetry_cycle();
+    TEST_ASSERT(dma_test_starts == 1 && dma_test_size == (sizeof(TelemetryStatus) + FRAME_OVERHEAD), "Frame not sent");
+    complete_dma();
+    frame_parser_reset(&parser);
+    for (i = 0; i < sent_size; i++) {
+        parsed = frame_parse(&parser, sent[i]);
+    }
+    TEST_ASSERT(parsed && parser.type == FRAME_TYPE_STATUS && parser.length == sizeof(status), "Status frame not parsed");
+    (void) memcpy(&status, parser.payload, sizeof(status));
+    TEST_ASSERT(status.sequence == 0 && status.alive_minutes == 600 && status.fsw_stats.switchI2CErrors == 5, "Counts wrong");
+    TEST_ASSERT(status.readings[0] == 11 && status.readings[3] == -1234 && status.readings[TELEMETRY_READING_COUNT - 1] == 40,
+                "Readings wrong");
+    TEST_ASSERT(status.alarms[0] == ALARM_LATCH && status.alarms[TELEMETRY_ALARM_COUNT - 1] == ALARM_SET, "Alarms wrong");
+    TEST_ASSERT(status.stage_last[PROFILE_STAGE_DISPLAY] == 96 && status.stage_max[PROFILE_STAGE_DISPLAY] == 4800,
+                "Stage timings wrong");
+    TEST_ASSERT(status.power_state == POWER_ON_STATE, "Power state wrong");
+    TEST_ASSERT(status.load == 125, "Load wrong");
+    return 0;
+}
+
+int test_telemetry_stream() {
+    TEST_START("telemetry frames stream across ring wraps");
+    uint32_t errors = 0;
+    uint32_t i = 0;
+    reset_telemetry();
+    for (i = 0; i < 100; i++) {
+        telemetry_cycle();
+        drain_dma();
+    }
+    TEST_ASSERT(dma_test_starts > 100, "Wrapped frames not split into two transfers");
+    TEST_ASSERT(parse_sent(0, &errors) == 100 && errors == 0 && telemetry_dropped() == 0, "Frames lost");
+    // Slow host, one transfer completed per cycle, drops whole frames only
+    reset_telemetry();
+    for (i = 0; i < 100; i++) {
+        telemetry_cycle();
+        if (i & 1) {
+            complete_dma();
+        }
+    }
+    drain_dma();
+    TEST_ASSERT(telemetry_dropped() > 0, "Slow host did not drop frames");
+    FrameParser parser;
+    uint32_t frames = 0;
+    uint32_t last = 0;
+    frame_parser_reset(&parser);
+    for (i = 0; i < sent_size; i++) {
+        if (frame_parse(&parser, sent[i])) {
+            TelemetryStatus status;
+            (void) memcpy(&status, parser.payload, sizeof(status));
+            TEST_ASSERT((frames == 0) || (status.sequence > last), "Frames out of order");
+            last = status.sequence;
+            frames++;
+        }
+    }
+    TEST_ASSERT(parser.errors == 0 && (frames + telemetry_dropped()) == 100, "Frames corrupted by a full ring");
+    return 0;
+}
+
+int test_telemetry_stalled() {
+    TEST_START("telemetry never waits on a stalled transfer");
+    uint32_t errors = 0;
+    uint32_t i = 0;
+    reset_telemetry();
+    // Host not reading, the transfer never completes
+    for (i = 0; i <= TELEMETRY_STALL_CYCLES; i++) {
+        telemetry_cycle();
+    }
+    TEST_ASSERT(dma_test_starts == 1 && dma_test_aborts == 0, "Transfer restarted while on the DMA");
+    TEST_ASSERT(telemetry_dropped() > 0, "Full ring did not drop frames");
+    telemetry_cycle();
+    TEST_ASSERT(dma_test_aborts == 1, "Stalled transfer not aborted");
+    // Sending resumes from the frame of the aborting cycle
+    sent_size = 0;
+    drain_dma();
+    TEST_ASSERT(parse_sent(TELEMETRY_STALL_CYCLES + 1, &errors) == 1 && errors == 0, "Sending did not resume");
+    // A transfer that fails to start is retried with the next frame
+    dma_test_status = HAL_ERROR;
+    telemetry_cycle();
+    dma_test_status = HAL_OK;
+    sent_size = 0;
+    telemetry_cycle();
+    drain_dma();
+    TEST_ASSERT(parse_sent(TELEMETRY_STALL_CYCLES + 2, &errors) == 2 && errors == 0, "Failed start not retried");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_frame_resync);
+    TEST(test_telemetry_status);
+    TEST(test_telemetry_stream);
+    TEST(test_telemetry_stalled);
+}
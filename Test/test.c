@@ -8,6 +8,17 @@ uint8_t SW_ASSERT_FLAG = 0;
 #undef EXTERN
 
 int GPIO_READ_TEST_VALUE = 1;
+int SPI_TRANSMIT_TEST_COUNT = 0;
+int I2C_WRITE_TEST_COUNT = 0;
+int I2C_READ_TEST_COUNT = 0;
+unsigned char I2C_READ_TEST_REGS[256];
+unsigned int HAL_TICK_TEST_VALUE = 0;
+int I2C_TEST_DEFER_COMPLETE = 0;
+unsigned char I2C_TEST_REG_POINTER = 0;
+unsigned char I2C_TEST_EEPROM[32768];              // EEPROM contents, 512 pages of 64 bytes
+unsigned int I2C_TEST_EEPROM_PAGE_WRITES[512];     // Writes made to each EEPROM page
+unsigned short I2C_TEST_EEPROM_POINTER = 0;
+int I2C_TEST_EEPROM_BUSY = 0;                      // Following EEPROM addresses not acknowledged
 
 // To resolve symbols:
 
@@ -45,7 +56,99 @@ HAL_StatusTypeDef sound_pwm_stop(TIM_HandleTypeDef* tim1) {
     return 0;
 }
 
+int CONTROLLER_TXRX_TEST_STATUS = HAL_OK;
+controller_packet_t CONTROLLER_TXRX_TEST_PACKET;
+
 HAL_StatusTypeDef if_txrx_packet(SPI_HandleTypeDef* spi_handle, panel_packet_t* outgoing, controller_packet_t* incoming, uint32_t timeout)
 {
-    return 0;
+    // A failed exchange leaves partial data behind
+    if (CONTROLLER_TXRX_TEST_STATUS != HAL_OK) {
+        (void) memset(incoming, 0xA5, sizeof(controller_packet_t));
+        return CONTROLLER_TXRX_TEST_STATUS;
+    }
+    (void) memcpy(incoming, &CONTROLLER_TXRX_TEST_PACKET, sizeof(controller_packet_t));
+    return HAL_OK;
+}
+
+// I2C queue completion, only linked into tests that include the queue
+void i2c_queue_complete(HAL_StatusTypeDef status) __attribute__((weak));
+
+/**
+ * Complete an interrupt driven I2C frame immediately, unless the test completes it by hand.
+ */
+int i2c_test_complete_status(HAL_StatusTypeDef status) {
+    if (!I2C_TEST_DEFER_COMPLETE && (i2c_queue_complete != NULL)) {
+        i2c_queue_complete(status);
+    }
+    return HAL_OK;
+}
+
+int i2c_test_complete(void) {
+    return i2c_test_complete_status(HAL_OK);
+}
+
+/**
+ * EEPROM side of the I2C fakes. Addresses are two bytes, and writes are stored into I2C_TEST_EEPROM.
+ */
+int i2c_test_eeprom_transmit(unsigned char* data, unsigned short size, unsigned int options) {
+    if ((options == I2C_FIRST_FRAME) || (options == I2C_FIRST_AND_NEXT_FRAME)) {
+        // Device in its write cycle does not acknowledge
+        if (I2C_TEST_EEPROM_BUSY > 0) {
+            I2C_TEST_EEPROM_BUSY--;
+            return i2c_test_complete_status(HAL_ERROR);
+        }
+        I2C_TEST_EEPROM_POINTER = ((data[0] << 8) | data[1]) % sizeof(I2C_TEST_EEPROM);
+    } else {
+        // Writes must stay within a page, as the device wraps within the page
+        if (((I2C_TEST_EEPROM_POINTER % 64) + size) > 64) {
+            printf("EEPROM write of %d bytes at 0x%04x crosses a page\n", size, I2C_TEST_EEPROM_POINTER);
+            SW_ASSERT_FLAG = 1;
+        } else {
+            (void) memcpy(&I2C_TEST_EEPROM[I2C_TEST_EEPROM_POINTER], data, size);
+            I2C_TEST_EEPROM_PAGE_WRITES[I2C_TEST_EEPROM_POINTER / 64]++;
+        }
+        I2C_WRITE_TEST_COUNT++;
+    }
+    return i2c_test_complete();
+}
+
+int i2c_test_seq_transmit(unsigned short addr, unsigned char* data, unsigned short size, unsigned int options) {
+    if (addr == (0x50 << 1)) {
+        return i2c_test_eeprom_transmit(data, size, options);
+    }
+    // A first frame carries the register address, read and write data follow from it in I2C_READ_TEST_REGS
+    if ((options == I2C_FIRST_FRAME) || (options == I2C_FIRST_AND_NEXT_FRAME)) {
+        I2C_TEST_REG_POINTER = data[size - 1];
+    } else {
+        I2C_WRITE_TEST_COUNT++;
+    }
+    return i2c_test_complete();
+}
+
+/**
+ * Blocking register access, reads come from I2C_READ_TEST_REGS and writes are only counted.
+ */
+int i2c_test_mem_read(unsigned short addr, unsigned short reg, unsigned char* data, unsigned short size) {
+    I2C_READ_TEST_COUNT++;
+    (void) memcpy(data, &I2C_READ_TEST_REGS[reg], size);
+    return HAL_OK;
+}
+
+int i2c_test_mem_write(unsigned short addr, unsigned short reg, unsigned char* data, unsigned short size) {
+    I2C_WRITE_TEST_COUNT++;
+    return HAL_OK;
+}
+
+int gpio_test_read_pin(unsigned short pin) {
+    return GPIO_READ_TEST_VALUE;
+}
+
+int i2c_test_seq_receive(unsigned short addr, unsigned char* data, unsigned short size) {
+    I2C_READ_TEST_COUNT++;
+    if (addr == (0x50 << 1)) {
+        (void) memcpy(data, &I2C_TEST_EEPROM[I2C_TEST_EEPROM_POINTER], size);
+        return i2c_test_complete();
+    }
+    (void) memcpy(data, &I2C_READ_TEST_REGS[I2C_TEST_REG_POINTER], size);
+    return i2c_test_complete();
 }
@@ -0,0 +1,68 @@
+/**
+ * trace_replay.c:
+ *
+ * Host replay of a trace captured from the debug UART. Reads the raw byte stream, as captured from the UART with the
+ * panel built with TRACE_FROM_BOOT set, replays the trace frames through the panel's modules, and reports the cycles
+ * where the replayed display or alarms differ from the panel's. Exits non-zero on a difference.
+ *
+ * Usage (from the Test directory): make -f Makefile.trace trace_replay && bin/trace_replay [-v] < uart.bin
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <test.h>
+#include <replay.h>
+#include <ventilator/command.h>
+
+extern int GPIO_READ_TEST_VALUE;
+
+// Driver functions of the linked modules, the replay does not run the UART
+HAL_StatusTypeDef telemetry_dma_start(const uint8_t* data, uint16_t size) {
+    return HAL_OK;
+}
+
+void telemetry_dma_abort(void) {}
+
+uint32_t profiler_timestamp(void) {
+    return 0;
+}
+
+void replay_set_low_battery(bool low) {
+    GPIO_READ_TEST_VALUE = low ? GPIO_PIN_RESET : GPIO_PIN_SET;
+}
+
+int main(int argc, char** argv) {
+    ReplayStats stats;
+    uint32_t capacity = 1 << 20;
+    uint32_t size = 0;
+    uint8_t* data = malloc(capacity);
+    size_t count = 0;
+    (void) memset(&stats, 0, sizeof(stats));
+    stats.verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+    // Read the whole capture, growing the buffer as needed
+    while ((data != NULL) && ((count = fread(&data[size], 1, capacity - size, stdin)) > 0)) {
+        size += (uint32_t)count;
+        if (size == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    if (data == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
+    replay_init(&stats);
+    replay_stream(data, size, &stats);
+    free(data);
+    if (!stats.from_boot) {
+        fprintf(stderr, "Trace does not start from boot, expect differences until the state converges\n");
+    }
+    printf("%u records, %u malformed, %u gaps, %u unsynced, %u display diffs, %u alarm diffs",
+           stats.records, stats.malformed, stats.gaps, stats.unsynced, stats.display_diffs, stats.alarm_diffs);
+    if (stats.first_diff_cycle != 0) {
+        printf(", first at cycle %u", stats.first_diff_cycle);
+    }
+    printf("\n");
+    return ((stats.display_diffs + stats.alarm_diffs) == 0) ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/**
+ * trace_test.c:
+ *
+ * Test the trace capture sends a record every cycle while capturing, carries the controller packet only when it
+ * changed or at a keyframe, and sends a packet again when its record was dropped by the telemetry ring.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/trace.h>
+#include <ventilator/telemetry.h>
+#include <ventilator/panel_public.h>
+
+extern int GPIO_READ_TEST_VALUE;
+
+controller_packet_t packet_test;
+Display display_test;
+uint16_t reading_test = 0;
+bool detected_test = false;
+bool dma_test_busy = false;
+const uint8_t* dma_test_data = NULL;
+uint16_t dma_test_size = 0;
+uint8_t sent[1 << 16];
+uint32_t sent_size = 0;
+
+uint32_t profiler_timestamp(void) {
+    return 0;
+}
+
+HAL_StatusTypeDef telemetry_dma_start(const uint8_t* data, uint16_t size) {
+    dma_test_busy = true;
+    dma_test_data = data;
+    dma_test_size = size;
+    return HAL_OK;
+}
+
+void telemetry_dma_abort(void) {
+    dma_test_busy = false;
+}
+
+const controller_packet_t* controller_last_packet(void) {
+    return &packet_test;
+}
+
+bool button_reading(uint16_t* reading) {
+    *reading = reading_test;
+    return detected_test;
+}
+
+const Display* display_image(void) {
+    return &display_test;
+}
+
+/**
+ * Run a cycle of the trace, sending the records unless the UART is stalled.
+ * TraceRecord* record: (output) record sent, zeroed past its length
+ * return: payload length of the record sent, zero without one
+ */
+uint8_t run_cycle(HAL_StatusTypeDef status, bool attached, bool stalled, TraceRecord* record) {
+    FrameParser parser;
+    uint32_t i = 0;
+    uint8_t length = 0;
+    sent_size = 0;
+    trace_cycle(status, attached);
+    while (dma_test_busy && !stalled) {
+        dma_test_busy = false;
+        (void) memcpy(&sent[sent_size], dma_test_data, dma_test_size);
+        sent_size += dma_test_size;
+        telemetry_sent();
+    }
+    (void) memset(record, 0, sizeof(TraceRecord));
+    frame_parser_reset(&parser);
+    for (i = 0; i < sent_size; i++) {
+        if (frame_parse(&parser, sent[i]) && (parser.type == FRAME_TYPE_TRACE)) {
+            length = parser.length;
+            (void) memcpy(record, parser.payload, length);
+        }
+    }
+    return length;
+}
+
+/**
+ * Reset the trace and its inputs.
+ */
+void reset_trace(bool capture) {
+    (void) memset(&packet_test, 0, sizeof(packet_test));
+    (void) memset(&display_test, 0, sizeof(display_test));
+    (void) memset(&p_numericalValues, 0, sizeof(p_numericalValues));
+    p_powerState = POWER_OFF_STATE;
+    p_aliveMinutes = 0;
+    reading_test = 0;
+    detected_test = false;
+    dma_test_busy = false;
+    GPIO_READ_TEST_VALUE = GPIO_PIN_SET;
+    telemetry_init();
+    trace_init(capture);
+}
+
+int test_trace_capture() {
+    TEST_START("trace records every cycle while capturing, starting with the packet");
+    TraceRecord record;
+    uint32_t i = 0;
+    reset_trace(false);
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == 0, "Record sent before capturing");
+    }
+    // Cycles are counted from init, so a late capture shows it did not start from boot
+    trace_capture(true);
+    packet_test.sensors.pressure_patient = 1234;
+    TEST_ASSERT(run_cycle(HAL_OK, false, false, &record) == sizeof(TraceRecord), "Capture not started with the packet");
+    TEST_ASSERT(record.cycle == 4 && record.flags == (TRACE_FLAG_CONTROLLER_OK | TRACE_FLAG_PACKET | TRACE_FLAG_START),
+                "Bad start record");
+    TEST_ASSERT(record.packet.sensors.pressure_patient == 1234, "Packet not recorded");
+    // Inputs and outputs of the cycle
+    detected_test = true;
+    reading_test = 0x2000;
+    GPIO_READ_TEST_VALUE = GPIO_PIN_RESET;
+    p_aliveMinutes = 185;
+    p_powerState = POWERING_STATE;
+    p_numericalValues.alarms.peep.status = ALARM_LATCH;
+    TEST_ASSERT(run_cycle(HAL_TIMEOUT, true, false, &record) == TRACE_RECORD_SHORT_SIZE, "Unchanged packet sent");
+    TEST_ASSERT(record.cycle == 5 && record.flags == (TRACE_FLAG_ATTACHED | TRACE_FLAG_BUTTONS | TRACE_FLAG_LOW_BATTERY),
+                "Bad flags");
+    TEST_ASSERT(record.buttons == 0x2000 && record.alive_hours == 3 && record.power_state == POWERING_STATE, "Bad inputs");
+    TEST_ASSERT(record.alarms[offsetof(Alarms, peep) / sizeof(Alarm)] == ALARM_LATCH, "Alarm not recorded");
+    TEST_ASSERT(record.display_crc == trace_display_crc(), "Display checksum not recorded");
+    // The checksum covers the bargraph
+    ((uint8_t*)&display_test.red_green_red)[0] = 0x10;
+    TEST_ASSERT(trace_display_crc() != record.display_crc, "Bargraph not in the checksum");
+    // Buttons are only recorded with the controller attached
+    TEST_ASSERT(run_cycle(HAL_OK, false, false, &record) == TRACE_RECORD_SHORT_SIZE, "Record not sent");
+    TEST_ASSERT(record.flags == (TRACE_FLAG_CONTROLLER_OK | TRACE_FLAG_LOW_BATTERY) && record.buttons == 0,
+                "Buttons recorded while detached");
+    trace_capture(false);
+    TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == 0, "Record sent after the capture stopped");
+    return 0;
+}
+
+int test_trace_compaction() {
+    TEST_START("trace sends the packet only when it changed, at keyframes, and after it was dropped");
+    TraceRecord record;
+    uint32_t i = 0;
+    reset_trace(true);
+    TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == sizeof(TraceRecord), "First record without the packet");
+    TEST_ASSERT(record.cycle == 1 && (record.flags & TRACE_FLAG_START) != 0, "Capture from boot not started");
+    // A keyframe every TRACE_KEYFRAME_CYCLES records
+    for (i = 1; i < TRACE_KEYFRAME_CYCLES; i++) {
+        TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == TRACE_RECORD_SHORT_SIZE, "Unchanged packet sent");
+    }
+    TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == sizeof(TraceRecord) &&
+                record.flags == (TRACE_FLAG_CONTROLLER_OK | TRACE_FLAG_ATTACHED | TRACE_FLAG_PACKET), "No keyframe");
+    // A changed packet is sent, and restarts the countdown
+    packet_test.sensors.fio2 = 21000;
+    TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == sizeof(TraceRecord) && record.packet.sensors.fio2 == 21000,
+                "Changed packet not sent");
+    TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == TRACE_RECORD_SHORT_SIZE, "Unchanged packet sent");
+    // A stalled UART fills the ring, and a changed packet dropped with its record is sent again once it drains
+    for (i = 0; i < ((TELEMETRY_RING_SIZE / (TRACE_RECORD_SHORT_SIZE + FRAME_OVERHEAD)) + 1); i++) {
+        (void) run_cycle(HAL_OK, true, true, &record);
+    }
+    TEST_ASSERT(telemetry_dropped() > 0, "Ring did not fill");
+    packet_test.sensors.fio2 = 50000;
+    uint32_t dropped = telemetry_dropped();
+    (void) run_cycle(HAL_OK, true, true, &record);
+    TEST_ASSERT(telemetry_dropped() == (dropped + 1), "Changed packet not dropped");
+    telemetry_dma_abort();
+    telemetry_init();
+    TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == sizeof(TraceRecord) && record.packet.sensors.fio2 == 50000,
+                "Dropped packet not sent again");
+    TEST_ASSERT(run_cycle(HAL_OK, true, false, &record) == TRACE_RECORD_SHORT_SIZE, "Delivered packet sent again");
+    return 0;
+}
+
+int main() {
+    TEST(test_trace_capture);
+    TEST(test_trace_compaction);
+}
@@ -0,0 +1,46 @@
+/**
+ * trend_decoder.c:
+ *
+ * Host decoder of the trend log. Reads pages as dumped from the debug UART, EEPROM_PAGE_SIZE bytes each from the
+ * oldest page, and prints a CSV line per minute with the alarm transitions of the minute.
+ *
+ * Usage (from the Test directory): make -f Makefile.trend trend_decoder && bin/trend_decoder < pages.bin
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <ventilator/trend.h>
+
+const char* QUANTITY_NAMES[TREND_QUANTITY_COUNT] = {"pressure", "tidal_volume_last", "resp_rate", "FIO2"};
+const char* ALARM_NAMES[TREND_ALARM_COUNT] = {
+    "disconnect", "tidal_vol", "peak_press", "resp_rate", "peep", "fio2", "machine_fault", "low_power", "power_off"
+};
+const char* STATUS_NAMES[] = {"off", "set", "latch", "blink"};
+
+int main(int argc, char** argv) {
+    uint8_t page[EEPROM_PAGE_SIZE];
+    TrendRecord records[EEPROM_PAGE_SIZE];
+    uint32_t i = 0, j = 0;
+    printf("minute");
+    for (i = 0; i < TREND_QUANTITY_COUNT; i++) {
+        printf(",%s_min,%s_max,%s_mean", QUANTITY_NAMES[i], QUANTITY_NAMES[i], QUANTITY_NAMES[i]);
+    }
+    printf(",alarms\n");
+    while (fread(page, sizeof(page), 1, stdin) == 1) {
+        uint32_t count = trend_decode(page, records, ARRAY_LEN(records));
+        for (i = 0; i < count; i++) {
+            printf("%u", records[i].minute);
+            for (j = 0; j < TREND_QUANTITY_COUNT; j++) {
+                const TrendAggregate* aggregate = &records[i].aggregates[j];
+                printf(",%d,%d,%d", aggregate->min, aggregate->max, aggregate->mean);
+            }
+            printf(",");
+            for (j = 0; j < records[i].event_count; j++) {
+                const TrendEvent* event = &records[i].events[j];
+                const char* status = (event->status < ARRAY_LEN(STATUS_NAMES)) ? STATUS_NAMES[event->status] : "blink";
+                printf("%s%s=%s", (j == 0) ? "" : " ", ALARM_NAMES[event->alarm % TREND_ALARM_COUNT], status);
+            }
+            printf("\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+/**
+ * trend_test.c:
+ *
+ * Test the trend log aggregates minutes, encodes records compactly, writes without waiting, and keeps hours of history
+ * in its ring of pages.
+ */
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+#include <ventilator/trend.h>
+#include <ventilator/i2c_queue.h>
+
+extern uint32_t m_trend_dropped;
+extern uint32_t m_trend_fill;
+extern uint32_t m_trend_sequence;
+
+uint32_t trend_encode(const TrendRecord* record, const TrendRecord* previous, uint8_t* data);
+bool trend_decode_record(const uint8_t* data, const TrendRecord* previous, TrendRecord* record);
+uint16_t trend_address(uint32_t sequence);
+
+/**
+ * Erase the EEPROM and start an empty log.
+ */
+void reset_trend(void) {
+    i2c_queue_init();
+    I2C_TEST_DEFER_COMPLETE = 0;
+    I2C_TEST_EEPROM_BUSY = 0;
+    (void) memset(I2C_TEST_EEPROM, 0xFF, sizeof(I2C_TEST_EEPROM));
+    (void) memset(I2C_TEST_EEPROM_PAGE_WRITES, 0, sizeof(I2C_TEST_EEPROM_PAGE_WRITES));
+    trend_init();
+    m_trend_dropped = 0;
+}
+
+/**
+ * Read a page of the log straight from the EEPROM, checking its sequence.
+ */
+EepromStatus read_page(uint32_t age, uint8_t* data) {
+    uint32_t count = trend_page_count();
+    if (age >= count) {
+        return EEPROM_ERROR;
+    }
+    uint32_t sequence = m_trend_sequence + ((m_trend_fill != 0) ? 1 : 0) - count + age;
+    EepromStatus status = eeprom_read_bytes(trend_address(sequence), data, EEPROM_PAGE_SIZE);
+    if ((status == EEPROM_OK) && (memcmp(data, &sequence, sizeof(uint32_t)) != 0)) {
+        status = EEPROM_ERROR;
+    }
+    return status;
+}
+
+/**
+ * Run cycles of the trend and EEPROM writes.
+ */
+void run_cycles(uint32_t cycles) {
+    uint32_t i = 0;
+    for (i = 0; i < cycles; i++) {
+        eeprom_cycle();
+        trend_cycle();
+    }
+}
+
+/**
+ * Sample a minute of steady breathing, varied by the minute.
+ */
+void sample_minute(uint32_t minute, uint32_t samples) {
+    NumericalValues values;
+    uint32_t i = 0;
+    (void) memset(&values, 0, sizeof(values));
+    for (i = 0; i < samples; i++) {
+        values.pressure.val = 500 + (int32_t)((i * 7) % 2000) + (int32_t)(minute % 13);
+        values.tidal_volume_last.val = 400 + (int32_t)(minute % 5);
+        values.resp_rate.val = 12 + (int32_t)((minute / 60) % 3);
+        values.FIO2.val = 40;
+        trend_sample(&values);
+    }
+}
+
+int test_trend_encoding() {
+    TEST_START("trend records decode to the encoded values");
+    uint8_t data[TREND_RECORD_MAX_SIZE];
+    TrendRecord previous;
+    TrendRecord record;
+    TrendRecord decoded;
+    uint32_t i = 0;
+    (void) memset(&previous, 0, sizeof(previous));
+    (void) memset(&record, 0, sizeof(record));
+    previous.minute = 100;
+    record.minute = 101;
+    for (i = 0; i < TREND_QUANTITY_COUNT; i++) {
+        previous.aggregates[i].min = INT32_MAX;
+        previous.aggregates[i].max = -5;
+        record.aggregates[i].min = INT32_MIN;
+        record.aggregates[i].max = 3;
+        record.aggregates[i].mean = -63;
+    }
+    record.event_count = TREND_EVENTS_MAX;
+    for (i = 0; i < TREND_EVENTS_MAX; i++) {
+        record.events[i].alarm = TREND_ALARM_COUNT - 1 - i;
+        record.events[i].status = ALARM_BLINK_ON;
+    }
+    // Extremes, wrapping deltas
+    uint32_t size = trend_encode(&record, &previous, data);
+    TEST_ASSERT(size <= TREND_RECORD_MAX_SIZE && data[0] == size, "Record size wrong");
+    TEST_ASSERT(trend_decode_record(data, &previous, &decoded), "Record not decoded");
+    TEST_ASSERT(memcmp(&decoded, &record, sizeof(record)) == 0, "Decoded record differs");
+    TEST_ASSERT(trend_encode(&record, NULL, data) > 0 && trend_decode_record(data, NULL, &decoded), "First record not decoded");
+    TEST_ASSERT(memcmp(&decoded, &record, sizeof(record)) == 0, "Decoded first record differs");
+    // Small deltas take a byte each
+    decoded = record;
+    decoded.minute += 1;
+    decoded.aggregates[TREND_PRESSURE].mean += 20;
+    decoded.event_count = 0;
+    TEST_ASSERT(trend_encode(&decoded, &record, data) == (1 + 1 + (TREND_QUANTITY_COUNT * 3) + 1), "Deltas not compact");
+    // Truncated
+    data[0] -= 1;
+    TEST_ASSERT(!trend_decode_record(data, &record, &decoded), "Truncated record decoded");
+    return 0;
+}
+
+int test_trend_minute() {
+    TEST_START("trend minute aggregates the samples and alarm transitions");
+    NumericalValues values;
+    uint8_t page[EEPROM_PAGE_SIZE];
+    TrendRecord records[4];
+    int32_t i = 0;
+    reset_trend();
+    (void) memset(&values, 0, sizeof(values));
+    for (i = 1; i <= 100; i++) {
+        values.pressure.val = i;
+        values.tidal_volume_last.val = -i;
+        values.resp_rate.val = 12;
+        values.FIO2.val = 21 + (i & 1);
+        // Blinking is not a transition
+        values.alarms.fio2.status = (i < 50) ? ALARM_OFF : ((i & 1) ? ALARM_BLINK_ON : ALARM_BLINK_OFF);
+        values.alarms.peep.status = (i < 90) ? ALARM_SET : ALARM_LATCH;
+        trend_sample(&values);
+    }
+    I2C_WRITE_TEST_COUNT = 0;
+    trend_minute(42);
+    TEST_ASSERT(I2C_WRITE_TEST_COUNT == 0, "Minute waited on the EEPROM");
+    TEST_ASSERT(trend_page_count() == 0, "Page opened before the cycle");
+    run_cycles(1);
+    TEST_ASSERT(I2C_WRITE_TEST_COUNT == 1 && I2C_TEST_EEPROM_PAGE_WRITES[EEPROM_TREND_FIRST_PAGE] == 1, "Page not written");
+    run_cycles(1);
+    TEST_ASSERT(trend_page_count() == 1 && read_page(0, page) == EEPROM_OK, "Page not read");
+    TEST_ASSERT(trend_decode(page, records, 4) == 1, "Record not decoded");
+    TEST_ASSERT(records[0].minute == 42, "Minute wrong");
+    TEST_ASSERT(records[0].aggregates[TREND_PRESSURE].min == 1 && records[0].aggregates[TREND_PRESSURE].max == 100 &&
+                records[0].aggregates[TREND_PRESSURE].mean == 50, "Pressure aggregate wrong");
+    TEST_ASSERT(records[0].aggregates[TREND_TIDAL_VOLUME].min == -100 && records[0].aggregates[TREND_TIDAL_VOLUME].max == -1,
+                "Tidal volume aggregate wrong");
+    TEST_ASSERT(records[0].aggregates[TREND_RESP_RATE].mean == 12 && records[0].aggregates[TREND_FIO2].max == 22,
+                "Rate or FIO2 aggregate wrong");
+    TEST_ASSERT(records[0].event_count == 3, "Transitions not counted");
+    TEST_ASSERT(records[0].events[0].alarm == 4 && records[0].events[0].status == ALARM_SET, "PEEP set not recorded");
+    TEST_ASSERT(records[0].events[1].alarm == 5 && records[0].events[1].status == ALARM_BLINK_ON, "FIO2 blink not recorded");
+    TEST_ASSERT(records[0].events[2].alarm == 4 && records[0].events[2].status == ALARM_LATCH, "PEEP latch not recorded");
+    // Nothing sampled in standby
+    trend_minute(43);
+    run_cycles(2);
+    TEST_ASSERT(read_page(0, page) == EEPROM_OK && trend_decode(page, records, 4) == 1, "Empty minute recorded");
+    return 0;
+}
+
+int test_trend_history() {
+    TEST_START("trend log keeps hours of history across its ring");
+    uint8_t page[EEPROM_PAGE_SIZE];
+    TrendRecord records[EEPROM_PAGE_SIZE];
+    uint32_t minute = 0;
+    uint32_t age = 0;
+    uint32_t expected = 0;
+    uint32_t last = 0;
+    reset_trend();
+    // Two days, enough to wrap the ring
+    for (minute = 1; minute <= (2 * 24 * 60); minute++) {
+        sample_minute(minute, 50);
+        trend_minute(minute);
+        run_cycles(3);
+    }
+    TEST_ASSERT(trend_dropped() == 0, "Records dropped");
+    TEST_ASSERT(trend_page_count() == EEPROM_TREND_PAGES, "Ring not filled");
+    for (age = 0; age < trend_page_count(); age++) {
+        TEST_ASSERT(read_page(age, page) == EEPROM_OK, "Page not read");
+        uint32_t count = trend_decode(page, records, ARRAY_LEN(records));
+        uint32_t i = 0;
+        TEST_ASSERT(count > 0, "Page without records");
+        for (i = 0; i < count; i++) {
+            expected = (age == 0 && i == 0) ? records[0].minute : (last + 1);
+            TEST_ASSERT(records[i].minute == expected, "Minutes not contiguous across the pages");
+            TEST_ASSERT(records[i].aggregates[TREND_TIDAL_VOLUME].mean == 400 + (int32_t)(expected % 5), "Value wrong");
+            last = records[i].minute;
+        }
+    }
+    TEST_ASSERT(last == (2 * 24 * 60), "Newest minute not in the log");
+    (void) read_page(0, page);
+    (void) trend_decode(page, records, ARRAY_LEN(records));
+    uint32_t history = last - records[0].minute + 1;
+    printf("Trend log holds %u minutes (%u hours) in %u pages\n", history, history / 60, EEPROM_TREND_PAGES);
+    TEST_ASSERT(history >= (12 * 60), "Less than 12 hours of history");
+    // Boot continues in the page after the newest
+    trend_init();
+    TEST_ASSERT(trend_page_count() == EEPROM_TREND_PAGES, "History lost at boot");
+    sample_minute(last + 5, 50);
+    trend_minute(last + 5);
+    run_cycles(3);
+    TEST_ASSERT(read_page(EEPROM_TREND_PAGES - 1, page) == EEPROM_OK, "New page not read");
+    TEST_ASSERT(trend_decode(page, records, ARRAY_LEN(records)) == 1 && records[0].minute == (last + 5), "Boot record lost");
+    TEST_ASSERT(read_page(EEPROM_TREND_PAGES - 2, page) == EEPROM_OK &&
+                trend_decode(page, records, ARRAY_LEN(records)) > 0, "Newest page before boot lost");
+    return 0;
+}
+
+int test_trend_failed_write() {
+    TEST_START("trend page write is retried after a failure");
+    uint8_t page[EEPROM_PAGE_SIZE];
+    TrendRecord records[4];
+    reset_trend();
+    sample_minute(1, 10);
+    trend_minute(1);
+    // Device never acknowledges the write
+    I2C_TEST_EEPROM_BUSY = 1;
+    run_cycles(1);
+    TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[EEPROM_TREND_FIRST_PAGE] == 0, "Page written while busy");
+    run_cycles(3);
+    TEST_ASSERT(read_page(0, page) == EEPROM_OK && trend_decode(page, records, 4) == 1 && records[0].minute == 1,
+                "Failed write not retried");
+    // A second record appends to the page
+    sample_minute(2, 10);
+    trend_minute(2);
+    run_cycles(3);
+    TEST_ASSERT(read_page(0, page) == EEPROM_OK && trend_decode(page, records, 4) == 2 && records[1].minute == 2,
+                "Record not appended");
+    TEST_ASSERT(I2C_TEST_EEPROM_PAGE_WRITES[EEPROM_TREND_FIRST_PAGE] == 2, "Append rewrote the whole page");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    TEST(test_trend_encoding);
+    TEST(test_trend_minute);
+    TEST(test_trend_history);
+    TEST(test_trend_failed_write);
+}